@@ -0,0 +1,32 @@
+#include "BenchUtil.hpp"
+#include <cstdlib>
+#include <new>
+
+/**
+ * \file AllocCounter.cpp
+ * Замена глобальных operator new/delete, подсчитывающая выделения памяти в
+ * бенчмарках
+ * \author dmsukhikh
+ */
+
+AllocStats &allocStats()
+{
+    static AllocStats stats;
+    return stats;
+}
+
+void *operator new(std::size_t size)
+{
+    allocStats().count++;
+    allocStats().bytes += size;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
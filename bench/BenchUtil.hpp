@@ -0,0 +1,71 @@
+#ifndef __BENCH_UTIL
+#define __BENCH_UTIL
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \file BenchUtil.hpp
+ * Вспомогательные средства для бенчмарков: замер времени и подсчет выделений
+ * памяти
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Счетчики выделений памяти
+ * \details Заполняются замененными operator new/delete из AllocCounter.cpp
+ */
+struct AllocStats
+{
+    std::size_t count{0}; ///< Количество вызовов operator new
+    std::size_t bytes{0}; ///< Суммарный объем выделенной памяти
+};
+
+/**
+ * \brief Текущие значения счетчиков выделений
+ * \return Ссылка на глобальные счетчики
+ */
+AllocStats &allocStats();
+
+/**
+ * \brief Замер одного запуска
+ * \details Запоминает время и счетчики выделений при создании, разности
+ * возвращаются методами seconds() и allocs()
+ */
+class BenchScope
+{
+    std::chrono::steady_clock::time_point _start;
+    AllocStats _allocs;
+
+  public:
+    BenchScope()
+        : _start(std::chrono::steady_clock::now()), _allocs(allocStats())
+    {
+    }
+
+    /// Время с момента создания в секундах
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             _start)
+            .count();
+    }
+
+    /// Выделения памяти с момента создания
+    AllocStats allocs() const
+    {
+        return {allocStats().count - _allocs.count,
+                allocStats().bytes - _allocs.bytes};
+    }
+};
+
+/**
+ * \brief Защита результата от удаления оптимизатором
+ */
+template <typename T> void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#endif
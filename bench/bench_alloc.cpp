@@ -0,0 +1,92 @@
+#include "BenchUtil.hpp"
+#include <MatrixAllocator.hpp>
+#include <MatrixGeneric.hpp>
+#include <cstdio>
+
+/**
+ * \file bench_alloc.cpp
+ * Бенчмарк распределителей памяти: серия одинаковых "запросов" (сложение,
+ * произведение, обращение, транспонирование, степень) над матрицами в куче,
+ * в арене, очищаемой после каждого запроса, и в пуле
+ * \author dmsukhikh
+ */
+
+constexpr uint32_t requests = 20000;
+
+template <typename M> M input(uint32_t n, double shift)
+{
+    M out(n, n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t j = 0; j < n; ++j)
+            out.get(i, j) = (i == j ? n : 0.01 * (i + 2 * j)) + shift;
+    }
+    return out;
+}
+
+/// Один запрос: для ResourceMatrix все матрицы берут память из источника
+/// текущего потока
+template <typename M> double request(uint32_t n)
+{
+    M a = input<M>(n, 0), b = input<M>(n, 1e-3);
+    M c = a + b;
+    M d = c * a.inverse();
+    M e = d.transpose().pow(3) - 2.0 * a;
+    return e.get(0, 0) + d.det();
+}
+
+void report(uint32_t n, const char *type, const BenchScope &scope)
+{
+    std::printf("%ux%-4u %-8s %12.1f %12.2f\n", n, n, type,
+                double(scope.allocs().count) / requests,
+                scope.seconds() * 1e6 / requests);
+}
+
+void run(uint32_t n)
+{
+    {
+        BenchScope scope;
+        double sum = 0;
+        for (uint32_t i = 0; i < requests; ++i)
+            sum += request<MatrixGeneric<double>>(n);
+        doNotOptimize(sum);
+        report(n, "heap", scope);
+    }
+    {
+        ArenaResource arena;
+        ResourceScope resource(&arena);
+        request<ResourceMatrix<double>>(n);
+        arena.reset();
+
+        BenchScope scope;
+        double sum = 0;
+        for (uint32_t i = 0; i < requests; ++i)
+        {
+            sum += request<ResourceMatrix<double>>(n);
+            arena.reset();
+        }
+        doNotOptimize(sum);
+        report(n, "arena", scope);
+    }
+    {
+        PoolResource pool;
+        ResourceScope resource(&pool);
+        request<ResourceMatrix<double>>(n);
+
+        BenchScope scope;
+        double sum = 0;
+        for (uint32_t i = 0; i < requests; ++i)
+            sum += request<ResourceMatrix<double>>(n);
+        doNotOptimize(sum);
+        report(n, "pool", scope);
+    }
+}
+
+int main()
+{
+    std::printf("%-6s %-8s %12s %12s\n", "size", "alloc", "allocs/req",
+                "us/req");
+    run(4);
+    run(16);
+    run(64);
+}
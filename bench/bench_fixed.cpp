@@ -0,0 +1,109 @@
+#include "BenchUtil.hpp"
+#include <FixedMatrix.hpp>
+#include <MatrixGeneric.hpp>
+#include <cstdio>
+
+/**
+ * \file bench_fixed.cpp
+ * Бенчмарк маленьких матриц: умножение, определитель и обращение матриц
+ * 2x2-4x4 в FixedMatrix и MatrixGeneric по времени и выделениям памяти
+ * \author dmsukhikh
+ */
+
+constexpr uint32_t iterations = 1000000;
+
+template <uint32_t N> FixedMatrix<double, N, N> transform(double shift)
+{
+    FixedMatrix<double, N, N> out;
+    for (uint32_t i = 0; i < N; ++i)
+    {
+        for (uint32_t j = 0; j < N; ++j)
+            out.get(i, j) = (i == j ? 1.0 : 0.01 * (i + 2 * j)) + shift;
+    }
+    return out;
+}
+
+void report(uint32_t n, const char *op, const char *type,
+            const BenchScope &scope)
+{
+    std::printf("%ux%-4u %-8s %-14s %10zu %12.1f\n", n, n, op, type,
+                scope.allocs().count, scope.seconds() * 1e9 / iterations);
+}
+
+template <uint32_t N> void run()
+{
+    FixedMatrix<double, N, N> fixed = transform<N>(0), step = transform<N>(1e-3);
+    MatrixGeneric<double> generic = fixed, genericStep = step;
+
+    {
+        BenchScope scope;
+        FixedMatrix<double, N, N> acc = fixed;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            acc = acc * step;
+            doNotOptimize(acc);
+        }
+        report(N, "mul", "FixedMatrix", scope);
+    }
+    {
+        BenchScope scope;
+        MatrixGeneric<double> acc = generic;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            acc = acc * genericStep;
+            doNotOptimize(acc.data());
+        }
+        report(N, "mul", "MatrixGeneric", scope);
+    }
+    {
+        BenchScope scope;
+        double sum = 0;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            fixed.get(0, 0) = 1.0 + i * 1e-9;
+            sum += fixed.det();
+        }
+        doNotOptimize(sum);
+        report(N, "det", "FixedMatrix", scope);
+    }
+    {
+        BenchScope scope;
+        double sum = 0;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            generic.get(0, 0) = 1.0 + i * 1e-9;
+            sum += generic.det();
+        }
+        doNotOptimize(sum);
+        report(N, "det", "MatrixGeneric", scope);
+    }
+    {
+        BenchScope scope;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            fixed.get(0, 0) = 1.0 + i * 1e-9;
+            auto inv = fixed.inverse();
+            doNotOptimize(inv);
+        }
+        report(N, "inverse", "FixedMatrix", scope);
+    }
+    {
+        BenchScope scope;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            generic.get(0, 0) = 1.0 + i * 1e-9;
+            auto inv = generic.inverse();
+            doNotOptimize(inv.data());
+        }
+        report(N, "inverse", "MatrixGeneric", scope);
+    }
+}
+
+int main()
+{
+    std::printf("%-6s %-8s %-14s %10s %12s\n", "size", "op", "type", "allocs",
+                "ns/op");
+    run<2>();
+    run<3>();
+    run<4>();
+}
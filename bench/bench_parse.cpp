@@ -0,0 +1,68 @@
+#include "BenchUtil.hpp"
+#include <Calculator.hpp>
+#include <TokenReader.hpp>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+
+/**
+ * \file bench_parse.cpp
+ * Бенчмарк чтения элементов матриц: сравнение прежнего пути
+ * (`stream >> std::string` и std::stod) с TokenReader и detail::parseNumber по
+ * скорости в МБ/с и количеству выделений памяти
+ * \author dmsukhikh
+ */
+
+/// Текст из **count** чисел, разделенных пробелами и переводами строк. Числа
+/// записываются с 6 значащими цифрами, как их выводит сама утилита
+template <typename T> std::string makeText(std::size_t count)
+{
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-1000, 1000);
+    std::ostringstream out;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        out << T(dist(gen));
+        out << ((i + 1) % 1000 == 0 ? '\n' : ' ');
+    }
+    return out.str();
+}
+
+template <typename T> void run(const char *type, std::size_t count)
+{
+    const std::string text = makeText<T>(count);
+    const double mb = double(text.size()) / (1 << 20);
+    T sum = 0;
+
+    {
+        std::istringstream stream(text);
+        BenchScope scope;
+        for (std::size_t i = 0; i < count; ++i)
+            sum += getFromStream<T>(stream, "bad element");
+        double s = scope.seconds();
+        std::printf("%-8s %-12s %10.1f %10zu %12.3f\n", type, "stream", mb / s,
+                    scope.allocs().count, s * 1e3);
+    }
+    {
+        std::istringstream stream(text);
+        BenchScope scope;
+        TokenReader reader(stream);
+        for (std::size_t i = 0; i < count; ++i)
+            sum += getFromTokens<T>(reader, "bad element");
+        double s = scope.seconds();
+        std::printf("%-8s %-12s %10.1f %10zu %12.3f\n", type, "TokenReader",
+                    mb / s, scope.allocs().count, s * 1e3);
+    }
+    doNotOptimize(sum);
+}
+
+int main()
+{
+    const std::size_t count = 1000 * 1000;
+    std::printf("%-8s %-12s %10s %10s %12s\n", "type", "method", "MB/s",
+                "allocs", "time, ms");
+    run<int>("int", count);
+    run<float>("float", count);
+    run<double>("double", count);
+}
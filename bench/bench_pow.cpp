@@ -0,0 +1,81 @@
+#include "BenchUtil.hpp"
+#include <MatrixGeneric.hpp>
+#include <cstdio>
+
+/**
+ * \file bench_pow.cpp
+ * Бенчмарк MatrixGeneric::pow(): сравнение бинарного возведения в степень с
+ * последовательным перемножением по количеству умножений, выделений памяти и
+ * времени
+ * \author dmsukhikh
+ */
+
+/// Прежняя реализация pow(): power - 1 умножений с новой матрицей на каждом шаге
+template <typename T>
+MatrixGeneric<T> powLinear(const MatrixGeneric<T> &a, uint32_t power,
+                           uint32_t &multiplies)
+{
+    if (power == 0)
+        return MatrixGeneric<T>::eye(a.height());
+    MatrixGeneric<T> out(a);
+    while (power > 1)
+    {
+        out = out * a;
+        ++multiplies;
+        --power;
+    }
+    return out;
+}
+
+uint32_t squaringMultiplies(uint32_t power)
+{
+    uint32_t bits = 0, ones = 0;
+    for (uint32_t p = power; p > 1; p >>= 1)
+        ++bits;
+    for (uint32_t p = power; p; p >>= 1)
+        ones += p & 1;
+    return power == 0 ? 0 : bits + ones - 1;
+}
+
+int main()
+{
+    const uint32_t n = 64;
+    MatrixGeneric<double> a(n, n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t j = 0; j < n; ++j)
+        {
+            a.get(i, j) = (i == j ? 0.5 : 0.5 / (n - 1));
+        }
+    }
+
+    std::printf("%-8s %-9s %10s %10s %12s\n", "power", "method", "multiplies",
+                "allocs", "time, ms");
+    for (uint32_t power : {10u, 100u, 1000u, 100000u})
+    {
+        {
+            BenchScope scope;
+            auto res = a.pow(power);
+            doNotOptimize(res.data());
+            std::printf("%-8u %-9s %10u %10zu %12.3f\n", power, "squaring",
+                        squaringMultiplies(power), scope.allocs().count,
+                        scope.seconds() * 1e3);
+        }
+        if (power <= 1000)
+        {
+            uint32_t multiplies = 0;
+            BenchScope scope;
+            auto res = powLinear(a, power, multiplies);
+            doNotOptimize(res.data());
+            std::printf("%-8u %-9s %10u %10zu %12.3f\n", power, "linear",
+                        multiplies, scope.allocs().count, scope.seconds() * 1e3);
+        }
+        {
+            BenchScope scope;
+            auto res = a.powSymmetric(power);
+            doNotOptimize(res.data());
+            std::printf("%-8u %-9s %10s %10zu %12.3f\n", power, "eigen", "-",
+                        scope.allocs().count, scope.seconds() * 1e3);
+        }
+    }
+}
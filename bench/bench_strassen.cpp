@@ -0,0 +1,79 @@
+#include "BenchUtil.hpp"
+#include <MatrixGeneric.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * \file bench_strassen.cpp
+ * Бенчмарк умножения алгоритмом Штрассена-Винограда: время и отклонение от
+ * обычного умножения в зависимости от размера матриц и порога, ниже которого
+ * работает блочное ядро. По нему выбирается strassenDefaultCrossover.
+ *
+ * Наибольший размер можно передать аргументом (по умолчанию 2048)
+ * \author dmsukhikh
+ */
+
+MatrixGeneric<double> randomMatrix(uint32_t n, uint64_t seed)
+{
+    MatrixGeneric<double> out(n, n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t j = 0; j < n; ++j)
+        {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            out.get(i, j) = double(seed >> 11) / double(uint64_t(1) << 53) * 2 - 1;
+        }
+    }
+    return out;
+}
+
+/// Наибольшее отклонение от обычного произведения
+double maxDiff(const MatrixGeneric<double> &a, const MatrixGeneric<double> &b)
+{
+    double out = 0;
+    for (uint32_t i = 0; i < a.height(); ++i)
+    {
+        for (uint32_t j = 0; j < a.width(); ++j)
+            out = std::max(out, std::fabs(a.get(i, j) - b.get(i, j)));
+    }
+    return out;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t maxSize = argc > 1 ? uint32_t(std::strtoul(argv[1], nullptr, 10))
+                                : 2048;
+
+    std::printf("%-6s %-10s %12s %10s %12s\n", "size", "crossover", "time, ms",
+                "GFLOP/s", "max diff");
+    for (uint32_t n : {256u, 512u, 1000u, 1024u, 2048u, 4096u, 8192u})
+    {
+        if (n > maxSize)
+            break;
+        auto a = randomMatrix(n, 1), b = randomMatrix(n, 2);
+        double flops = 2.0 * n * n * n;
+
+        MatrixGeneric<double> classic;
+        {
+            BenchScope scope;
+            classic = a * b;
+            std::printf("%-6u %-10s %12.1f %10.2f %12s\n", n, "classic",
+                        scope.seconds() * 1e3, flops / scope.seconds() / 1e9,
+                        "-");
+        }
+        for (uint32_t crossover : {128u, 256u, 512u, 1024u})
+        {
+            if (crossover > n)
+                break;
+            BenchScope scope;
+            auto c = multiplyStrassen(a, b, crossover);
+            double seconds = scope.seconds();
+            doNotOptimize(c.data());
+            std::printf("%-6u %-10u %12.1f %10.2f %12.2e\n", n, crossover,
+                        seconds * 1e3, flops / seconds / 1e9,
+                        maxDiff(c, classic));
+        }
+    }
+}
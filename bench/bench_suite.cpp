@@ -0,0 +1,408 @@
+#include "BenchUtil.hpp"
+#include <Calculator.hpp>
+#include <MatrixGeneric.hpp>
+#include <ThreadPool.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * \file bench_suite.cpp
+ * Набор микробенчмарков всех операций MatrixGeneric (цель сборки bench):
+ * +, -, *, /, det, inverse, rk, transpose, pow и чтение и печать матриц
+ * калькулятором - для нескольких размеров и типов элементов. Для каждого
+ * замера печатаются время, GFLOP/s, GB/s и выделения памяти; результаты
+ * можно сохранить в JSON и сравнить с сохраненными ранее, чтобы найти
+ * регрессии.
+ *
+ * Использование:
+ * ```
+ * bench [--filter S] [--sizes 64,256] [--types int,float,double]
+ *       [--min-time SEC] [--json FILE] [--compare BASE [CURRENT]]
+ *       [--threshold PCT]
+ * ```
+ *  - --filter S - только замеры, в имени которых есть подстрока S
+ *  - --sizes, --types - размеры и типы элементов (по умолчанию 64,256,1024 и
+ *  int,float,double)
+ *  - --min-time SEC - наименьшее суммарное время повторов одного замера
+ *  (по умолчанию 0.2 с); в результат идет медиана повторов
+ *  - --json FILE - записать результаты в FILE
+ *  - --compare BASE - сравнить результаты с сохраненными в BASE. Если указан
+ *  и CURRENT, замеры не запускаются, а сравниваются два файла
+ *  - --threshold PCT - на сколько процентов замер может стать медленнее,
+ *  прежде чем он считается регрессией (по умолчанию 10)
+ *
+ * Код возврата: 0 - регрессий нет, 1 - есть регрессии, 2 - ошибка в
+ * аргументах или файлах
+ * \author dmsukhikh
+ */
+
+/// Описание замера: что запускать и сколько работы в одном запуске
+struct BenchCase
+{
+    std::string name;          ///< Имя вида операция/тип/размер
+    double flops;              ///< Арифметических операций за запуск
+    double bytes;              ///< Байт, которые запуск читает и пишет
+    std::function<void()> run; ///< Один запуск
+};
+
+/// Результат замера
+struct BenchResult
+{
+    std::string name;
+    double seconds{0};    ///< Медиана времени одного запуска
+    double gflops{0};     ///< Миллиардов операций в секунду
+    double gbps{0};       ///< Гигабайт в секунду
+    std::size_t allocs{0}; ///< Выделений памяти за запуск
+    std::size_t allocBytes{0}; ///< Байт выделено за запуск
+};
+
+/// Матрица с диагональным преобладанием: обратима и хорошо обусловлена
+template <typename T> MatrixGeneric<T> benchMatrix(uint32_t n, uint32_t seed)
+{
+    MatrixGeneric<T> out(n, n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t j = 0; j < n; ++j)
+        {
+            int value = int((i * 31 + j * 17 + seed) % 19) - 9;
+            out.get(i, j) = T(i == j ? value + 20 * int(n) : value);
+        }
+    }
+    return out;
+}
+
+/// Количество умножений при бинарном возведении в степень
+uint32_t squaringMultiplies(uint32_t power)
+{
+    uint32_t bits = 0, ones = 0;
+    for (uint32_t p = power; p > 1; p >>= 1)
+        ++bits;
+    for (uint32_t p = power; p; p >>= 1)
+        ones += p & 1;
+    return power == 0 ? 0 : bits + ones - 1;
+}
+
+/// Входной файл калькулятора, который удаляется вместе с объектом
+struct TempFile
+{
+    std::string path;
+
+    TempFile(std::string p, const std::string &text) : path(std::move(p))
+    {
+        std::ofstream(path) << text;
+    }
+    ~TempFile() { std::remove(path.c_str()); }
+};
+
+/**
+ * \brief Чтение файла калькулятором и печать результата
+ * \details Команда t почти ничего не стоит, так что время - это разбор
+ * текста. Калькулятор работает только с float и double
+ */
+template <typename T>
+void addCalculatorCases(std::vector<BenchCase> &cases, const std::string &type,
+                        const MatrixGeneric<T> &a, std::true_type)
+{
+    const uint32_t n = a.height();
+    std::ostringstream text;
+    text << "t\n" << n << ' ' << n << '\n';
+    writeResult(text, a, CalculatorOptions());
+    auto file = std::make_shared<TempFile>(
+        "bench_" + type + "_" + std::to_string(n) + ".tmp", text.str());
+    const double textBytes = double(text.str().size());
+    const std::string suffix = "/" + type + "/" + std::to_string(n);
+    cases.push_back({"calc-parse" + suffix, 0, textBytes, [file]()
+                     { doNotOptimize(calculate<T>(file->path).dense.data()); }});
+
+    auto result =
+        std::make_shared<CalculatorResult<T>>(calculate<T>(file->path));
+    cases.push_back({"calc-print" + suffix, 0, textBytes,
+                     [result]()
+                     {
+                         std::ostringstream out;
+                         writeResult(out, *result, CalculatorOptions());
+                         doNotOptimize(out.tellp());
+                     }});
+}
+
+template <typename T>
+void addCalculatorCases(std::vector<BenchCase> &, const std::string &,
+                        const MatrixGeneric<T> &, std::false_type)
+{
+}
+
+/// Замеры одного типа элементов и размера
+template <typename T>
+void addCases(std::vector<BenchCase> &cases, const std::string &type,
+              uint32_t n)
+{
+    auto a = std::make_shared<MatrixGeneric<T>>(benchMatrix<T>(n, 1));
+    auto b = std::make_shared<MatrixGeneric<T>>(benchMatrix<T>(n, 2));
+    const double n2 = double(n) * n, n3 = n2 * n, elem = sizeof(T);
+    auto add = [&](const std::string &op, double flops, double bytes,
+                   std::function<void()> run)
+    {
+        cases.push_back({op + "/" + type + "/" + std::to_string(n), flops,
+                         bytes, std::move(run)});
+    };
+    auto keep = [](const auto &m) { doNotOptimize(m.data()); };
+
+    add("add", n2, 3 * n2 * elem, [=]() { keep(MatrixGeneric<T>(*a + *b)); });
+    add("sub", n2, 3 * n2 * elem, [=]() { keep(MatrixGeneric<T>(*a - *b)); });
+    add("mul", 2 * n3, 3 * n2 * elem, [=]() { keep(*a * *b); });
+    // LU-разложение делителя и решение для n правых частей
+    add("div", 8 * n3 / 3, 3 * n2 * elem, [=]() { keep(*a / *b); });
+    add("det", 2 * n3 / 3, n2 * elem, [=]() { doNotOptimize(a->det()); });
+    add("inverse", 8 * n3 / 3, 2 * n2 * elem, [=]() { keep(a->inverse()); });
+    // QR-разложение Хаусхолдера квадратной матрицы
+    add("rk", 4 * n3 / 3, n2 * elem, [=]() { doNotOptimize(a->rk()); });
+    add("transpose", 0, 2 * n2 * elem, [=]() { keep(a->transpose()); });
+
+    // Степень целой матрицы переполняется, поэтому только для вещественных
+    const uint32_t power = 16;
+    if (std::is_floating_point<T>::value)
+        add("pow", 2 * n3 * squaringMultiplies(power), 2 * n2 * elem,
+            [=]() { keep(a->pow(power)); });
+
+    addCalculatorCases(cases, type, *a, std::is_floating_point<T>{});
+}
+
+/**
+ * \brief Замер одного случая
+ * \details Первый запуск прогревает кеши и буферы и по нему считаются
+ * выделения памяти. Затем запуски повторяются, пока их суммарное время не
+ * превысит **minTime** (но не меньше трех раз); в результат идет медиана
+ */
+BenchResult measure(const BenchCase &c, double minTime)
+{
+    BenchResult out;
+    out.name = c.name;
+    {
+        BenchScope scope;
+        c.run();
+        out.allocs = scope.allocs().count;
+        out.allocBytes = scope.allocs().bytes;
+    }
+
+    std::vector<double> times;
+    double total = 0;
+    while (times.size() < 3 || (total < minTime && times.size() < 100000))
+    {
+        BenchScope scope;
+        c.run();
+        times.push_back(scope.seconds());
+        total += times.back();
+    }
+    std::nth_element(times.begin(), times.begin() + times.size() / 2,
+                     times.end());
+    out.seconds = times[times.size() / 2];
+    out.gflops = c.flops / out.seconds / 1e9;
+    out.gbps = c.bytes / out.seconds / 1e9;
+    return out;
+}
+
+void writeJson(const std::string &path, const std::vector<BenchResult> &results)
+{
+    std::ofstream out(path);
+    out << "{\n  \"threads\": " << ThreadPool::global().size()
+        << ",\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult &r = results[i];
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"seconds\": %.6e, \"gflops\": "
+                      "%.4f, \"gbps\": %.4f, \"allocs\": %zu, "
+                      "\"alloc_bytes\": %zu}%s\n",
+                      r.name.c_str(), r.seconds, r.gflops, r.gbps, r.allocs,
+                      r.allocBytes, i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+}
+
+/**
+ * \brief Чтение результатов, записанных writeJson()
+ * \details Разбирается только собственный формат: один замер на строку
+ * \return Время замеров по именам; пусто, если файл не удалось прочитать
+ */
+std::map<std::string, double> readJson(const std::string &path)
+{
+    std::map<std::string, double> out;
+    std::ifstream in(path);
+    std::string line;
+    const std::string nameKey = "\"name\": \"", secondsKey = "\"seconds\": ";
+    while (std::getline(in, line))
+    {
+        std::size_t name = line.find(nameKey), seconds = line.find(secondsKey);
+        if (name == std::string::npos || seconds == std::string::npos)
+            continue;
+        name += nameKey.size();
+        out[line.substr(name, line.find('"', name) - name)] =
+            std::strtod(line.c_str() + seconds + secondsKey.size(), nullptr);
+    }
+    return out;
+}
+
+/**
+ * \brief Сравнение с сохраненными результатами
+ * \return Количество регрессий: замеров, ставших медленнее больше чем на
+ * **threshold** процентов
+ */
+int compare(const std::map<std::string, double> &base,
+            const std::map<std::string, double> &current, double threshold)
+{
+    int regressions = 0;
+    std::printf("\n%-26s %12s %12s %9s\n", "name", "base, ms", "now, ms",
+                "change");
+    for (const auto &entry : current)
+    {
+        auto it = base.find(entry.first);
+        if (it == base.end())
+        {
+            std::printf("%-26s %12s %12.3f %9s\n", entry.first.c_str(), "-",
+                        entry.second * 1e3, "new");
+            continue;
+        }
+        double change = (entry.second / it->second - 1) * 100;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        std::printf("%-26s %12.3f %12.3f %+8.1f%%%s\n", entry.first.c_str(),
+                    it->second * 1e3, entry.second * 1e3, change,
+                    regressed ? "  REGRESSION" : "");
+    }
+    std::printf("%d regression(s) over %.1f%%\n", regressions, threshold);
+    return regressions;
+}
+
+std::vector<std::string> splitList(const std::string &list)
+{
+    std::vector<std::string> out;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        if (!item.empty())
+            out.push_back(item);
+    }
+    return out;
+}
+
+int usage()
+{
+    std::fprintf(stderr,
+                 "usage: bench [--filter S] [--sizes 64,256] "
+                 "[--types int,float,double] [--min-time SEC]\n"
+                 "             [--json FILE] [--compare BASE [CURRENT]] "
+                 "[--threshold PCT]\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    std::string filter, jsonPath, basePath, currentPath;
+    std::vector<std::string> sizes = {"64", "256", "1024"},
+                             types = {"int", "float", "double"};
+    double minTime = 0.2, threshold = 10;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue)
+            filter = argv[++i];
+        else if (arg == "--sizes" && hasValue)
+            sizes = splitList(argv[++i]);
+        else if (arg == "--types" && hasValue)
+            types = splitList(argv[++i]);
+        else if (arg == "--min-time" && hasValue)
+            minTime = std::strtod(argv[++i], nullptr);
+        else if (arg == "--json" && hasValue)
+            jsonPath = argv[++i];
+        else if (arg == "--threshold" && hasValue)
+            threshold = std::strtod(argv[++i], nullptr);
+        else if (arg == "--compare" && hasValue)
+        {
+            basePath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                currentPath = argv[++i];
+        }
+        else
+            return usage();
+    }
+
+    std::map<std::string, double> base;
+    if (!basePath.empty())
+    {
+        base = readJson(basePath);
+        if (base.empty())
+        {
+            std::fprintf(stderr, "bench: can't read results from %s\n",
+                         basePath.c_str());
+            return 2;
+        }
+    }
+    if (!currentPath.empty())
+    {
+        auto current = readJson(currentPath);
+        if (current.empty())
+        {
+            std::fprintf(stderr, "bench: can't read results from %s\n",
+                         currentPath.c_str());
+            return 2;
+        }
+        return compare(base, current, threshold) ? 1 : 0;
+    }
+
+    std::vector<BenchCase> cases;
+    for (const std::string &size : sizes)
+    {
+        uint32_t n = uint32_t(std::strtoul(size.c_str(), nullptr, 10));
+        if (n == 0)
+            return usage();
+        for (const std::string &type : types)
+        {
+            if (type == "int")
+                addCases<int>(cases, type, n);
+            else if (type == "float")
+                addCases<float>(cases, type, n);
+            else if (type == "double")
+                addCases<double>(cases, type, n);
+            else
+                return usage();
+        }
+    }
+
+    std::printf("%-26s %12s %10s %10s %10s %12s\n", "name", "time, ms",
+                "GFLOP/s", "GB/s", "allocs", "alloc, KiB");
+    std::vector<BenchResult> results;
+    for (const BenchCase &c : cases)
+    {
+        if (c.name.find(filter) == std::string::npos)
+            continue;
+        results.push_back(measure(c, minTime));
+        const BenchResult &r = results.back();
+        std::printf("%-26s %12.3f %10.2f %10.2f %10zu %12.1f\n",
+                    r.name.c_str(), r.seconds * 1e3, r.gflops, r.gbps,
+                    r.allocs, r.allocBytes / 1024.0);
+        std::fflush(stdout);
+    }
+
+    if (!jsonPath.empty())
+        writeJson(jsonPath, results);
+    if (base.empty())
+        return 0;
+
+    std::map<std::string, double> current;
+    for (const BenchResult &r : results)
+        current[r.name] = r.seconds;
+    return compare(base, current, threshold) ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+#include "BenchUtil.hpp"
+#include <MatrixGeneric.hpp>
+#include <cstdio>
+
+/**
+ * \file bench_transpose.cpp
+ * Бенчмарк транспонирования: пропускная способность прежнего построчного
+ * обхода, блочного transpose() и transposeInPlace() в зависимости от размера
+ * матрицы
+ * \author dmsukhikh
+ */
+
+/// Прежняя реализация transpose(): чтение по строкам, запись по столбцам
+template <typename T> MatrixGeneric<T> transposeNaive(const MatrixGeneric<T> &a)
+{
+    MatrixGeneric<T> out(a.width(), a.height());
+    const T *src = a.data();
+    T *dst = out.data();
+    for (uint32_t i = 0; i < a.height(); ++i)
+    {
+        for (uint32_t j = 0; j < a.width(); ++j)
+            dst[std::size_t(j) * a.height() + i] = src[std::size_t(i) * a.width() + j];
+    }
+    return out;
+}
+
+/// Количество повторов, чтобы замер длился порядка 0.1 с
+uint32_t repeats(uint32_t n)
+{
+    uint64_t elements = uint64_t(n) * n;
+    return uint32_t(std::max<uint64_t>(1, (uint64_t(1) << 25) / elements));
+}
+
+void report(uint32_t n, const char *method, uint32_t reps,
+            const BenchScope &scope)
+{
+    double bytes = 2.0 * n * n * sizeof(double) * reps;
+    std::printf("%-6u %-10s %12.3f %10.2f\n", n, method,
+                scope.seconds() * 1e3 / reps, bytes / scope.seconds() / 1e9);
+}
+
+int main()
+{
+    std::printf("%-6s %-10s %12s %10s\n", "size", "method", "time, ms",
+                "GB/s");
+    for (uint32_t n : {64u, 256u, 512u, 1000u, 1024u, 2048u, 4096u})
+    {
+        MatrixGeneric<double> a(n, n);
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            for (uint32_t j = 0; j < n; ++j)
+                a.get(i, j) = i * 0.5 + j;
+        }
+        uint32_t reps = repeats(n);
+
+        {
+            BenchScope scope;
+            for (uint32_t r = 0; r < reps; ++r)
+            {
+                auto t = transposeNaive(a);
+                doNotOptimize(t.data());
+            }
+            report(n, "naive", reps, scope);
+        }
+        {
+            BenchScope scope;
+            for (uint32_t r = 0; r < reps; ++r)
+            {
+                auto t = a.transpose();
+                doNotOptimize(t.data());
+            }
+            report(n, "blocked", reps, scope);
+        }
+        {
+            BenchScope scope;
+            for (uint32_t r = 0; r < reps; ++r)
+            {
+                a.transposeInPlace();
+                doNotOptimize(a.data());
+            }
+            report(n, "in-place", reps, scope);
+        }
+    }
+}
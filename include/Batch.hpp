@@ -0,0 +1,226 @@
+#ifndef __BATCH
+#define __BATCH
+
+#include <Calculator.hpp>
+#include <ThreadPool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+/**
+ * \file Batch.hpp
+ * Файл, содержащий пакетный режим калькулятора: обработку множества файлов за
+ * один запуск утилиты
+ * \author dmsukhikh
+ */
+
+/// Суффикс файлов с результатами пакетного режима
+constexpr const char *batchOutputSuffix = ".out";
+
+/**
+ * \brief Итоги пакетного запуска
+ */
+struct BatchReport
+{
+    std::vector<std::string> files;  ///< Обработанные файлы
+    std::vector<std::string> errors; ///< Ошибка для каждого файла или ""
+    std::size_t failed{0};           ///< Количество файлов с ошибками
+    double seconds{0};               ///< Время обработки всех файлов
+};
+
+/**
+ * \brief Является ли путь директорией
+ */
+inline bool isDirectory(const std::string &path)
+{
+    struct stat info;
+    return ::stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+/**
+ * \brief Список файлов для пакетного режима
+ * \details Каждый путь - это файл с задачей, директория или "-". Из
+ * директории берутся все обычные файлы, кроме скрытых и результатов
+ * предыдущих запусков (*.out), в порядке имен. Вместо "-" подставляется
+ * список путей из **manifest**, по одному на строку. Пустой список путей
+ * равносилен "-"
+ *
+ * \param paths Пути из командной строки
+ * \param manifest Поток со списком путей (обычно std::cin)
+ * \return Пути к файлам с задачами
+ * \throw std::runtime_error Если директорию не удалось прочитать
+ */
+inline std::vector<std::string>
+collectBatchFiles(const std::vector<std::string> &paths, std::istream &manifest)
+{
+    std::vector<std::string> files;
+    auto add = [&files](const std::string &path)
+    {
+        if (!isDirectory(path))
+        {
+            files.push_back(path);
+            return;
+        }
+
+        DIR *dir = ::opendir(path.c_str());
+        if (!dir)
+            throw std::runtime_error("can't read directory " + path);
+
+        std::vector<std::string> entries;
+        const std::string suffix = batchOutputSuffix;
+        while (dirent *entry = ::readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name.empty() || name[0] == '.')
+                continue;
+            if (name.size() >= suffix.size() &&
+                name.compare(name.size() - suffix.size(), suffix.size(),
+                             suffix) == 0)
+                continue;
+
+            std::string full = path + "/" + name;
+            struct stat info;
+            if (::stat(full.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+                entries.push_back(full);
+        }
+        ::closedir(dir);
+
+        std::sort(entries.begin(), entries.end());
+        files.insert(files.end(), entries.begin(), entries.end());
+    };
+
+    bool manifestRead = false;
+    for (const auto &path : paths.empty() ? std::vector<std::string>{"-"}
+                                          : paths)
+    {
+        if (path != "-")
+        {
+            add(path);
+            continue;
+        }
+        if (manifestRead)
+            continue;
+        manifestRead = true;
+
+        std::string line;
+        while (std::getline(manifest, line))
+        {
+            line.erase(0, line.find_first_not_of(" \t\r"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (!line.empty())
+                add(line);
+        }
+    }
+    return files;
+}
+
+/**
+ * \brief Обработка множества файлов
+ * \details Файлы распределяются между потоками \ref ThreadPool::global()
+ * "общего пула"; операции внутри задач (умножение, обращение и т.п.)
+ * распараллеливаются на тех же потоках. Результат для файла `path`
+ * записывается в `path.out` в том же виде, в каком его напечатала бы утилита
+ * (см. writeResult()). Ошибка в одном файле не останавливает обработку
+ * остальных
+ *
+ * \param files Пути к файлам с задачами
+ * \param options Параметры чтения файлов и записи результатов
+ * \return Итоги запуска
+ */
+template <typename T>
+BatchReport runBatch(const std::vector<std::string> &files,
+                     const CalculatorOptions &options = CalculatorOptions())
+{
+    BatchReport report;
+    report.files = files;
+    report.errors.resize(files.size());
+
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool::global().parallelFor(
+        0, uint32_t(files.size()), 1,
+        [&](uint32_t lo, uint32_t hi)
+        {
+            for (uint32_t i = lo; i < hi; ++i)
+            {
+                try
+                {
+                    CalculatorResult<T> res =
+                        calculate<T>(files[i], options);
+                    std::ofstream out(files[i] + batchOutputSuffix,
+                                      std::ios::binary);
+                    if (!out)
+                        throw std::runtime_error(
+                            "error: can't write the result");
+                    writeResult(out, res, options);
+                }
+                catch (std::exception &e)
+                {
+                    report.errors[i] = e.what();
+                }
+                catch (...)
+                {
+                    report.errors[i] = "error: unknown error";
+                }
+            }
+        });
+    report.seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    report.failed = std::size_t(
+        std::count_if(report.errors.begin(), report.errors.end(),
+                      [](const std::string &e) { return !e.empty(); }));
+    return report;
+}
+
+/**
+ * \brief Основная процедура пакетного режима
+ * \details Собирает список файлов (см. collectBatchFiles()), обрабатывает их
+ * (см. runBatch()) и печатает ошибки и итоговую пропускную способность в
+ * задачах в секунду
+ *
+ * \param paths Пути из командной строки
+ * \param options Параметры чтения файлов и записи результатов
+ * \throw std::runtime_error Если хотя бы один файл не удалось обработать
+ */
+template <typename T>
+void batchRoutine(const std::vector<std::string> &paths,
+                  const CalculatorOptions &options = CalculatorOptions())
+{
+    std::vector<std::string> files;
+    try
+    {
+        files = collectBatchFiles(paths, std::cin);
+    }
+    catch (std::runtime_error &e)
+    {
+        std::cout << "[tspp_calc] error: " << e.what() << std::endl;
+        throw;
+    }
+
+    BatchReport report = runBatch<T>(files, options);
+    for (std::size_t i = 0; i < report.files.size(); ++i)
+    {
+        if (!report.errors[i].empty())
+            std::cout << "[tspp_calc] " << report.files[i] << ": "
+                      << report.errors[i] << std::endl;
+    }
+
+    double rate = report.seconds > 0 ? double(files.size()) / report.seconds
+                                     : 0.0;
+    std::cout << "[tspp_calc] batch: " << files.size() << " problems, "
+              << report.failed << " failed, " << report.seconds << " s, "
+              << rate << " problems/s" << std::endl;
+
+    if (report.failed != 0)
+        throw std::runtime_error("batch failed");
+}
+
+#endif
@@ -1,11 +1,20 @@
 #ifndef __CALCULATOR
 #define __CALCULATOR
+#include <MappedFile.hpp>
 #include <MatrixGeneric.hpp>
+#include <MatrixStats.hpp>
+#include <ResultWriter.hpp>
+#include <Script.hpp>
+#include <SparseMatrix.hpp>
+#include <TokenReader.hpp>
+#include <algorithm>
 #include <cstdint>
 #include <exception>
 #include <fstream>
 #include <functional>
+#include <memory>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -26,6 +35,17 @@
  * [Высота] [Ширина]
  * [Через пробел члены строк матриц]
  * ... сколько нужно матриц для операции ...
+ *
+ * Вместо текстовой записи любая матрица может идти в двоичном формате
+ * MatrixGeneric::save() (см. MatrixBinary.hpp) или в координатном формате
+ * разреженной матрицы:
+ * coo
+ * [Высота] [Ширина] [Количество элементов]
+ * [Строка] [Столбец] [Значение]
+ * ...
+ *
+ * Если операция - script, вместо матриц идет сценарий из нескольких
+ * инструкций с переменными, см. Script.hpp
  */
 
 /**
@@ -81,6 +101,115 @@ T getFromStream(std::basic_istream<char, std::char_traits<char>> &stream,
     }
 }
 
+/**
+ * \brief Преобразование лексемы в объект типа **T**
+ * \details Вспомогательная функция, которая используется в getFromTokens.
+ * Для произвольного типа лексема копируется в строку и передается в
+ * _conversionFromString()
+ *
+ * \param first Начало лексемы
+ * \param last Конец лексемы
+ * \param[out] out Полученный объект
+ * \return false, если преобразование не удалось
+ * \sa getFromTokens()
+ */
+template <typename T>
+bool _conversionFromToken(const char *first, const char *last, T &out)
+{
+    std::string i(first, last);
+    try
+    {
+        out = _conversionFromString<T>(i);
+        return true;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+template <> inline bool _conversionFromToken(const char *first, const char *last,
+                                             int &out)
+{
+    return detail::parseNumber(first, last, out);
+}
+
+template <> inline bool _conversionFromToken(const char *first, const char *last,
+                                             long long &out)
+{
+    return detail::parseNumber(first, last, out);
+}
+
+template <> inline bool _conversionFromToken(const char *first, const char *last,
+                                             float &out)
+{
+    return detail::parseNumber(first, last, out);
+}
+
+template <> inline bool _conversionFromToken(const char *first, const char *last,
+                                             double &out)
+{
+    return detail::parseNumber(first, last, out);
+}
+
+/**
+ * \brief Безопасное получение следующего объекта из TokenReader
+ * \details То же, что и getFromStream(), но без выделения памяти на каждую
+ * лексему: встроенные числовые типы разбираются прямо из буфера читателя
+ *
+ * \param reader Источник лексем
+ * \param msg Сообщение при ошибке
+ * \return Полученный объект
+ * \throw std::runtime_error В случае, если лексемы закончились или если
+ * происходит ошибка при преобразовании лексемы в объект типа T
+ * \sa getFromStream()
+ */
+template <typename T> T getFromTokens(TokenReader &reader, const char *msg)
+{
+    const char *first, *last;
+    if (!reader.next(first, last))
+    {
+        throw std::runtime_error("not enough args or elements");
+    }
+
+    T out{};
+    if (!_conversionFromToken(first, last, out))
+    {
+        throw std::runtime_error(msg);
+    }
+    return out;
+}
+
+/**
+ * \brief Параметры калькулятора: чтение входного файла и печать результата
+ */
+struct CalculatorOptions
+{
+    bool mmap{false}; ///< Отображать файл в память вместо чтения через поток
+    bool binaryOutput{false}; ///< Печатать результат в двоичном формате
+    int precision{6}; ///< Значащих цифр при печати; 0 - кратчайшая запись без
+                      ///< потерь, см. detail::formatNumber()
+};
+
+/**
+ * \brief Результат калькулятора
+ * \details Операции +, -, * и t над разреженными операндами (формат coo)
+ * считаются без перевода в плотный вид; если результат разреженный, он
+ * хранится в поле sparse и печатается в том же формате coo
+ */
+template <typename T> struct CalculatorResult
+{
+    MatrixGeneric<T> dense; ///< Результат, если isSparse == false
+    SparseMatrix<T> sparse; ///< Результат, если isSparse == true
+    bool isSparse{false};   ///< Разреженный ли результат
+
+    /// Результат в плотном виде
+    MatrixGeneric<T> toDense() const
+    {
+        return isSparse ? sparse.toDense() : dense;
+    }
+};
+
 /**
  * \brief Класс для работы с выражениями из файла
  * \details Класс Calculator парсит задаваемый пользователем файл и вычисляет
@@ -111,6 +240,7 @@ template <typename Type> class Calculator
         {"-", {2, [this]() { return matrices[0] - matrices[1]; }}},
         {"/", {2, [this]() { return matrices[0] / matrices[1]; }}},
         {"*", {2, [this]() { return matrices[0] * matrices[1]; }}},
+        {"solve", {2, [this]() { return solve(matrices[0], matrices[1]); }}},
         {"det",
          {1, [this]() { return MatrixGeneric<Type>{{matrices[0].det()}}; }}},
         {"inv", {1, [this]() { return matrices[0].inverse(); }}},
@@ -123,6 +253,7 @@ template <typename Type> class Calculator
         {"t", {1, [this]() { return matrices[0].transpose(); }}},
         {"pow",
          {1, [this]() { return matrices[0].pow(std::stoul(opArgs[1])); }}},
+        {"script", {0, [this]() { return script.run(); }}},
     };
 
     std::unordered_map<std::string, size_t> commandsWithArgs = {{"pow", 1}};
@@ -130,132 +261,440 @@ template <typename Type> class Calculator
     std::vector<MatrixGeneric<Type>>
         matrices;                    ///< Здесь хранятся распарсенные матрицы
     std::vector<std::string> opArgs; ///< Распарсенные операция и ее аргументы
+    /// Разреженные операнды; для них в matrices лежит пустая матрица, пока
+    /// операция не потребует плотного вида
+    std::vector<SparseMatrix<Type>> sparse;
+    std::vector<char> isSparse; ///< Записан ли операнд в формате coo
+    Script<Type> script; ///< Разобранный сценарий для операции script
 
-  public:
     /**
-     * \brief Парсит вводимый файл
-     * \details Получает данные о матрицах и операции над ними из файла
-     * \param argv аргументы командной строки
-     * \throw std::exception Если файл не существует или информация в нем
-     * некорректная
+     * \brief Парсит строку с операцией и ее аргументами
+     * \param operationString Первая строка файла
+     * \throw std::runtime_error Если операция неизвестна или ей не хватает
+     * аргументов
      */
-    Calculator(char **argv) : opArgs(1)
+    void _parseOperation(const std::string &operationString)
     {
-        // Открытие файла
-        std::ifstream matrixData(argv[1]);
-        if (!matrixData.is_open())
+        std::stringstream itParsed(operationString);
+        itParsed >> opArgs[0];
+
+        if (commands.count(opArgs[0]) == 0)
         {
-            std::cout
-                << "[tspp_calc] error: invalid file. See README.md for info"
-                << std::endl;
-            throw std::exception();
+            throw std::runtime_error("invalid operation \"" + opArgs[0] +
+                                     "\".  See README.md for info");
         }
+        else
+        {
+            std::string temp;
+            while (itParsed >> temp)
+            {
+                opArgs.push_back(temp);
+            }
 
-        // Парсинг информации об операции + аргументы
+            if (opArgs.size() - 1 < commandsWithArgs[opArgs[0]])
+            {
+                throw std::runtime_error(
+                    "not enough arguments for operation " + opArgs[0] + ". " +
+                    std::to_string(commandsWithArgs[opArgs[0]]) +
+                    " expected, but " + std::to_string(opArgs.size() - 1) +
+                    " was given.");
+            }
+        }
+    }
+
+    /**
+     * \brief Парсит матрицы-операнды
+     * \details Память под каждую матрицу выделяется один раз по размерам из
+     * ее заголовка, после чего элементы разбираются прямо в нее. Каждый
+     * операнд может быть записан как текстом, так и в двоичном формате
+     * MatrixGeneric::save() - он распознается по сигнатуре, - или в
+     * координатном формате coo: тогда операнд разбирается в SparseMatrix и
+     * память занимают только ненулевые элементы
+     *
+     * \param reader Источник лексем, начинающийся после строки с операцией
+     * \throw std::exception Если информация о матрицах некорректна
+     */
+    void _parseMatrices(TokenReader &reader)
+    {
+        const size_t operands = commands[opArgs[0]].operands;
+        matrices.reserve(operands);
+        sparse.resize(operands);
+        isSparse.assign(operands, 0);
+        for (size_t idx = 0; idx < operands; ++idx)
         {
-            std::string operationString;
-            std::getline(matrixData,
-                         operationString); // операция + аргументы
-            std::stringstream itParsed(operationString);
-            itParsed >> opArgs[0];
+            if (reader.lookingAt("coo", 3))
+            {
+                _parseSparse(reader, idx);
+                matrices.emplace_back();
+                continue;
+            }
 
-            if (commands.count(opArgs[0]) == 0)
+            // Матрица в двоичном формате, см. MatrixBinary.hpp
+            if (reader.lookingAt(detail::binaryMagic,
+                                 sizeof(detail::binaryMagic)))
             {
-                std::cout << "[tspp_calc] error: invalid operation \""
-                          << opArgs[0] << "\".  See README.md for info"
-                          << std::endl;
-                throw std::exception();
+                char bytes[detail::binaryHeaderSize];
+                if (!reader.read(bytes, sizeof(bytes)))
+                    throw std::runtime_error("not enough args or elements");
+                auto header =
+                    detail::decodeBinaryHeader(bytes, reader.available());
+
+                matrices.emplace_back(header.height, header.width);
+                detail::readBinaryPayload(
+                    header, matrices[idx].data(),
+                    [&reader](char *out, std::size_t bytes)
+                    { return reader.read(out, bytes); });
+                continue;
             }
-            else
+
+            auto height = static_cast<uint32_t>(
+                getFromTokens<int>(reader, "error in getting height"));
+            auto width = static_cast<uint32_t>(
+                getFromTokens<int>(reader, "error in getting width"));
+
+            matrices.emplace_back(height, width);
+
+            Type *elements = matrices[idx].data();
+            std::size_t count = std::size_t(height) * width;
+            for (std::size_t i = 0; i < count; ++i)
             {
-                std::string temp;
-                while (itParsed >> temp)
-                {
-                    opArgs.push_back(temp);
-                }
-
-                if (opArgs.size() - 1 < commandsWithArgs[opArgs[0]])
-                {
-                    std::cout << "[tspp_calc] error: not enough arguments for "
-                                 "operation "
-                              << opArgs[0] << ". "
-                              << commandsWithArgs[opArgs[0]]
-                              << " expected, but " << opArgs.size() - 1
-                              << " was given." << std::endl;
-                    throw std::exception();
-                }
+                elements[i] = getFromTokens<Type>(
+                    reader, "error in getting elements of the matrix");
             }
         }
+    }
+
+    /**
+     * \brief Парсит разреженный операнд номер **idx** в формате coo
+     * \details Элементы могут идти в любом порядке, значения с одинаковыми
+     * координатами складываются
+     *
+     * \throw std::exception Если информация о матрице некорректна или
+     * координаты элемента выходят за ее пределы
+     */
+    void _parseSparse(TokenReader &reader, size_t idx)
+    {
+        const char *first, *last;
+        reader.next(first, last);
+        if (std::string(first, last) != "coo")
+            throw std::runtime_error("unknown operand format \"" +
+                                     std::string(first, last) + "\"");
+
+        auto height = static_cast<uint32_t>(
+            getFromTokens<int>(reader, "error in getting height"));
+        auto width = static_cast<uint32_t>(
+            getFromTokens<int>(reader, "error in getting width"));
+        auto count = getFromTokens<long long>(
+            reader, "error in getting count of elements");
+        if (count < 0)
+            throw std::runtime_error("error in getting count of elements");
+
+        std::vector<Triplet<Type>> triplets;
+        triplets.reserve(std::size_t(std::min(count, 1LL << 20)));
+        for (long long k = 0; k < count; ++k)
+        {
+            Triplet<Type> t;
+            t.row = static_cast<uint32_t>(getFromTokens<int>(
+                reader, "error in getting coordinates of an element"));
+            t.col = static_cast<uint32_t>(getFromTokens<int>(
+                reader, "error in getting coordinates of an element"));
+            t.value = getFromTokens<Type>(
+                reader, "error in getting elements of the matrix");
+            triplets.push_back(t);
+        }
+
+        sparse[idx] =
+            SparseMatrix<Type>::fromTriplets(height, width, std::move(triplets));
+        isSparse[idx] = 1;
+    }
 
-        try
+    /**
+     * \brief Операция над разреженными операндами без перевода в плотный вид
+     * \details Сумма, разность и произведение двух разреженных матриц и
+     * транспонирование разреженной дают разреженную матрицу, операции над
+     * разреженной и плотной - плотную
+     *
+     * \param[out] out Результат
+     * \return false, если операция требует плотных операндов
+     */
+    bool _sparseOperation(CalculatorResult<Type> &out)
+    {
+        const std::string &op = opArgs[0];
+        if (op == "t")
         {
-            // Парсинг матриц
-            for (size_t idx = 0; idx < commands[opArgs[0]].operands; ++idx)
+            out.sparse = sparse[0].transpose();
+            out.isSparse = true;
+            return true;
+        }
+        if (op != "+" && op != "-" && op != "*")
+            return false;
+
+        if (isSparse[0] && isSparse[1])
+        {
+            out.isSparse = true;
+            if (op == "+")
+                out.sparse = sparse[0] + sparse[1];
+            else if (op == "-")
+                out.sparse = sparse[0] - sparse[1];
+            else
+                out.sparse = sparse[0] * sparse[1];
+        }
+        else if (isSparse[0])
+        {
+            if (op == "+")
+                out.dense = sparse[0] + matrices[1];
+            else if (op == "-")
+                out.dense = sparse[0] - matrices[1];
+            else
+                out.dense = sparse[0] * matrices[1];
+        }
+        else
+        {
+            if (op == "+")
+                out.dense = matrices[0] + sparse[1];
+            else if (op == "-")
+                out.dense = matrices[0] - sparse[1];
+            else
+                out.dense = matrices[0] * sparse[1];
+        }
+        return true;
+    }
+
+  public:
+    /**
+     * \brief Парсит вводимый файл
+     * \details Получает данные о матрицах и операции над ними из файла.
+     * Файл читается через поток или, если задано CalculatorOptions::mmap,
+     * отображается в память и разбирается прямо из отображения
+     *
+     * \param path Путь к файлу
+     * \param options Параметры чтения файла
+     * \throw std::exception Если файл не существует или информация в нем
+     * некорректная. what() содержит описание ошибки для пользователя
+     */
+    Calculator(const std::string &path,
+               const CalculatorOptions &options = CalculatorOptions())
+        : opArgs(1)
+    {
+        if (options.mmap)
+        {
+            // Открытие файла
+            MappedFile matrixData;
+            try
+            {
+                matrixData = MappedFile(path);
+            }
+            catch (std::exception &)
+            {
+                throw std::runtime_error(
+                    "invalid file. See README.md for info");
+            }
+
+            // Парсинг информации об операции + аргументы
+            const char *rest =
+                std::find(matrixData.begin(), matrixData.end(), '\n');
+            _parseOperation(std::string(matrixData.begin(), rest));
+            if (opArgs[0] == "script")
             {
-                auto height = static_cast<uint32_t>(
-                    getFromStream<int>(matrixData, "error in getting height"));
-                auto width = static_cast<uint32_t>(
-                    getFromStream<int>(matrixData, "error in getting width"));
-
-                matrices.emplace_back(height, width);
-
-                for (uint32_t i = 0; i < matrices[idx].height(); ++i)
-                {
-                    for (uint32_t j = 0; j < matrices[idx].width(); ++j)
-                    {
-                        matrices[idx].get(i, j) = getFromStream<Type>(
-                            matrixData,
-                            "error in getting elements of the matrix");
-                    }
-                }
+                script.parse(rest, matrixData.end(), 1);
+                return;
             }
+
+            // Парсинг матриц прямо из отображенной памяти
+            TokenReader reader(rest, matrixData.end());
+            _parseMatrices(reader);
+            return;
         }
-        catch (std::exception &e)
+
+        // Открытие файла
+        std::ifstream matrixData(path, std::ios::binary);
+        if (!matrixData.is_open())
+        {
+            throw std::runtime_error("invalid file. See README.md for info");
+        }
+
+        // Парсинг информации об операции + аргументы
+        std::string operationString;
+        std::getline(matrixData, operationString); // операция + аргументы
+        _parseOperation(operationString);
+        if (opArgs[0] == "script")
         {
-            std::cout << "[tspp_calc] error: " << e.what() << std::endl;
-            throw e;
+            std::string text((std::istreambuf_iterator<char>(matrixData)),
+                             std::istreambuf_iterator<char>());
+            script.parse(text.data(), text.data() + text.size(), 2);
+            return;
         }
+
+        // Парсинг матриц
+        TokenReader reader(matrixData);
+        _parseMatrices(reader);
+    }
+
+    /**
+     * \brief Парсит файл, путь к которому передан в командной строке
+     * \param argv аргументы командной строки; путь - argv[1]
+     * \param options Параметры чтения файла
+     * \throw std::exception Если файл не существует или информация в нем
+     * некорректная
+     */
+    Calculator(char **argv,
+               const CalculatorOptions &options = CalculatorOptions())
+        : Calculator(std::string(argv[1]), options)
+    {
     }
 
     /**
      * \brief Вычисляет результат операции
-     * \return Результат операции
+     * \details Если среди операндов есть разреженные, а операция не
+     * поддерживается для них напрямую (det, inv, pow и т. д.), они
+     * переводятся в плотный вид
+     *
+     * \return Результат операции, плотный или разреженный
      * \throw <Any> Если происходит ошибка в операции
      */
-    MatrixGeneric<Type> getResult() { return commands[opArgs[0]].func(); }
+    CalculatorResult<Type> compute()
+    {
+        CalculatorResult<Type> out;
+        bool anySparse =
+            std::find(isSparse.begin(), isSparse.end(), 1) != isSparse.end();
+        if (anySparse && _sparseOperation(out))
+            return out;
+
+        for (size_t i = 0; i < isSparse.size(); ++i)
+        {
+            if (isSparse[i])
+            {
+                matrices[i] = sparse[i].toDense();
+                sparse[i] = SparseMatrix<Type>();
+                isSparse[i] = 0;
+            }
+        }
+        out.dense = commands[opArgs[0]].func();
+        return out;
+    }
+
+    /**
+     * \brief Вычисляет результат операции
+     * \return Результат операции в плотном виде
+     * \throw <Any> Если происходит ошибка в операции
+     * \sa compute()
+     */
+    MatrixGeneric<Type> getResult() { return compute().toDense(); }
 };
 
 /**
- * \brief Основная процедура калькулятора
- * \details Калькулятор принимает аргументы, открывает файл, парсит его и
- * печатает результат
- * \param argv аргументы командной строки
- * \return None
- * \throw basic_matrix_exception В случае неудачного парсинга файла
+ * \brief Вычисление результата для одного файла
+ * \details Парсит файл и выполняет записанную в нем операцию. Ничего не
+ * печатает, поэтому может вызываться из нескольких потоков одновременно.
+ * Этапы замеряются как calculator.parse и calculator.compute, см.
+ * StatsScope
+ *
+ * \param path Путь к файлу
+ * \param options Параметры чтения файла
+ * \return Результат операции
+ * \throw std::runtime_error С сообщением вида "error: ..." в случае
+ * неудачного парсинга файла или "error while computing: ..." в случае ошибки
+ * в операции
  */
-template <typename T> void mainRoutine(char **argv)
+template <typename T>
+CalculatorResult<T>
+calculate(const std::string &path,
+          const CalculatorOptions &options = CalculatorOptions())
 {
-    Calculator<T> a(argv);
-    MatrixGeneric<T> res;
+    std::unique_ptr<Calculator<T>> calculator;
+    try
+    {
+        StatsScope stats("calculator.parse");
+        calculator.reset(new Calculator<T>(path, options));
+    }
+    catch (std::exception &e)
+    {
+        throw std::runtime_error(std::string("error: ") + e.what());
+    }
 
     try
     {
-        res = a.getResult();
+        StatsScope stats("calculator.compute");
+        return calculator->compute();
     }
     catch (basic_matrix_exception &e)
     {
-        std::cout << "[tspp_calc] error while computing: " << e.what()
-                  << std::endl;
-        throw e;
+        throw std::runtime_error(std::string("error while computing: ") +
+                                 e.what());
     }
+}
 
-    for (uint32_t i = 0; i < res.height(); ++i)
+/**
+ * \brief Печать результата
+ * \details Текстом через ResultWriter или в двоичном формате, в зависимости
+ * от **options**
+ */
+template <typename T>
+void writeResult(std::ostream &out, const MatrixGeneric<T> &res,
+                 const CalculatorOptions &options)
+{
+    if (options.binaryOutput)
     {
-        for (uint32_t j = 0; j < res.width(); ++j)
-        {
-            std::cout << res.get(i, j) << " ";
-        }
-        std::cout << std::endl;
+        res.save(out);
+        out.flush();
+        return;
+    }
+
+    ResultWriter writer(out, options.precision);
+    writer.writeMatrix(res);
+}
+
+/**
+ * \brief Печать результата
+ * \details Разреженный результат печатается текстом в формате coo; в
+ * двоичном формате он, как и плотный, записывается MatrixGeneric::save().
+ * Печать замеряется как calculator.print
+ */
+template <typename T>
+void writeResult(std::ostream &out, const CalculatorResult<T> &res,
+                 const CalculatorOptions &options)
+{
+    StatsScope stats("calculator.print");
+    if (!res.isSparse)
+    {
+        writeResult(out, res.dense, options);
+        return;
+    }
+    if (options.binaryOutput)
+    {
+        writeResult(out, res.sparse.toDense(), options);
+        return;
+    }
+
+    ResultWriter writer(out, options.precision);
+    writer.writeSparse(res.sparse);
+}
+
+/**
+ * \brief Основная процедура калькулятора
+ * \details Калькулятор принимает аргументы, открывает файл, парсит его и
+ * печатает результат - текстом или в двоичном формате
+ * \param argv аргументы командной строки
+ * \param options Параметры чтения файла и печати результата
+ * \return None
+ * \throw std::runtime_error В случае неудачного парсинга файла или ошибки в
+ * операции. Сообщение об ошибке уже напечатано
+ */
+template <typename T>
+void mainRoutine(char **argv,
+                 const CalculatorOptions &options = CalculatorOptions())
+{
+    CalculatorResult<T> res;
+    try
+    {
+        res = calculate<T>(argv[1], options);
     }
+    catch (std::runtime_error &e)
+    {
+        std::cout << "[tspp_calc] " << e.what() << std::endl;
+        throw;
+    }
+
+    writeResult(std::cout, res, options);
 }
 #endif
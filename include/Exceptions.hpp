@@ -57,4 +57,10 @@ class matrix_bad_operation : public basic_matrix_exception
     matrix_bad_operation(const char *msg) : basic_matrix_exception(msg) {}
 };
 
+class matrix_io_error : public basic_matrix_exception
+{
+  public:
+    matrix_io_error(const char *msg) : basic_matrix_exception(msg) {}
+};
+
 #endif
@@ -0,0 +1,692 @@
+#ifndef __FIXED_MATRIX
+#define __FIXED_MATRIX
+
+#include "Exceptions.hpp"
+#include "MatrixExpression.hpp"
+#include "MatrixGeneric.hpp"
+#include "MatrixOperation.hpp"
+#include "MatrixTypes.hpp"
+#include "MatrixView.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+/**
+ * \file FixedMatrix.hpp
+ * Файл, содержащий класс FixedMatrix - матрицу, размеры которой известны во
+ * время компиляции
+ * \author dmsukhikh
+ */
+
+template <typename T, uint32_t Rows, uint32_t Cols> class FixedMatrix;
+
+namespace detail
+{
+
+/// Является ли **T** матрицей FixedMatrix
+template <typename T> struct IsFixedMatrix : std::false_type
+{
+};
+
+template <typename T, uint32_t R, uint32_t C>
+struct IsFixedMatrix<FixedMatrix<T, R, C>> : std::true_type
+{
+};
+
+/// Наибольшее количество умножений элементов, при котором циклы разворачиваются
+constexpr std::size_t fixedUnrollLimit = 64;
+
+/**
+ * \brief Скалярное произведение строки на столбец
+ * \details Сумма развернута раскрытием пакета индексов, поэтому не зависит
+ * от того, решит ли компилятор развернуть цикл. Слагаемые складываются в том
+ * же порядке, что и в цикле
+ *
+ * \param a Строка из K элементов подряд
+ * \param b Первый элемент столбца
+ * \param stride Шаг между элементами столбца
+ */
+template <typename R, typename A, typename B, std::size_t... K>
+R fixedDot(const A *a, const B *b, std::size_t stride,
+           std::index_sequence<K...>)
+{
+    R sum = 0;
+    int expand[] = {0, (sum += a[K] * b[K * stride], 0)...};
+    (void)expand;
+    return sum;
+}
+
+template <uint32_t K, uint32_t M, typename R, typename A, typename B,
+          std::size_t... IJ>
+void fixedMultiplyUnrolled(const A *a, const B *b, R *out,
+                           std::index_sequence<IJ...>)
+{
+    int expand[] = {0, (out[IJ] = fixedDot<R>(a + IJ / M * K, b + IJ % M, M,
+                                              std::make_index_sequence<K>{}),
+                        0)...};
+    (void)expand;
+}
+
+/**
+ * \brief Умножение матриц фиксированного размера
+ * \details Для маленьких матриц (не больше fixedUnrollLimit умножений
+ * элементов) все циклы развернуты, для больших - обычные циклы с известными
+ * при компиляции границами
+ *
+ * \param a Матрица N x K, построчно
+ * \param b Матрица K x M, построчно
+ * \param out Матрица N x M, построчно
+ */
+template <uint32_t N, uint32_t K, uint32_t M, typename R, typename A,
+          typename B>
+void fixedMultiply(const A *a, const B *b, R *out, std::true_type)
+{
+    fixedMultiplyUnrolled<K, M>(a, b, out, std::make_index_sequence<N * M>{});
+}
+
+template <uint32_t N, uint32_t K, uint32_t M, typename R, typename A,
+          typename B>
+void fixedMultiply(const A *a, const B *b, R *out, std::false_type)
+{
+    for (uint32_t i = 0; i < N; ++i)
+    {
+        for (uint32_t j = 0; j < M; ++j)
+        {
+            R sum = 0;
+            for (uint32_t k = 0; k < K; ++k)
+                sum += a[i * K + k] * b[k * M + j];
+            out[i * M + j] = sum;
+        }
+    }
+}
+
+template <uint32_t N, uint32_t K, uint32_t M, typename R, typename A,
+          typename B>
+void fixedMultiply(const A *a, const B *b, R *out)
+{
+    fixedMultiply<N, K, M>(
+        a, b, out,
+        std::integral_constant<bool, std::size_t(N) * K * M <=
+                                         fixedUnrollLimit>{});
+}
+
+// Определитель и присоединенная матрица в замкнутом виде для матриц до 4x4.
+// Элементы приводятся к типу вычислений W до первой операции
+
+template <typename W, typename T>
+W fixedDet(const T *a, std::integral_constant<uint32_t, 1>)
+{
+    return W(a[0]);
+}
+
+template <typename W, typename T>
+W fixedDet(const T *a, std::integral_constant<uint32_t, 2>)
+{
+    return W(a[0]) * W(a[3]) - W(a[1]) * W(a[2]);
+}
+
+template <typename W, typename T>
+W fixedDet(const T *m, std::integral_constant<uint32_t, 3>)
+{
+    const W a00 = m[0], a01 = m[1], a02 = m[2], a10 = m[3], a11 = m[4],
+            a12 = m[5], a20 = m[6], a21 = m[7], a22 = m[8];
+    return a00 * (a11 * a22 - a12 * a21) - a01 * (a10 * a22 - a12 * a20) +
+           a02 * (a10 * a21 - a11 * a20);
+}
+
+/**
+ * \brief Миноры 2x2 матрицы 4x4
+ * \details s - миноры из строк 0 и 1, c - из строк 2 и 3; через них
+ * выражаются и определитель, и присоединенная матрица
+ */
+template <typename W> struct FixedMinors4
+{
+    W a[16];
+    W s[6];
+    W c[6];
+
+    template <typename T> explicit FixedMinors4(const T *m)
+    {
+        for (int i = 0; i < 16; ++i)
+            a[i] = W(m[i]);
+        s[0] = a[0] * a[5] - a[4] * a[1];
+        s[1] = a[0] * a[6] - a[4] * a[2];
+        s[2] = a[0] * a[7] - a[4] * a[3];
+        s[3] = a[1] * a[6] - a[5] * a[2];
+        s[4] = a[1] * a[7] - a[5] * a[3];
+        s[5] = a[2] * a[7] - a[6] * a[3];
+        c[5] = a[10] * a[15] - a[14] * a[11];
+        c[4] = a[9] * a[15] - a[13] * a[11];
+        c[3] = a[9] * a[14] - a[13] * a[10];
+        c[2] = a[8] * a[15] - a[12] * a[11];
+        c[1] = a[8] * a[14] - a[12] * a[10];
+        c[0] = a[8] * a[13] - a[12] * a[9];
+    }
+
+    W det() const
+    {
+        return s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] -
+               s[4] * c[1] + s[5] * c[0];
+    }
+};
+
+template <typename W, typename T>
+W fixedDet(const T *a, std::integral_constant<uint32_t, 4>)
+{
+    return FixedMinors4<W>(a).det();
+}
+
+template <typename W, typename T>
+void fixedAdjugate(const T *a, W *out, std::integral_constant<uint32_t, 1>)
+{
+    (void)a;
+    out[0] = W(1);
+}
+
+template <typename W, typename T>
+void fixedAdjugate(const T *a, W *out, std::integral_constant<uint32_t, 2>)
+{
+    out[0] = W(a[3]);
+    out[1] = -W(a[1]);
+    out[2] = -W(a[2]);
+    out[3] = W(a[0]);
+}
+
+template <typename W, typename T>
+void fixedAdjugate(const T *m, W *out, std::integral_constant<uint32_t, 3>)
+{
+    const W a00 = m[0], a01 = m[1], a02 = m[2], a10 = m[3], a11 = m[4],
+            a12 = m[5], a20 = m[6], a21 = m[7], a22 = m[8];
+    out[0] = a11 * a22 - a12 * a21;
+    out[1] = a02 * a21 - a01 * a22;
+    out[2] = a01 * a12 - a02 * a11;
+    out[3] = a12 * a20 - a10 * a22;
+    out[4] = a00 * a22 - a02 * a20;
+    out[5] = a02 * a10 - a00 * a12;
+    out[6] = a10 * a21 - a11 * a20;
+    out[7] = a01 * a20 - a00 * a21;
+    out[8] = a00 * a11 - a01 * a10;
+}
+
+template <typename W, typename T>
+void fixedAdjugate(const T *m, W *out, std::integral_constant<uint32_t, 4>)
+{
+    const FixedMinors4<W> n(m);
+    const W *a = n.a, *s = n.s, *c = n.c;
+    out[0] = a[5] * c[5] - a[6] * c[4] + a[7] * c[3];
+    out[1] = -a[1] * c[5] + a[2] * c[4] - a[3] * c[3];
+    out[2] = a[13] * s[5] - a[14] * s[4] + a[15] * s[3];
+    out[3] = -a[9] * s[5] + a[10] * s[4] - a[11] * s[3];
+    out[4] = -a[4] * c[5] + a[6] * c[2] - a[7] * c[1];
+    out[5] = a[0] * c[5] - a[2] * c[2] + a[3] * c[1];
+    out[6] = -a[12] * s[5] + a[14] * s[2] - a[15] * s[1];
+    out[7] = a[8] * s[5] - a[10] * s[2] + a[11] * s[1];
+    out[8] = a[4] * c[4] - a[5] * c[2] + a[7] * c[0];
+    out[9] = -a[0] * c[4] + a[1] * c[2] - a[3] * c[0];
+    out[10] = a[12] * s[4] - a[13] * s[2] + a[15] * s[0];
+    out[11] = -a[8] * s[4] + a[9] * s[2] - a[11] * s[0];
+    out[12] = -a[4] * c[3] + a[5] * c[1] - a[6] * c[0];
+    out[13] = a[0] * c[3] - a[1] * c[1] + a[2] * c[0];
+    out[14] = -a[12] * s[3] + a[13] * s[1] - a[14] * s[0];
+    out[15] = a[8] * s[3] - a[9] * s[1] + a[10] * s[0];
+}
+
+/// Есть ли для матрицы N x N формулы в замкнутом виде
+template <uint32_t N>
+struct HasClosedForm : std::integral_constant<bool, N >= 1 && N <= 4>
+{
+};
+
+} // namespace detail
+
+/**
+ * \brief Матрица фиксированного размера
+ * \details Размеры задаются параметрами шаблона, а элементы хранятся прямо в
+ * объекте (в `std::array`), поэтому создание, копирование и операции над
+ * такими матрицами не выделяют память. Предназначена для маленьких матриц
+ * (2x2-4x4 преобразований и т.п.), которые перемножаются в больших
+ * количествах:
+ * - умножение двух FixedMatrix возвращает FixedMatrix, несовпадение размеров
+ *   обнаруживается при компиляции; для маленьких матриц циклы умножения
+ *   полностью развернуты;
+ * - det() и inverse() для матриц до 4x4 считаются по формулам в замкнутом
+ *   виде, для больших - через MatrixGeneric;
+ * - FixedMatrix является \ref MatrixExpression "выражением", поэтому
+ *   работает со всеми операциями MatrixGeneric: сложение, вычитание и
+ *   умножение на скаляр вычисляются лениво и записываются обратно в
+ *   FixedMatrix без выделения памяти, умножение на MatrixGeneric передает
+ *   элементы в ядро умножения без копирования, а MatrixGeneric создается из
+ *   FixedMatrix неявно.
+ *
+ * Пример использования:
+ * \code
+ * FixedMatrix<double, 3, 3> rot = {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}};
+ * FixedMatrix<double, 3, 1> p = {{1}, {2}, {3}};
+ * FixedMatrix<double, 3, 1> q = rot * p + p;  // без выделений памяти
+ * MatrixGeneric<double> big = rot.inverse();  // преобразование в MatrixGeneric
+ * \endcode
+ *
+ * \tparam T Тип элементов, с теми же требованиями, что и у MatrixGeneric
+ * \tparam Rows Высота, больше нуля
+ * \tparam Cols Ширина, больше нуля
+ */
+template <typename T, uint32_t Rows, uint32_t Cols>
+class FixedMatrix : public MatrixExpression<FixedMatrix<T, Rows, Cols>>
+{
+    static_assert(Rows > 0 && Cols > 0,
+                  "FixedMatrix sizes must be greater than zero");
+
+  public:
+    using value_type = T; ///< Тип элементов матрицы
+
+    /**
+     * \brief Конструктор по умолчанию
+     * \details Создает матрицу, заполненную значениями `T()`
+     */
+    FixedMatrix() : _data{} {}
+
+    /**
+     * \brief Конструктор матрицы из initializer_list
+     * \details Так же, как и у MatrixGeneric:
+     * \code
+     * FixedMatrix<int, 2, 3> m = {{1, 2, 3},
+     *                             {4, 5, 6}};
+     * \endcode
+     *
+     * \param nums Список строк
+     * \exception matrix_initialization_error Если количество строк или их
+     * длина не совпадает с размерами матрицы
+     */
+    FixedMatrix(const std::initializer_list<std::initializer_list<T>> &nums)
+        : _data{}
+    {
+        if (nums.size() != Rows ||
+            std::any_of(nums.begin(), nums.end(),
+                        [](const std::initializer_list<T> &row)
+                        { return row.size() != Cols; }))
+            throw matrix_initialization_error("Invalid initializer list");
+
+        T *out = _data.data();
+        for (auto &row : nums)
+            out = std::copy(row.begin(), row.end(), out);
+    }
+
+    /**
+     * \brief Преобразование типа элементов
+     * \details Матрицы разных размеров друг в друга не преобразуются: такая
+     * попытка не скомпилируется
+     */
+    template <typename U, uint32_t R, uint32_t C>
+    explicit FixedMatrix(const FixedMatrix<U, R, C> &other)
+    {
+        static_assert(R == Rows && C == Cols,
+                      "FixedMatrix sizes don't match");
+        other.assignTo(_data.data(), Cols);
+    }
+
+    /**
+     * \brief Вычисление ленивого выражения
+     * \details Элементы выражения вида `a + b`, `2 * (a - b)` и т.п.
+     * вычисляются прямо в эту матрицу. MatrixGeneric сюда не попадает: она
+     * преобразуется только явно, см. FixedMatrix(const MatrixGeneric &)
+     *
+     * \param expr Выражение, тип элементов которого приводится к **T**
+     * \throw matrix_bad_operation Если размеры выражения не совпадают с
+     * размерами матрицы
+     */
+    template <typename E,
+              typename = std::enable_if_t<!detail::IsFixedMatrix<E>::value &&
+                                          !detail::IsMatrixGeneric<E>::value>>
+    FixedMatrix(const MatrixExpression<E> &expr)
+    {
+        _checkSize(expr.derived());
+        expr.derived().assignTo(_data.data(), Cols);
+    }
+
+    /**
+     * \brief Копирование матрицы MatrixGeneric
+     * \param m Матрица, тип элементов которой приводится к **T**
+     * \throw matrix_bad_operation Если размеры **m** не совпадают с размерами
+     * матрицы
+     */
+    template <typename U, typename Alloc>
+    explicit FixedMatrix(const MatrixGeneric<U, Alloc> &m)
+    {
+        _checkSize(m);
+        for (uint32_t i = 0; i < Rows; ++i)
+        {
+            const U *row = m.data() + i * m.stride();
+            std::transform(row, row + Cols, _data.begin() + i * Cols,
+                           [](const U &x) { return static_cast<T>(x); });
+        }
+    }
+
+    /**
+     * \brief Присваивание ленивого выражения
+     * \param expr Выражение, тип элементов которого приводится к **T**
+     * \return Ссылка на эту матрицу
+     * \throw matrix_bad_operation Если размеры выражения не совпадают с
+     * размерами матрицы
+     */
+    template <typename E> FixedMatrix &operator=(const MatrixExpression<E> &expr)
+    {
+        _checkSize(expr.derived());
+        // Выражение может ссылаться на эту же матрицу не поэлементно,
+        // например, a = a.transposeView()
+        std::array<T, Rows * Cols> tmp;
+        expr.derived().assignTo(tmp.data(), Cols);
+        _data = tmp;
+        return *this;
+    }
+
+    FixedMatrix(const FixedMatrix &) = default;
+    FixedMatrix &operator=(const FixedMatrix &) = default;
+
+    /**
+     * \brief Создание единичной матрицы
+     * \return Единичная матрица Rows x Rows
+     */
+    static FixedMatrix eye()
+    {
+        static_assert(Rows == Cols, "Identity matrix must be square");
+        FixedMatrix out;
+        for (uint32_t i = 0; i < Rows; ++i)
+            out._data[i * Cols + i] = T(1);
+        return out;
+    }
+
+    /**
+     * \brief Получение высоты
+     * \return Высота
+     */
+    static constexpr uint32_t height() noexcept { return Rows; }
+
+    /**
+     * \brief Получение ширины
+     * \return Ширина
+     */
+    static constexpr uint32_t width() noexcept { return Cols; }
+
+    /// \copydoc get()
+    T &get(uint32_t x, uint32_t y)
+    {
+        return const_cast<T &>(
+            const_cast<const FixedMatrix *>(this)->get(x, y));
+    }
+
+    /**
+     * \brief Получение элемента
+     * \details Получение элемента, находящегося в строке **x** и столбце **y**
+     * \note Нумерация строк и столбцов начинается с нуля
+     *
+     * \param x Строка элемента
+     * \param y Столбец элемента
+     * \return Ссылка на элемент
+     * \throw matrix_bad_access Если взятие элемента выходит за пределы матрицы
+     */
+    const T &get(uint32_t x, uint32_t y) const
+    {
+        if (x >= Rows || y >= Cols)
+            throw matrix_bad_access("Indexing is out of range");
+        return _data[x * Cols + y];
+    }
+
+    /// \copydoc data()
+    T *data() noexcept { return _data.data(); }
+
+    /**
+     * \brief Получение указателя на элементы матрицы
+     * \details Элементы хранятся построчно, как и у MatrixGeneric
+     * \return Указатель на первый элемент
+     */
+    const T *data() const noexcept { return _data.data(); }
+
+    /**
+     * \brief Шаг между строками в элементах
+     * \return Ширина матрицы: строки хранятся без дополнения
+     */
+    static constexpr std::size_t stride() noexcept { return Cols; }
+
+    /**
+     * \brief Представление всей матрицы
+     * \return Представление, ссылающееся на элементы этой матрицы
+     */
+    MatrixView<T> view() noexcept
+    {
+        return MatrixView<T>(_data.data(), Rows, Cols, Cols, 1);
+    }
+
+    /// \copydoc view()
+    MatrixView<const T> view() const noexcept
+    {
+        return MatrixView<const T>(_data.data(), Rows, Cols, Cols, 1);
+    }
+
+    /// Вычислитель для \ref MatrixExpression "выражений"
+    detail::DenseEvaluator<T> evaluator() const noexcept
+    {
+        return {_data.data(), Cols};
+    }
+
+    /**
+     * \brief Копирование элементов в буфер
+     * \param out Буфер из Rows строк по Cols элементов
+     * \param ld Шаг между строками буфера, не меньше Cols
+     */
+    template <typename U> void assignTo(U *out, std::size_t ld) const
+    {
+        for (uint32_t i = 0; i < Rows; ++i)
+        {
+            for (uint32_t j = 0; j < Cols; ++j)
+                out[i * ld + j] = static_cast<U>(_data[i * Cols + j]);
+        }
+    }
+
+    /**
+     * \brief Вычисление определителя матрицы
+     * \details Для матриц до 4x4 - по формуле в замкнутом виде (разложение
+     * по минорам 2x2 для 4x4), для больших - как MatrixGeneric::det(). Для
+     * целых типов определитель считается в double и округляется до
+     * ближайшего целого
+     *
+     * \return Определитель матрицы
+     */
+    T det() const
+    {
+        static_assert(Rows == Cols, "Determinant requires a square matrix");
+        return _det(detail::HasClosedForm<Rows>{});
+    }
+
+    /**
+     * \brief Транспонирование матрицы
+     * \return Транспонированная копия размером Cols x Rows
+     */
+    FixedMatrix<T, Cols, Rows> transpose() const
+    {
+        FixedMatrix<T, Cols, Rows> out;
+        for (uint32_t i = 0; i < Rows; ++i)
+        {
+            for (uint32_t j = 0; j < Cols; ++j)
+                out.data()[j * Rows + i] = _data[i * Cols + j];
+        }
+        return out;
+    }
+
+    /**
+     * \brief Обращение матрицы
+     * \details Для матриц до 4x4 - присоединенная матрица, деленная на
+     * определитель, для больших - как MatrixGeneric::inverse(). Вычисления
+     * ведутся в типе `T / float`
+     *
+     * \return Матрица, обратная данной
+     * \throw matrix_bad_inverse Если определитель матрицы равен нулю
+     */
+    FixedMatrix<DivType<T, float>, Rows, Cols> inverse() const
+    {
+        static_assert(Rows == Cols, "Inverse requires a square matrix");
+        return _inverse(detail::HasClosedForm<Rows>{});
+    }
+
+    /**
+     * \brief Возведение матрицы в степень
+     * \details Бинарное возведение в степень, как у MatrixGeneric::pow(), но
+     * все промежуточные матрицы лежат на стеке
+     *
+     * \param power Степень
+     * \return Исходная матрица в степени **power**
+     */
+    FixedMatrix pow(uint32_t power) const
+    {
+        static_assert(Rows == Cols, "Power requires a square matrix");
+        FixedMatrix out = eye(), base = *this;
+        bool first = true;
+        while (power != 0)
+        {
+            if (power & 1)
+            {
+                out = first ? base : FixedMatrix(out * base);
+                first = false;
+            }
+            power >>= 1;
+            if (power != 0)
+                base = FixedMatrix(base * base);
+        }
+        return out;
+    }
+
+  private:
+    std::array<T, Rows * Cols> _data; ///< Элементы матрицы построчно
+
+    template <typename M> static void _checkSize(const M &m)
+    {
+        if (m.height() != Rows || m.width() != Cols)
+        {
+            std::string what = "Sizes of matrices aren't equal: ";
+            what += std::to_string(m.height()) + "x" +
+                    std::to_string(m.width()) + " != " +
+                    std::to_string(Rows) + "x" + std::to_string(Cols);
+            throw matrix_bad_operation(what.c_str());
+        }
+    }
+
+    T _det(std::true_type) const
+    {
+        using W = detail::DetWorkType<T>;
+        return detail::castDeterminant<T>(
+            detail::fixedDet<W>(_data.data(),
+                                std::integral_constant<uint32_t, Rows>{}),
+            std::is_integral<T>{});
+    }
+
+    T _det(std::false_type) const { return MatrixGeneric<T>(*this).det(); }
+
+    FixedMatrix<DivType<T, float>, Rows, Cols> _inverse(std::true_type) const
+    {
+        using W = DivType<T, float>;
+        const auto size = std::integral_constant<uint32_t, Rows>{};
+        const W det = detail::fixedDet<W>(_data.data(), size);
+        if (det == W(0))
+            throw matrix_bad_inverse("Matrix determinant equals zero");
+
+        FixedMatrix<W, Rows, Cols> out;
+        detail::fixedAdjugate(_data.data(), out.data(), size);
+        for (uint32_t i = 0; i < Rows * Cols; ++i)
+            out.data()[i] /= det;
+        return out;
+    }
+
+    FixedMatrix<DivType<T, float>, Rows, Cols> _inverse(std::false_type) const
+    {
+        return FixedMatrix<DivType<T, float>, Rows, Cols>(
+            MatrixGeneric<T>(*this).inverse());
+    }
+};
+
+namespace detail
+{
+// Ссылки на FixedMatrix внутри выражений хранятся как листья-матрицы, без
+// копирования элементов, и поэлементные операции над ними идут через
+// векторные ядра
+
+template <typename T, uint32_t R, uint32_t C>
+struct ExprOperandImpl<FixedMatrix<T, R, C> &>
+{
+    using type = MatrixLeaf<const FixedMatrix<T, R, C> &>;
+};
+
+template <typename T, uint32_t R, uint32_t C>
+struct ExprOperandImpl<const FixedMatrix<T, R, C> &>
+{
+    using type = MatrixLeaf<const FixedMatrix<T, R, C> &>;
+};
+
+template <typename T, uint32_t R, uint32_t C>
+struct ExprOperandImpl<FixedMatrix<T, R, C>>
+{
+    using type = MatrixLeaf<FixedMatrix<T, R, C>>;
+};
+
+template <typename T, uint32_t R, uint32_t C>
+struct ExprOperandImpl<const FixedMatrix<T, R, C>>
+{
+    using type = MatrixLeaf<FixedMatrix<T, R, C>>;
+};
+} // namespace detail
+
+/**
+ * \brief Произведение матриц фиксированного размера
+ * \details Результат - FixedMatrix, память не выделяется
+ *
+ * \return Матрица R x C с элементами того же типа, что и у произведения
+ * MatrixGeneric
+ */
+template <typename A, typename B, uint32_t R, uint32_t K, uint32_t C>
+FixedMatrix<AddType<MulType<A, B>, MulType<A, B>>, R, C>
+operator*(const FixedMatrix<A, R, K> &a, const FixedMatrix<B, K, C> &b)
+{
+    FixedMatrix<AddType<MulType<A, B>, MulType<A, B>>, R, C> out;
+    detail::fixedMultiply<R, K, C>(a.data(), b.data(), out.data());
+    return out;
+}
+
+/// Умножение матриц фиксированного размера с несовместимыми размерами
+template <typename A, typename B, uint32_t R, uint32_t K1, uint32_t K2,
+          uint32_t C, typename = std::enable_if_t<K1 != K2>>
+void operator*(const FixedMatrix<A, R, K1> &,
+               const FixedMatrix<B, K2, C> &) = delete;
+
+/**
+ * \brief Произведение матрицы фиксированного размера и MatrixGeneric
+ * \details Элементы обеих матриц передаются в ядро умножения без копирования.
+ * Память под результат берется у распределителя MatrixGeneric
+ * \throw matrix_bad_operation Если размеры не позволяют произвести умножение
+ */
+template <typename A, typename B, typename Alloc, uint32_t R, uint32_t C>
+MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>,
+              RebindAlloc<Alloc, AddType<MulType<A, B>, MulType<A, B>>>>
+operator*(const FixedMatrix<A, R, C> &a, const MatrixGeneric<B, Alloc> &b)
+{
+    return detail::multiplyViews(
+        a.view(), detail::constView(b),
+        RebindAlloc<Alloc, AddType<MulType<A, B>, MulType<A, B>>>(
+            b.get_allocator()));
+}
+
+/// \copydoc operator*(const FixedMatrix<A, R, C> &, const MatrixGeneric<B, Alloc> &)
+template <typename A, typename Alloc, typename B, uint32_t R, uint32_t C>
+MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>,
+              RebindAlloc<Alloc, AddType<MulType<A, B>, MulType<A, B>>>>
+operator*(const MatrixGeneric<A, Alloc> &a, const FixedMatrix<B, R, C> &b)
+{
+    return detail::multiplyViews(
+        detail::constView(a), b.view(),
+        RebindAlloc<Alloc, AddType<MulType<A, B>, MulType<A, B>>>(
+            a.get_allocator()));
+}
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef __GAUSS_ELIMINATION
+#define __GAUSS_ELIMINATION
+
+#include "Exceptions.hpp"
+#include "MatrixGeneric.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+/**
+ * \file GaussElimination.hpp
+ * Файл, содержащий класс GaussElimination - прямой ход метода Гаусса с выбором
+ * главного элемента, которым считается MatrixGeneric::det()
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Прямой ход метода Гаусса
+ * \details Приводит прямоугольную матрицу к ступенчатому виду. Ведущий
+ * элемент выбирается наибольшим по модулю: в столбце (Pivoting::Partial) или
+ * во всей оставшейся подматрице (Pivoting::Full). Элемент, не превосходящий
+ * по модулю порога, считается нулем: при частичном выборе столбец
+ * пропускается, при полном исключение заканчивается. Число ведущих элементов
+ * - ранг матрицы, их произведение с учетом знака перестановок - определитель.
+ *
+ * В отличие от LUDecomposition множители не сохраняются и обнуляются только
+ * строки ниже ведущей, так что разложение занимает n^3 / 3 умножений, а
+ * матрица может быть прямоугольной.
+ *
+ * Пример использования:
+ * \code
+ * MatrixGeneric<double> a = {{1, 2, 3}, {2, 4, 6.000001}};
+ * GaussElimination<double> exact(a, Pivoting::Full, 0);
+ * GaussElimination<double> loose(a, Pivoting::Full, 1e-3);
+ * exact.rank(); // 2
+ * loose.rank(); // 1
+ * \endcode
+ *
+ * \tparam T Тип элементов исходной матрицы
+ * \tparam Work Тип, в котором ведутся вычисления. По умолчанию - как у
+ * MatrixGeneric<T>::det(): double для целых типов, иначе `T / float`
+ * \tparam Alloc Распределитель памяти для копии матрицы
+ */
+template <typename T, typename Work, typename Alloc> class GaussElimination
+{
+  public:
+    using value_type = Work;      ///< Тип элементов, в котором ведется счет
+    using allocator_type = Alloc; ///< Распределитель памяти
+
+    /**
+     * \brief Порог, который выбирается по матрице
+     * \details Если передать его конструктору, порог будет равен
+     * `max(h, w) * eps * max|a_ij|` - погрешности округления, которую
+     * накапливает исключение
+     *
+     * \return Отрицательное значение - признак автоматического порога
+     */
+    static value_type autoTolerance() noexcept { return value_type(-1); }
+
+    /**
+     * \brief Приведение матрицы к ступенчатому виду
+     *
+     * \param a Матрица или ее \ref MatrixView "представление"
+     * \param pivoting Способ выбора ведущего элемента
+     * \param tolerance Наибольший модуль элемента, который считается нулем.
+     * При нулевом пороге нулем считается только точный ноль. По умолчанию -
+     * autoTolerance()
+     * \param alloc Распределитель памяти для копии матрицы
+     */
+    explicit GaussElimination(MatrixView<const T> a,
+                              Pivoting pivoting = Pivoting::Partial,
+                              value_type tolerance = autoTolerance(),
+                              const Alloc &alloc = Alloc())
+        : _height(a.height()), _width(a.width()),
+          _data(std::size_t(a.height()) * a.width(), alloc),
+          _pivots(RebindAlloc<Alloc, value_type>(alloc))
+    {
+        a.assignTo(_data.data(), _width);
+        _tolerance = tolerance < value_type(0) ? _autoTolerance() : tolerance;
+        _pivots.reserve(std::min(_height, _width));
+
+        if (pivoting == Pivoting::Full)
+            _eliminateFull();
+        else
+            _eliminatePartial();
+    }
+
+    /**
+     * \brief Ранг матрицы
+     * \return Количество ведущих элементов, больших порога по модулю
+     */
+    uint32_t rank() const noexcept { return uint32_t(_pivots.size()); }
+
+    /**
+     * \brief Порог, с которым велось исключение
+     * \return Наибольший модуль элемента, который считался нулем
+     */
+    value_type tolerance() const noexcept { return _tolerance; }
+
+    /**
+     * \brief Определитель матрицы
+     * \details Произведение ведущих элементов с учетом знака перестановок
+     * строк и столбцов.
+     *
+     * Временная сложность: O(n)
+     *
+     * \return Определитель; ноль, если ранг меньше размера. Для пустой
+     * матрицы - единица
+     * \throw matrix_bad_det Если матрица не квадратная
+     */
+    value_type det() const
+    {
+        if (_height != _width)
+            throw matrix_bad_det("Matrix isn't square");
+        if (rank() < _height)
+            return value_type(0);
+
+        value_type out = value_type(_sign);
+        for (const value_type &p : _pivots)
+            out *= p;
+        return out;
+    }
+
+  private:
+    uint32_t _height, ///< Высота матрицы
+        _width;       ///< Ширина матрицы
+    /// Копия матрицы построчно, приводится к ступенчатому виду
+    std::vector<value_type, Alloc> _data;
+    /// Ведущие элементы в порядке исключения
+    std::vector<value_type, RebindAlloc<Alloc, value_type>> _pivots;
+    value_type _tolerance; ///< Порог, см. tolerance()
+    int _sign{1};          ///< Четность перестановок строк и столбцов
+
+    /// Объем работы одного шага исключения, начиная с которого он
+    /// распараллеливается
+    static constexpr uint64_t _parallelThreshold = uint64_t(1) << 14;
+
+    value_type &_at(uint32_t i, uint32_t j)
+    {
+        return _data[std::size_t(i) * _width + j];
+    }
+
+    value_type _autoTolerance() const
+    {
+        using std::abs;
+        value_type norm = value_type(0);
+        for (const value_type &x : _data)
+            norm = std::max<value_type>(norm, abs(x));
+        return value_type(std::max(_height, _width)) *
+               std::numeric_limits<value_type>::epsilon() * norm;
+    }
+
+    /**
+     * \brief Выбор ведущего элемента по столбцу
+     * \details Строка **row** - следующая ведущая, в столбце **col** ищется
+     * наибольший по модулю элемент среди строк ниже. Если он не больше порога,
+     * столбец пропускается
+     */
+    void _eliminatePartial()
+    {
+        using std::abs;
+
+        uint32_t row = 0;
+        for (uint32_t col = 0; col < _width && row < _height; ++col)
+        {
+            uint32_t pivot = row;
+            for (uint32_t i = row + 1; i < _height; ++i)
+            {
+                if (abs(_at(i, col)) > abs(_at(pivot, col)))
+                    pivot = i;
+            }
+            if (abs(_at(pivot, col)) <= _tolerance)
+                continue;
+
+            if (pivot != row)
+            {
+                std::swap_ranges(&_at(row, col), &_at(row, 0) + _width,
+                                 &_at(pivot, col));
+                _sign = -_sign;
+            }
+            _eliminateBelow(row, col);
+            ++row;
+        }
+    }
+
+    /**
+     * \brief Выбор ведущего элемента по всей оставшейся подматрице
+     * \details Ведущий элемент переставляется на диагональ перестановкой
+     * строк и столбцов. Если он не больше порога, остаток матрицы считается
+     * нулевым
+     */
+    void _eliminateFull()
+    {
+        using std::abs;
+
+        for (uint32_t k = 0; k < std::min(_height, _width); ++k)
+        {
+            uint32_t pi = k, pj = k;
+            for (uint32_t i = k; i < _height; ++i)
+            {
+                for (uint32_t j = k; j < _width; ++j)
+                {
+                    if (abs(_at(i, j)) > abs(_at(pi, pj)))
+                    {
+                        pi = i;
+                        pj = j;
+                    }
+                }
+            }
+            if (abs(_at(pi, pj)) <= _tolerance)
+                break;
+
+            if (pi != k)
+            {
+                std::swap_ranges(&_at(k, k), &_at(k, 0) + _width, &_at(pi, k));
+                _sign = -_sign;
+            }
+            if (pj != k)
+            {
+                for (uint32_t i = k; i < _height; ++i)
+                    std::swap(_at(i, k), _at(i, pj));
+                _sign = -_sign;
+            }
+            _eliminateBelow(k, k);
+        }
+    }
+
+    /**
+     * \brief Обнуление столбца **col** ниже ведущей строки **row**
+     * \details Столбцы левее **col** в строках ниже ведущей уже нулевые и не
+     * читаются, поэтому не пересчитываются. При большом объеме работы строки
+     * делятся между потоками \ref ThreadPool::global() "общего пула"
+     */
+    void _eliminateBelow(uint32_t row, uint32_t col)
+    {
+        const value_type *rowK = &_at(row, 0);
+        _pivots.push_back(rowK[col]);
+
+        auto eliminate = [this, rowK, col](uint32_t lo, uint32_t hi)
+        {
+            for (uint32_t i = lo; i < hi; ++i)
+            {
+                value_type *rowI = &_at(i, 0);
+                value_type mult = rowI[col] / rowK[col];
+                if (mult == value_type(0))
+                    continue;
+                for (uint32_t j = col + 1; j < _width; ++j)
+                    rowI[j] -= mult * rowK[j];
+            }
+        };
+
+        uint64_t rest = uint64_t(_height - row - 1) * (_width - col - 1);
+        if (rest >= _parallelThreshold)
+            ThreadPool::global().parallelFor(row + 1, _height, 16, eliminate);
+        else
+            eliminate(row + 1, _height);
+    }
+};
+
+#endif
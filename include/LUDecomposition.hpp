@@ -0,0 +1,408 @@
+#ifndef __LU_DECOMPOSITION
+#define __LU_DECOMPOSITION
+
+#include "Exceptions.hpp"
+#include "MatrixGeneric.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * \file LUDecomposition.hpp
+ * Файл, содержащий класс LUDecomposition - LU-разложение квадратной матрицы с
+ * частичным выбором главного элемента
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief LU-разложение квадратной матрицы
+ * \details Раскладывает матрицу A в произведение PA = LU, где P - матрица
+ * перестановки строк, L - нижнетреугольная матрица с единицами на диагонали, U
+ * - верхнетреугольная. На каждом шаге в качестве ведущего выбирается
+ * наибольший по модулю элемент столбца.
+ *
+ * Разложение считается один раз за O(n^3), после чего определитель находится
+ * за O(n), а решение системы с k правыми частями - за O(n^2 * k). L и U
+ * хранятся в одном массиве n x n, это единственная аллокация разложения.
+ *
+ * Пример использования:
+ * \code
+ * MatrixGeneric<double> a = {{2, 1}, {4, 3}}, b = {{1}, {2}};
+ * LUDecomposition<double> lu(a);
+ * auto x = lu.solve(b); // a * x == b
+ * \endcode
+ *
+ * \tparam T Тип элементов исходной матрицы
+ * \tparam Work Тип, в котором ведутся вычисления. По умолчанию - тип частного
+ * `T / float`, как и у MatrixGeneric<T>::inverse()
+ * \tparam Alloc Распределитель памяти для разложения и результатов
+ */
+template <typename T, typename Work, typename Alloc> class LUDecomposition
+{
+  public:
+    using value_type = Work;      ///< Тип элементов разложения и результатов
+    using allocator_type = Alloc; ///< Распределитель памяти
+
+    /**
+     * \brief Разложение матрицы
+     * \details Если на каком-то шаге весь остаток столбца нулевой, матрица
+     * вырождена: исключение продолжается со следующего столбца, а методы
+     * solve() и inverse() будут выбрасывать исключение
+     *
+     * \param a Раскладываемая матрица или ее \ref MatrixView "представление"
+     * \param alloc Распределитель памяти для разложения
+     * \throw matrix_bad_operation Если матрица не квадратная
+     */
+    explicit LUDecomposition(MatrixView<const T> a, const Alloc &alloc = Alloc())
+        : _size(a.height()), _lu(std::size_t(a.height()) * a.width(), alloc),
+          _perm(a.height(), RebindAlloc<Alloc, uint32_t>(alloc))
+    {
+        if (a.height() != a.width())
+            throw matrix_bad_operation("Matrix isn't square");
+
+        a.assignTo(_lu.data(), _size);
+        std::iota(_perm.begin(), _perm.end(), 0u);
+        _factorize();
+    }
+
+    /**
+     * \brief Размер разложенной матрицы
+     * \return Длина стороны матрицы
+     */
+    uint32_t size() const noexcept { return _size; }
+
+    /**
+     * \brief Вырождена ли матрица
+     * \return true, если определитель равен нулю
+     */
+    bool isSingular() const noexcept { return _singular; }
+
+    /**
+     * \brief Перестановка строк
+     * \return Вектор, в i-той позиции которого стоит номер строки исходной
+     * матрицы, ставшей i-той строкой PA
+     */
+    const std::vector<uint32_t, RebindAlloc<Alloc, uint32_t>> &
+    permutation() const noexcept
+    {
+        return _perm;
+    }
+
+    /**
+     * \brief Определитель исходной матрицы
+     * \details Произведение диагонали U с учетом знака перестановки.
+     *
+     * Временная сложность: O(n)
+     *
+     * \return Определитель. Для пустой матрицы - единица
+     */
+    value_type det() const
+    {
+        if (_singular)
+            return value_type(0);
+
+        value_type out = value_type(_sign);
+        for (uint32_t i = 0; i < _size; ++i)
+            out *= _at(i, i);
+        return out;
+    }
+
+    /**
+     * \brief Решение системы A * X = B
+     * \details Все столбцы B решаются одновременно: прямой и обратный ход идут
+     * по строкам X целиком, а для широкой правой части - блоками строк, вклад
+     * которых вычитается блочным умножением.
+     *
+     * Временная сложность: O(n^2 * k), где k - ширина B
+     *
+     * \tparam S Тип элементов правой части
+     * \param b Матрица правых частей или ее \ref MatrixView "представление"
+     * \return Решение X размером n x k. Память берется у распределителя
+     * разложения
+     * \throw matrix_bad_operation Если высота B не совпадает с размером
+     * матрицы или если матрица вырождена
+     */
+    template <typename S>
+    MatrixGeneric<value_type, Alloc> solve(MatrixView<S> b) const
+    {
+        if (b.height() != _size)
+            throw matrix_bad_operation(
+                "Height of right-hand side doesn't match the matrix");
+        if (_singular)
+            throw matrix_bad_operation("Matrix is singular");
+
+        MatrixGeneric<value_type, Alloc> x(b.height(), b.width(),
+                                           _lu.get_allocator());
+        for (uint32_t i = 0; i < _size; ++i)
+            b.row(_perm[i]).assignTo(x.data() + std::size_t(i) * x.stride(),
+                                     x.stride());
+        _solveInPlace(x.data(), b.width(), x.stride());
+        return x;
+    }
+
+    /// \copydoc solve()
+    template <typename S, typename SAlloc>
+    MatrixGeneric<value_type, Alloc> solve(const MatrixGeneric<S, SAlloc> &b) const
+    {
+        return solve(MatrixView<const S>(b));
+    }
+
+    /**
+     * \brief Обратная матрица
+     * \details Решение системы A * X = E, где в качестве правой части сразу
+     * берется переставленная единичная матрица.
+     *
+     * Временная сложность: O(n^3)
+     *
+     * \return Матрица, обратная исходной. Память берется у распределителя
+     * разложения
+     * \throw matrix_bad_inverse Если матрица вырождена
+     */
+    MatrixGeneric<value_type, Alloc> inverse() const
+    {
+        if (_singular)
+            throw matrix_bad_inverse("Matrix determinant equals zero");
+
+        MatrixGeneric<value_type, Alloc> x(_size, _size, _lu.get_allocator());
+        for (uint32_t i = 0; i < _size; ++i)
+            x.data()[std::size_t(i) * x.stride() + _perm[i]] = value_type(1);
+        _solveInPlace(x.data(), _size, x.stride());
+        return x;
+    }
+
+  private:
+    uint32_t _size;                     ///< Длина стороны матрицы
+    std::vector<value_type, Alloc> _lu; ///< L и U построчно в одном массиве
+    /// Перестановка строк, см. permutation()
+    std::vector<uint32_t, RebindAlloc<Alloc, uint32_t>> _perm;
+    int _sign{1};                 ///< Четность перестановки
+    bool _singular{false};        ///< Вырождена ли матрица
+
+    /// Объем работы одного шага исключения, начиная с которого он
+    /// распараллеливается
+    static constexpr uint64_t _parallelThreshold = uint64_t(1) << 14;
+    /// Высота блока строк в блочном прямом и обратном ходе
+    static constexpr uint32_t _block = 64;
+    /// Ширина правой части, начиная с которой ход идет блоками
+    static constexpr uint32_t _blockedColumns = 16;
+
+    value_type &_at(uint32_t i, uint32_t j)
+    {
+        return _lu[std::size_t(i) * _size + j];
+    }
+
+    const value_type &_at(uint32_t i, uint32_t j) const
+    {
+        return _lu[std::size_t(i) * _size + j];
+    }
+
+    /**
+     * \brief Разложение Гаусса с выбором главного элемента по столбцу
+     * \details Множители L записываются на место обнуляемых элементов
+     */
+    void _factorize()
+    {
+        using std::abs;
+
+        for (uint32_t k = 0; k < _size; ++k)
+        {
+            uint32_t pivot = k;
+            for (uint32_t i = k + 1; i < _size; ++i)
+            {
+                if (abs(_at(i, k)) > abs(_at(pivot, k)))
+                    pivot = i;
+            }
+
+            if (_at(pivot, k) == value_type(0))
+            {
+                _singular = true;
+                continue;
+            }
+
+            if (pivot != k)
+            {
+                std::swap_ranges(&_at(k, 0), &_at(k, 0) + _size, &_at(pivot, 0));
+                std::swap(_perm[k], _perm[pivot]);
+                _sign = -_sign;
+            }
+
+            const value_type *rowK = &_at(k, 0);
+            auto eliminate = [this, k, rowK](uint32_t lo, uint32_t hi)
+            {
+                for (uint32_t i = lo; i < hi; ++i)
+                {
+                    value_type *rowI = &_at(i, 0);
+                    value_type mult = rowI[k] / rowK[k];
+                    rowI[k] = mult;
+                    for (uint32_t j = k + 1; j < _size; ++j)
+                        rowI[j] -= mult * rowK[j];
+                }
+            };
+
+            uint64_t rest = _size - k - 1;
+            if (rest * rest >= _parallelThreshold)
+                ThreadPool::global().parallelFor(k + 1, _size, 16, eliminate);
+            else
+                eliminate(k + 1, _size);
+        }
+    }
+
+    /**
+     * \brief Прямой и обратный ход
+     * \details Столбцы правой части независимы, поэтому при большом объеме
+     * работы они делятся между потоками \ref ThreadPool::global() "общего
+     * пула"
+     *
+     * \param x Переставленная правая часть, n строк по **cols** элементов.
+     * Заменяется решением
+     * \param ld Шаг между строками **x**
+     */
+    void _solveInPlace(value_type *x, uint32_t cols, std::size_t ld) const
+    {
+        if (uint64_t(_size) * _size * cols >= _parallelThreshold * 64)
+        {
+            ThreadPool::global().parallelFor(
+                0, cols, 64, [this, x, ld](uint32_t lo, uint32_t hi)
+                { _solveColumns(x, ld, lo, hi); });
+        }
+        else
+        {
+            _solveColumns(x, ld, 0, cols);
+        }
+    }
+
+    /**
+     * \brief Прямой и обратный ход для столбцов [**lo**, **hi**)
+     * \copydetails _solveInPlace()
+     */
+    void _solveColumns(value_type *x, std::size_t ld, uint32_t lo,
+                       uint32_t hi) const
+    {
+        _solveColumns(x, ld, lo, hi,
+                      detail::UseBlockedGemm<value_type, value_type,
+                                             value_type>{});
+    }
+
+    /**
+     * \brief Блочный прямой и обратный ход
+     * \details Строки делятся на блоки по _block. Вклад уже найденных строк
+     * в очередной блок вычитается одним умножением gemm(), так что основная
+     * часть работы идет блочным ядром, а подстановка остается только внутри
+     * блоков на диагонали. Для узкой правой части умножение не окупается
+     * упаковкой, и ход идет построчно
+     */
+    void _solveColumns(value_type *x, std::size_t ld, uint32_t lo, uint32_t hi,
+                       std::true_type) const
+    {
+        const uint32_t cols = hi - lo;
+        if (cols < _blockedColumns || _size <= _block)
+        {
+            _solveColumns(x, ld, lo, hi, std::false_type{});
+            return;
+        }
+
+        // Буфер под произведение; решения разных столбцов могут идти
+        // в разных потоках, поэтому память берется не у распределителя
+        // разложения
+        std::vector<value_type> update(std::size_t(_block) * cols);
+        auto subtract = [&](uint32_t ib, uint32_t ie)
+        {
+            for (uint32_t i = ib; i < ie; ++i)
+            {
+                value_type *xi = x + i * ld + lo;
+                const value_type *ui = update.data() + std::size_t(i - ib) * cols;
+                for (uint32_t j = 0; j < cols; ++j)
+                    xi[j] -= ui[j];
+            }
+        };
+
+        // L * Y = PB
+        for (uint32_t ib = 0; ib < _size; ib += _block)
+        {
+            uint32_t ie = std::min(ib + _block, _size);
+            if (ib > 0)
+            {
+                detail::gemm(ie - ib, cols, ib, &_at(ib, 0), _size, 1, x + lo,
+                             ld, 1, update.data(), cols);
+                subtract(ib, ie);
+            }
+            _forward(x, ld, lo, hi, ib, ie);
+        }
+
+        // U * X = Y
+        for (uint32_t ie = _size; ie > 0;)
+        {
+            uint32_t ib = ie > _block ? ie - _block : 0;
+            if (ie < _size)
+            {
+                detail::gemm(ie - ib, cols, _size - ie, &_at(ib, ie), _size, 1,
+                             x + ie * ld + lo, ld, 1, update.data(), cols);
+                subtract(ib, ie);
+            }
+            _backward(x, ld, lo, hi, ib, ie);
+            ie = ib;
+        }
+    }
+
+    /// Построчный прямой и обратный ход для типов без блочного ядра
+    void _solveColumns(value_type *x, std::size_t ld, uint32_t lo, uint32_t hi,
+                       std::false_type) const
+    {
+        _forward(x, ld, lo, hi, 0, _size);
+        _backward(x, ld, lo, hi, 0, _size);
+    }
+
+    /**
+     * \brief Подстановка L * Y = PB в строках [**ib**, **ie**)
+     * \details Вклад строк выше **ib** уже вычтен
+     */
+    void _forward(value_type *x, std::size_t ld, uint32_t lo, uint32_t hi,
+                  uint32_t ib, uint32_t ie) const
+    {
+        for (uint32_t i = ib + 1; i < ie; ++i)
+        {
+            value_type *xi = x + i * ld;
+            for (uint32_t k = ib; k < i; ++k)
+            {
+                value_type l = _at(i, k);
+                if (l == value_type(0))
+                    continue;
+                const value_type *xk = x + k * ld;
+                for (uint32_t j = lo; j < hi; ++j)
+                    xi[j] -= l * xk[j];
+            }
+        }
+    }
+
+    /**
+     * \brief Подстановка U * X = Y в строках [**ib**, **ie**)
+     * \details Вклад строк ниже **ie** уже вычтен
+     */
+    void _backward(value_type *x, std::size_t ld, uint32_t lo, uint32_t hi,
+                   uint32_t ib, uint32_t ie) const
+    {
+        for (uint32_t i = ie; i-- > ib;)
+        {
+            value_type *xi = x + i * ld;
+            for (uint32_t k = i + 1; k < ie; ++k)
+            {
+                value_type u = _at(i, k);
+                if (u == value_type(0))
+                    continue;
+                const value_type *xk = x + k * ld;
+                for (uint32_t j = lo; j < hi; ++j)
+                    xi[j] -= u * xk[j];
+            }
+            value_type diag = _at(i, i);
+            for (uint32_t j = lo; j < hi; ++j)
+                xi[j] /= diag;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef __MAPPED_FILE
+#define __MAPPED_FILE
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * \file MappedFile.hpp
+ * Файл, содержащий класс MappedFile - файл, отображенный в память только для
+ * чтения. Используется калькулятором в режиме `--mmap`
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Файл, отображенный в память
+ * \details Отображает файл целиком с помощью mmap(). Данные не копируются в
+ * пространство процесса: страницы подгружаются из страничного кеша по мере
+ * чтения, и повторные запуски над тем же файлом читают его из кеша. Ядру
+ * сообщается, что файл будет читаться последовательно.
+ *
+ * Пример использования:
+ * \code
+ * MappedFile file("matrices.txt");
+ * TokenReader reader(file.begin(), file.end());
+ * \endcode
+ */
+class MappedFile
+{
+  public:
+    /**
+     * \brief Конструктор по умолчанию
+     * \details Создает пустой объект, не связанный с файлом
+     */
+    MappedFile() = default;
+
+    /**
+     * \brief Отображение файла
+     * \param path Путь к файлу
+     * \throw std::runtime_error Если файл не удалось открыть или отобразить
+     */
+    explicit MappedFile(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            _fail("can't open", path);
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+        {
+            int error = errno;
+            ::close(fd);
+            errno = error;
+            _fail("can't map", path);
+        }
+
+        _size = static_cast<std::size_t>(info.st_size);
+        if (_size != 0)
+        {
+            void *data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                int error = errno;
+                ::close(fd);
+                errno = error;
+                _fail("can't map", path);
+            }
+            _data = static_cast<const char *>(data);
+            ::madvise(data, _size, MADV_SEQUENTIAL);
+        }
+        // Отображение остается действительным и после закрытия дескриптора
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept
+        : _data(other._data), _size(other._size)
+    {
+        other._data = nullptr;
+        other._size = 0;
+    }
+
+    MappedFile &operator=(MappedFile &&other) noexcept
+    {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        if (_data)
+            ::munmap(const_cast<char *>(_data), _size);
+    }
+
+    /**
+     * \brief Начало данных
+     * \return Указатель на первый байт файла или nullptr для пустого файла
+     */
+    const char *begin() const noexcept { return _data; }
+
+    /**
+     * \brief Конец данных
+     * \return Указатель за последний байт файла
+     */
+    const char *end() const noexcept { return _data + _size; }
+
+    /**
+     * \brief Размер файла
+     * \return Размер в байтах
+     */
+    std::size_t size() const noexcept { return _size; }
+
+  private:
+    const char *_data{nullptr}; ///< Отображенные данные
+    std::size_t _size{0};       ///< Размер файла
+
+    [[noreturn]] static void _fail(const char *what, const std::string &path)
+    {
+        throw std::runtime_error(std::string(what) + " " + path + ": " +
+                                 std::strerror(errno));
+    }
+};
+
+#endif
@@ -0,0 +1,523 @@
+#ifndef __MATRIX_ALLOCATOR
+#define __MATRIX_ALLOCATOR
+
+#include "MatrixGeneric.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * \file MatrixAllocator.hpp
+ * Файл, содержащий распределители памяти для элементов матриц: арену
+ * (ArenaResource), пул блоков по классам размеров (PoolResource),
+ * распределитель ResourceAllocator, через который их использует
+ * MatrixGeneric, и распределитель выровненной памяти AlignedAllocator
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Источник памяти для ResourceAllocator
+ * \details Аналог `std::pmr::memory_resource` для C++14. Все матрицы с
+ * ResourceAllocator имеют один и тот же тип независимо от того, из какого
+ * источника они берут память, поэтому их можно смешивать в выражениях
+ */
+class MemoryResource
+{
+  public:
+    virtual ~MemoryResource() = default;
+
+    /**
+     * \brief Выделение памяти
+     * \param bytes Размер блока в байтах
+     * \param alignment Выравнивание, степень двойки
+     * \return Указатель на блок
+     * \throw std::bad_alloc Если память не удалось выделить
+     */
+    virtual void *allocate(std::size_t bytes, std::size_t alignment) = 0;
+
+    /**
+     * \brief Освобождение памяти
+     * \details Параметры совпадают с переданными в allocate()
+     */
+    virtual void deallocate(void *p, std::size_t bytes,
+                            std::size_t alignment) noexcept = 0;
+
+    /**
+     * \brief Источник памяти текущего потока
+     * \details Задается \ref ResourceScope. Его используют ResourceAllocator,
+     * созданные конструктором по умолчанию
+     *
+     * \return Источник или nullptr, если память берется из кучи
+     */
+    static MemoryResource *current() noexcept { return _current(); }
+
+  private:
+    friend class ResourceScope;
+
+    static MemoryResource *&_current() noexcept
+    {
+        static thread_local MemoryResource *resource = nullptr;
+        return resource;
+    }
+};
+
+/**
+ * \brief Арена: выделение памяти сдвигом указателя
+ * \details Память берется из крупных кусков последовательно, освобождение
+ * отдельных блоков ничего не делает. Вся память возвращается разом методом
+ * reset(), после чего арену можно использовать заново. Если за прошлый проход
+ * понадобилось несколько кусков, reset() заменяет их одним суммарного размера,
+ * так что повторяющиеся вычисления одного вида не обращаются к куче вовсе.
+ *
+ * Арена не потокобезопасна: ее заводят на каждый запрос или на каждый поток.
+ * Матрицы, выделенные в арене, должны быть уничтожены или скопированы в
+ * другую память до вызова reset().
+ *
+ * Пример использования:
+ * \code
+ * ArenaResource arena;
+ * for (auto &request : requests)
+ * {
+ *     ResourceScope scope(&arena);
+ *     ResourceMatrix<double> a = request.a, b = request.b;
+ *     MatrixGeneric<double> result(a * b.inverse() + a); // копия в кучу
+ *     arena.reset();
+ * }
+ * \endcode
+ */
+class ArenaResource : public MemoryResource
+{
+  public:
+    /// Размер куска по умолчанию
+    static constexpr std::size_t defaultChunkSize = std::size_t(1) << 20;
+
+    /**
+     * \brief Создание арены
+     * \details Память не выделяется до первого запроса
+     * \param chunkSize Минимальный размер куска в байтах
+     */
+    explicit ArenaResource(std::size_t chunkSize = defaultChunkSize)
+        : _chunkSize(chunkSize ? chunkSize : defaultChunkSize)
+    {
+    }
+
+    ArenaResource(const ArenaResource &) = delete;
+    ArenaResource &operator=(const ArenaResource &) = delete;
+
+    ~ArenaResource() override { release(); }
+
+    void *allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        while (true)
+        {
+            if (_current < _chunks.size())
+            {
+                const Chunk &chunk = _chunks[_current];
+                std::uintptr_t base = reinterpret_cast<std::uintptr_t>(chunk.data);
+                std::uintptr_t start =
+                    (base + _offset + alignment - 1) & ~(alignment - 1);
+                std::size_t end = std::size_t(start - base) + bytes;
+                if (end <= chunk.size)
+                {
+                    _used += end - _offset;
+                    _offset = end;
+                    return reinterpret_cast<void *>(start);
+                }
+                if (++_current < _chunks.size())
+                {
+                    _offset = 0;
+                    continue;
+                }
+            }
+
+            if (bytes > std::numeric_limits<std::size_t>::max() - alignment)
+                throw std::bad_alloc();
+            std::size_t size = std::max(_chunkSize, bytes + alignment);
+            _chunks.push_back({static_cast<char *>(::operator new(size)), size});
+            _current = _chunks.size() - 1;
+            _offset = 0;
+        }
+    }
+
+    /// Ничего не делает: память возвращается методом reset()
+    void deallocate(void *, std::size_t, std::size_t) noexcept override {}
+
+    /**
+     * \brief Освобождение всех блоков арены
+     * \details Память остается за ареной и выдается заново. Несколько кусков
+     * объединяются в один
+     */
+    void reset()
+    {
+        if (_chunks.size() > 1)
+        {
+            std::size_t total = capacity();
+            release();
+            _chunks.push_back(
+                {static_cast<char *>(::operator new(total)), total});
+        }
+        _current = 0;
+        _offset = 0;
+        _used = 0;
+    }
+
+    /**
+     * \brief Возврат всей памяти арены в кучу
+     */
+    void release() noexcept
+    {
+        for (const Chunk &chunk : _chunks)
+            ::operator delete(chunk.data);
+        _chunks.clear();
+        _current = 0;
+        _offset = 0;
+        _used = 0;
+    }
+
+    /**
+     * \brief Объем памяти, выданной с последнего reset()
+     * \return Количество байт с учетом выравнивания
+     */
+    std::size_t used() const noexcept { return _used; }
+
+    /**
+     * \brief Объем памяти, принадлежащей арене
+     * \return Суммарный размер кусков в байтах
+     */
+    std::size_t capacity() const noexcept
+    {
+        std::size_t total = 0;
+        for (const Chunk &chunk : _chunks)
+            total += chunk.size;
+        return total;
+    }
+
+  private:
+    /// Кусок памяти, из которого выдаются блоки
+    struct Chunk
+    {
+        char *data;
+        std::size_t size;
+    };
+
+    std::size_t _chunkSize;      ///< Минимальный размер куска
+    std::vector<Chunk> _chunks;  ///< Все куски арены
+    std::size_t _current{0};     ///< Кусок, из которого идет выдача
+    std::size_t _offset{0};      ///< Занятая часть текущего куска
+    std::size_t _used{0};        ///< См. used()
+};
+
+/**
+ * \brief Пул блоков по классам размеров
+ * \details Запрос округляется вверх до степени двойки от 64 байт до 1 МиБ, и
+ * блок берется из списка свободных блоков своего класса. Освобожденные блоки
+ * возвращаются в список и переиспользуются, память в кучу не отдается до
+ * release() или уничтожения пула. Блоки больше 1 МиБ выделяются в куче
+ * напрямую.
+ *
+ * В отличие от арены, пул подходит для долгоживущих матриц разных размеров.
+ * Пул защищен мьютексом, но выделение из списка занимает O(1); чтобы потоки
+ * не ждали друг друга, каждому потоку заводят свой пул.
+ */
+class PoolResource : public MemoryResource
+{
+  public:
+    static constexpr std::size_t minBlockSize = 64; ///< Наименьший класс
+    static constexpr std::size_t maxBlockSize = std::size_t(1) << 20; ///< Наибольший класс
+    static constexpr std::size_t defaultChunkSize = std::size_t(1) << 18; ///< Размер куска по умолчанию
+
+    /**
+     * \brief Создание пула
+     * \param chunkSize Размер куска, который делится на блоки одного класса.
+     * Для классов больше куска кусок содержит один блок
+     */
+    explicit PoolResource(std::size_t chunkSize = defaultChunkSize)
+        : _chunkSize(chunkSize)
+    {
+    }
+
+    PoolResource(const PoolResource &) = delete;
+    PoolResource &operator=(const PoolResource &) = delete;
+
+    ~PoolResource() override { release(); }
+
+    void *allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (alignment > alignof(std::max_align_t))
+            throw std::bad_alloc();
+        if (bytes > maxBlockSize)
+            return ::operator new(bytes);
+
+        std::size_t cls = _sizeClass(bytes);
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_free[cls])
+            _refill(cls);
+        FreeBlock *block = _free[cls];
+        _free[cls] = block->next;
+        return block;
+    }
+
+    void deallocate(void *p, std::size_t bytes, std::size_t) noexcept override
+    {
+        if (bytes > maxBlockSize)
+        {
+            ::operator delete(p);
+            return;
+        }
+
+        std::size_t cls = _sizeClass(bytes);
+        std::lock_guard<std::mutex> lock(_mutex);
+        FreeBlock *block = static_cast<FreeBlock *>(p);
+        block->next = _free[cls];
+        _free[cls] = block;
+    }
+
+    /**
+     * \brief Возврат всей памяти пула в кучу
+     * \details Все блоки пула к этому моменту должны быть освобождены
+     */
+    void release() noexcept
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (void *chunk : _chunks)
+            ::operator delete(chunk);
+        _chunks.clear();
+        std::fill(std::begin(_free), std::end(_free), nullptr);
+    }
+
+  private:
+    /// Свободный блок хранит указатель на следующий свободный блок класса
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    /// Количество классов размеров: от minBlockSize до maxBlockSize
+    static constexpr std::size_t _classes = 15;
+
+    std::size_t _chunkSize;          ///< Размер куска
+    std::mutex _mutex;               ///< Защищает списки и куски
+    FreeBlock *_free[_classes] = {}; ///< Свободные блоки каждого класса
+    std::vector<void *> _chunks;     ///< Все куски пула
+
+    /// Номер класса для блока из **bytes** байт
+    static std::size_t _sizeClass(std::size_t bytes) noexcept
+    {
+        std::size_t cls = 0;
+        for (std::size_t size = minBlockSize; size < bytes; size <<= 1)
+            ++cls;
+        return cls;
+    }
+
+    /// Нарезка нового куска на блоки класса **cls**
+    void _refill(std::size_t cls)
+    {
+        std::size_t block = minBlockSize << cls;
+        std::size_t count = std::max<std::size_t>(1, _chunkSize / block);
+        char *chunk = static_cast<char *>(::operator new(block * count));
+        _chunks.push_back(chunk);
+
+        for (std::size_t i = count; i-- > 0;)
+        {
+            FreeBlock *free = reinterpret_cast<FreeBlock *>(chunk + i * block);
+            free->next = _free[cls];
+            _free[cls] = free;
+        }
+    }
+};
+
+/**
+ * \brief Установка источника памяти текущего потока
+ * \details Пока объект жив, ResourceAllocator, созданные конструктором по
+ * умолчанию в этом потоке, берут память из **resource**. Это касается и
+ * матриц, которые создают операции над ResourceMatrix (например, результат
+ * `a + b`). Области вкладываются: при уничтожении восстанавливается прежний
+ * источник. Другие потоки, в том числе потоки ThreadPool, источник не
+ * наследуют
+ */
+class ResourceScope
+{
+  public:
+    /**
+     * \param resource Источник памяти или nullptr для кучи
+     */
+    explicit ResourceScope(MemoryResource *resource) noexcept
+        : _previous(MemoryResource::_current())
+    {
+        MemoryResource::_current() = resource;
+    }
+
+    ResourceScope(const ResourceScope &) = delete;
+    ResourceScope &operator=(const ResourceScope &) = delete;
+
+    ~ResourceScope() { MemoryResource::_current() = _previous; }
+
+  private:
+    MemoryResource *_previous; ///< Источник до создания области
+};
+
+/**
+ * \brief Распределитель, берущий память из MemoryResource
+ * \details Источник запоминается при создании распределителя. Как и у
+ * `std::pmr::polymorphic_allocator`, при присваивании матрица сохраняет свой
+ * источник, а копия матрицы берет память из того же источника, что и
+ * оригинал. Результаты операций берут память из источника первого операнда
+ *
+ * \tparam T Тип элементов
+ */
+template <typename T> class ResourceAllocator
+{
+  public:
+    using value_type = T; ///< Тип элементов
+
+    /**
+     * \brief Распределитель для источника текущего потока
+     * \sa MemoryResource::current()
+     */
+    ResourceAllocator() noexcept : _resource(MemoryResource::current()) {}
+
+    /**
+     * \brief Распределитель для заданного источника
+     * \param resource Источник памяти или nullptr для кучи
+     */
+    ResourceAllocator(MemoryResource *resource) noexcept : _resource(resource)
+    {
+    }
+
+    template <typename U>
+    ResourceAllocator(const ResourceAllocator<U> &other) noexcept
+        : _resource(other.resource())
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+            throw std::bad_alloc();
+        std::size_t bytes = n * sizeof(T);
+        return static_cast<T *>(_resource ? _resource->allocate(bytes, alignof(T))
+                                          : ::operator new(bytes));
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+        if (_resource)
+            _resource->deallocate(p, n * sizeof(T), alignof(T));
+        else
+            ::operator delete(p);
+    }
+
+    /**
+     * \brief Источник памяти
+     * \return Источник или nullptr, если память берется из кучи
+     */
+    MemoryResource *resource() const noexcept { return _resource; }
+
+  private:
+    MemoryResource *_resource; ///< Источник памяти
+};
+
+template <typename A, typename B>
+bool operator==(const ResourceAllocator<A> &a,
+                const ResourceAllocator<B> &b) noexcept
+{
+    return a.resource() == b.resource();
+}
+
+template <typename A, typename B>
+bool operator!=(const ResourceAllocator<A> &a,
+                const ResourceAllocator<B> &b) noexcept
+{
+    return !(a == b);
+}
+
+/// Матрица, берущая память из MemoryResource, см. ResourceAllocator
+template <typename T>
+using ResourceMatrix = MatrixGeneric<T, ResourceAllocator<T>>;
+
+/// Размер строки кеша, по которой по умолчанию выравнивается AlignedAllocator
+constexpr std::size_t cacheLineSize = 64;
+
+/**
+ * \brief Распределитель выровненной памяти
+ * \details Выдает блоки, начинающиеся с адреса, кратного **Alignment**.
+ * MatrixGeneric с таким распределителем дополняет строки до кратного
+ * **Alignment** размера (см. MatrixGeneric::stride()), поэтому каждая строка
+ * начинается с границы строки кеша, и векторные загрузки не пересекают ее
+ * границ. Платой за это служит дополнение: для матрицы из double ширины 5
+ * строка занимает 8 элементов
+ *
+ * \tparam T Тип элементов
+ * \tparam Alignment Выравнивание в байтах, степень двойки не меньше
+ * `alignof(T)` и размера указателя
+ */
+template <typename T, std::size_t Alignment = cacheLineSize>
+class AlignedAllocator
+{
+    static_assert((Alignment & (Alignment - 1)) == 0,
+                  "Alignment must be a power of two");
+    static_assert(Alignment >= alignof(T) && Alignment >= sizeof(void *),
+                  "Alignment is too small");
+
+  public:
+    using value_type = T; ///< Тип элементов
+    static constexpr std::size_t alignment = Alignment; ///< Выравнивание
+
+    template <typename U> struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        if (n > (std::numeric_limits<std::size_t>::max() - Alignment) /
+                    sizeof(T))
+            throw std::bad_alloc();
+
+        // Перед выровненным блоком хранится указатель на выделенную память
+        char *raw = static_cast<char *>(::operator new(n * sizeof(T) + Alignment));
+        std::uintptr_t start =
+            (reinterpret_cast<std::uintptr_t>(raw) + Alignment) &
+            ~std::uintptr_t(Alignment - 1);
+        reinterpret_cast<void **>(start)[-1] = raw;
+        return reinterpret_cast<T *>(start);
+    }
+
+    void deallocate(T *p, std::size_t) noexcept
+    {
+        ::operator delete(reinterpret_cast<void **>(p)[-1]);
+    }
+};
+
+template <typename A, typename B, std::size_t Alignment>
+bool operator==(const AlignedAllocator<A, Alignment> &,
+                const AlignedAllocator<B, Alignment> &) noexcept
+{
+    return true;
+}
+
+template <typename A, typename B, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<A, Alignment> &,
+                const AlignedAllocator<B, Alignment> &) noexcept
+{
+    return false;
+}
+
+/// Матрица с выровненными строками, см. AlignedAllocator
+template <typename T>
+using AlignedMatrix = MatrixGeneric<T, AlignedAllocator<T>>;
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef __MATRIX_BINARY
+#define __MATRIX_BINARY
+
+#include "Exceptions.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+/**
+ * \file MatrixBinary.hpp
+ * Файл, содержащий двоичный формат хранения матриц, которым пользуются
+ * MatrixGeneric::save(), MatrixGeneric::load() и калькулятор
+ * \author dmsukhikh
+ */
+
+/*
+ * Формат файла (все многобайтовые поля - в порядке байт, указанном в поле
+ * endian):
+ *
+ * смещение  размер  поле
+ *  0        8       сигнатура "\x89TSPPMX\n"
+ *  8        2       версия формата (1)
+ * 10        1       тип элементов, см. detail::binaryTypeCode()
+ * 11        1       размер элемента в байтах
+ * 12        1       порядок байт: 1 - little-endian, 2 - big-endian
+ * 13        3       зарезервировано (нули)
+ * 16        4       высота
+ * 20        4       ширина
+ * 24        8       смещение данных от начала заголовка (64)
+ * 32       32       зарезервировано (нули)
+ * 64        ...     элементы построчно, без разделителей
+ *
+ * Данные начинаются со смещения, кратного 64 байтам, так что в отображенном в
+ * память файле они выровнены под любые векторные загрузки.
+ */
+
+namespace detail
+{
+
+/// Размер заголовка двоичного файла
+constexpr std::size_t binaryHeaderSize = 64;
+
+/// Сигнатура двоичного файла. Первый байт не встречается в текстовых файлах
+constexpr char binaryMagic[8] = {'\x89', 'T', 'S', 'P', 'P', 'M', 'X', '\n'};
+
+/// Версия формата
+constexpr uint16_t binaryVersion = 1;
+
+/**
+ * \brief Код типа элементов в заголовке
+ * \details 1 - int32, 2 - int64, 3 - float32, 4 - float64, 5 - uint32,
+ * 6 - uint64; 0 - тип не поддерживается форматом
+ */
+template <typename T> constexpr uint8_t binaryTypeCode()
+{
+    if (std::is_floating_point<T>::value)
+        return sizeof(T) == 4 ? 3 : sizeof(T) == 8 ? 4 : 0;
+    if (std::is_integral<T>::value && sizeof(T) == 4)
+        return std::is_signed<T>::value ? 1 : 5;
+    if (std::is_integral<T>::value && sizeof(T) == 8)
+        return std::is_signed<T>::value ? 2 : 6;
+    return 0;
+}
+
+/// Порядок байт текущей платформы в терминах поля endian
+inline uint8_t nativeEndian()
+{
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1 ? 1 : 2;
+}
+
+/// Разворот порядка байт в каждом из **count** элементов размером **size**
+inline void swapBytes(char *data, std::size_t count, std::size_t size)
+{
+    for (std::size_t i = 0; i < count; ++i, data += size)
+        std::reverse(data, data + size);
+}
+
+/// Разобранный заголовок двоичного файла
+struct BinaryHeader
+{
+    uint8_t type;        ///< Код типа элементов
+    uint8_t elementSize; ///< Размер элемента в байтах
+    bool swap;           ///< Отличается ли порядок байт от текущей платформы
+    uint32_t height;     ///< Высота
+    uint32_t width;      ///< Ширина
+    uint64_t offset;     ///< Смещение данных от начала заголовка
+};
+
+/**
+ * \brief Начинается ли участок памяти с сигнатуры двоичного файла
+ * \param data Не меньше sizeof(binaryMagic) байт
+ */
+inline bool isBinaryMatrix(const char *data)
+{
+    return std::memcmp(data, binaryMagic, sizeof(binaryMagic)) == 0;
+}
+
+/**
+ * \brief Заполнение заголовка для матрицы с элементами типа **T**
+ * \param[out] out Буфер размером binaryHeaderSize
+ */
+template <typename T>
+void encodeBinaryHeader(uint32_t height, uint32_t width, char *out)
+{
+    static_assert(binaryTypeCode<T>() != 0,
+                  "Binary format supports only 32/64-bit integers, float and "
+                  "double elements");
+
+    const uint64_t offset = binaryHeaderSize;
+    std::memset(out, 0, binaryHeaderSize);
+    std::memcpy(out, binaryMagic, sizeof(binaryMagic));
+    std::memcpy(out + 8, &binaryVersion, 2);
+    out[10] = char(binaryTypeCode<T>());
+    out[11] = char(sizeof(T));
+    out[12] = char(nativeEndian());
+    std::memcpy(out + 16, &height, 4);
+    std::memcpy(out + 20, &width, 4);
+    std::memcpy(out + 24, &offset, 8);
+}
+
+/// Количество доступных байт, если источник не знает, сколько их осталось
+constexpr uint64_t binaryUnknownSize = std::numeric_limits<uint64_t>::max();
+
+/**
+ * \brief Количество байт от текущей позиции до конца потока
+ * \return binaryUnknownSize, если поток не поддерживает позиционирование
+ * (например, канал)
+ */
+inline uint64_t streamRemaining(std::istream &in)
+{
+    const std::streampos pos = in.tellg();
+    if (pos == std::streampos(-1))
+        return binaryUnknownSize;
+    in.seekg(0, std::ios::end);
+    const std::streampos end = in.tellg();
+    in.clear();
+    in.seekg(pos);
+    if (end == std::streampos(-1) || end < pos)
+        return binaryUnknownSize;
+    return uint64_t(std::streamoff(end - pos));
+}
+
+/**
+ * \brief Разбор заголовка
+ * \details Размеры из заголовка сверяются с **available**: поврежденный или
+ * обрезанный файл не должен приводить к выделению памяти под элементы,
+ * которых в нем нет
+ *
+ * \param data Буфер размером binaryHeaderSize
+ * \param available Сколько байт доступно после заголовка;
+ * binaryUnknownSize, если неизвестно
+ * \return Разобранный заголовок
+ * \throw matrix_io_error Если заголовок некорректен или данных меньше, чем
+ * в нем указано
+ */
+inline BinaryHeader decodeBinaryHeader(const char *data,
+                                       uint64_t available = binaryUnknownSize)
+{
+    if (!isBinaryMatrix(data))
+        throw matrix_io_error("Not a binary matrix: bad magic");
+
+    uint8_t endian = uint8_t(data[12]);
+    if (endian != 1 && endian != 2)
+        throw matrix_io_error("Bad binary matrix header: unknown byte order");
+
+    BinaryHeader header;
+    header.swap = endian != nativeEndian();
+    auto field = [&](std::size_t pos, std::size_t size, void *out)
+    {
+        char bytes[8];
+        std::memcpy(bytes, data + pos, size);
+        if (header.swap)
+            std::reverse(bytes, bytes + size);
+        std::memcpy(out, bytes, size);
+    };
+
+    uint16_t version;
+    field(8, 2, &version);
+    if (version != binaryVersion)
+        throw matrix_io_error(
+            ("Unsupported binary matrix version " + std::to_string(version))
+                .c_str());
+
+    header.type = uint8_t(data[10]);
+    header.elementSize = uint8_t(data[11]);
+    const std::size_t sizes[] = {0, 4, 8, 4, 8, 4, 8};
+    if (header.type == 0 || header.type > 6 ||
+        header.elementSize != sizes[header.type])
+        throw matrix_io_error("Bad binary matrix header: unknown element type");
+
+    field(16, 4, &header.height);
+    field(20, 4, &header.width);
+    field(24, 8, &header.offset);
+    if ((header.height == 0) != (header.width == 0))
+        throw matrix_io_error("Only both height and width can be zero");
+    if (header.offset < binaryHeaderSize)
+        throw matrix_io_error("Bad binary matrix header: bad data offset");
+
+    const uint64_t count = uint64_t(header.height) * header.width;
+    if (count > std::numeric_limits<std::size_t>::max() / 8)
+        throw matrix_io_error("Bad binary matrix header: matrix is too large");
+    const uint64_t gap = header.offset - binaryHeaderSize;
+    if (gap > available || count * header.elementSize > available - gap)
+        throw matrix_io_error("Binary matrix is truncated");
+    return header;
+}
+
+/**
+ * \brief Чтение элементов с приведением типа
+ * \details Элементы читаются кусками через буфер в стеке, разворачиваются при
+ * другом порядке байт и приводятся к **T**
+ */
+template <typename Stored, typename T, typename Read>
+void readConverted(const BinaryHeader &header, T *out, std::size_t count,
+                   Read &read)
+{
+    constexpr std::size_t chunk = 1024;
+    Stored buf[chunk];
+    for (std::size_t done = 0; done < count; done += chunk)
+    {
+        std::size_t n = std::min(chunk, count - done);
+        if (!read(reinterpret_cast<char *>(buf), n * sizeof(Stored)))
+            throw matrix_io_error("Binary matrix is truncated");
+        if (header.swap)
+            swapBytes(reinterpret_cast<char *>(buf), n, sizeof(Stored));
+        for (std::size_t i = 0; i < n; ++i)
+            out[done + i] = static_cast<T>(buf[i]);
+    }
+}
+
+/**
+ * \brief Чтение элементов матрицы, описанной заголовком
+ * \details Если тип в файле совпадает с **T**, элементы читаются прямо в
+ * **out** без промежуточных копий. Иначе они приводятся к **T**, как при
+ * static_cast
+ *
+ * \param header Заголовок, данные за которым еще не прочитаны
+ * \param out Буфер из height * width элементов
+ * \param read Функция вида `bool(char *out, std::size_t bytes)`, читающая
+ * следующие байты сразу после заголовка
+ * \throw matrix_io_error Если данных не хватает
+ */
+template <typename T, typename Read>
+void readBinaryPayload(const BinaryHeader &header, T *out, Read read)
+{
+    // Пропуск байт между заголовком и данными, если они есть
+    for (uint64_t skip = header.offset - binaryHeaderSize; skip != 0;)
+    {
+        char buf[256];
+        std::size_t n = std::size_t(std::min<uint64_t>(skip, sizeof(buf)));
+        if (!read(buf, n))
+            throw matrix_io_error("Binary matrix is truncated");
+        skip -= n;
+    }
+
+    const std::size_t count = std::size_t(header.height) * header.width;
+    if (header.type == binaryTypeCode<T>() && header.elementSize == sizeof(T))
+    {
+        if (!read(reinterpret_cast<char *>(out), count * sizeof(T)))
+            throw matrix_io_error("Binary matrix is truncated");
+        if (header.swap)
+            swapBytes(reinterpret_cast<char *>(out), count, sizeof(T));
+        return;
+    }
+
+    switch (header.type)
+    {
+    case 1:
+        return readConverted<int32_t>(header, out, count, read);
+    case 2:
+        return readConverted<int64_t>(header, out, count, read);
+    case 3:
+        return readConverted<float>(header, out, count, read);
+    case 4:
+        return readConverted<double>(header, out, count, read);
+    case 5:
+        return readConverted<uint32_t>(header, out, count, read);
+    default:
+        return readConverted<uint64_t>(header, out, count, read);
+    }
+}
+
+} // namespace detail
+
+#endif
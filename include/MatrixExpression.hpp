@@ -0,0 +1,587 @@
+#ifndef __MATRIX_EXPRESSION
+#define __MATRIX_EXPRESSION
+
+#include "Exceptions.hpp"
+#include "MatrixSimd.hpp"
+#include "MatrixTypes.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+/**
+ * \file MatrixExpression.hpp
+ * Файл, содержащий шаблоны выражений (expression templates) для поэлементных
+ * операций над матрицами: сложения, вычитания и умножения на скаляр
+ * \author dmsukhikh
+ */
+
+// forward declaration
+template <typename T, typename Alloc = std::allocator<T>> class MatrixGeneric;
+template <typename T> class MatrixView;
+
+/**
+ * \brief Базовый класс ленивых матричных выражений
+ * \details operator+(), operator-() и умножение на скаляр не вычисляют
+ * результат сразу, а возвращают объект-выражение, хранящий дерево операций.
+ * Выражение вычисляется за один проход по элементам, когда оно присваивается
+ * в MatrixGeneric или когда у него вызывается метод, требующий готовой
+ * матрицы. Так, `a + b - c` выделяет память только под итоговую матрицу.
+ *
+ * Размеры операндов проверяются при построении выражения, поэтому исключения
+ * выбрасываются там же, где и раньше.
+ *
+ * Пример использования:
+ * \code
+ * MatrixGeneric<double> a = {{1, 2}, {3, 4}}, b = MatrixGeneric<double>::eye(2);
+ * MatrixGeneric<double> c = 2.0 * (a + b) - a; // один проход, одна аллокация
+ * \endcode
+ *
+ * \warning Выражение хранит ссылки на матрицы-lvalue, из которых оно
+ * построено (временные матрицы оно хранит по значению). Поэтому выражение,
+ * сохраненное в `auto`, не должно переживать свои операнды.
+ *
+ * \tparam E Тип конкретного выражения (CRTP)
+ */
+template <typename E> class MatrixExpression
+{
+  public:
+    /**
+     * \brief Конкретное выражение
+     * \return Ссылка на выражение типа **E**
+     */
+    const E &derived() const noexcept { return static_cast<const E &>(*this); }
+
+    /**
+     * \brief Получение элемента
+     * \details Вычисляет один элемент выражения, не вычисляя остальные
+     *
+     * \param x Строка элемента
+     * \param y Столбец элемента
+     * \return Значение элемента
+     * \throw matrix_bad_access Если взятие элемента выходит за пределы матрицы
+     */
+    auto get(uint32_t x, uint32_t y) const
+    {
+        const E &e = derived();
+        if (x >= e.height() || y >= e.width())
+            throw matrix_bad_access("Indexing is out of range");
+        return e.evaluator()(x, y);
+    }
+
+    /**
+     * \brief Вычисление выражения
+     * \return Матрица с элементами типа E::value_type
+     */
+    auto eval() const
+    {
+        return MatrixGeneric<typename E::value_type>(*this);
+    }
+
+    /// \copydoc MatrixGeneric::det()
+    auto det() const { return eval().det(); }
+
+    /// \copydoc MatrixGeneric::transpose()
+    auto transpose() const { return eval().transpose(); }
+
+    /// \copydoc MatrixGeneric::inverse()
+    auto inverse() const { return eval().inverse(); }
+
+    /// \copydoc MatrixGeneric::pow()
+    auto pow(uint32_t power) const { return eval().pow(power); }
+
+    /// \copydoc MatrixGeneric::rk()
+    uint32_t rk() const { return eval().rk(); }
+
+  protected:
+    MatrixExpression() = default;
+};
+
+namespace detail
+{
+
+/// Является ли **T** матрицей MatrixGeneric
+template <typename T> struct IsMatrixGeneric : std::false_type
+{
+};
+
+template <typename T, typename Alloc>
+struct IsMatrixGeneric<MatrixGeneric<T, Alloc>> : std::true_type
+{
+};
+
+/// Является ли **T** ленивым выражением
+template <typename T>
+struct IsMatrixExpression : std::is_base_of<MatrixExpression<T>, T>
+{
+};
+
+/// Может ли **T** (с точностью до ссылок и cv) быть операндом матричной
+/// операции
+template <typename T>
+struct IsMatrixOperand
+    : std::integral_constant<
+          bool, IsMatrixGeneric<std::decay_t<T>>::value ||
+                    IsMatrixExpression<std::decay_t<T>>::value>
+{
+};
+
+/// Может ли **T** быть скаляром в произведении на матрицу. Матричные типы
+/// вне выражений (например, SparseMatrix) специализируют его как
+/// std::false_type, чтобы их произведение на MatrixGeneric не считалось
+/// умножением на число
+template <typename T> struct IsScalarOperand : std::true_type
+{
+};
+
+/// Оба операнда матричные, и хотя бы один из них - ленивое выражение
+template <typename L, typename R>
+struct IsLazyOperandPair
+    : std::integral_constant<bool,
+                             IsMatrixOperand<L>::value &&
+                                 IsMatrixOperand<R>::value &&
+                                 (IsMatrixExpression<std::decay_t<L>>::value ||
+                                  IsMatrixExpression<std::decay_t<R>>::value)>
+{
+};
+
+/**
+ * \brief Проверка совпадения размеров операндов поэлементной операции
+ * \throw matrix_bad_operation Если размеры не совпадают
+ */
+template <typename L, typename R> void checkSameSize(const L &a, const R &b)
+{
+    if (a.height() != b.height() || a.width() != b.width())
+    {
+        std::string what = "Sizes of matrices aren't equal: ";
+        what += std::to_string(a.height()) + "x" + std::to_string(a.width());
+        what += " != ";
+        what += std::to_string(b.height()) + "x" + std::to_string(b.width());
+        throw matrix_bad_operation(what.c_str());
+    }
+}
+
+// Вычислители (evaluators) - то, во что выражение превращается на время
+// вычисления: деревья из сырых указателей, шагов и скаляров без проверок,
+// которые компилятор может встроить и векторизовать в одном цикле
+
+/// Вычислитель матрицы, хранящейся построчно
+template <typename T> struct DenseEvaluator
+{
+    const T *data;
+    std::size_t ld; ///< Шаг между строками
+
+    const T &operator()(uint32_t i, uint32_t j) const
+    {
+        return data[i * ld + j];
+    }
+};
+
+/// Вычислитель матрицы с произвольными шагами, см. MatrixView
+template <typename T> struct StridedEvaluator
+{
+    const T *data;
+    std::size_t rs; ///< Шаг между строками
+    std::size_t cs; ///< Шаг между столбцами
+
+    const T &operator()(uint32_t i, uint32_t j) const
+    {
+        return data[i * rs + j * cs];
+    }
+};
+
+/// Вычислитель бинарной поэлементной операции
+template <typename Op, typename L, typename R> struct BinaryEvaluator
+{
+    L lhs;
+    R rhs;
+
+    auto operator()(uint32_t i, uint32_t j) const
+    {
+        return Op::apply(lhs(i, j), rhs(i, j));
+    }
+};
+
+/// Вычислитель умножения на скаляр
+template <typename Scalar, typename E> struct ScaleEvaluator
+{
+    Scalar scalar;
+    E expr;
+
+    auto operator()(uint32_t i, uint32_t j) const
+    {
+        return scalar * expr(i, j);
+    }
+};
+
+/**
+ * \brief Вычисление выражения в буфер
+ * \details Единственный проход по элементам всего дерева выражения
+ *
+ * \param out Буфер из **height** строк с шагом **ld**
+ */
+template <typename U, typename Evaluator>
+void evaluate(const Evaluator &e, uint32_t height, uint32_t width, U *out,
+              std::size_t ld)
+{
+    for (uint32_t i = 0; i < height; ++i)
+    {
+        U *row = out + i * ld;
+        for (uint32_t j = 0; j < width; ++j)
+            row[j] = static_cast<U>(e(i, j));
+    }
+}
+
+/**
+ * \brief Лист выражения - матрица
+ * \tparam M `const MatrixGeneric<T> &` для lvalue-операндов или
+ * `MatrixGeneric<T>` для временных матриц, которые выражение забирает себе
+ */
+template <typename M> class MatrixLeaf
+{
+  public:
+    using value_type = typename std::decay_t<M>::value_type;
+
+    explicit MatrixLeaf(M m) : _m(std::forward<M>(m)) {}
+
+    uint32_t height() const noexcept { return _m.height(); }
+    uint32_t width() const noexcept { return _m.width(); }
+    const value_type *data() const noexcept { return _m.data(); }
+    std::size_t stride() const noexcept { return _m.stride(); }
+    DenseEvaluator<value_type> evaluator() const noexcept
+    {
+        return {_m.data(), _m.stride()};
+    }
+
+  private:
+    M _m;
+};
+
+template <typename T> struct IsMatrixLeaf : std::false_type
+{
+};
+
+template <typename M> struct IsMatrixLeaf<MatrixLeaf<M>> : std::true_type
+{
+};
+
+/// Как хранится операнд типа **X** (выведенного из `X&&`) внутри выражения
+template <typename X> struct ExprOperandImpl
+{
+    using type = std::decay_t<X>;
+};
+
+template <typename T, typename Alloc>
+struct ExprOperandImpl<MatrixGeneric<T, Alloc> &>
+{
+    using type = MatrixLeaf<const MatrixGeneric<T, Alloc> &>;
+};
+
+template <typename T, typename Alloc>
+struct ExprOperandImpl<const MatrixGeneric<T, Alloc> &>
+{
+    using type = MatrixLeaf<const MatrixGeneric<T, Alloc> &>;
+};
+
+template <typename T, typename Alloc>
+struct ExprOperandImpl<MatrixGeneric<T, Alloc>>
+{
+    using type = MatrixLeaf<MatrixGeneric<T, Alloc>>;
+};
+
+template <typename T, typename Alloc>
+struct ExprOperandImpl<const MatrixGeneric<T, Alloc>>
+{
+    using type = MatrixLeaf<MatrixGeneric<T, Alloc>>;
+};
+
+template <typename X> using ExprOperand = typename ExprOperandImpl<X>::type;
+
+/// Операция сложения для MatrixBinaryExpression
+struct AddOp
+{
+    template <typename A, typename B> using result = AddType<A, B>;
+
+    template <typename A, typename B>
+    static auto apply(const A &a, const B &b)
+    {
+        return a + b;
+    }
+
+    template <typename R, typename A, typename B>
+    static void kernel(const A *a, const B *b, R *out, std::size_t n)
+    {
+        simd::add(a, b, out, n, simd::UseSimd<R, A, B>{});
+    }
+};
+
+/// Операция вычитания для MatrixBinaryExpression
+struct SubOp
+{
+    template <typename A, typename B> using result = SubsType<A, B>;
+
+    template <typename A, typename B>
+    static auto apply(const A &a, const B &b)
+    {
+        return a - b;
+    }
+
+    template <typename R, typename A, typename B>
+    static void kernel(const A *a, const B *b, R *out, std::size_t n)
+    {
+        simd::sub(a, b, out, n, simd::UseSimd<R, A, B>{});
+    }
+};
+
+/**
+ * \brief Поэлементное ядро над построчно хранящимися матрицами
+ * \details Если шаги строк у всех буферов совпадают, ядро вызывается один
+ * раз для всего буфера вместе с дополнением строк, иначе - по строкам
+ *
+ * \param ld Шаг строк буфера результата
+ * \param strides Шаги строк операндов
+ * \param kernel Функция `kernel(i, n)`: обработка n подряд идущих элементов,
+ * начиная со строки i
+ */
+template <typename Kernel>
+void rowwise(uint32_t height, uint32_t width, std::size_t ld,
+             std::initializer_list<std::size_t> strides, Kernel kernel)
+{
+    if (height == 0)
+        return;
+
+    bool same = true;
+    for (std::size_t s : strides)
+        same = same && s == ld;
+    if (same)
+    {
+        kernel(0, std::size_t(height - 1) * ld + width);
+        return;
+    }
+
+    for (uint32_t i = 0; i < height; ++i)
+        kernel(i, width);
+}
+
+} // namespace detail
+
+/**
+ * \brief Ленивая поэлементная операция над двумя матрицами
+ * \details Тип элементов выводится так же, как и у неленивых операций: для
+ * сложения - AddType, для вычитания - SubsType от типов элементов операндов.
+ * Если оба операнда - матрицы, а не выражения, используются векторные ядра из
+ * MatrixSimd.hpp
+ *
+ * \tparam Op detail::AddOp или detail::SubOp
+ * \tparam L, R Типы операндов: detail::MatrixLeaf или другие выражения
+ */
+template <typename Op, typename L, typename R>
+class MatrixBinaryExpression
+    : public MatrixExpression<MatrixBinaryExpression<Op, L, R>>
+{
+  public:
+    using value_type = typename Op::template result<typename L::value_type,
+                                                    typename R::value_type>;
+
+    /**
+     * \throw matrix_bad_operation Если размеры операндов не совпадают
+     */
+    template <typename LA, typename RA>
+    MatrixBinaryExpression(LA &&lhs, RA &&rhs)
+        : _lhs(std::forward<LA>(lhs)), _rhs(std::forward<RA>(rhs))
+    {
+        detail::checkSameSize(_lhs, _rhs);
+    }
+
+    uint32_t height() const noexcept { return _lhs.height(); }
+    uint32_t width() const noexcept { return _lhs.width(); }
+
+    auto evaluator() const
+    {
+        using Evaluator =
+            detail::BinaryEvaluator<Op, decltype(_lhs.evaluator()),
+                                    decltype(_rhs.evaluator())>;
+        return Evaluator{_lhs.evaluator(), _rhs.evaluator()};
+    }
+
+    /**
+     * \brief Вычисление выражения в буфер
+     * \param out Буфер из height() строк по width() элементов. Может
+     * совпадать с одним из операндов
+     * \param ld Шаг между строками буфера, не меньше width()
+     */
+    template <typename U> void assignTo(U *out, std::size_t ld) const
+    {
+        _assignTo(out, ld,
+                  std::integral_constant<
+                      bool, detail::IsMatrixLeaf<L>::value &&
+                                detail::IsMatrixLeaf<R>::value &&
+                                std::is_same<U, value_type>::value>{});
+    }
+
+  private:
+    L _lhs;
+    R _rhs;
+
+    template <typename U>
+    void _assignTo(U *out, std::size_t ld, std::true_type) const
+    {
+        const auto *a = _lhs.data();
+        const auto *b = _rhs.data();
+        std::size_t la = _lhs.stride(), lb = _rhs.stride();
+        detail::rowwise(height(), width(), ld, {la, lb},
+                        [=](uint32_t i, std::size_t n)
+                        { Op::kernel(a + i * la, b + i * lb, out + i * ld, n); });
+    }
+
+    template <typename U>
+    void _assignTo(U *out, std::size_t ld, std::false_type) const
+    {
+        detail::evaluate(evaluator(), height(), width(), out, ld);
+    }
+};
+
+/**
+ * \brief Ленивое умножение матрицы на скаляр
+ * \details Тип элементов - MulType<Scalar, E::value_type>
+ *
+ * \tparam Scalar Тип скаляра
+ * \tparam E Тип операнда: detail::MatrixLeaf или другое выражение
+ */
+template <typename Scalar, typename E>
+class MatrixScaleExpression
+    : public MatrixExpression<MatrixScaleExpression<Scalar, E>>
+{
+  public:
+    using value_type = MulType<Scalar, typename E::value_type>;
+
+    template <typename EA>
+    MatrixScaleExpression(Scalar scalar, EA &&expr)
+        : _scalar(scalar), _expr(std::forward<EA>(expr))
+    {
+    }
+
+    uint32_t height() const noexcept { return _expr.height(); }
+    uint32_t width() const noexcept { return _expr.width(); }
+
+    auto evaluator() const
+    {
+        using Evaluator =
+            detail::ScaleEvaluator<Scalar, decltype(_expr.evaluator())>;
+        return Evaluator{_scalar, _expr.evaluator()};
+    }
+
+    /// \copydoc MatrixBinaryExpression::assignTo()
+    template <typename U> void assignTo(U *out, std::size_t ld) const
+    {
+        _assignTo(out, ld,
+                  std::integral_constant<
+                      bool, detail::IsMatrixLeaf<E>::value &&
+                                std::is_same<U, value_type>::value>{});
+    }
+
+  private:
+    Scalar _scalar;
+    E _expr;
+
+    template <typename U>
+    void _assignTo(U *out, std::size_t ld, std::true_type) const
+    {
+        using G = typename E::value_type;
+        const G *a = _expr.data();
+        std::size_t la = _expr.stride();
+        Scalar scalar = _scalar;
+        detail::rowwise(height(), width(), ld, {la},
+                        [=](uint32_t i, std::size_t n)
+                        {
+                            detail::simd::scale(
+                                scalar, a + i * la, out + i * ld, n,
+                                detail::simd::UseSimd<value_type, G, G>{});
+                        });
+    }
+
+    template <typename U>
+    void _assignTo(U *out, std::size_t ld, std::false_type) const
+    {
+        detail::evaluate(evaluator(), height(), width(), out, ld);
+    }
+};
+
+namespace detail
+{
+/// Тип выражения `a + b` для операндов, выведенных из `L&&` и `R&&`
+template <typename L, typename R>
+using SumExpression =
+    MatrixBinaryExpression<AddOp, ExprOperand<L>, ExprOperand<R>>;
+
+/// Тип выражения `a - b` для операндов, выведенных из `L&&` и `R&&`
+template <typename L, typename R>
+using DifferenceExpression =
+    MatrixBinaryExpression<SubOp, ExprOperand<L>, ExprOperand<R>>;
+
+/// Тип выражения `s * a` для операнда, выведенного из `M&&`
+template <typename Scalar, typename M>
+using ScaleExpression = MatrixScaleExpression<Scalar, ExprOperand<M>>;
+
+/**
+ * \brief Матрица, соответствующая операнду
+ * \details Для матрицы и \ref MatrixView "представления" - они сами, для
+ * выражения - результат его вычисления. Используется операциями, которым
+ * нужны готовые элементы в памяти (умножение, деление)
+ */
+template <typename T, typename Alloc>
+const MatrixGeneric<T, Alloc> &evaluate(const MatrixGeneric<T, Alloc> &m)
+{
+    return m;
+}
+
+template <typename T> const MatrixView<T> &evaluate(const MatrixView<T> &m)
+{
+    return m;
+}
+
+template <typename E>
+MatrixGeneric<typename E::value_type> evaluate(const MatrixExpression<E> &e)
+{
+    return e.eval();
+}
+
+/// Вычислитель операнда: матрицы или выражения
+template <typename T, typename Alloc>
+DenseEvaluator<T> evaluatorOf(const MatrixGeneric<T, Alloc> &m) noexcept
+{
+    return {m.data(), m.stride()};
+}
+
+template <typename E> auto evaluatorOf(const MatrixExpression<E> &e)
+{
+    return e.derived().evaluator();
+}
+
+/**
+ * \brief Поэлементное сравнение операндов без вычисления выражений в память
+ * \return Совпадают ли размеры и все элементы
+ */
+template <typename L, typename R> bool equalOperands(const L &a, const R &b)
+{
+    if (a.height() != b.height() || a.width() != b.width())
+        return false;
+
+    auto ea = evaluatorOf(a);
+    auto eb = evaluatorOf(b);
+    for (uint32_t i = 0; i < a.height(); ++i)
+    {
+        for (uint32_t j = 0; j < a.width(); ++j)
+        {
+            if (!(ea(i, j) == eb(i, j)))
+                return false;
+        }
+    }
+    return true;
+}
+} // namespace detail
+
+#endif
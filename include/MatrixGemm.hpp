@@ -0,0 +1,343 @@
+#ifndef __MATRIX_GEMM
+#define __MATRIX_GEMM
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * \file MatrixGemm.hpp
+ * Файл, содержащий ядро умножения матриц из арифметических типов: упаковка
+ * блоков, блочное разбиение под кэши L1/L2 и регистровые тайлы
+ * \author dmsukhikh
+ */
+
+namespace detail
+{
+
+/**
+ * \brief Параметры блочного разбиения умножения
+ * \details
+ *  - MR x NR - размер регистрового тайла, который считает микроядро
+ *  - KC - глубина блока: упакованная полоса B шириной NR и полоса A высотой
+ *  MR должны помещаться в L1
+ *  - MC x KC - блок A, который должен помещаться в L2
+ *  - KC x NC - панель B, которая переиспользуется всеми блоками A
+ *
+ * \tparam T Тип элементов, в котором ведутся вычисления
+ */
+template <typename T> struct GemmBlocking
+{
+    static constexpr uint32_t MR = 4;
+    static constexpr uint32_t NR = 8;
+    static constexpr uint32_t KC = 256;
+    static constexpr uint32_t MC = 128;
+    static constexpr uint32_t NC = 2048;
+};
+
+// Определения нужны в C++14, так как std::min принимает аргументы по ссылке
+template <typename T> constexpr uint32_t GemmBlocking<T>::MR;
+template <typename T> constexpr uint32_t GemmBlocking<T>::NR;
+template <typename T> constexpr uint32_t GemmBlocking<T>::KC;
+template <typename T> constexpr uint32_t GemmBlocking<T>::MC;
+template <typename T> constexpr uint32_t GemmBlocking<T>::NC;
+
+/**
+ * \brief Упаковка блока матрицы A
+ * \details Копирует блок **mc** x **kc** в буфер полосами по MR строк. Внутри
+ * полосы элементы лежат по столбцам, так что микроядро читает A подряд.
+ * Неполная последняя полоса дополняется нулями.
+ *
+ * \tparam T Тип элементов буфера
+ * \tparam S Тип элементов исходной матрицы, приводится к **T**
+ * \param a Указатель на левый верхний элемент блока
+ * \param rs Шаг между строками
+ * \param cs Шаг между столбцами
+ */
+template <typename T, typename S>
+void packA(uint32_t mc, uint32_t kc, const S *a, std::size_t rs,
+           std::size_t cs, T *buf)
+{
+    constexpr uint32_t MR = GemmBlocking<T>::MR;
+    for (uint32_t ir = 0; ir < mc; ir += MR)
+    {
+        uint32_t mr = std::min(MR, mc - ir);
+        for (uint32_t p = 0; p < kc; ++p)
+        {
+            uint32_t i = 0;
+            for (; i < mr; ++i)
+                *buf++ = static_cast<T>(a[(ir + i) * rs + p * cs]);
+            for (; i < MR; ++i)
+                *buf++ = T(0);
+        }
+    }
+}
+
+/**
+ * \brief Упаковка панели матрицы B
+ * \details Копирует панель **kc** x **nc** в буфер полосами по NR столбцов.
+ * Внутри полосы элементы лежат по строкам. Неполная последняя полоса
+ * дополняется нулями.
+ *
+ * \sa packA()
+ */
+template <typename T, typename S>
+void packB(uint32_t kc, uint32_t nc, const S *b, std::size_t rs,
+           std::size_t cs, T *buf)
+{
+    constexpr uint32_t NR = GemmBlocking<T>::NR;
+    for (uint32_t jr = 0; jr < nc; jr += NR)
+    {
+        uint32_t nr = std::min(NR, nc - jr);
+        for (uint32_t p = 0; p < kc; ++p)
+        {
+            uint32_t j = 0;
+            for (; j < nr; ++j)
+                *buf++ = static_cast<T>(b[p * rs + (jr + j) * cs]);
+            for (; j < NR; ++j)
+                *buf++ = T(0);
+        }
+    }
+}
+
+/**
+ * \brief Микроядро умножения
+ * \details Считает тайл MR x NR произведения упакованных полос A и B глубиной
+ * **kc**. Аккумуляторы лежат на регистрах, в C записываются только **mr** x
+ * **nr** значимых элементов.
+ *
+ * \param accumulate Прибавлять ли результат к C (иначе C перезаписывается)
+ */
+template <typename T>
+void microKernel(uint32_t kc, const T *a, const T *b, T *c, std::size_t ldc,
+                 uint32_t mr, uint32_t nr, bool accumulate)
+{
+    constexpr uint32_t MR = GemmBlocking<T>::MR;
+    constexpr uint32_t NR = GemmBlocking<T>::NR;
+
+    T acc[MR][NR] = {};
+    for (uint32_t p = 0; p < kc; ++p)
+    {
+        for (uint32_t i = 0; i < MR; ++i)
+        {
+            for (uint32_t j = 0; j < NR; ++j)
+            {
+                acc[i][j] += a[i] * b[j];
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+
+    for (uint32_t i = 0; i < mr; ++i)
+    {
+        for (uint32_t j = 0; j < nr; ++j)
+        {
+            if (accumulate)
+                c[i * ldc + j] += acc[i][j];
+            else
+                c[i * ldc + j] = acc[i][j];
+        }
+    }
+}
+
+/**
+ * \brief Буферы упаковки для gemm()
+ * \details Буферы растут до нужного размера и не освобождаются между
+ * вызовами, поэтому серия умножений (например, в MatrixGeneric::pow())
+ * выделяет память для упаковки один раз
+ *
+ * \tparam Alloc Распределитель памяти для буферов
+ */
+template <typename T, typename Alloc = std::allocator<T>> struct GemmWorkspace
+{
+    GemmWorkspace() = default;
+
+    /// Буферы, выделяющие память у **alloc**
+    explicit GemmWorkspace(const Alloc &alloc) : a(alloc), b(alloc) {}
+
+    std::vector<T, Alloc> a; ///< Упакованный блок A
+    std::vector<T, Alloc> b; ///< Упакованная панель B
+};
+
+/**
+ * \brief Умножение упакованного блока A на часть упакованной панели B
+ * \details Проходит по регистровым тайлам блока **mc** x **nc**
+ */
+template <typename T>
+void macroKernel(uint32_t mc, uint32_t nc, uint32_t kc, const T *bufA,
+                 const T *bufB, T *c, std::size_t ldc, bool accumulate)
+{
+    using Blk = GemmBlocking<T>;
+    for (uint32_t jr = 0; jr < nc; jr += Blk::NR)
+    {
+        for (uint32_t ir = 0; ir < mc; ir += Blk::MR)
+        {
+            microKernel(kc, bufA + ir * kc, bufB + jr * kc,
+                        c + ir * ldc + jr, ldc, std::min(Blk::MR, mc - ir),
+                        std::min(Blk::NR, nc - jr), accumulate);
+        }
+    }
+}
+
+/**
+ * \brief Буфер упаковки A текущего потока
+ * \details Используется задачами параллельного gemm(): у каждого потока пула
+ * свой буфер, который живет до завершения потока
+ */
+template <typename T> std::vector<T> &threadPackBuffer()
+{
+    static thread_local std::vector<T> buf;
+    return buf;
+}
+
+/// Минимальное число умножений m * n * k, при котором gemm() распараллеливается
+constexpr uint64_t gemmParallelThreshold = uint64_t(1) << 18;
+
+/**
+ * \brief Блочное умножение матриц C = A * B
+ * \details Матрицы задаются указателем и шагами между строками и столбцами,
+ * поэтому на вход можно подавать и транспонированные данные. C хранится
+ * построчно с шагом **ldc** и полностью перезаписывается.
+ *
+ * Если в \ref ThreadPool::global() "общем пуле" больше одного потока, а
+ * умножение достаточно большое, блоки C считаются параллельно: панель B
+ * упаковывается один раз, после чего задачи пула независимо упаковывают свои
+ * блоки A и считают свои части C.
+ *
+ * Временная сложность: O(m * n * k), дополнительная память: O(MC * KC + KC *
+ * NC) на поток
+ *
+ * \tparam T Тип, в котором ведутся вычисления
+ * \tparam SA Тип элементов A
+ * \tparam SB Тип элементов B
+ * \param m Высота A и C
+ * \param n Ширина B и C
+ * \param k Ширина A и высота B
+ * \param ws Буферы упаковки
+ */
+template <typename T, typename SA, typename SB, typename Alloc>
+void gemm(uint32_t m, uint32_t n, uint32_t k, const SA *a, std::size_t rsa,
+          std::size_t csa, const SB *b, std::size_t rsb, std::size_t csb, T *c,
+          std::size_t ldc, GemmWorkspace<T, Alloc> &ws)
+{
+    using Blk = GemmBlocking<T>;
+
+    if (m == 0 || n == 0)
+        return;
+
+    if (k == 0)
+    {
+        for (uint32_t i = 0; i < m; ++i)
+            std::fill(c + i * ldc, c + i * ldc + n, T(0));
+        return;
+    }
+
+    auto roundUp = [](uint32_t x, uint32_t to) { return (x + to - 1) / to * to; };
+    uint32_t kcMax = std::min(k, Blk::KC);
+    std::size_t sizeA =
+        std::size_t(roundUp(std::min(m, Blk::MC), Blk::MR)) * kcMax;
+    std::size_t sizeB =
+        std::size_t(roundUp(std::min(n, Blk::NC), Blk::NR)) * kcMax;
+    if (ws.b.size() < sizeB)
+        ws.b.resize(sizeB);
+    T *bufB = ws.b.data();
+
+    ThreadPool &pool = ThreadPool::global();
+    bool parallel = pool.size() > 1 &&
+                    uint64_t(m) * n * k >= gemmParallelThreshold;
+    if (!parallel && ws.a.size() < sizeA)
+        ws.a.resize(sizeA);
+
+    for (uint32_t jc = 0; jc < n; jc += Blk::NC)
+    {
+        uint32_t nc = std::min(Blk::NC, n - jc);
+        for (uint32_t pc = 0; pc < k; pc += Blk::KC)
+        {
+            uint32_t kc = std::min(Blk::KC, k - pc);
+            packB(kc, nc, b + pc * rsb + jc * csb, rsb, csb, bufB);
+
+            if (!parallel)
+            {
+                for (uint32_t ic = 0; ic < m; ic += Blk::MC)
+                {
+                    uint32_t mc = std::min(Blk::MC, m - ic);
+                    packA(mc, kc, a + ic * rsa + pc * csa, rsa, csa,
+                          ws.a.data());
+                    macroKernel(mc, nc, kc, ws.a.data(), bufB,
+                                c + ic * ldc + jc, ldc, pc != 0);
+                }
+                continue;
+            }
+
+            // Если блоков A меньше, чем потоков, панель B дополнительно
+            // делится по столбцам
+            uint32_t icBlocks = (m + Blk::MC - 1) / Blk::MC;
+            uint32_t chunks = 1;
+            if (icBlocks < 2 * pool.size())
+            {
+                chunks = std::min((2 * pool.size() + icBlocks - 1) / icBlocks,
+                                  (nc + 4 * Blk::NR - 1) / (4 * Blk::NR));
+                chunks = std::max(chunks, 1u);
+            }
+            uint32_t chunkWidth = roundUp((nc + chunks - 1) / chunks, Blk::NR);
+            chunks = (nc + chunkWidth - 1) / chunkWidth;
+
+            pool.parallelFor(
+                0, icBlocks * chunks, 1,
+                [&, kc, nc, pc, jc](uint32_t lo, uint32_t hi)
+                {
+                    std::vector<T> &bufA = threadPackBuffer<T>();
+                    if (bufA.size() < sizeA)
+                        bufA.resize(sizeA);
+                    for (uint32_t task = lo; task < hi; ++task)
+                    {
+                        uint32_t ic = task / chunks * Blk::MC;
+                        uint32_t jr = task % chunks * chunkWidth;
+                        uint32_t mc = std::min(Blk::MC, m - ic);
+                        packA(mc, kc, a + ic * rsa + pc * csa, rsa, csa,
+                              bufA.data());
+                        macroKernel(mc, std::min(chunkWidth, nc - jr), kc,
+                                    bufA.data(), bufB + std::size_t(jr) * kc,
+                                    c + ic * ldc + jc + jr, ldc, pc != 0);
+                    }
+                });
+        }
+    }
+}
+
+/**
+ * \copybrief gemm()
+ * \details Перегрузка, использующая буферы упаковки текущего потока: их
+ * размер ограничен размерами блоков, поэтому после первого умножения память
+ * под упаковку не выделяется. Если поток уже внутри gemm() (задача пула,
+ * перехваченная во время ожидания), буферы выделяются на время вызова
+ */
+template <typename T, typename SA, typename SB>
+void gemm(uint32_t m, uint32_t n, uint32_t k, const SA *a, std::size_t rsa,
+          std::size_t csa, const SB *b, std::size_t rsb, std::size_t csb, T *c,
+          std::size_t ldc)
+{
+    static thread_local GemmWorkspace<T> cached;
+    static thread_local bool busy = false;
+    if (busy)
+    {
+        GemmWorkspace<T> ws;
+        gemm(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc, ws);
+        return;
+    }
+
+    struct Release
+    {
+        ~Release() { busy = false; }
+    } release;
+    busy = true;
+    gemm(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc, cached);
+}
+
+} // namespace detail
+
+#endif
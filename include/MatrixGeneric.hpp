@@ -2,13 +2,36 @@
 #define __MATRIX_GENERIC
 
 #include "Exceptions.hpp"
+#include "MatrixBinary.hpp"
 #include "MatrixOperation.hpp"
+#include "MatrixStats.hpp"
 #include <algorithm>
 #include <cstdint>
+#include <fstream>
 #include <initializer_list>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+template <typename T, typename Work = detail::DetWorkType<T>,
+          typename Alloc = std::allocator<Work>>
+class GaussElimination;
+template <typename T, typename Work = detail::DetWorkType<T>,
+          typename Alloc = std::allocator<Work>>
+class QRDecomposition;
+template <typename T> class SymmetricEigen;
+
+/// Способ выбора ведущего элемента в GaussElimination
+enum class Pivoting
+{
+    Partial, ///< Наибольший по модулю элемент столбца
+    Full     ///< Наибольший по модулю элемент оставшейся подматрицы
+};
+
 /**
  * \file MatrixGeneric.hpp
  * Файл, содержащий класс MatrixGeneric
@@ -23,40 +46,142 @@
  *   - Иметь конструктор по умолчанию
  *   - Поддерживать основные арифметические операции: сложение, умножение,
  * деление и вычитание.
+ *  \tparam Alloc Распределитель памяти для элементов. Временные матрицы
+ * методов (transpose(), inverse(), pow() и т.д.) и результаты операций берут
+ * память у распределителя исходной матрицы (для бинарных операций - первого
+ * операнда). Готовые распределители - в MatrixAllocator.hpp. Если
+ * распределитель выравнивает память (AlignedAllocator), строки дополняются до
+ * границы выравнивания, см. stride()
  */
-template <typename T> class MatrixGeneric
+template <typename T, typename Alloc> class MatrixGeneric
 {
   public:
+    using value_type = T;         ///< Тип элементов матрицы
+    using allocator_type = Alloc; ///< Распределитель памяти для элементов
+
     /**
      * \brief Конструктор по умолчанию
      * \details Создает пустую матрицу размером 0x0
      */
     explicit MatrixGeneric() = default;
 
+    /**
+     * \brief Конструктор пустой матрицы с заданным распределителем
+     * \param alloc Распределитель памяти для элементов
+     */
+    explicit MatrixGeneric(const Alloc &alloc) : _data(alloc) {}
+
     /**
      * \brief Конструктор, создающий матрицу с заданным размером
      * \details Создается матрица размером **height** x **width**
      *
      * \param height Высота матрицы
      * \param width Ширина матрицы
+     * \param alloc Распределитель памяти для элементов
      *
      * \exception matrix_initialization_error В случае, если ширина нулевая, а
      * высота - нет, и наоборот. Так, нельзя создать матрицу 0x10 или 2x0.
      */
-    explicit MatrixGeneric(uint32_t height, uint32_t width)
-        : _height(height), _width(width)
+    explicit MatrixGeneric(uint32_t height, uint32_t width,
+                           const Alloc &alloc = Alloc())
+        : _height(height), _width(width), _data(alloc)
     {
         if ((_height == 0 && _width != 0) || (_width == 0 && _height != 0))
         {
             throw matrix_initialization_error(
                 "Only both height and width can be zero");
         }
-        _data.resize(_height * _width);
+        _data.resize(std::size_t(_height) * stride());
     }
 
     MatrixGeneric(const MatrixGeneric &) = default;
     MatrixGeneric &operator=(const MatrixGeneric &) = default;
 
+    /**
+     * \brief Копирование матрицы в память другого распределителя
+     * \param other Копируемая матрица
+     * \param alloc Распределитель памяти для элементов копии
+     */
+    MatrixGeneric(const MatrixGeneric &other, const Alloc &alloc)
+        : _height(other._height), _width(other._width),
+          _data(other._data, alloc)
+    {
+    }
+
+    /**
+     * \brief Перемещение матрицы в память другого распределителя
+     * \details Если распределители равны, элементы не копируются
+     * \param other Перемещаемая матрица
+     * \param alloc Распределитель памяти для элементов
+     */
+    MatrixGeneric(MatrixGeneric &&other, const Alloc &alloc)
+        : _height(other._height), _width(other._width),
+          _data(std::move(other._data), alloc)
+    {
+        other._height = 0;
+        other._width = 0;
+    }
+
+    /**
+     * \brief Копирование матрицы с другим типом распределителя
+     * \details Например, так результат, вычисленный в
+     * \ref ArenaResource "арене", переносится в кучу до ее очистки
+     *
+     * \param other Копируемая матрица
+     * \param alloc Распределитель памяти для элементов копии
+     */
+    template <typename OtherAlloc,
+              typename = std::enable_if_t<!std::is_same<OtherAlloc, Alloc>::value>>
+    explicit MatrixGeneric(const MatrixGeneric<T, OtherAlloc> &other,
+                           const Alloc &alloc = Alloc())
+        : MatrixGeneric(other.height(), other.width(), alloc)
+    {
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            const T *row = other.data() + std::size_t(i) * other.stride();
+            std::copy(row, row + _width, _row(i));
+        }
+    }
+
+    /**
+     * \brief Вычисление ленивого выражения
+     * \details Создает матрицу из \ref MatrixExpression "выражения" вида
+     * `a + b`, `2 * (a - b)` и т.п. Все элементы вычисляются за один проход,
+     * без промежуточных матриц
+     *
+     * \param expr Выражение, тип элементов которого приводится к **T**
+     * \param alloc Распределитель памяти для элементов
+     */
+    template <typename E>
+    MatrixGeneric(const MatrixExpression<E> &expr, const Alloc &alloc = Alloc())
+        : MatrixGeneric(expr.derived().height(), expr.derived().width(), alloc)
+    {
+        StatsScope stats("elementwise", double(_height) * _width);
+        expr.derived().assignTo(_data.data(), stride());
+    }
+
+    /**
+     * \brief Присваивание ленивого выражения
+     * \details Если размеры совпадают, выражение вычисляется прямо в
+     * элементы матрицы, поэтому запись `a = a + b` не выделяет память
+     *
+     * \param expr Выражение, тип элементов которого приводится к **T**
+     * \return Ссылка на эту матрицу
+     */
+    template <typename E>
+    MatrixGeneric &operator=(const MatrixExpression<E> &expr)
+    {
+        const E &e = expr.derived();
+        if (e.height() == _height && e.width() == _width)
+        {
+            StatsScope stats("elementwise", double(_height) * _width);
+            e.assignTo(_data.data(), stride());
+        }
+        else
+            *this = MatrixGeneric(expr, get_allocator());
+        return *this;
+    }
+
     /**
      * \brief Конструктор матрицы из initializer_list
      * \details Конструктор создает матрицу из списка списков инициализации.
@@ -68,12 +193,15 @@ template <typename T> class MatrixGeneric
      * \endcode
      *
      * \param nums Список списков инициализации
+     * \param alloc Распределитель памяти для элементов
      * \exception matrix_initialization_error Выбрасывается в двух случаях:
      *  - Список некорректный: все списки должны быть одинаковой длины
      *  - Ширина нулевая, а высота - нет, и наоборот. Так, нельзя создать
      * матрицу 0x10 или 2x0.
      */
-    MatrixGeneric(const std::initializer_list<std::initializer_list<T>> &nums)
+    MatrixGeneric(const std::initializer_list<std::initializer_list<T>> &nums,
+                  const Alloc &alloc = Alloc())
+        : _data(alloc)
     {
         if (nums.size() == 0)
             return;
@@ -96,12 +224,11 @@ template <typename T> class MatrixGeneric
                 "Only both height and width can be zero");
         }
 
+        _data.resize(std::size_t(_height) * stride());
+        uint32_t i = 0;
         for (auto &raw : nums)
         {
-            for (auto &i : raw)
-            {
-                _data.push_back(i);
-            }
+            std::copy(raw.begin(), raw.end(), _row(i++));
         }
     }
 
@@ -113,11 +240,12 @@ template <typename T> class MatrixGeneric
      * `T::T(int)`.
      *
      * \param size Длина стороны матрицы
+     * \param alloc Распределитель памяти для элементов
      * \return Единичная матрицы
      */
-    static MatrixGeneric eye(uint32_t size)
+    static MatrixGeneric eye(uint32_t size, const Alloc &alloc = Alloc())
     {
-        MatrixGeneric<T> out(size, size);
+        MatrixGeneric out(size, size, alloc);
         for (uint32_t i = 0; i < size; ++i)
         {
             out.get(i, i) = T(1);
@@ -125,7 +253,13 @@ template <typename T> class MatrixGeneric
         return out;
     }
 
-    MatrixGeneric(MatrixGeneric &&other) { *this = std::move(other); };
+    MatrixGeneric(MatrixGeneric &&other)
+        : _height(other._height), _width(other._width),
+          _data(std::move(other._data))
+    {
+        other._height = 0;
+        other._width = 0;
+    }
 
     MatrixGeneric &operator=(MatrixGeneric &&other)
     {
@@ -148,7 +282,7 @@ template <typename T> class MatrixGeneric
     T &get(uint32_t x, uint32_t y)
     {
         return const_cast<T &>(
-            const_cast<const MatrixGeneric<T> *>(this)->get(x, y));
+            const_cast<const MatrixGeneric *>(this)->get(x, y));
     }
 
     /**
@@ -164,13 +298,127 @@ template <typename T> class MatrixGeneric
      */
     const T &get(uint32_t x, uint32_t y) const
     {
-        auto idx = x * _width + y;
-        if (idx >= _width * _height)
+        if (x >= _height || y >= _width)
         {
             throw matrix_bad_access("Indexing is out of range");
         }
 
-        return _data[x * _width + y];
+        return _data[std::size_t(x) * stride() + y];
+    }
+
+    /**
+     * \copydoc data()
+     */
+    T *data() noexcept { return _data.data(); }
+
+    /**
+     * \brief Получение указателя на элементы матрицы
+     * \details Элементы хранятся построчно в непрерывном массиве: элемент
+     * (x, y) лежит по индексу `x * stride() + y`
+     *
+     * \return Указатель на первый элемент или nullptr для пустой матрицы
+     */
+    const T *data() const noexcept { return _data.data(); }
+
+    /**
+     * \brief Шаг между строками в элементах
+     * \details Для обычных распределителей совпадает с width(). Если у
+     * распределителя есть выравнивание (например, AlignedAllocator), ширина
+     * округляется вверх до числа элементов в нем, так что каждая строка
+     * начинается с выровненного адреса. Элементы дополнения в операциях не
+     * участвуют
+     *
+     * \return Шаг, не меньший width()
+     */
+    uint32_t stride() const noexcept
+    {
+        return detail::paddedStride<T, Alloc>(_width);
+    }
+
+    /**
+     * \copydoc block()
+     */
+    MatrixView<T> block(uint32_t row, uint32_t col, uint32_t height,
+                        uint32_t width)
+    {
+        return MatrixView<T>(*this).block(row, col, height, width);
+    }
+
+    /**
+     * \brief Представление блока матрицы
+     * \details Возвращает \ref MatrixView "представление" блока размером
+     * **height** x **width**, левый верхний элемент которого находится в
+     * строке **row** и столбце **col**. Элементы не копируются.
+     *
+     * \param row Строка левого верхнего элемента
+     * \param col Столбец левого верхнего элемента
+     * \param height Высота блока
+     * \param width Ширина блока
+     * \return Представление блока
+     * \throw matrix_bad_access Если блок выходит за пределы матрицы
+     */
+    MatrixView<const T> block(uint32_t row, uint32_t col, uint32_t height,
+                              uint32_t width) const
+    {
+        return MatrixView<const T>(*this).block(row, col, height, width);
+    }
+
+    /**
+     * \copydoc row()
+     */
+    MatrixView<T> row(uint32_t x) { return MatrixView<T>(*this).row(x); }
+
+    /**
+     * \brief Представление строки матрицы
+     * \param x Номер строки
+     * \return Представление размером 1 x width()
+     * \throw matrix_bad_access Если строки не существует
+     * \sa block()
+     */
+    MatrixView<const T> row(uint32_t x) const
+    {
+        return MatrixView<const T>(*this).row(x);
+    }
+
+    /**
+     * \copydoc col()
+     */
+    MatrixView<T> col(uint32_t y) { return MatrixView<T>(*this).col(y); }
+
+    /**
+     * \brief Представление столбца матрицы
+     * \param y Номер столбца
+     * \return Представление размером height() x 1
+     * \throw matrix_bad_access Если столбца не существует
+     * \sa block()
+     */
+    MatrixView<const T> col(uint32_t y) const
+    {
+        return MatrixView<const T>(*this).col(y);
+    }
+
+    /**
+     * \copydoc transposeView()
+     */
+    MatrixView<T> transposeView()
+    {
+        return MatrixView<T>(*this).transposeView();
+    }
+
+    /**
+     * \brief Ленивое транспонирование
+     * \details В отличие от transpose(), не копирует элементы, а возвращает
+     * \ref MatrixView "представление" с переставленными шагами. Умножение на
+     * такое представление не транспонирует матрицу в памяти.
+     *
+     * Временная сложность: O(1)
+     *
+     * \return Транспонированное представление
+     * \sa transpose()
+     */
+    MatrixView<const T> transposeView() const
+    {
+        return MatrixView<const T>(*this).transposeView();
     }
 
     /**
@@ -186,50 +434,105 @@ template <typename T> class MatrixGeneric
     uint32_t width() const noexcept { return _width; }
 
     /**
-     * \brief Сложение двух матриц
-     * \details Складывает две матрицы.
-     *
-     * Временная сложность: O(n), где n - количество элементов в матрице.
-     *
-     * \note Тип элементов возвращаемой матрицы вычисляется как тип,
-     * получающийся в результате сложения двух элементов из разных матриц. Так,
-     * если мы складываем MatrixGeneric<int> и MatrixGeneric<float>, то
-     * получится MatrixGeneric<float>. Таким образом, можно складывать матрицы,
-     * состоящие из элементов разных типов, но которые приводятся один к другому
-     *
-     * \tparam A Тип элеметов первой матрицы
-     * \tparam B Тип элементов второй матрицы
-     * \param a Первая матрицa
-     * \param b Вторая матрица
-     *
-     * \exception matrix_bad_operation Если размеры матриц не совпадают
-     * \return Сумма матриц
+     * \brief Получение распределителя памяти
+     * \return Копия распределителя, из которого выделены элементы
      */
-    template <typename A, typename B>
-    friend MatrixGeneric<AddType<A, B>> operator+(const MatrixGeneric<A> &a,
-                                                  const MatrixGeneric<B> &b);
+    Alloc get_allocator() const noexcept { return _data.get_allocator(); }
 
     /**
-     * \brief Разность двух матриц
-     * \details Вычитает одну матрицу из другой
-     *
-     * Временная сложность: O(n), где n - количество элементов в матрице.
-     *
-     * \note Тип вычисляется подобно тому, как и при \ref operator+() "сложении"
-     * матриц. То есть, есть возможность вычитать матрицы разных типов.
-     *
-     * \tparam A Тип элеметов первой матрицы
-     * \tparam B Тип элементов второй матрицы
-     * \param a Первая матрицa
-     * \param b Вторая матрица
-     *
-     * \return Разность матриц
-     * \exception matrix_bad_operation Если размеры матриц не совпадают
-     * \sa operator+()
+     * \brief Запись матрицы в двоичном формате
+     * \details Пишет заголовок (сигнатура, тип элементов, порядок байт,
+     * размеры) и элементы построчно, как они лежат в памяти. Формат описан в
+     * MatrixBinary.hpp
+     * \note Поддерживаются элементы типов float, double и 32/64-битные целые
+     *
+     * \param out Поток, открытый в двоичном режиме
+     * \throw matrix_io_error Если запись не удалась
+     */
+    void save(std::ostream &out) const
+    {
+        char header[detail::binaryHeaderSize];
+        detail::encodeBinaryHeader<T>(_height, _width, header);
+        out.write(header, sizeof(header));
+        if (stride() == _width)
+            out.write(reinterpret_cast<const char *>(_data.data()),
+                      std::streamsize(_data.size() * sizeof(T)));
+        else
+        {
+            for (uint32_t i = 0; i < _height; ++i)
+                out.write(reinterpret_cast<const char *>(_row(i)),
+                          std::streamsize(_width * sizeof(T)));
+        }
+        if (!out)
+            throw matrix_io_error("Can't write binary matrix");
+    }
+
+    /**
+     * \brief Запись матрицы в двоичный файл
+     * \param path Путь к файлу. Существующий файл перезаписывается
+     * \throw matrix_io_error Если файл не удалось открыть или записать
+     */
+    void save(const std::string &path) const
+    {
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+            throw matrix_io_error(("Can't open file " + path).c_str());
+        save(out);
+    }
+
+    /**
+     * \brief Чтение матрицы в двоичном формате
+     * \details Если тип элементов в файле отличается от **T**, элементы
+     * приводятся к **T**. Файл, записанный на платформе с другим порядком байт,
+     * читается корректно
+     *
+     * \param in Поток, открытый в двоичном режиме
+     * \param alloc Распределитель памяти для элементов
+     * \return Прочитанная матрица
+     * \throw matrix_io_error Если данные не в двоичном формате или обрываются
+     */
+    static MatrixGeneric load(std::istream &in, const Alloc &alloc = Alloc())
+    {
+        auto read = [&in](char *out, std::size_t bytes)
+        { return bool(in.read(out, std::streamsize(bytes))); };
+
+        char bytes[detail::binaryHeaderSize];
+        if (!read(bytes, sizeof(bytes)))
+            throw matrix_io_error("Binary matrix is truncated");
+        detail::BinaryHeader header =
+            detail::decodeBinaryHeader(bytes, detail::streamRemaining(in));
+
+        MatrixGeneric out(header.height, header.width, alloc);
+        detail::readBinaryPayload(header, out._data.data(), read);
+
+        // Строки прочитаны подряд: разносим их по местам с конца, чтобы не
+        // затереть еще не перенесенные
+        uint32_t stride = out.stride();
+        for (uint32_t i = out._height; stride != out._width && i-- > 1;)
+        {
+            T *row = out._data.data() + std::size_t(i) * out._width;
+            std::copy_backward(row, row + out._width,
+                               out._row(i) + out._width);
+            std::fill(row, std::min(row + out._width, out._row(i)), T());
+        }
+        return out;
+    }
+
+    /**
+     * \brief Чтение матрицы из двоичного файла
+     * \param path Путь к файлу
+     * \param alloc Распределитель памяти для элементов
+     * \return Прочитанная матрица
+     * \throw matrix_io_error Если файл не удалось открыть или он некорректен
      */
-    template <typename A, typename B>
-    friend MatrixGeneric<SubsType<A, B>> operator-(const MatrixGeneric<A> &a,
-                                                   const MatrixGeneric<B> &b);
+    static MatrixGeneric load(const std::string &path,
+                              const Alloc &alloc = Alloc())
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw matrix_io_error(("Can't open file " + path).c_str());
+        return load(in, alloc);
+    }
 
     /**
      * \brief Произведение двух матриц
@@ -238,6 +541,11 @@ template <typename T> class MatrixGeneric
      *
      * Временная сложность: O(n^3), где n - длина стороны матрицы.
      *
+     * Для арифметических типов используется блочное ядро из MatrixGemm.hpp,
+     * для остальных - умножение по определению (detail::multiplyReference()).
+     * Если задан порог setStrassenCrossover() и все размеры не меньше него,
+     * произведение считается как в multiplyStrassen().
+     *
      * \note Тип вычисляется подобно тому, как и при \ref operator+() "сложении"
      * матриц. То есть, есть возможность вычитать матрицы разных типов.
      * Конкретнее, тип элементов возвращаемой матрицы вычисляется как тип
@@ -253,41 +561,23 @@ template <typename T> class MatrixGeneric
      * произвести умножение
      * \sa operator+()
      */
-    template <typename A, typename B>
-    friend MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>>
-    operator*(const MatrixGeneric<A> &a, const MatrixGeneric<B> &b);
-
-    /**
-     * \brief Произведение матрицы на скаляр
-     * \details Умножает матрицу на скаляр
-     *
-     * Временная сложность: O(n), где n - длина стороны матрицы.
-     *
-     * \note
-     * - Тип вычисляется подобно тому, как и при \ref operator+() "сложении"
-     * матриц
-     * - Число должно идти первым. Выражение вида `MatrixGeneric<int>::eye(3) *
-     * 2` не скомпилируется
-     *
-     * \tparam G Тип элеметов матрицы
-     * \tparam Scalar Тип скаляра
-     * \param scalar Скаляр, на который умножается матрица
-     * \param a Mатрица
-     *
-     * \return Матрица, умноженная на скаляр
-     * \sa operator+()
-     */
-    template <typename G, typename Scalar>
-    friend MatrixGeneric<MulType<Scalar, G>>
-    operator*(Scalar scalar, const MatrixGeneric<G> &a);
+    template <typename A, typename AllocA, typename B, typename AllocB>
+    friend MatrixGeneric<
+        AddType<MulType<A, B>, MulType<A, B>>,
+        RebindAlloc<AllocA, AddType<MulType<A, B>, MulType<A, B>>>>
+    operator*(const MatrixGeneric<A, AllocA> &a,
+              const MatrixGeneric<B, AllocB> &b);
 
     /**
      * \brief Делит матрицу на другую
      * \details Делит первую матрицу на вторую. По определению, деление на
-     * матрицу означает умножение на обратную, так что матрицы должны быть
-     * квадратными, а делитель, к тому же, иметь ненулевой определитель
+     * матрицу означает умножение на обратную, так что делитель должен быть
+     * квадратным и иметь ненулевой определитель. Обратная матрица явно не
+     * строится: частное X - решение системы X * b = a, которое находится
+     * через \ref solve() "LU-разложение" транспонированного делителя. Это
+     * быстрее и точнее, чем `a * b.inverse()`
      *
-     * Временная сложность: O(n^4), где n - длина стороны матрицы
+     * Временная сложность: O(n^3), где n - длина стороны матрицы
      *
      * \note Тип элементов возвращаемой матрицы вычисляется подобно тому, как он
      * вычисляется при \ref operator+() "сложении" матриц. Однако, данный тип
@@ -307,17 +597,18 @@ template <typename T> class MatrixGeneric
      * \param b Матрица-делитель
      * \return Частное деления матрицы **a** на матрицу **b**
      *
-     * \exception matrix_bad_operation Если делитель не квадратный
-     * \exception <any> Выбрасывает то же самое, что и operator*(),
-     * MatrixGeneric<T>::inverse()
+     * \exception matrix_bad_operation Если делитель не квадратный или его
+     * размер не совпадает с шириной делимого
+     * \exception matrix_bad_inverse Если определитель делителя равен нулю
      *
      * \sa operator+()
      * \sa operator*()
-     * \sa MatrixGeneric<T>::inverse()
+     * \sa solve()
      */
-    template <typename A, typename B>
-    friend MatrixGeneric<MulType<A, DivType<B, float>>>
-    operator/(const MatrixGeneric<A> &a, const MatrixGeneric<B> &b);
+    template <typename A, typename AllocA, typename B, typename AllocB>
+    friend MatrixGeneric<QuotType<A, B>, RebindAlloc<AllocA, QuotType<A, B>>>
+    operator/(const MatrixGeneric<A, AllocA> &a,
+              const MatrixGeneric<B, AllocB> &b);
 
     /**
      * \brief Сравнение матриц
@@ -330,9 +621,9 @@ template <typename T> class MatrixGeneric
      * \param b Вторая матрица
      * \return Равны ли две матрицы
      */
-    template <typename A, typename B>
-    friend bool operator==(const MatrixGeneric<A> &a,
-                           const MatrixGeneric<B> &b);
+    template <typename A, typename AllocA, typename B, typename AllocB>
+    friend bool operator==(const MatrixGeneric<A, AllocA> &a,
+                           const MatrixGeneric<B, AllocB> &b);
 
     /**
      * \brief Сравнение матриц
@@ -347,267 +638,287 @@ template <typename T> class MatrixGeneric
      * \return Равны ли две матрицы
      * \sa operator==()
      */
-    template <typename A, typename B>
-    friend bool operator!=(const MatrixGeneric<A> &a,
-                           const MatrixGeneric<B> &b);
+    template <typename A, typename AllocA, typename B, typename AllocB>
+    friend bool operator!=(const MatrixGeneric<A, AllocA> &a,
+                           const MatrixGeneric<B, AllocB> &b);
 
     /**
      * \brief Вычисление определителя матрицы
-     * \details Метод вычисляет определитель матрицы, используя метод Гаусса
-     * сведения матрицы к вернетреугольному виду.
+     * \details Метод вычисляет определитель матрицы как произведение ведущих
+     * элементов \ref GaussElimination "прямого хода метода Гаусса" с
+     * частичным выбором главного элемента. Нулем считается только точный
+     * ноль, поэтому определитель плохо обусловленной матрицы не обнуляется.
      *
      * Временная сложность алгоритма: O(n^3), где n - длина стороны матрицы
      * \note
      * - Для использования данной функции тип T должен быть арифметическим, то
-     * есть поддерживать арифметические операции. Также, тип T должен
-     * приводиться к типу float, даже несмотря на то, что возвращаемый тип - T.
+     * есть поддерживать арифметические операции. Для целых типов исключение
+     * ведется в double, а результат округляется до ближайшего целого, для
+     * остальных - в типе `T / float`.
      * - Для пустой матрицы определитель принимается равным единице
      *
-     * \todo Планируется сделать дополнительную перегрузку det, которая не
-     * зависит от приведения к float
-     *
      * \return Определитель матрицы
      * \throw matrix_bad_det Если матрица не квадратная
+     * \sa GaussElimination
      */
     T det() const
     {
         if (_height != _width)
             throw matrix_bad_det("Matrix isn't square");
 
-        if (_height == 0 && _width == 0)
-            return 1;
-
-        return _gauss().second;
+        StatsScope stats("det", 2.0 / 3 * _height * _height * _height);
+        using Work = detail::DetWorkType<T>;
+        return detail::castDeterminant<T>(
+            GaussElimination<T, Work, RebindAlloc<Alloc, Work>>(
+                *this, Pivoting::Partial, Work(0),
+                RebindAlloc<Alloc, Work>(get_allocator()))
+                .det(),
+            std::is_integral<T>{});
     }
 
     /**
      * \brief Транспонирование матрицы
      * \details Метод вычисляет новую матрицу, транспонируя исходную, и
      * возвращает транспонированную копию. Исходная матрица **не меняется**.
+     * Элементы переставляются рекурсивно по блокам (см.
+     * detail::transposeBlock()), так что и чтение, и запись идут по
+     * небольшим блокам, помещающимся в кеш.
      *
      * Временная сложность алгоритма: O(n), где n - количество элементов
      *
      * \return Транспонированная матрица
+     * \sa transposeView(), transposeInPlace()
      */
     MatrixGeneric transpose() const
     {
-        std::vector<T> _new_data(_width * _height);
-        for (uint32_t i = 0; i < _height; ++i)
-        {
-            for (uint32_t j = 0; j < _width; ++j)
-            {
-                _new_data[j * _height + i] = _data[i * _width + j];
-            }
-        }
-
-        MatrixGeneric<T> out(_width, _height);
-        out._data = std::move(_new_data);
+        StatsScope stats("transpose");
+        MatrixGeneric out(_width, _height, get_allocator());
+        detail::transposeBlock(_data.data(), stride(), out._data.data(),
+                               out.stride(), _height, _width);
         return out;
     }
 
+    /**
+     * \brief Транспонирование матрицы на месте
+     * \details Квадратная матрица транспонируется без выделения памяти:
+     * блоки по разные стороны диагонали меняются местами рекурсивно (см.
+     * detail::transposeSquare()). Неквадратная матрица заменяется результатом
+     * transpose()
+     *
+     * Временная сложность алгоритма: O(n), где n - количество элементов
+     *
+     * \return Ссылка на эту матрицу
+     * \sa transpose()
+     */
+    MatrixGeneric &transposeInPlace()
+    {
+        if (_height == _width)
+            detail::transposeSquare(_data.data(), stride(), _height);
+        else
+            *this = transpose();
+        return *this;
+    }
+
     /**
      * \brief Обращение матрицы
-     * \details Метод вычисляет матрицу, обратную исходной, используя метод
-     * алгебраических дополнений.
+     * \details Метод вычисляет матрицу, обратную исходной, решая систему A * X
+     * = E с помощью \ref LUDecomposition "LU-разложения".
      *
-     * Временная сложность алгоритма: O(n^4), где n - длина стороны матрицы
+     * Временная сложность алгоритма: O(n^3), где n - длина стороны матрицы
      *
      * \note Для использования данной функции тип T должен быть арифметическим,
-     * то есть поддерживать арифметические операции. Также, тип T должен
-     * приводиться к типу float
-     *
-     * \todo Планируется сделать дополнительную перегрузку inverse, которая не
-     * зависит от приведения к float
+     * то есть поддерживать арифметические операции. Вычисления ведутся в типе
+     * `T / float`
      *
      * \return Матрица, обратная данной
      * \throw matrix_bad_inverse Если матрица не квадратная
      * \throw matrix_bad_inverse Если определитель матрицы равен нулю. В таком
      * случае, обратной матрицы к данной не существует
+     * \sa LUDecomposition
      * */
-    MatrixGeneric<DivType<T, float>> inverse() const
+    MatrixGeneric<DivType<T, float>, RebindAlloc<Alloc, DivType<T, float>>>
+    inverse() const
     {
         if (_height != _width)
             throw matrix_bad_inverse("Matrix isn't square");
 
-        MatrixGeneric<DivType<T, float>> out(_height, _width);
-
-        auto delta = det();
-        if (delta == 0)
-            throw matrix_bad_inverse("Matrix determinant equals zero");
-
-        for (uint32_t i = 0; i < _height; ++i)
-        {
-            for (uint32_t j = 0; j < _width; ++j)
-            {
-                out.get(i, j) = ((i + j) % 2 ? -1 : 1) * _cofactor(i, j).det();
-            }
-        }
-
-        out = (1.f / delta) * out.transpose();
-        return out;
+        StatsScope stats("inverse", 8.0 / 3 * _height * _height * _height);
+        using Work = DivType<T, float>;
+        return LUDecomposition<T, Work, RebindAlloc<Alloc, Work>>(
+                   *this, RebindAlloc<Alloc, Work>(get_allocator()))
+            .inverse();
     }
 
     /**
      * \brief Возведение матрицы в степень
      * \details Возвращает исходную матрицу, возведенную в степень **pow**. При
-     * вычислении степени используется линейное перемножение матриц.
+     * вычислении степени используется бинарное возведение: матрица
+     * последовательно возводится в квадрат, а в результат домножаются квадраты,
+     * соответствующие единичным битам степени. Результат и квадраты живут в
+     * трех буферах, которые выделяются один раз и меняются местами, так что
+     * количество выделений памяти не зависит от **power**.
      *
-     * Временная сложность: O(n^3 * pow), где n - длина стороны матрицы
+     * Временная сложность: O(n^3 * log(pow)), где n - длина стороны матрицы.
+     * Количество умножений: floor(log2(pow)) + popcount(pow) - 1
      *
      * \param power Степень, в которую необходимо возвести матрицу
      * \return Исходная матрица в степени **power**
      * \exception matrix_bad_pow Если матрица не квадратная
+     * \sa powSymmetric()
      */
-    MatrixGeneric pow(uint32_t power)
+    MatrixGeneric pow(uint32_t power) const
     {
         if (_height != _width)
             throw matrix_bad_pow("Matrix isn't square");
 
+        uint32_t products = 0;
+        for (uint32_t p = power; p > 1; p >>= 1)
+            products += 1 + (p & 1);
+        StatsScope stats("pow", 2.0 * products * _height * _height * _height);
+
         if (power == 0)
-            return MatrixGeneric<T>::eye(_height);
+            return eye(_height, get_allocator());
 
-        MatrixGeneric<T> out(*this);
+        MatrixGeneric base(*this), out(_height, _width, get_allocator()),
+            scratch(_height, _width, get_allocator());
+        detail::GemmWorkspace<T, Alloc> ws(get_allocator());
+        bool first = true;
 
-        while (power > 1)
+        while (true)
         {
-            out = out * *this;
-            --power;
+            if (power & 1)
+            {
+                if (first)
+                {
+                    std::copy(base._data.begin(), base._data.end(),
+                              out._data.begin());
+                    first = false;
+                }
+                else
+                {
+                    detail::multiplyInto(out, base, scratch, ws);
+                    std::swap(out, scratch);
+                }
+            }
+
+            power >>= 1;
+            if (power == 0)
+                break;
+
+            detail::multiplyInto(base, base, scratch, ws);
+            std::swap(base, scratch);
         }
         return out;
     }
 
     /**
-     * \brief Вычисление ранга матрицы
-     * \details Вычисление ранга матрицы методом Гаусса.
+     * \brief Возведение симметричной матрицы в степень через
+     * диагонализацию
+     * \details Матрица раскладывается методом Якоби как A = V * D * V^T, после
+     * чего A^power = V * D^power * V^T. Время работы не зависит от степени,
+     * но результат совпадает с pow() лишь с точностью до погрешности
+     * разложения.
      *
-     * Временная сложность: О(n^3), где n - длина стороны матрицы.
+     * Временная сложность: O(n^3 * s), где s - количество проходов метода
+     * Якоби (обычно меньше десяти)
      *
-     * \note Поскольку при вычислении ранга используется метод Гаусса, в силе
-     * все ограничения, накладываемые на метод \ref det()
+     * \note Доступно только для вещественных типов T
      *
-     * \return Ранг матрицы
-     * \sa det()
+     * \param power Степень, в которую необходимо возвести матрицу
+     * \return Исходная матрица в степени **power**
+     * \exception matrix_bad_pow Если матрица не квадратная или не симметричная
+     * \sa pow(), SymmetricEigen
      */
-    uint32_t rk() const { return _gauss().first; }
+    MatrixGeneric powSymmetric(uint32_t power) const
+    {
+        static_assert(std::is_floating_point<T>::value,
+                      "powSymmetric() requires floating point elements");
 
-  private:
-    uint32_t _height{0}, ///< Высота матрицы
-        _width{0};       ///< Ширина матрицы
+        if (_height != _width)
+            throw matrix_bad_pow("Matrix isn't square");
+        if (transposeView() != *this)
+            throw matrix_bad_pow("Matrix isn't symmetric");
+
+        if (power == 0)
+            return eye(_height, get_allocator());
 
-    std::vector<T> _data; ///< Элементы матрицы, хранятся в одномерном массиве
+        StatsScope stats("powSymmetric");
+        return MatrixGeneric(SymmetricEigen<T>(*this).pow(power),
+                             get_allocator());
+    }
 
     /**
-     * \brief Вычисление алгебраического дополнения матрицы
-     * \details Вычисляет алгебраическое дополнение, удаляя i-тую строку и j-тый
-     * столбец
+     * \brief Вычисление ранга матрицы
+     * \details Ранг - количество диагональных элементов R в
+     * \ref QRDecomposition "QR-разложении с выбором столбцов", модуль которых
+     * больше `max(h, w) * eps * |r(0, 0)|`: так погрешность округления не
+     * повышает ранг вырожденной матрицы.
+     *
+     * Временная сложность: О(n^3), где n - длина стороны матрицы.
      *
-     * Временная сложность - O(n), где n - количество элементов
+     * \note Для ранга в силе все ограничения, накладываемые на метод
+     * \ref det()
      *
-     * \param i строка, которую нужно удалить
-     * \param j столбец, который нужно удалить
-     * \return Алгебраическое дополнение
-     * \throw matrix_bad_access Если удаляемая строка или столбец выходит за
-     * пределы матрицы
+     * \return Ранг матрицы
+     * \sa det(), qr()
      */
-    MatrixGeneric _cofactor(uint32_t i, uint32_t j) const
-    {
-        if (i >= _height)
-            throw matrix_bad_access("i is out of range");
-        if (j >= _width)
-            throw matrix_bad_access("j is out of range");
-
-        MatrixGeneric out = *this;
-
-        auto cnt = 0;
-        auto deleter = [&cnt, i, j, this](const T &)
-        {
-            auto pred = cnt / _width == i || cnt % _width == j;
-            ++cnt;
-            return pred;
-        };
+    uint32_t rk() const { return qr().rank(); }
 
-        auto to_del =
-            std::remove_if(out._data.begin(), out._data.end(), deleter);
-        out._data.erase(to_del, out._data.end());
-        out._height--;
-        out._width--;
-
-        return out;
+    /**
+     * \brief Вычисление ранга матрицы с заданным порогом
+     * \copydetails rk()
+     * \param tolerance Наибольший модуль диагонального элемента R, который
+     * считается нулем
+     */
+    uint32_t rk(detail::DetWorkType<T> tolerance) const
+    {
+        return qr().rank(tolerance);
     }
 
     /**
-     * \brief Метод Гаусса
-     * \details Метод Гаусса =). Вычисляет одновременно и определитель, и ранг.
-     * \todo Сделать кэширование для метода Гаусса
-     * \return `std::pair`. В first лежит ранг, в second - определитель
+     * \brief QR-разложение матрицы
+     * \details Разложение AP = QR отражениями Хаусхолдера с выбором столбцов,
+     * см. QRDecomposition. Вычисления ведутся в том же типе, что и у det()
+     *
+     * Временная сложность: О(h * w * min(h, w))
+     *
+     * \return Разложение. Память берется у распределителя матрицы
      */
-    std::pair<uint32_t, T> _gauss() const
+    QRDecomposition<T, detail::DetWorkType<T>,
+                    RebindAlloc<Alloc, detail::DetWorkType<T>>>
+    qr() const
     {
-        // Метод Гаусса приведения матрицы к верхнетреугольному виду. 1 - ранг,
-        // 2 - определитель
-
-        char sign = 1;
-
-        MatrixGeneric<DivType<float, T>> _copy(_height, _width);
-        for (uint32_t i = 0; i < _width * _height; ++i)
-        {
-            _copy.get(i / _width, i % _width) = _data[i];
-        }
-        uint32_t rank = std::min(_height, _width);
+        const double lo = std::min(_height, _width),
+                     hi = std::max(_height, _width);
+        StatsScope stats("qr", 2.0 * lo * lo * (hi - lo / 3));
+        using Work = detail::DetWorkType<T>;
+        return QRDecomposition<T, Work, RebindAlloc<Alloc, Work>>(
+            *this, RebindAlloc<Alloc, Work>(get_allocator()));
+    }
 
-        for (uint32_t row = 0; row < rank; row++)
-        {
-            if (_copy.get(row, row) != 0)
-            {
-                for (uint32_t targetRow = 0; targetRow < _height; targetRow++)
-                {
-                    if (targetRow != row)
-                    {
-                        auto mult = (float)_copy.get(targetRow, row) /
-                                    _copy.get(row, row);
-                        for (uint32_t i = 0; i < rank; i++)
-                            _copy.get(targetRow, i) -= mult * _copy.get(row, i);
-                    }
-                }
-            }
-            else
-            {
-                bool reduce = true;
-                for (uint32_t i = row + 1; i < _height; i++)
-                {
-                    if (_copy.get(i, row) != 0)
-                    {
-                        for (uint32_t targetRow = 0; targetRow < rank;
-                             targetRow++)
-                        {
-                            std::swap(_copy.get(row, targetRow),
-                                      _copy.get(i, targetRow));
-                        }
-                        reduce = false;
-                        sign *= -1;
-                        break;
-                    }
-                }
+  private:
+    uint32_t _height{0}, ///< Высота матрицы
+        _width{0};       ///< Ширина матрицы
 
-                if (reduce)
-                {
-                    rank--;
-                    sign = 0;
-                    for (uint32_t i = 0; i < _height; i++)
-                        _copy.get(i, row) = _copy.get(i, rank);
-                }
-                row--;
-            }
-        }
+    /// Элементы матрицы, хранятся построчно с шагом stride()
+    std::vector<T, Alloc> _data;
 
-        T absdet = (_width == 0 && _height == 0) ? 0 : 1;
-        for (uint32_t i = 0; i < std::min(_width, _height); ++i)
-        {
-            absdet *= _copy.get(i, i);
-        }
+    /// Начало строки **i**
+    T *_row(uint32_t i) noexcept
+    {
+        return _data.data() + std::size_t(i) * stride();
+    }
 
-        return {rank, absdet * sign};
+    /// \copydoc _row()
+    const T *_row(uint32_t i) const noexcept
+    {
+        return _data.data() + std::size_t(i) * stride();
     }
 };
 
+#include "GaussElimination.hpp"
+#include "LUDecomposition.hpp"
+#include "QRDecomposition.hpp"
+#include "SymmetricEigen.hpp"
+
 #endif
@@ -2,117 +2,286 @@
 #define __MATRIX_OPS
 
 #include "Exceptions.hpp"
+#include "MatrixExpression.hpp"
+#include "MatrixGemm.hpp"
+#include "MatrixSimd.hpp"
+#include "MatrixStats.hpp"
+#include "MatrixStrassen.hpp"
+#include "MatrixTypes.hpp"
+#include "MatrixView.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 /** \file MatrixOperation.hpp
- *  Файл содержащий арифметические операции над матрицами и некоторые type
- * aliases
+ *  Файл содержащий арифметические операции над матрицами. Type aliases для
+ * типов результатов вынесены в MatrixTypes.hpp
  *  \author dmsukhikh
  */
 
 // forward declaration
-template <typename T> class MatrixGeneric;
+template <typename T, typename Work = DivType<T, float>,
+          typename Alloc = std::allocator<Work>>
+class LUDecomposition;
 
-template <typename A, typename B>
-using AddType = decltype(std::declval<A>() + std::declval<B>());
-
-template <typename A, typename B>
-using SubsType = decltype(std::declval<A>() - std::declval<B>());
+namespace detail
+{
+/**
+ * \brief Эталонное умножение матриц
+ * \details Умножение по определению: тройной цикл с проверкой границ на
+ * каждом обращении. Используется для типов, для которых не подходит блочное
+ * ядро из MatrixGemm.hpp, а также как эталон в тестах.
+ *
+ * \param alloc Распределитель памяти для результата
+ * \sa operator*()
+ */
+template <typename L, typename R,
+          typename A = typename L::value_type,
+          typename B = typename R::value_type,
+          typename Alloc = std::allocator<AddType<MulType<A, B>, MulType<A, B>>>>
+MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>, Alloc>
+multiplyReference(const L &a, const R &b, const Alloc &alloc = Alloc())
+{
+    using RetType = AddType<MulType<A, B>, MulType<A, B>>;
 
-template <typename A, typename B>
-using MulType = decltype(std::declval<A>() * std::declval<B>());
+    MatrixGeneric<RetType, Alloc> out(a.height(), b.width(), alloc);
+    for (uint32_t i = 0; i < a.height(); ++i)
+    {
+        for (uint32_t j = 0; j < b.width(); ++j)
+        {
+            RetType sm = 0;
+            for (uint32_t k = 0; k < a.width(); ++k)
+            {
+                sm += a.get(i, k) * b.get(k, j);
+            }
+            out.get(i, j) = sm;
+        }
+    }
 
-template <typename A, typename B>
-using DivType = decltype(std::declval<A>() / std::declval<B>());
+    return out;
+}
 
-template <typename First, typename Second>
-MatrixGeneric<AddType<First, Second>> operator+(const MatrixGeneric<First> &a,
-                                                const MatrixGeneric<Second> &b)
+/**
+ * \brief Можно ли умножать матрицы блочным ядром
+ * \details Блочное ядро работает для арифметических типов: элементы
+ * операндов приводятся к типу результата при упаковке, что совпадает с
+ * обычными арифметическими преобразованиями в выражении `a * b`
+ */
+template <typename A, typename B, typename R>
+struct UseBlockedGemm
+    : std::integral_constant<bool, std::is_arithmetic<A>::value &&
+                                       std::is_arithmetic<B>::value &&
+                                       std::is_arithmetic<R>::value>
 {
-    using RetType = MatrixGeneric<AddType<First, Second>>;
+};
 
-    if (a.height() != b.height() || a.width() != b.width())
+/**
+ * \brief Операнд strassen(): построчно, в типе вычислений
+ * \details Если представление уже такое, возвращаются его данные, иначе
+ * оно копируется в **copy**
+ *
+ * \param ld Шаг между строками возвращенных данных
+ */
+template <typename T, typename S>
+const T *strassenOperand(MatrixView<const S> v, std::vector<T> &copy,
+                         std::size_t &ld)
+{
+    if (std::is_same<T, S>::value && v.colStride() == 1)
     {
-        std::string what = "Sizes of matrices aren't equal: ";
-        what += std::to_string(a.height()) + "x" + std::to_string(a.width());
-        what += " != ";
-        what += std::to_string(b.height()) + "x" + std::to_string(b.width());
-        throw matrix_bad_operation(what.c_str());
+        ld = v.rowStride();
+        return reinterpret_cast<const T *>(v.data());
     }
+    copy.resize(std::size_t(v.height()) * v.width());
+    v.assignTo(copy.data(), v.width());
+    ld = v.width();
+    return copy.data();
+}
 
-    RetType out(a.height(), a.width());
-    for (uint32_t i = 0; i < out.height() * out.width(); ++i)
+/**
+ * \brief Умножение матриц блочным ядром
+ * \details Перегрузка для арифметических типов, см. UseBlockedGemm. Если все
+ * размеры не меньше **crossover**, умножение идет алгоритмом
+ * Штрассена-Винограда
+ *
+ * \param crossover Порог strassen(); 0 - всегда gemm()
+ * \sa gemm()
+ */
+template <typename A, typename B, typename Alloc>
+MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>, Alloc>
+multiply(MatrixView<const A> a, MatrixView<const B> b, const Alloc &alloc,
+         uint32_t crossover, std::true_type)
+{
+    using RetType = AddType<MulType<A, B>, MulType<A, B>>;
+    MatrixGeneric<RetType, Alloc> out(a.height(), b.width(), alloc);
+
+    if (crossover != 0 &&
+        std::min({a.height(), a.width(), b.width()}) >= crossover)
     {
-        out._data[i] = a._data[i] + b._data[i];
+        std::vector<RetType> copyA, copyB;
+        std::size_t lda, ldb;
+        const RetType *pa = strassenOperand(a, copyA, lda);
+        const RetType *pb = strassenOperand(b, copyB, ldb);
+        std::vector<RetType> work(strassenWorkspace(a.height(), b.width(),
+                                                    a.width(), crossover));
+        strassen(a.height(), b.width(), a.width(), pa, lda, pb, ldb,
+                 out.data(), out.stride(), crossover, work.data());
+        return out;
     }
 
+    gemm(a.height(), b.width(), a.width(), a.data(), a.rowStride(),
+         a.colStride(), b.data(), b.rowStride(), b.colStride(), out.data(),
+         out.stride());
     return out;
 }
 
-template <typename G, typename Scalar>
-MatrixGeneric<MulType<Scalar, G>> operator*(Scalar s, const MatrixGeneric<G> &a)
+/**
+ * \brief Умножение матриц по определению
+ * \details Перегрузка для произвольных типов
+ * \sa multiplyReference()
+ */
+template <typename A, typename B, typename Alloc>
+MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>, Alloc>
+multiply(MatrixView<const A> a, MatrixView<const B> b, const Alloc &alloc,
+         uint32_t, std::false_type)
 {
-    MatrixGeneric<MulType<Scalar, G>> out(a.height(), a.width());
-    for (uint32_t i = 0; i < out.height() * out.width(); ++i)
-    {
-        out._data[i] = a._data[i] * s;
-    }
-    return out;
+    return multiplyReference(a, b, alloc);
 }
 
-template <typename A, typename B>
-MatrixGeneric<SubsType<A, B>> operator-(const MatrixGeneric<A> &a,
-                                        const MatrixGeneric<B> &b)
+/**
+ * \brief Произведение матриц, заданных представлениями
+ * \details Проверяет размеры и выбирает ядро. Шаги представлений передаются
+ * в gemm() напрямую, поэтому блоки и транспонированные представления не
+ * копируются
+ *
+ * \param alloc Распределитель памяти для результата
+ * \param crossover Порог алгоритма Штрассена-Винограда, см.
+ * strassenCrossover()
+ * \throw matrix_bad_operation Если размеры не позволяют произвести умножение
+ * \sa operator*()
+ */
+template <typename A, typename B,
+          typename Alloc = std::allocator<AddType<MulType<A, B>, MulType<A, B>>>>
+MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>, Alloc>
+multiplyViews(MatrixView<const A> a, MatrixView<const B> b,
+              const Alloc &alloc = Alloc(),
+              uint32_t crossover = strassenCrossover())
 {
-    // Код дублируется, потому что a + ((-1) * b) может привести к
-    // неправильному выводу типа: скажем a, b хранят тип short. Тогда в
-    // результате мы получим тип int, потому что -1 типа int. static_cast в
-    // теории может не сработать.
-    // Возможно, стоит добавить generic функцию, принимающую std::function?
-
-    using RetType = MatrixGeneric<SubsType<A, A>>;
+    using RetType = AddType<MulType<A, B>, MulType<A, B>>;
 
-    if (a.height() != b.height() || a.width() != b.width())
+    if (a.width() != b.height())
     {
-        std::string what = "Sizes of matrices aren't equal: ";
+        std::string what =
+            "Sizes of matrices aren't compatible for multiplication: ";
         what += std::to_string(a.height()) + "x" + std::to_string(a.width());
-        what += " != ";
+        what += " and ";
         what += std::to_string(b.height()) + "x" + std::to_string(b.width());
         throw matrix_bad_operation(what.c_str());
     }
 
-    RetType out(a.height(), a.width());
-    for (uint32_t i = 0; i < out.height() * out.width(); ++i)
-    {
-        out._data[i] = a._data[i] - b._data[i];
-    }
-
-    return out;
+    StatsScope stats("mul", 2.0 * a.height() * a.width() * b.width());
+    return multiply(a, b, alloc, crossover, UseBlockedGemm<A, B, RetType>{});
 }
 
-template <typename A, typename B>
-MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>>
-operator*(const MatrixGeneric<A> &a, const MatrixGeneric<B> &b)
+/**
+ * \brief Решение системы a * X = b, заданной представлениями
+ * \details Матрица раскладывается один раз, после чего все столбцы **b**
+ * решаются прямым и обратным ходом вместе
+ *
+ * \tparam Alloc Распределитель памяти для разложения и результата
+ * \throw matrix_bad_operation Если **a** не квадратная, высоты не совпадают
+ * или **a** вырождена
+ * \sa solve()
+ */
+template <typename A, typename B, typename Alloc>
+MatrixGeneric<QuotType<B, A>, Alloc>
+solveViews(MatrixView<const A> a, MatrixView<const B> b, const Alloc &alloc)
 {
-    using RetType = AddType<MulType<A, B>, MulType<A, B>>;
+    const double n = a.height();
+    StatsScope stats("solve", 2.0 / 3 * n * n * n + 2.0 * n * n * b.width());
+    return LUDecomposition<A, QuotType<B, A>, Alloc>(a, alloc).solve(b);
+}
 
+/**
+ * \brief Частное матриц, заданных представлениями
+ * \details X * b = a решается как b^T * X^T = a^T: транспонированные
+ * представления не копируются, а строки **a** становятся столбцами правой
+ * части
+ *
+ * \param alloc Распределитель памяти для разложения и результата
+ * \throw matrix_bad_operation Если делитель не квадратный или размеры не
+ * совпадают
+ * \throw matrix_bad_inverse Если делитель вырожден
+ * \sa operator/()
+ */
+template <typename A, typename B,
+          typename Alloc = std::allocator<QuotType<A, B>>>
+MatrixGeneric<QuotType<A, B>, Alloc>
+divideViews(MatrixView<const A> a, MatrixView<const B> b,
+            const Alloc &alloc = Alloc())
+{
+    if (b.width() != b.height())
+        throw matrix_bad_operation("Denominator isn't square");
     if (a.width() != b.height())
     {
-        std::string what =
-            "Sizes of matrices aren't compatible for multiplication: ";
+        std::string what = "Sizes of matrices aren't compatible for division: ";
         what += std::to_string(a.height()) + "x" + std::to_string(a.width());
         what += " and ";
         what += std::to_string(b.height()) + "x" + std::to_string(b.width());
         throw matrix_bad_operation(what.c_str());
     }
 
-    MatrixGeneric<RetType> out(a.height(), b.width());
+    const double n = b.height();
+    StatsScope stats("div", 2.0 / 3 * n * n * n + 2.0 * n * n * a.height());
+    LUDecomposition<B, QuotType<A, B>, Alloc> lu(b.transposeView(), alloc);
+    if (lu.isSingular())
+        throw matrix_bad_inverse("Matrix determinant equals zero");
+    MatrixGeneric<QuotType<A, B>, Alloc> x = lu.solve(a.transposeView());
+    x.transposeInPlace();
+    return x;
+}
+
+/// Представление только для чтения для матрицы или представления
+template <typename T, typename Alloc>
+MatrixView<const T> constView(const MatrixGeneric<T, Alloc> &m) noexcept
+{
+    return MatrixView<const T>(m);
+}
+
+template <typename T>
+MatrixView<const std::remove_const_t<T>>
+constView(const MatrixView<T> &v) noexcept
+{
+    return v;
+}
+
+/**
+ * \brief Умножение квадратных матриц в заранее выделенный буфер
+ * \details Перегрузка для арифметических типов
+ * \sa multiplyInto()
+ */
+template <typename T, typename Alloc>
+void multiplyInto(const MatrixGeneric<T, Alloc> &a,
+                  const MatrixGeneric<T, Alloc> &b, MatrixGeneric<T, Alloc> &out,
+                  GemmWorkspace<T, Alloc> &ws, std::true_type)
+{
+    gemm(a.height(), b.width(), a.width(), a.data(), a.stride(), 1, b.data(),
+         b.stride(), 1, out.data(), out.stride(), ws);
+}
+
+template <typename T, typename Alloc>
+void multiplyInto(const MatrixGeneric<T, Alloc> &a,
+                  const MatrixGeneric<T, Alloc> &b, MatrixGeneric<T, Alloc> &out,
+                  GemmWorkspace<T, Alloc> &, std::false_type)
+{
     for (uint32_t i = 0; i < a.height(); ++i)
     {
         for (uint32_t j = 0; j < b.width(); ++j)
         {
-            RetType sm = 0;
+            T sm = 0;
             for (uint32_t k = 0; k < a.width(); ++k)
             {
                 sm += a.get(i, k) * b.get(k, j);
@@ -120,36 +289,441 @@ operator*(const MatrixGeneric<A> &a, const MatrixGeneric<B> &b)
             out.get(i, j) = sm;
         }
     }
+}
 
-    return out;
+/**
+ * \brief Умножение матриц в заранее выделенный буфер
+ * \details out = a * b без выделения памяти под результат. Используется в
+ * сериях умножений, например, в MatrixGeneric::pow()
+ *
+ * \param out Матрица размером a.height() x b.width(), не совпадающая с
+ * операндами
+ * \param ws Буферы упаковки, переиспользуются между вызовами
+ */
+template <typename T, typename Alloc>
+void multiplyInto(const MatrixGeneric<T, Alloc> &a,
+                  const MatrixGeneric<T, Alloc> &b, MatrixGeneric<T, Alloc> &out,
+                  GemmWorkspace<T, Alloc> &ws)
+{
+    multiplyInto(a, b, out, ws, UseBlockedGemm<T, T, T>{});
 }
 
-template <typename A, typename B>
-MatrixGeneric<MulType<A, DivType<B, float>>>
-operator/(const MatrixGeneric<A> &a, const MatrixGeneric<B> &b)
+/// Сторона блока, который транспонируется напрямую, без деления
+constexpr uint32_t transposeTile = 16;
+
+/**
+ * \brief Транспонирование блока в другой буфер
+ * \details Cache-oblivious алгоритм: большая из сторон блока делится пополам,
+ * пока блок не станет не больше transposeTile x transposeTile. На каждом
+ * уровне рекурсии блок и его образ со временем помещаются в кеш
+ * соответствующего уровня, поэтому чтение по столбцам не вызывает промахов
+ * на каждом элементе, какими бы ни были размеры кешей и TLB.
+ *
+ * \param src Блок **rows** x **cols** с шагом строк **lds**
+ * \param dst Буфер **cols** x **rows** с шагом строк **ldd**, не
+ * пересекающийся с **src**
+ */
+template <typename T>
+void transposeBlock(const T *src, std::size_t lds, T *dst, std::size_t ldd,
+                    uint32_t rows, uint32_t cols)
 {
-    if (b.width() != b.height())
-        throw matrix_bad_operation("Denominator isn't square");
-    return a * b.inverse();
+    if (rows <= transposeTile && cols <= transposeTile)
+    {
+        for (uint32_t i = 0; i < rows; ++i)
+        {
+            for (uint32_t j = 0; j < cols; ++j)
+                dst[j * ldd + i] = src[i * lds + j];
+        }
+        return;
+    }
+
+    if (rows >= cols)
+    {
+        uint32_t half = rows / 2;
+        transposeBlock(src, lds, dst, ldd, half, cols);
+        transposeBlock(src + half * lds, lds, dst + half, ldd, rows - half,
+                       cols);
+    }
+    else
+    {
+        uint32_t half = cols / 2;
+        transposeBlock(src, lds, dst, ldd, rows, half);
+        transposeBlock(src + half, lds, dst + half * ldd, ldd, rows,
+                       cols - half);
+    }
 }
 
-template <typename A, typename B>
-bool operator==(const MatrixGeneric<A> &a, const MatrixGeneric<B> &b)
+/**
+ * \brief Обмен блока с транспонированным образом другого блока
+ * \details a[i][j] меняется местами с b[j][i]. Блоки делятся так же, как в
+ * transposeBlock()
+ *
+ * \param a Блок **rows** x **cols**
+ * \param b Блок **cols** x **rows**, не пересекающийся с **a**
+ * \param ld Общий шаг строк
+ */
+template <typename T>
+void swapTransposed(T *a, T *b, std::size_t ld, uint32_t rows, uint32_t cols)
+{
+    if (rows <= transposeTile && cols <= transposeTile)
+    {
+        for (uint32_t i = 0; i < rows; ++i)
+        {
+            for (uint32_t j = 0; j < cols; ++j)
+                std::swap(a[i * ld + j], b[j * ld + i]);
+        }
+        return;
+    }
+
+    if (rows >= cols)
+    {
+        uint32_t half = rows / 2;
+        swapTransposed(a, b, ld, half, cols);
+        swapTransposed(a + half * ld, b + half, ld, rows - half, cols);
+    }
+    else
+    {
+        uint32_t half = cols / 2;
+        swapTransposed(a, b, ld, rows, half);
+        swapTransposed(a + half, b + half * ld, ld, rows, cols - half);
+    }
+}
+
+/**
+ * \brief Транспонирование квадратного блока на месте
+ * \details Диагональные блоки транспонируются рекурсивно, а внедиагональные
+ * меняются местами через swapTransposed()
+ *
+ * \param a Блок **n** x **n** с шагом строк **ld**
+ */
+template <typename T> void transposeSquare(T *a, std::size_t ld, uint32_t n)
 {
-    auto comp = [](const A &first, const B &second) { return first == second; };
-    if (a._data.size() != b._data.size())
+    if (n <= transposeTile)
+    {
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            for (uint32_t j = i + 1; j < n; ++j)
+                std::swap(a[i * ld + j], a[j * ld + i]);
+        }
+        return;
+    }
+
+    uint32_t half = n / 2;
+    transposeSquare(a, ld, half);
+    transposeSquare(a + half * ld + half, ld, n - half);
+    swapTransposed(a + half, a + half * ld, ld, half, n - half);
+}
+
+/**
+ * \brief Выравнивание строк матрицы с распределителем **Alloc**
+ * \details Распределитель, у которого есть статический член `alignment`,
+ * выдает память с таким выравниванием, и MatrixGeneric дополняет строки так,
+ * чтобы каждая из них начиналась с выровненного адреса (см.
+ * AlignedAllocator). Для остальных распределителей - 0, строки хранятся
+ * подряд
+ */
+template <typename Alloc, typename = void>
+struct StorageAlignment : std::integral_constant<std::size_t, 0>
+{
+};
+
+template <typename Alloc>
+struct StorageAlignment<Alloc, decltype(void(Alloc::alignment))>
+    : std::integral_constant<std::size_t, Alloc::alignment>
+{
+};
+
+/**
+ * \brief Шаг между строками матрицы ширины **width**
+ * \details Ширина, округленная вверх до числа элементов **T** в
+ * StorageAlignment. Если выравнивание не кратно размеру элемента, строки не
+ * дополняются
+ */
+template <typename T, typename Alloc> uint32_t paddedStride(uint32_t width)
+{
+    constexpr std::size_t align = StorageAlignment<Alloc>::value;
+    constexpr std::size_t lanes = align % sizeof(T) == 0 ? align / sizeof(T) : 0;
+    if (lanes <= 1)
+        return width;
+    return uint32_t((width + lanes - 1) / lanes * lanes);
+}
+
+/**
+ * \brief Тип, в котором считается определитель матрицы из элементов **T**
+ * \details Для целых типов - double, чтобы произведение диагонали не теряло
+ * точность float, для остальных - тип частного `T / float`
+ */
+template <typename T>
+using DetWorkType = typename std::conditional<std::is_integral<T>::value, double,
+                                              DivType<T, float>>::type;
+
+/**
+ * \brief Приведение определителя к типу элементов матрицы
+ * \details Для целых типов значение округляется до ближайшего целого:
+ * определитель целочисленной матрицы - целое число, а погрешность исключения
+ * не должна превращать 325 в 324
+ */
+template <typename T, typename W>
+T castDeterminant(const W &value, std::true_type)
+{
+    return static_cast<T>(std::llround(value));
+}
+
+template <typename T, typename W>
+T castDeterminant(const W &value, std::false_type)
+{
+    return static_cast<T>(value);
+}
+} // namespace detail
+
+/**
+ * \brief Сложение двух матриц
+ * \details Складывает две матрицы. Результат вычисляется лениво: возвращается
+ * \ref MatrixExpression "выражение", которое вычисляется за один проход при
+ * присваивании в MatrixGeneric. Цепочки вида `a + b - c` не создают
+ * промежуточных матриц.
+ *
+ * Временная сложность: O(n), где n - количество элементов в матрице.
+ *
+ * \note Тип элементов результата вычисляется как тип, получающийся в
+ * результате сложения двух элементов из разных матриц. Так, если мы
+ * складываем MatrixGeneric<int> и MatrixGeneric<float>, то получится
+ * MatrixGeneric<float>. Таким образом, можно складывать матрицы, состоящие из
+ * элементов разных типов, но которые приводятся один к другому
+ *
+ * \tparam L Тип первого операнда: MatrixGeneric или выражение
+ * \tparam R Тип второго операнда: MatrixGeneric или выражение
+ * \param a Первая матрицa
+ * \param b Вторая матрица
+ *
+ * \exception matrix_bad_operation Если размеры матриц не совпадают
+ * \return Выражение-сумма матриц
+ */
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::IsMatrixOperand<L>::value &&
+                                      detail::IsMatrixOperand<R>::value>>
+detail::SumExpression<L, R> operator+(L &&a, R &&b)
+{
+    return detail::SumExpression<L, R>(std::forward<L>(a), std::forward<R>(b));
+}
+
+/**
+ * \brief Произведение матрицы на скаляр
+ * \details Умножает матрицу на скаляр. Как и \ref operator+() "сложение",
+ * вычисляется лениво.
+ *
+ * Временная сложность: O(n), где n - количество элементов в матрице.
+ *
+ * \note
+ * - Тип вычисляется подобно тому, как и при \ref operator+() "сложении"
+ * матриц
+ * - Число должно идти первым. Выражение вида `MatrixGeneric<int>::eye(3) *
+ * 2` не скомпилируется
+ *
+ * \tparam Scalar Тип скаляра
+ * \tparam M Тип операнда: MatrixGeneric или выражение
+ * \param scalar Скаляр, на который умножается матрица
+ * \param a Mатрица
+ *
+ * \return Выражение - матрица, умноженная на скаляр
+ * \sa operator+()
+ */
+template <typename Scalar, typename M,
+          typename = std::enable_if_t<
+              !detail::IsMatrixOperand<Scalar>::value &&
+              detail::IsScalarOperand<std::decay_t<Scalar>>::value &&
+              detail::IsMatrixOperand<M>::value>>
+detail::ScaleExpression<Scalar, M> operator*(Scalar scalar, M &&a)
+{
+    return detail::ScaleExpression<Scalar, M>(scalar, std::forward<M>(a));
+}
+
+/**
+ * \brief Разность двух матриц
+ * \details Вычитает одну матрицу из другой. Как и \ref operator+()
+ * "сложение", вычисляется лениво.
+ *
+ * Временная сложность: O(n), где n - количество элементов в матрице.
+ *
+ * \note Тип вычисляется подобно тому, как и при \ref operator+() "сложении"
+ * матриц. То есть, есть возможность вычитать матрицы разных типов.
+ *
+ * \tparam L Тип первого операнда: MatrixGeneric или выражение
+ * \tparam R Тип второго операнда: MatrixGeneric или выражение
+ * \param a Первая матрицa
+ * \param b Вторая матрица
+ *
+ * \return Выражение-разность матриц
+ * \exception matrix_bad_operation Если размеры матриц не совпадают
+ * \sa operator+()
+ */
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::IsMatrixOperand<L>::value &&
+                                      detail::IsMatrixOperand<R>::value>>
+detail::DifferenceExpression<L, R> operator-(L &&a, R &&b)
+{
+    return detail::DifferenceExpression<L, R>(std::forward<L>(a),
+                                              std::forward<R>(b));
+}
+
+template <typename A, typename AllocA, typename B, typename AllocB>
+MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>,
+              RebindAlloc<AllocA, AddType<MulType<A, B>, MulType<A, B>>>>
+operator*(const MatrixGeneric<A, AllocA> &a, const MatrixGeneric<B, AllocB> &b)
+{
+    return detail::multiplyViews(
+        detail::constView(a), detail::constView(b),
+        RebindAlloc<AllocA, AddType<MulType<A, B>, MulType<A, B>>>(
+            a.get_allocator()));
+}
+
+/**
+ * \brief Умножение матриц алгоритмом Штрассена-Винограда
+ * \details Произведение то же, что у operator*(), но пока все размеры не
+ * меньше **crossover**, матрицы делятся на блоки и перемножаются через семь
+ * умножений блоков вместо восьми (см. detail::strassen()). Размеры могут быть
+ * любыми, в том числе нечетными и разными.
+ *
+ * Временная сложность: O(n^2.81)
+ *
+ * \note Погрешность для чисел с плавающей точкой больше, чем у operator*(),
+ * и растет с каждым уровнем рекурсии. Для целых типов результат совпадает с
+ * обычным умножением. Для неарифметических типов используется обычное
+ * умножение
+ *
+ * \param crossover Размер, ниже которого блоки перемножаются обычным ядром.
+ * 0 - алгоритм не используется
+ * \throw matrix_bad_operation Если размеры не позволяют произвести умножение
+ * \sa setStrassenCrossover()
+ */
+template <typename A, typename AllocA, typename B, typename AllocB>
+MatrixGeneric<AddType<MulType<A, B>, MulType<A, B>>,
+              RebindAlloc<AllocA, AddType<MulType<A, B>, MulType<A, B>>>>
+multiplyStrassen(const MatrixGeneric<A, AllocA> &a,
+                 const MatrixGeneric<B, AllocB> &b,
+                 uint32_t crossover = strassenDefaultCrossover)
+{
+    return detail::multiplyViews(
+        detail::constView(a), detail::constView(b),
+        RebindAlloc<AllocA, AddType<MulType<A, B>, MulType<A, B>>>(
+            a.get_allocator()),
+        crossover);
+}
+
+template <typename A, typename AllocA, typename B, typename AllocB>
+MatrixGeneric<QuotType<A, B>, RebindAlloc<AllocA, QuotType<A, B>>>
+operator/(const MatrixGeneric<A, AllocA> &a, const MatrixGeneric<B, AllocB> &b)
+{
+    return detail::divideViews(
+        detail::constView(a), detail::constView(b),
+        RebindAlloc<AllocA, QuotType<A, B>>(a.get_allocator()));
+}
+
+/**
+ * \brief Решение системы линейных уравнений a * X = b
+ * \details Матрица **a** раскладывается в \ref LUDecomposition
+ * "LU-разложение" один раз, после чего прямой и обратный ход идут сразу для
+ * всех столбцов **b**; для широкой правой части - блоками строк с вычитанием
+ * через блочное умножение. В отличие от `a.inverse() * b` обратная матрица не
+ * строится, что вдвое-втрое быстрее и дает меньшую погрешность.
+ *
+ * Временная сложность: O(n^3 + n^2 * k), где n - сторона **a**, k - ширина
+ * **b**
+ *
+ * \note Вычисления ведутся в типе `B * (A / float)`, как и у operator/()
+ *
+ * \param a Квадратная матрица системы
+ * \param b Матрица правых частей, по столбцу на систему
+ * \return Решение X размером n x k. Память берется у распределителя **a**
+ * \throw matrix_bad_operation Если **a** не квадратная, высота **b** не
+ * совпадает с ее размером или **a** вырождена
+ *
+ * \sa operator/()
+ * \sa LUDecomposition
+ */
+template <typename A, typename AllocA, typename B, typename AllocB>
+MatrixGeneric<QuotType<B, A>, RebindAlloc<AllocA, QuotType<B, A>>>
+solve(const MatrixGeneric<A, AllocA> &a, const MatrixGeneric<B, AllocB> &b)
+{
+    return detail::solveViews(
+        detail::constView(a), detail::constView(b),
+        RebindAlloc<AllocA, QuotType<B, A>>(a.get_allocator()));
+}
+
+template <typename A, typename AllocA, typename B, typename AllocB>
+bool operator==(const MatrixGeneric<A, AllocA> &a,
+                const MatrixGeneric<B, AllocB> &b)
+{
+    if (a.width() != b.width() || a.height() != b.height())
         return false;
 
-    bool output = a.width() == b.width() && a.height() == b.height();
-    for (std::size_t i = 0; i < a._data.size(); ++i)
+    if (a.stride() == a.width() && b.stride() == b.width())
+        return detail::simd::equal(a.data(), b.data(),
+                                   std::size_t(a.height()) * a.width(),
+                                   detail::simd::UseSimd<A, A, B>{});
+
+    for (uint32_t i = 0; i < a.height(); ++i)
     {
-        output = output && comp(a._data[i], b._data[i]);
+        if (!detail::simd::equal(a.data() + i * a.stride(),
+                                 b.data() + i * b.stride(), a.width(),
+                                 detail::simd::UseSimd<A, A, B>{}))
+            return false;
     }
-    return output;
+    return true;
+}
+
+template <typename A, typename AllocA, typename B, typename AllocB>
+bool operator!=(const MatrixGeneric<A, AllocA> &a,
+                const MatrixGeneric<B, AllocB> &b)
+{
+    return !(a == b);
+}
+
+// Перегрузки для ленивых выражений и представлений. Для умножения
+// выражения вычисляются, а представления передаются в ядро как есть;
+// сравнение идет поэлементно без вычисления выражений в память
+
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::IsLazyOperandPair<L, R>::value>>
+auto operator*(const L &a, const R &b)
+{
+    const auto &ea = detail::evaluate(a);
+    const auto &eb = detail::evaluate(b);
+    return detail::multiplyViews(detail::constView(ea), detail::constView(eb));
+}
+
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::IsLazyOperandPair<L, R>::value>>
+auto operator/(const L &a, const R &b)
+{
+    const auto &ea = detail::evaluate(a);
+    const auto &eb = detail::evaluate(b);
+    return detail::divideViews(detail::constView(ea), detail::constView(eb));
+}
+
+/// \copydoc solve()
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::IsLazyOperandPair<L, R>::value>>
+auto solve(const L &a, const R &b)
+{
+    const auto &ea = detail::evaluate(a);
+    const auto &eb = detail::evaluate(b);
+    using A = typename std::decay_t<decltype(ea)>::value_type;
+    using B = typename std::decay_t<decltype(eb)>::value_type;
+    return detail::solveViews(detail::constView(ea), detail::constView(eb),
+                              std::allocator<QuotType<B, A>>());
+}
+
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::IsLazyOperandPair<L, R>::value>>
+bool operator==(const L &a, const R &b)
+{
+    return detail::equalOperands(a, b);
 }
 
-template <typename A, typename B>
-bool operator!=(const MatrixGeneric<A> &a, const MatrixGeneric<B> &b)
+template <typename L, typename R,
+          typename = std::enable_if_t<detail::IsLazyOperandPair<L, R>::value>>
+bool operator!=(const L &a, const R &b)
 {
     return !(a == b);
 }
@@ -0,0 +1,559 @@
+#ifndef __MATRIX_SIMD
+#define __MATRIX_SIMD
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                               \
+    (defined(__x86_64__) || defined(__i386__))
+#define TSPP_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define TSPP_SIMD_X86 0
+#endif
+
+/**
+ * \file MatrixSimd.hpp
+ * Файл, содержащий векторизованные поэлементные ядра (сложение, вычитание,
+ * умножение на скаляр, сравнение) для float, double, int и long long.
+ * Набор инструкций (SSE2, AVX2, AVX-512) выбирается во время исполнения по
+ * возможностям процессора, на остальных платформах используется скалярная
+ * реализация
+ * \author dmsukhikh
+ */
+
+namespace detail
+{
+namespace simd
+{
+
+/**
+ * \brief Набор инструкций, которым исполняются ядра
+ * \details Уровни упорядочены: каждый следующий поддерживает все предыдущие
+ */
+enum class Level
+{
+    Scalar = 0,
+    SSE2 = 1,
+    AVX2 = 2,
+    AVX512 = 3
+};
+
+/**
+ * \brief Определение лучшего набора инструкций
+ * \details Проверка выполняется один раз, результат кэшируется
+ * \return Самый широкий набор инструкций, поддерживаемый процессором
+ */
+inline Level detectedLevel()
+{
+#if TSPP_SIMD_X86
+    static const Level level = []()
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") &&
+            __builtin_cpu_supports("avx512dq"))
+            return Level::AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return Level::AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return Level::SSE2;
+        return Level::Scalar;
+    }();
+    return level;
+#else
+    return Level::Scalar;
+#endif
+}
+
+/**
+ * \brief Ограничение запрошенного набора инструкций доступным
+ * \param requested Желаемый набор инструкций
+ * \return **requested**, если процессор его поддерживает, иначе detectedLevel()
+ */
+inline Level clampLevel(Level requested)
+{
+    return static_cast<int>(requested) < static_cast<int>(detectedLevel())
+               ? requested
+               : detectedLevel();
+}
+
+/// Типы, для которых есть векторизованные ядра
+template <typename T>
+struct IsSimdType
+    : std::integral_constant<bool, std::is_same<T, float>::value ||
+                                       std::is_same<T, double>::value ||
+                                       std::is_same<T, int>::value ||
+                                       std::is_same<T, long long>::value>
+{
+};
+
+// Скалярные реализации. Используются для хвостов массивов, для остальных
+// типов и на платформах без SIMD
+
+template <typename R, typename A, typename B>
+void addScalar(const A *a, const B *b, R *out, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = a[i] + b[i];
+}
+
+template <typename R, typename A, typename B>
+void subScalar(const A *a, const B *b, R *out, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = a[i] - b[i];
+}
+
+template <typename R, typename A, typename S>
+void scaleScalar(S s, const A *a, R *out, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = a[i] * s;
+}
+
+template <typename A, typename B>
+bool equalScalar(const A *a, const B *b, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (!(a[i] == b[i]))
+            return false;
+    }
+    return true;
+}
+
+#if TSPP_SIMD_X86
+
+#define TSPP_TARGET_SSE2 __attribute__((target("sse2")))
+#define TSPP_TARGET_AVX2 __attribute__((target("avx2")))
+#define TSPP_TARGET_AVX512 __attribute__((target("avx512f,avx512dq")))
+
+struct Sse2
+{
+};
+struct Avx2
+{
+};
+struct Avx512
+{
+};
+
+/**
+ * \brief Обертка над векторным регистром
+ * \details Для каждой пары (тип, набор инструкций) задает ширину регистра и
+ * операции load, store, set1, add, sub, mul и eq. Операции, которых нет в наборе
+ * инструкций (например, умножение 64-битных целых в AVX2), эмулируются
+ * поэлементно
+ */
+template <typename T, typename Isa> struct Vec;
+
+// ----- SSE2 -----
+
+template <> struct Vec<float, Sse2>
+{
+    using Reg = __m128;
+    static constexpr std::size_t width = 4;
+    TSPP_TARGET_SSE2 static Reg load(const float *p) { return _mm_loadu_ps(p); }
+    TSPP_TARGET_SSE2 static void store(float *p, Reg r) { _mm_storeu_ps(p, r); }
+    TSPP_TARGET_SSE2 static Reg set1(float s) { return _mm_set1_ps(s); }
+    TSPP_TARGET_SSE2 static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+    TSPP_TARGET_SSE2 static Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+    TSPP_TARGET_SSE2 static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+    TSPP_TARGET_SSE2 static bool eq(Reg a, Reg b)
+    {
+        return _mm_movemask_ps(_mm_cmpeq_ps(a, b)) == 0xF;
+    }
+};
+
+template <> struct Vec<double, Sse2>
+{
+    using Reg = __m128d;
+    static constexpr std::size_t width = 2;
+    TSPP_TARGET_SSE2 static Reg load(const double *p) { return _mm_loadu_pd(p); }
+    TSPP_TARGET_SSE2 static void store(double *p, Reg r) { _mm_storeu_pd(p, r); }
+    TSPP_TARGET_SSE2 static Reg set1(double s) { return _mm_set1_pd(s); }
+    TSPP_TARGET_SSE2 static Reg add(Reg a, Reg b) { return _mm_add_pd(a, b); }
+    TSPP_TARGET_SSE2 static Reg sub(Reg a, Reg b) { return _mm_sub_pd(a, b); }
+    TSPP_TARGET_SSE2 static Reg mul(Reg a, Reg b) { return _mm_mul_pd(a, b); }
+    TSPP_TARGET_SSE2 static bool eq(Reg a, Reg b)
+    {
+        return _mm_movemask_pd(_mm_cmpeq_pd(a, b)) == 0x3;
+    }
+};
+
+/// Общая часть целочисленных регистров SSE2
+template <typename T> struct VecIntSse2
+{
+    using Reg = __m128i;
+    static constexpr std::size_t width = 16 / sizeof(T);
+    TSPP_TARGET_SSE2 static Reg load(const T *p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+    TSPP_TARGET_SSE2 static void store(T *p, Reg r)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), r);
+    }
+    TSPP_TARGET_SSE2 static Reg mul(Reg a, Reg b)
+    {
+        alignas(16) T x[width], y[width];
+        store(x, a);
+        store(y, b);
+        for (std::size_t i = 0; i < width; ++i)
+            x[i] *= y[i];
+        return load(x);
+    }
+    // Целые равны тогда и только тогда, когда равны все их байты
+    TSPP_TARGET_SSE2 static bool eq(Reg a, Reg b)
+    {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xFFFF;
+    }
+};
+
+template <> struct Vec<int, Sse2> : VecIntSse2<int>
+{
+    TSPP_TARGET_SSE2 static Reg set1(int s) { return _mm_set1_epi32(s); }
+    TSPP_TARGET_SSE2 static Reg add(Reg a, Reg b) { return _mm_add_epi32(a, b); }
+    TSPP_TARGET_SSE2 static Reg sub(Reg a, Reg b) { return _mm_sub_epi32(a, b); }
+};
+
+template <> struct Vec<long long, Sse2> : VecIntSse2<long long>
+{
+    TSPP_TARGET_SSE2 static Reg set1(long long s) { return _mm_set1_epi64x(s); }
+    TSPP_TARGET_SSE2 static Reg add(Reg a, Reg b) { return _mm_add_epi64(a, b); }
+    TSPP_TARGET_SSE2 static Reg sub(Reg a, Reg b) { return _mm_sub_epi64(a, b); }
+};
+
+// ----- AVX2 -----
+
+template <> struct Vec<float, Avx2>
+{
+    using Reg = __m256;
+    static constexpr std::size_t width = 8;
+    TSPP_TARGET_AVX2 static Reg load(const float *p) { return _mm256_loadu_ps(p); }
+    TSPP_TARGET_AVX2 static void store(float *p, Reg r) { _mm256_storeu_ps(p, r); }
+    TSPP_TARGET_AVX2 static Reg set1(float s) { return _mm256_set1_ps(s); }
+    TSPP_TARGET_AVX2 static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+    TSPP_TARGET_AVX2 static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+    TSPP_TARGET_AVX2 static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+    TSPP_TARGET_AVX2 static bool eq(Reg a, Reg b)
+    {
+        return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)) == 0xFF;
+    }
+};
+
+template <> struct Vec<double, Avx2>
+{
+    using Reg = __m256d;
+    static constexpr std::size_t width = 4;
+    TSPP_TARGET_AVX2 static Reg load(const double *p) { return _mm256_loadu_pd(p); }
+    TSPP_TARGET_AVX2 static void store(double *p, Reg r) { _mm256_storeu_pd(p, r); }
+    TSPP_TARGET_AVX2 static Reg set1(double s) { return _mm256_set1_pd(s); }
+    TSPP_TARGET_AVX2 static Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+    TSPP_TARGET_AVX2 static Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+    TSPP_TARGET_AVX2 static Reg mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+    TSPP_TARGET_AVX2 static bool eq(Reg a, Reg b)
+    {
+        return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)) == 0xF;
+    }
+};
+
+/// Общая часть целочисленных регистров AVX2
+template <typename T> struct VecIntAvx2
+{
+    using Reg = __m256i;
+    static constexpr std::size_t width = 32 / sizeof(T);
+    TSPP_TARGET_AVX2 static Reg load(const T *p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    TSPP_TARGET_AVX2 static void store(T *p, Reg r)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), r);
+    }
+    TSPP_TARGET_AVX2 static bool eq(Reg a, Reg b)
+    {
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) == -1;
+    }
+};
+
+template <> struct Vec<int, Avx2> : VecIntAvx2<int>
+{
+    TSPP_TARGET_AVX2 static Reg set1(int s) { return _mm256_set1_epi32(s); }
+    TSPP_TARGET_AVX2 static Reg add(Reg a, Reg b) { return _mm256_add_epi32(a, b); }
+    TSPP_TARGET_AVX2 static Reg sub(Reg a, Reg b) { return _mm256_sub_epi32(a, b); }
+    TSPP_TARGET_AVX2 static Reg mul(Reg a, Reg b) { return _mm256_mullo_epi32(a, b); }
+};
+
+template <> struct Vec<long long, Avx2> : VecIntAvx2<long long>
+{
+    TSPP_TARGET_AVX2 static Reg set1(long long s) { return _mm256_set1_epi64x(s); }
+    TSPP_TARGET_AVX2 static Reg add(Reg a, Reg b) { return _mm256_add_epi64(a, b); }
+    TSPP_TARGET_AVX2 static Reg sub(Reg a, Reg b) { return _mm256_sub_epi64(a, b); }
+    TSPP_TARGET_AVX2 static Reg mul(Reg a, Reg b)
+    {
+        alignas(32) long long x[width], y[width];
+        store(x, a);
+        store(y, b);
+        for (std::size_t i = 0; i < width; ++i)
+            x[i] *= y[i];
+        return load(x);
+    }
+};
+
+// ----- AVX-512 -----
+
+template <> struct Vec<float, Avx512>
+{
+    using Reg = __m512;
+    static constexpr std::size_t width = 16;
+    TSPP_TARGET_AVX512 static Reg load(const float *p) { return _mm512_loadu_ps(p); }
+    TSPP_TARGET_AVX512 static void store(float *p, Reg r) { _mm512_storeu_ps(p, r); }
+    TSPP_TARGET_AVX512 static Reg set1(float s) { return _mm512_set1_ps(s); }
+    TSPP_TARGET_AVX512 static Reg add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+    TSPP_TARGET_AVX512 static Reg sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+    TSPP_TARGET_AVX512 static Reg mul(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+    TSPP_TARGET_AVX512 static bool eq(Reg a, Reg b)
+    {
+        return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ) == 0xFFFF;
+    }
+};
+
+template <> struct Vec<double, Avx512>
+{
+    using Reg = __m512d;
+    static constexpr std::size_t width = 8;
+    TSPP_TARGET_AVX512 static Reg load(const double *p) { return _mm512_loadu_pd(p); }
+    TSPP_TARGET_AVX512 static void store(double *p, Reg r) { _mm512_storeu_pd(p, r); }
+    TSPP_TARGET_AVX512 static Reg set1(double s) { return _mm512_set1_pd(s); }
+    TSPP_TARGET_AVX512 static Reg add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+    TSPP_TARGET_AVX512 static Reg sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+    TSPP_TARGET_AVX512 static Reg mul(Reg a, Reg b) { return _mm512_mul_pd(a, b); }
+    TSPP_TARGET_AVX512 static bool eq(Reg a, Reg b)
+    {
+        return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ) == 0xFF;
+    }
+};
+
+template <> struct Vec<int, Avx512>
+{
+    using Reg = __m512i;
+    static constexpr std::size_t width = 16;
+    TSPP_TARGET_AVX512 static Reg load(const int *p) { return _mm512_loadu_si512(p); }
+    TSPP_TARGET_AVX512 static void store(int *p, Reg r) { _mm512_storeu_si512(p, r); }
+    TSPP_TARGET_AVX512 static Reg set1(int s) { return _mm512_set1_epi32(s); }
+    TSPP_TARGET_AVX512 static Reg add(Reg a, Reg b) { return _mm512_add_epi32(a, b); }
+    TSPP_TARGET_AVX512 static Reg sub(Reg a, Reg b) { return _mm512_sub_epi32(a, b); }
+    TSPP_TARGET_AVX512 static Reg mul(Reg a, Reg b) { return _mm512_mullo_epi32(a, b); }
+    TSPP_TARGET_AVX512 static bool eq(Reg a, Reg b)
+    {
+        return _mm512_cmpeq_epi32_mask(a, b) == 0xFFFF;
+    }
+};
+
+template <> struct Vec<long long, Avx512>
+{
+    using Reg = __m512i;
+    static constexpr std::size_t width = 8;
+    TSPP_TARGET_AVX512 static Reg load(const long long *p) { return _mm512_loadu_si512(p); }
+    TSPP_TARGET_AVX512 static void store(long long *p, Reg r) { _mm512_storeu_si512(p, r); }
+    TSPP_TARGET_AVX512 static Reg set1(long long s) { return _mm512_set1_epi64(s); }
+    TSPP_TARGET_AVX512 static Reg add(Reg a, Reg b) { return _mm512_add_epi64(a, b); }
+    TSPP_TARGET_AVX512 static Reg sub(Reg a, Reg b) { return _mm512_sub_epi64(a, b); }
+    TSPP_TARGET_AVX512 static Reg mul(Reg a, Reg b) { return _mm512_mullo_epi64(a, b); }
+    TSPP_TARGET_AVX512 static bool eq(Reg a, Reg b)
+    {
+        return _mm512_cmpeq_epi64_mask(a, b) == 0xFF;
+    }
+};
+
+// Циклы над массивами. Атрибут target нельзя вывести из параметра шаблона,
+// поэтому у каждого набора инструкций свой экземпляр цикла
+
+#define TSPP_SIMD_LOOPS(Isa, TARGET)                                           \
+    template <typename T>                                                      \
+    TARGET void add##Isa(const T *a, const T *b, T *out, std::size_t n)        \
+    {                                                                          \
+        using V = Vec<T, Isa>;                                                 \
+        std::size_t i = 0;                                                     \
+        for (; i + V::width <= n; i += V::width)                               \
+            V::store(out + i, V::add(V::load(a + i), V::load(b + i)));         \
+        addScalar(a + i, b + i, out + i, n - i);                               \
+    }                                                                          \
+                                                                               \
+    template <typename T>                                                      \
+    TARGET void sub##Isa(const T *a, const T *b, T *out, std::size_t n)        \
+    {                                                                          \
+        using V = Vec<T, Isa>;                                                 \
+        std::size_t i = 0;                                                     \
+        for (; i + V::width <= n; i += V::width)                               \
+            V::store(out + i, V::sub(V::load(a + i), V::load(b + i)));         \
+        subScalar(a + i, b + i, out + i, n - i);                               \
+    }                                                                          \
+                                                                               \
+    template <typename T>                                                      \
+    TARGET void scale##Isa(T s, const T *a, T *out, std::size_t n)             \
+    {                                                                          \
+        using V = Vec<T, Isa>;                                                 \
+        auto vs = V::set1(s);                                                  \
+        std::size_t i = 0;                                                     \
+        for (; i + V::width <= n; i += V::width)                               \
+            V::store(out + i, V::mul(V::load(a + i), vs));                     \
+        scaleScalar(s, a + i, out + i, n - i);                                 \
+    }                                                                          \
+                                                                               \
+    template <typename T>                                                      \
+    TARGET bool equal##Isa(const T *a, const T *b, std::size_t n)              \
+    {                                                                          \
+        using V = Vec<T, Isa>;                                                 \
+        std::size_t i = 0;                                                     \
+        for (; i + V::width <= n; i += V::width)                               \
+        {                                                                      \
+            if (!V::eq(V::load(a + i), V::load(b + i)))                        \
+                return false;                                                  \
+        }                                                                      \
+        return equalScalar(a + i, b + i, n - i);                               \
+    }
+
+TSPP_SIMD_LOOPS(Sse2, TSPP_TARGET_SSE2)
+TSPP_SIMD_LOOPS(Avx2, TSPP_TARGET_AVX2)
+TSPP_SIMD_LOOPS(Avx512, TSPP_TARGET_AVX512)
+
+#undef TSPP_SIMD_LOOPS
+
+#define TSPP_SIMD_DISPATCH(op, ...)                                            \
+    switch (clampLevel(level))                                                 \
+    {                                                                          \
+    case Level::AVX512:                                                        \
+        return op##Avx512(__VA_ARGS__);                                        \
+    case Level::AVX2:                                                          \
+        return op##Avx2(__VA_ARGS__);                                          \
+    case Level::SSE2:                                                          \
+        return op##Sse2(__VA_ARGS__);                                          \
+    default:                                                                   \
+        return op##Scalar(__VA_ARGS__);                                        \
+    }
+
+#else
+
+#define TSPP_SIMD_DISPATCH(op, ...)                                            \
+    (void)level;                                                               \
+    return op##Scalar(__VA_ARGS__);
+
+#endif
+
+/**
+ * \brief Поэлементное сложение out = a + b
+ * \param level Набор инструкций. Если процессор его не поддерживает, берется
+ * лучший доступный
+ */
+template <typename T>
+void add(const T *a, const T *b, T *out, std::size_t n, Level level)
+{
+    static_assert(IsSimdType<T>::value, "No SIMD kernels for this type");
+    TSPP_SIMD_DISPATCH(add, a, b, out, n)
+}
+
+/**
+ * \brief Поэлементное вычитание out = a - b
+ * \copydetails add()
+ */
+template <typename T>
+void sub(const T *a, const T *b, T *out, std::size_t n, Level level)
+{
+    static_assert(IsSimdType<T>::value, "No SIMD kernels for this type");
+    TSPP_SIMD_DISPATCH(sub, a, b, out, n)
+}
+
+/**
+ * \brief Умножение на скаляр out = a * s
+ * \copydetails add()
+ */
+template <typename T>
+void scale(T s, const T *a, T *out, std::size_t n, Level level)
+{
+    static_assert(IsSimdType<T>::value, "No SIMD kernels for this type");
+    TSPP_SIMD_DISPATCH(scale, s, a, out, n)
+}
+
+/**
+ * \brief Поэлементное сравнение массивов
+ * \details Прекращает проверку на первом несовпавшем векторе
+ * \copydetails add()
+ * \return Равны ли все элементы
+ */
+template <typename T>
+bool equal(const T *a, const T *b, std::size_t n, Level level)
+{
+    static_assert(IsSimdType<T>::value, "No SIMD kernels for this type");
+    TSPP_SIMD_DISPATCH(equal, a, b, n)
+}
+
+#undef TSPP_SIMD_DISPATCH
+
+// Точки входа для операторов. Векторные ядра выбираются, если типы
+// операндов и результата совпадают и входят в IsSimdType, иначе
+// используется скалярный цикл
+
+/// Векторизуется ли операция над операндами типов **A**, **B** с результатом **R**
+template <typename R, typename A, typename B>
+struct UseSimd
+    : std::integral_constant<bool, IsSimdType<R>::value &&
+                                       std::is_same<R, A>::value &&
+                                       std::is_same<R, B>::value>
+{
+};
+
+template <typename R, typename A, typename B>
+void add(const A *a, const B *b, R *out, std::size_t n, std::false_type)
+{
+    addScalar(a, b, out, n);
+}
+
+template <typename T>
+void add(const T *a, const T *b, T *out, std::size_t n, std::true_type)
+{
+    add(a, b, out, n, detectedLevel());
+}
+
+template <typename R, typename A, typename B>
+void sub(const A *a, const B *b, R *out, std::size_t n, std::false_type)
+{
+    subScalar(a, b, out, n);
+}
+
+template <typename T>
+void sub(const T *a, const T *b, T *out, std::size_t n, std::true_type)
+{
+    sub(a, b, out, n, detectedLevel());
+}
+
+template <typename R, typename A, typename S>
+void scale(S s, const A *a, R *out, std::size_t n, std::false_type)
+{
+    scaleScalar(s, a, out, n);
+}
+
+template <typename T, typename S>
+void scale(S s, const T *a, T *out, std::size_t n, std::true_type)
+{
+    scale(static_cast<T>(s), a, out, n, detectedLevel());
+}
+
+template <typename A, typename B>
+bool equal(const A *a, const B *b, std::size_t n, std::false_type)
+{
+    return equalScalar(a, b, n);
+}
+
+template <typename T>
+bool equal(const T *a, const T *b, std::size_t n, std::true_type)
+{
+    return equal(a, b, n, detectedLevel());
+}
+
+} // namespace simd
+} // namespace detail
+
+#endif
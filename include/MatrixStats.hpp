@@ -0,0 +1,325 @@
+#ifndef __MATRIX_STATS
+#define __MATRIX_STATS
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+ * \file MatrixStats.hpp
+ * Файл, содержащий счетчики операций библиотеки: время, оценку количества
+ * операций с плавающей точкой, выделенную и наибольшую занятую память
+ * \author dmsukhikh
+ */
+
+#ifndef TSPP_STATS
+/**
+ * \brief Включение счетчиков
+ * \details При TSPP_STATS = 0 (по умолчанию) StatsScope пуст, и компилятор
+ * полностью удаляет замеры. Значение должно быть одинаковым во всех единицах
+ * трансляции программы
+ */
+#define TSPP_STATS 0
+#endif
+
+/**
+ * \brief Накопленные счетчики одной операции
+ * \details Время и память операции включают вложенные в нее операции: так,
+ * calculator.compute включает inverse, если файл требует обращения
+ */
+struct OperationStats
+{
+    const char *name;        ///< Имя операции, например "mul"
+    uint64_t calls{0};       ///< Количество вызовов
+    double seconds{0};       ///< Суммарное время
+    double flops{0};         ///< Оценка количества операций с плавающей точкой
+    uint64_t allocations{0}; ///< Количество выделений памяти
+    uint64_t bytes{0};       ///< Суммарный объем выделений, байт
+    uint64_t peakBytes{0};   ///< Наибольший за вызов прирост занятой памяти
+};
+
+namespace detail
+{
+
+/// Счетчики памяти, которые ведут statsAllocate() и statsDeallocate()
+struct MemoryCounters
+{
+    std::atomic<uint64_t> allocations{0}, bytes{0};
+    std::atomic<uint64_t> current{0}; ///< Занято сейчас
+    std::atomic<uint64_t> peak{0};    ///< Наибольшее занятое за все время
+    /// Наибольшее занятое с начала самого внутреннего StatsScope
+    std::atomic<uint64_t> mark{0};
+};
+
+inline MemoryCounters &memoryCounters() noexcept
+{
+    static MemoryCounters counters;
+    return counters;
+}
+
+inline void atomicMax(std::atomic<uint64_t> &a, uint64_t value) noexcept
+{
+    uint64_t old = a.load(std::memory_order_relaxed);
+    while (old < value &&
+           !a.compare_exchange_weak(old, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+/// Заголовок перед блоком statsAllocate(), в котором хранится размер блока
+constexpr std::size_t statsHeader = alignof(std::max_align_t);
+
+/**
+ * \brief Выделение памяти с учетом в memoryCounters()
+ * \details Используется заменой глобального operator new (см.
+ * src/StatsAlloc.cpp): без нее библиотека не видит выделений, и счетчики
+ * памяти остаются нулевыми
+ *
+ * \return Блок, выровненный как std::max_align_t, или nullptr
+ */
+inline void *statsAllocate(std::size_t size) noexcept
+{
+    if (size > std::numeric_limits<std::size_t>::max() - statsHeader)
+        return nullptr;
+    auto *block =
+        static_cast<unsigned char *>(std::malloc(size + statsHeader));
+    if (!block)
+        return nullptr;
+    std::memcpy(block, &size, sizeof(size));
+
+    MemoryCounters &c = memoryCounters();
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(size, std::memory_order_relaxed);
+    uint64_t now = c.current.fetch_add(size, std::memory_order_relaxed) + size;
+    atomicMax(c.peak, now);
+    atomicMax(c.mark, now);
+    return block + statsHeader;
+}
+
+/// Освобождение блока statsAllocate()
+inline void statsDeallocate(void *p) noexcept
+{
+    if (!p)
+        return;
+    auto *block = static_cast<unsigned char *>(p) - statsHeader;
+    std::size_t size;
+    std::memcpy(&size, block, sizeof(size));
+    memoryCounters().current.fetch_sub(size, std::memory_order_relaxed);
+    std::free(block);
+}
+
+/// Счетчики всех операций в порядке первого завершения
+struct StatsRegistry
+{
+    // Запас, чтобы первые записи не выделяли память внутри внешних замеров
+    StatsRegistry() { operations.reserve(64); }
+
+    std::mutex mutex;
+    std::vector<OperationStats> operations;
+};
+
+inline StatsRegistry &statsRegistry()
+{
+    static StatsRegistry registry;
+    return registry;
+}
+
+/// Добавление одного вызова операции **name** к счетчикам
+inline void statsRecord(const char *name, double seconds, double flops,
+                        uint64_t allocations, uint64_t bytes,
+                        uint64_t peakBytes) noexcept
+{
+    try
+    {
+        StatsRegistry &r = statsRegistry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        OperationStats *op = nullptr;
+        for (OperationStats &i : r.operations)
+        {
+            if (std::strcmp(i.name, name) == 0)
+            {
+                op = &i;
+                break;
+            }
+        }
+        if (!op)
+        {
+            r.operations.push_back(OperationStats{name});
+            op = &r.operations.back();
+        }
+        op->calls++;
+        op->seconds += seconds;
+        op->flops += flops;
+        op->allocations += allocations;
+        op->bytes += bytes;
+        op->peakBytes = std::max(op->peakBytes, peakBytes);
+    }
+    catch (...)
+    {
+        // Счетчики не должны ломать саму операцию
+    }
+}
+
+} // namespace detail
+
+/// Включены ли счетчики, см. TSPP_STATS
+constexpr bool statsEnabled() noexcept { return TSPP_STATS != 0; }
+
+#if TSPP_STATS
+/**
+ * \brief Замер одного вызова операции
+ * \details Объект создается в начале операции и при разрушении добавляет к
+ * счетчикам операции **name** прошедшее время, **flops** и выделения памяти.
+ * Пиковая память считается от занятой на момент создания объекта.
+ *
+ * Вложенные замеры одного потока учитываются точно. Если операции идут в
+ * нескольких потоках одновременно (пакетный режим), время складывается по
+ * потокам, а выделения и пиковая память других потоков попадают и в чужие
+ * замеры
+ */
+class StatsScope
+{
+  public:
+    /**
+     * \param name Имя операции; строка должна жить до конца программы
+     * \param flops Оценка количества операций с плавающей точкой
+     */
+    explicit StatsScope(const char *name, double flops = 0) noexcept
+        : _name(name), _flops(flops)
+    {
+        detail::MemoryCounters &c = detail::memoryCounters();
+        _allocations = c.allocations.load(std::memory_order_relaxed);
+        _bytes = c.bytes.load(std::memory_order_relaxed);
+        _current = c.current.load(std::memory_order_relaxed);
+        _mark = c.mark.exchange(_current, std::memory_order_relaxed);
+        _start = std::chrono::steady_clock::now();
+    }
+
+    StatsScope(const StatsScope &) = delete;
+    StatsScope &operator=(const StatsScope &) = delete;
+
+    ~StatsScope()
+    {
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - _start)
+                             .count();
+        detail::MemoryCounters &c = detail::memoryCounters();
+        uint64_t mark = c.mark.load(std::memory_order_relaxed);
+        // Пик внешнего замера - наибольший из его пика и пика этого
+        detail::atomicMax(c.mark, _mark);
+        detail::statsRecord(
+            _name, seconds, _flops,
+            c.allocations.load(std::memory_order_relaxed) - _allocations,
+            c.bytes.load(std::memory_order_relaxed) - _bytes,
+            mark > _current ? mark - _current : 0);
+    }
+
+  private:
+    const char *_name;
+    double _flops;
+    uint64_t _allocations, _bytes, _current, _mark;
+    std::chrono::steady_clock::time_point _start;
+};
+#else
+/// Пустой замер: при TSPP_STATS = 0 счетчики не ведутся
+class StatsScope
+{
+  public:
+    explicit StatsScope(const char *, double = 0) noexcept {}
+};
+#endif
+
+/// Счетчики всех операций, вызванных с последнего resetStats()
+inline std::vector<OperationStats> statsSnapshot()
+{
+    detail::StatsRegistry &r = detail::statsRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.operations;
+}
+
+/// Наибольшая занятая память с последнего resetStats(), байт
+inline uint64_t statsPeakMemory() noexcept
+{
+    return detail::memoryCounters().peak.load(std::memory_order_relaxed);
+}
+
+/// Обнуление счетчиков операций и пиковой памяти
+inline void resetStats()
+{
+    detail::StatsRegistry &r = detail::statsRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.operations.clear();
+    detail::MemoryCounters &c = detail::memoryCounters();
+    c.peak.store(c.current.load(std::memory_order_relaxed),
+                 std::memory_order_relaxed);
+}
+
+/**
+ * \brief Печать счетчиков таблицей
+ * \details По строке на операцию: вызовы, время, GFLOP/s, выделения и
+ * пиковая память; в конце - наибольшая занятая память программы
+ */
+inline void printStats(std::ostream &out)
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-20s %8s %12s %9s %10s %12s %12s\n",
+                  "operation", "calls", "time, ms", "GFLOP/s", "allocs",
+                  "alloc, KiB", "peak, KiB");
+    out << line;
+    for (const OperationStats &op : statsSnapshot())
+    {
+        char gflops[16] = "-";
+        if (op.flops > 0 && op.seconds > 0)
+            std::snprintf(gflops, sizeof(gflops), "%.2f",
+                          op.flops / op.seconds / 1e9);
+        std::snprintf(line, sizeof(line),
+                      "%-20s %8llu %12.3f %9s %10llu %12.1f %12.1f\n", op.name,
+                      (unsigned long long)op.calls, op.seconds * 1e3, gflops,
+                      (unsigned long long)op.allocations, op.bytes / 1024.0,
+                      op.peakBytes / 1024.0);
+        out << line;
+    }
+    std::snprintf(line, sizeof(line), "peak memory: %.1f KiB\n",
+                  statsPeakMemory() / 1024.0);
+    out << line;
+}
+
+/**
+ * \brief Печать счетчиков в JSON
+ * \details Объект с полями peak_bytes и operations - массивом объектов
+ * name, calls, seconds, flops, allocs, alloc_bytes, peak_bytes, по одному на
+ * строку
+ */
+inline void printStatsJson(std::ostream &out)
+{
+    std::vector<OperationStats> ops = statsSnapshot();
+    out << "{\n  \"peak_bytes\": " << statsPeakMemory()
+        << ",\n  \"operations\": [\n";
+    for (std::size_t i = 0; i < ops.size(); ++i)
+    {
+        const OperationStats &op = ops[i];
+        char line[320];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"calls\": %llu, \"seconds\": "
+                      "%.6e, \"flops\": %.6e, \"allocs\": %llu, "
+                      "\"alloc_bytes\": %llu, \"peak_bytes\": %llu}%s\n",
+                      op.name, (unsigned long long)op.calls, op.seconds,
+                      op.flops, (unsigned long long)op.allocations,
+                      (unsigned long long)op.bytes,
+                      (unsigned long long)op.peakBytes,
+                      i + 1 < ops.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef __MATRIX_STRASSEN
+#define __MATRIX_STRASSEN
+
+#include "MatrixGemm.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * \file MatrixStrassen.hpp
+ * Файл, содержащий умножение матриц алгоритмом Штрассена-Винограда поверх
+ * блочного ядра gemm()
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Размер, с которого умножение переходит на алгоритм
+ * Штрассена-Винограда, если вызывающий не задал свой
+ * \details Подобран бенчмарком bench_strassen: ниже него семь умножений
+ * половинного размера не окупают сложений и лишних проходов по памяти
+ */
+constexpr uint32_t strassenDefaultCrossover = 512;
+
+namespace detail
+{
+
+/// Порог из переменной окружения TSPP_STRASSEN, если она задана, иначе 0
+inline uint32_t environmentStrassenCrossover()
+{
+    const char *env = std::getenv("TSPP_STRASSEN");
+    return env ? uint32_t(std::strtoul(env, nullptr, 10)) : 0u;
+}
+
+/// Значение, которое возвращает strassenCrossover()
+inline std::atomic<uint32_t> &strassenCrossoverValue()
+{
+    static std::atomic<uint32_t> value{environmentStrassenCrossover()};
+    return value;
+}
+
+} // namespace detail
+
+/**
+ * \brief Порог алгоритма Штрассена-Винограда для operator*()
+ * \details Если порог ненулевой, произведения, у которых все три размера не
+ * меньше порога, считаются multiplyStrassen(). По умолчанию порог равен
+ * значению переменной окружения TSPP_STRASSEN, а если она не задана - нулю:
+ * алгоритм дает большую погрешность, чем обычное умножение, поэтому
+ * включается явно
+ *
+ * \return Порог; 0 - operator*() не использует алгоритм
+ */
+inline uint32_t strassenCrossover() noexcept
+{
+    return detail::strassenCrossoverValue().load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Изменение порога алгоритма Штрассена-Винограда
+ * \param crossover Новый порог, см. strassenCrossover(). 0 отключает алгоритм
+ * в operator*()
+ */
+inline void setStrassenCrossover(uint32_t crossover) noexcept
+{
+    detail::strassenCrossoverValue().store(crossover,
+                                           std::memory_order_relaxed);
+}
+
+namespace detail
+{
+
+/// Поэлементная операция над блоками **m** x **n**: out = f(x, y)
+template <typename T, typename F>
+void strassenCombine(uint32_t m, uint32_t n, const T *x, std::size_t ldx,
+                     const T *y, std::size_t ldy, T *out, std::size_t ldo, F f)
+{
+    for (uint32_t i = 0; i < m; ++i)
+    {
+        const T *xi = x + i * ldx;
+        const T *yi = y + i * ldy;
+        T *oi = out + i * ldo;
+        for (uint32_t j = 0; j < n; ++j)
+            oi[j] = f(xi[j], yi[j]);
+    }
+}
+
+/**
+ * \brief Объем временной памяти для strassen()
+ * \details На каждом уровне рекурсии нужны два блока под суммы блоков A и B
+ * и два блока под произведения. Вызовы одного уровня идут по очереди,
+ * поэтому память уровня переиспользуется
+ */
+inline std::size_t strassenWorkspace(uint32_t m, uint32_t n, uint32_t k,
+                                     uint32_t crossover)
+{
+    std::size_t total = 0;
+    while (std::min({m, n, k}) >= crossover && std::min({m, n, k}) >= 2)
+    {
+        m /= 2, n /= 2, k /= 2;
+        total += std::size_t(m) * k + std::size_t(k) * n +
+                 2 * std::size_t(m) * n;
+    }
+    return total;
+}
+
+/**
+ * \brief Умножение C = A * B алгоритмом Штрассена-Винограда
+ * \details Матрицы делятся на четыре блока, и произведение считается через
+ * семь умножений блоков и пятнадцать сложений (вариант Винограда) вместо
+ * восьми умножений. Блоки умножаются рекурсивно, пока наименьший из размеров
+ * не станет меньше **crossover**, после чего работает gemm().
+ *
+ * Нечетные размеры обрабатываются отщеплением: рекурсия идет по наибольшей
+ * подматрице четного размера, а последние строка, столбец и слагаемое по k
+ * досчитываются отдельно за O(mn + mk + kn). Поэтому ни размеры-степени
+ * двойки, ни квадратные матрицы не требуются, и память на дополнение нулями
+ * не тратится.
+ *
+ * Временная сложность: O(n^log2(7)) ~ O(n^2.81). Погрешность растет с
+ * глубиной рекурсии быстрее, чем у обычного умножения: оценка нормы ошибки
+ * хуже примерно в 3 раза на каждый уровень
+ *
+ * \param a, b, c Матрицы, хранящиеся построчно с шагами **lda**, **ldb**,
+ * **ldc**. C полностью перезаписывается
+ * \param work Временная память не меньше strassenWorkspace()
+ */
+template <typename T>
+void strassen(uint32_t m, uint32_t n, uint32_t k, const T *a, std::size_t lda,
+              const T *b, std::size_t ldb, T *c, std::size_t ldc,
+              uint32_t crossover, T *work)
+{
+    if (std::min({m, n, k}) < crossover || std::min({m, n, k}) < 2)
+    {
+        gemm(m, n, k, a, lda, 1, b, ldb, 1, c, ldc);
+        return;
+    }
+
+    const uint32_t m2 = m / 2, n2 = n / 2, k2 = k / 2;
+    const T *a11 = a, *a12 = a + k2, *a21 = a + m2 * lda, *a22 = a21 + k2;
+    const T *b11 = b, *b12 = b + n2, *b21 = b + k2 * ldb, *b22 = b21 + n2;
+    T *c11 = c, *c12 = c + n2, *c21 = c + m2 * ldc, *c22 = c21 + n2;
+
+    T *x = work, *y = x + std::size_t(m2) * k2, *p = y + std::size_t(k2) * n2,
+      *q = p + std::size_t(m2) * n2, *rest = q + std::size_t(m2) * n2;
+    auto mul = [&](const T *l, std::size_t ldl, const T *r, std::size_t ldr,
+                   T *out, std::size_t ldo)
+    { strassen(m2, n2, k2, l, ldl, r, ldr, out, ldo, crossover, rest); };
+    auto add = [](const T &u, const T &v) { return u + v; };
+    auto sub = [](const T &u, const T &v) { return u - v; };
+
+    // C21 = M7 = (A11 - A21)(B22 - B12)
+    strassenCombine(m2, k2, a11, lda, a21, lda, x, k2, sub);
+    strassenCombine(k2, n2, b22, ldb, b12, ldb, y, n2, sub);
+    mul(x, k2, y, n2, c21, ldc);
+    // C22 = M5 = (A21 + A22)(B12 - B11)
+    strassenCombine(m2, k2, a21, lda, a22, lda, x, k2, add);
+    strassenCombine(k2, n2, b12, ldb, b11, ldb, y, n2, sub);
+    mul(x, k2, y, n2, c22, ldc);
+    // C12 = M6 = (S1 - A11)(B22 - T1)
+    strassenCombine(m2, k2, x, k2, a11, lda, x, k2, sub);
+    strassenCombine(k2, n2, b22, ldb, y, n2, y, n2, sub);
+    mul(x, k2, y, n2, c12, ldc);
+    // P = M3 = (A12 - S2) B22, Q = M1 = A11 B11
+    strassenCombine(m2, k2, a12, lda, x, k2, x, k2, sub);
+    mul(x, k2, b22, ldb, p, n2);
+    mul(a11, lda, b11, ldb, q, n2);
+
+    // U2 = M1 + M6, U3 = U2 + M7, U4 = U2 + M5, C12 = U4 + M3, C22 = U3 + M5
+    strassenCombine(m2, n2, q, n2, c12, ldc, c12, ldc, add);
+    strassenCombine(m2, n2, c12, ldc, c21, ldc, c21, ldc, add);
+    strassenCombine(m2, n2, c12, ldc, c22, ldc, c12, ldc, add);
+    strassenCombine(m2, n2, c12, ldc, p, n2, c12, ldc, add);
+    strassenCombine(m2, n2, c21, ldc, c22, ldc, c22, ldc, add);
+
+    // C21 = U3 - M4, M4 = A22 (T2 - B21)
+    strassenCombine(k2, n2, y, n2, b21, ldb, y, n2, sub);
+    mul(a22, lda, y, n2, p, n2);
+    strassenCombine(m2, n2, c21, ldc, p, n2, c21, ldc, sub);
+
+    // C11 = M1 + M2, M2 = A12 B21
+    mul(a12, lda, b21, ldb, p, n2);
+    strassenCombine(m2, n2, q, n2, p, n2, c11, ldc, add);
+
+    // Отщепленные строка, столбец и слагаемое по k
+    const uint32_t me = 2 * m2, ne = 2 * n2;
+    if (k % 2)
+    {
+        const T *ak = a + (k - 1), *bk = b + (k - 1) * ldb;
+        for (uint32_t i = 0; i < me; ++i)
+        {
+            T aik = ak[i * lda];
+            T *ci = c + i * ldc;
+            for (uint32_t j = 0; j < ne; ++j)
+                ci[j] += aik * bk[j];
+        }
+    }
+    if (n % 2)
+        gemm(me, 1, k, a, lda, 1, b + ne, ldb, 1, c + ne, ldc);
+    if (m % 2)
+        gemm(1, n, k, a + me * lda, lda, 1, b, ldb, 1, c + me * ldc, ldc);
+}
+
+} // namespace detail
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef __MATRIX_TYPES
+#define __MATRIX_TYPES
+
+#include <memory>
+#include <utility>
+
+/** \file MatrixTypes.hpp
+ *  Файл, содержащий type aliases для типов элементов результатов операций над
+ * матрицами
+ *  \author dmsukhikh
+ */
+
+template <typename A, typename B>
+using AddType = decltype(std::declval<A>() + std::declval<B>());
+
+template <typename A, typename B>
+using SubsType = decltype(std::declval<A>() - std::declval<B>());
+
+template <typename A, typename B>
+using MulType = decltype(std::declval<A>() * std::declval<B>());
+
+template <typename A, typename B>
+using DivType = decltype(std::declval<A>() / std::declval<B>());
+
+/// Тип элементов частного двух матриц, см. operator/()
+template <typename A, typename B> using QuotType = MulType<A, DivType<B, float>>;
+
+/// Распределитель памяти **Alloc**, перенастроенный на элементы типа **U**
+template <typename Alloc, typename U>
+using RebindAlloc =
+    typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+
+#endif
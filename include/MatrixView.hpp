@@ -0,0 +1,261 @@
+#ifndef __MATRIX_VIEW
+#define __MATRIX_VIEW
+
+#include "Exceptions.hpp"
+#include "MatrixExpression.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+/**
+ * \file MatrixView.hpp
+ * Файл, содержащий класс MatrixView - невладеющее представление матрицы или
+ * ее части
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Невладеющее представление матрицы с произвольными шагами
+ * \details Представление задается указателем на левый верхний элемент,
+ * размерами и шагами между строками и столбцами. Так без копирования
+ * описываются блоки, строки, столбцы и транспонированные матрицы, см.
+ * MatrixGeneric::block(), MatrixGeneric::row(), MatrixGeneric::col(),
+ * MatrixGeneric::transposeView().
+ *
+ * Представление является \ref MatrixExpression "выражением", поэтому его
+ * можно использовать везде, где и матрицу: в поэлементных операциях, при
+ * умножении (блочное ядро работает с шагами напрямую), при сравнении, а
+ * также вызывать у него det(), inverse() и т.п.
+ *
+ * Пример использования:
+ * \code
+ * MatrixGeneric<double> a = MatrixGeneric<double>::eye(4);
+ * auto corner = a.block(2, 2, 2, 2);           // копирования нет
+ * corner.assign(2.0 * corner);                  // запись в элементы a
+ * MatrixGeneric<double> ata = a.transposeView() * a;
+ * \endcode
+ *
+ * \warning Представление не продлевает жизнь матрицы, на которую ссылается.
+ * Изменение размеров исходной матрицы делает представление недействительным
+ *
+ * \tparam T Тип элементов. `MatrixView<const T>` - представление только для
+ * чтения
+ */
+template <typename T> class MatrixView : public MatrixExpression<MatrixView<T>>
+{
+  public:
+    using value_type = std::remove_const_t<T>; ///< Тип элементов
+
+    /**
+     * \brief Конструктор по умолчанию
+     * \details Создает пустое представление размером 0x0
+     */
+    MatrixView() = default;
+
+    /**
+     * \brief Представление произвольного участка памяти
+     *
+     * \param data Указатель на левый верхний элемент
+     * \param height Высота
+     * \param width Ширина
+     * \param rowStride Шаг между строками в элементах
+     * \param colStride Шаг между столбцами в элементах
+     */
+    MatrixView(T *data, uint32_t height, uint32_t width, std::size_t rowStride,
+               std::size_t colStride) noexcept
+        : _data(data), _height(height), _width(width), _rowStride(rowStride),
+          _colStride(colStride)
+    {
+    }
+
+    /**
+     * \brief Представление всей матрицы
+     * \details Неявное преобразование, благодаря которому матрицу можно
+     * передавать в функции, принимающие представление
+     */
+    template <typename Alloc>
+    MatrixView(MatrixGeneric<value_type, Alloc> &m) noexcept
+        : MatrixView(m.data(), m.height(), m.width(), m.stride(), 1)
+    {
+    }
+
+    /// \copydoc MatrixView(MatrixGeneric<value_type, Alloc> &)
+    template <typename Alloc, typename U = T,
+              typename = std::enable_if_t<std::is_const<U>::value>>
+    MatrixView(const MatrixGeneric<value_type, Alloc> &m) noexcept
+        : MatrixView(m.data(), m.height(), m.width(), m.stride(), 1)
+    {
+    }
+
+    /**
+     * \brief Преобразование в представление только для чтения
+     */
+    template <typename U,
+              typename = std::enable_if_t<std::is_same<const U, T>::value &&
+                                          !std::is_const<U>::value>>
+    MatrixView(const MatrixView<U> &other) noexcept
+        : MatrixView(other.data(), other.height(), other.width(),
+                     other.rowStride(), other.colStride())
+    {
+    }
+
+    /**
+     * \brief Получение высоты
+     * \return Высота
+     */
+    uint32_t height() const noexcept { return _height; }
+
+    /**
+     * \brief Получение ширины
+     * \return Ширина
+     */
+    uint32_t width() const noexcept { return _width; }
+
+    /**
+     * \brief Шаг между строками
+     * \return Расстояние в элементах между соседними элементами столбца
+     */
+    std::size_t rowStride() const noexcept { return _rowStride; }
+
+    /**
+     * \brief Шаг между столбцами
+     * \return Расстояние в элементах между соседними элементами строки
+     */
+    std::size_t colStride() const noexcept { return _colStride; }
+
+    /**
+     * \brief Указатель на левый верхний элемент
+     * \return Указатель или nullptr для пустого представления
+     */
+    T *data() const noexcept { return _data; }
+
+    /**
+     * \brief Лежат ли элементы построчно без пропусков
+     * \return true, если представление можно читать как обычную матрицу
+     */
+    bool isContiguous() const noexcept
+    {
+        return _colStride == 1 && (_height <= 1 || _rowStride == _width);
+    }
+
+    /**
+     * \brief Получение элемента
+     * \details Получение элемента, находящегося в строке **x** и столбце **y**
+     * \note Нумерация строк и столбцов начинается с нуля
+     *
+     * \param x Строка элемента
+     * \param y Столбец элемента
+     * \return Ссылка на элемент исходной матрицы
+     * \throw matrix_bad_access Если взятие элемента выходит за пределы
+     * представления
+     */
+    T &get(uint32_t x, uint32_t y) const
+    {
+        if (x >= _height || y >= _width)
+            throw matrix_bad_access("Indexing is out of range");
+        return _data[x * _rowStride + y * _colStride];
+    }
+
+    /**
+     * \brief Представление блока
+     * \details Блок размером **height** x **width**, левый верхний элемент
+     * которого находится в строке **row** и столбце **col**
+     *
+     * \return Представление блока
+     * \throw matrix_bad_access Если блок выходит за пределы представления
+     */
+    MatrixView block(uint32_t row, uint32_t col, uint32_t height,
+                     uint32_t width) const
+    {
+        if (uint64_t(row) + height > _height || uint64_t(col) + width > _width)
+        {
+            std::string what = "Block is out of range: ";
+            what += std::to_string(height) + "x" + std::to_string(width);
+            what += " at (" + std::to_string(row) + ", " + std::to_string(col);
+            what += ") in " + std::to_string(_height) + "x" +
+                    std::to_string(_width);
+            throw matrix_bad_access(what.c_str());
+        }
+        if (height == 0 || width == 0)
+            return MatrixView();
+        return MatrixView(_data + row * _rowStride + col * _colStride, height,
+                          width, _rowStride, _colStride);
+    }
+
+    /**
+     * \brief Представление строки
+     * \param x Номер строки
+     * \return Представление размером 1 x width()
+     * \throw matrix_bad_access Если строки не существует
+     */
+    MatrixView row(uint32_t x) const { return block(x, 0, 1, _width); }
+
+    /**
+     * \brief Представление столбца
+     * \param y Номер столбца
+     * \return Представление размером height() x 1
+     * \throw matrix_bad_access Если столбца не существует
+     */
+    MatrixView col(uint32_t y) const { return block(0, y, _height, 1); }
+
+    /**
+     * \brief Транспонированное представление
+     * \details Меняет местами размеры и шаги, не трогая элементы
+     * \return Представление размером width() x height()
+     */
+    MatrixView transposeView() const noexcept
+    {
+        return MatrixView(_data, _width, _height, _colStride, _rowStride);
+    }
+
+    /**
+     * \brief Запись в элементы представления
+     * \details Вычисляет **src** (матрицу, представление или выражение) и
+     * записывает результат в элементы исходной матрицы. Если **src**
+     * пересекается с этим представлением не поэлементно (например,
+     * `v.assign(v.transposeView())`), результат не определен
+     *
+     * \param src Источник того же размера
+     * \throw matrix_bad_operation Если размеры не совпадают
+     */
+    template <typename Src> void assign(const Src &src) const
+    {
+        static_assert(!std::is_const<T>::value,
+                      "Can't assign to a read-only view");
+        detail::checkSameSize(*this, src);
+
+        auto e = detail::evaluatorOf(src);
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            for (uint32_t j = 0; j < _width; ++j)
+                _data[i * _rowStride + j * _colStride] =
+                    static_cast<value_type>(e(i, j));
+        }
+    }
+
+    /// Вычислитель для \ref MatrixExpression "выражений"
+    detail::StridedEvaluator<value_type> evaluator() const noexcept
+    {
+        return {_data, _rowStride, _colStride};
+    }
+
+    /**
+     * \brief Копирование элементов в буфер
+     * \param out Буфер из height() строк по width() элементов
+     * \param ld Шаг между строками буфера, не меньше width()
+     */
+    template <typename U> void assignTo(U *out, std::size_t ld) const
+    {
+        detail::evaluate(evaluator(), _height, _width, out, ld);
+    }
+
+  private:
+    T *_data{nullptr};       ///< Левый верхний элемент
+    uint32_t _height{0},     ///< Высота
+        _width{0};           ///< Ширина
+    std::size_t _rowStride{0}, ///< Шаг между строками
+        _colStride{1};         ///< Шаг между столбцами
+};
+
+#endif
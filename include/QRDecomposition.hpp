@@ -0,0 +1,468 @@
+#ifndef __QR_DECOMPOSITION
+#define __QR_DECOMPOSITION
+
+#include "Exceptions.hpp"
+#include "MatrixGemm.hpp"
+#include "MatrixGeneric.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+/**
+ * \file QRDecomposition.hpp
+ * Файл, содержащий класс QRDecomposition - QR-разложение прямоугольной
+ * матрицы отражениями Хаусхолдера с выбором столбцов
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief QR-разложение с выбором столбцов
+ * \details Раскладывает матрицу A размером m x n в произведение AP = QR, где P
+ * - перестановка столбцов, Q - матрица m x k с ортонормированными столбцами,
+ * R - верхнетреугольная k x n, k = min(m, n). На каждом шаге ведущим
+ * становится столбец с наибольшей нормой оставшейся части, поэтому модули
+ * диагонали R не возрастают и ранг определяется по ним с порогом (см. rank()).
+ *
+ * Разложение блочное: внутри панели из _block столбцов отражения
+ * накапливаются в матрице F, а остаток матрицы обновляется один раз на панель
+ * произведением через gemm(). Чтобы выбирать ведущий столбец без обновления
+ * остатка, нормы столбцов пересчитываются по обновленной строке R; если
+ * пересчет теряет точность, панель завершается раньше и нормы считаются
+ * заново.
+ *
+ * Пример использования:
+ * \code
+ * MatrixGeneric<double> a = {{1, 2}, {2, 4}, {3, 6}};
+ * auto qr = a.qr();
+ * qr.rank(); // 1
+ * auto r = qr.r(); // |r(0, 0)| = ||(2, 4, 6)||
+ * \endcode
+ *
+ * \tparam T Тип элементов исходной матрицы
+ * \tparam Work Вещественный тип, в котором ведутся вычисления. По умолчанию
+ * - как у MatrixGeneric<T>::det(): double для целых типов, иначе `T / float`
+ * \tparam Alloc Распределитель памяти для разложения и результатов
+ */
+template <typename T, typename Work, typename Alloc> class QRDecomposition
+{
+  public:
+    using value_type = Work;      ///< Тип элементов разложения и результатов
+    using allocator_type = Alloc; ///< Распределитель памяти
+
+    /**
+     * \brief Разложение матрицы
+     *
+     * Временная сложность: O(m * n * min(m, n))
+     *
+     * \param a Раскладываемая матрица или ее \ref MatrixView "представление"
+     * \param alloc Распределитель памяти для разложения
+     */
+    explicit QRDecomposition(MatrixView<const T> a, const Alloc &alloc = Alloc())
+        : _height(a.height()), _width(a.width()),
+          _qr(std::size_t(a.height()) * a.width(), alloc),
+          _tau(std::min(a.height(), a.width()), value_type(0), alloc),
+          _perm(a.width(), RebindAlloc<Alloc, uint32_t>(alloc))
+    {
+        // Столбцы хранятся подряд: отражения применяются к столбцам
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            for (uint32_t j = 0; j < _width; ++j)
+                _at(i, j) = value_type(a.get(i, j));
+        }
+        std::iota(_perm.begin(), _perm.end(), 0u);
+        _factorize();
+    }
+
+    /// Высота разложенной матрицы
+    uint32_t height() const noexcept { return _height; }
+
+    /// Ширина разложенной матрицы
+    uint32_t width() const noexcept { return _width; }
+
+    /**
+     * \brief Перестановка столбцов
+     * \return Вектор, в j-той позиции которого стоит номер столбца исходной
+     * матрицы, ставшего j-тым столбцом AP
+     */
+    const std::vector<uint32_t, RebindAlloc<Alloc, uint32_t>> &
+    permutation() const noexcept
+    {
+        return _perm;
+    }
+
+    /**
+     * \brief Порог, который используется rank() по умолчанию
+     * \return `max(m, n) * eps * |r(0, 0)|` - погрешность округления,
+     * которую накапливает разложение
+     */
+    value_type defaultTolerance() const
+    {
+        using std::abs;
+        if (_tau.empty())
+            return value_type(0);
+        return value_type(std::max(_height, _width)) *
+               std::numeric_limits<value_type>::epsilon() * abs(_at(0, 0));
+    }
+
+    /**
+     * \brief Численный ранг матрицы
+     * \details Количество первых диагональных элементов R, модуль которых
+     * больше порога.
+     *
+     * Временная сложность: O(min(m, n))
+     *
+     * \param tolerance Наибольший модуль диагонального элемента R, который
+     * считается нулем
+     * \return Ранг матрицы
+     */
+    uint32_t rank(value_type tolerance) const
+    {
+        using std::abs;
+        uint32_t out = 0;
+        while (out < _tau.size() && abs(_at(out, out)) > tolerance)
+            ++out;
+        return out;
+    }
+
+    /// \copydoc rank(value_type) const
+    /// \details Порог - defaultTolerance()
+    uint32_t rank() const { return rank(defaultTolerance()); }
+
+    /**
+     * \brief Матрица R
+     * \return Верхнетреугольная матрица min(m, n) x n, столбцы которой идут в
+     * порядке permutation()
+     */
+    MatrixGeneric<value_type, Alloc> r() const
+    {
+        uint32_t k = uint32_t(_tau.size());
+        MatrixGeneric<value_type, Alloc> out(k, _width, _qr.get_allocator());
+        for (uint32_t i = 0; i < k; ++i)
+        {
+            for (uint32_t j = i; j < _width; ++j)
+                out.get(i, j) = _at(i, j);
+        }
+        return out;
+    }
+
+    /**
+     * \brief Матрица Q
+     * \details Отражения применяются к первым min(m, n) столбцам единичной
+     * матрицы в обратном порядке.
+     *
+     * Временная сложность: O(m * min(m, n)^2)
+     *
+     * \return Матрица m x min(m, n) с ортонормированными столбцами
+     */
+    MatrixGeneric<value_type, Alloc> q() const
+    {
+        uint32_t k = uint32_t(_tau.size());
+        std::vector<value_type, Alloc> cols(std::size_t(_height) * k,
+                                            value_type(0), _qr.get_allocator());
+        for (uint32_t j = 0; j < k; ++j)
+            cols[std::size_t(j) * _height + j] = value_type(1);
+
+        for (uint32_t p = k; p-- > 0;)
+        {
+            const value_type *v = _col(p);
+            for (uint32_t j = p; j < k; ++j)
+            {
+                value_type *c = cols.data() + std::size_t(j) * _height;
+                value_type s = c[p];
+                for (uint32_t i = p + 1; i < _height; ++i)
+                    s += v[i] * c[i];
+                s *= _tau[p];
+                c[p] -= s;
+                for (uint32_t i = p + 1; i < _height; ++i)
+                    c[i] -= s * v[i];
+            }
+        }
+
+        MatrixGeneric<value_type, Alloc> out(_height, k, _qr.get_allocator());
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            for (uint32_t j = 0; j < k; ++j)
+                out.get(i, j) = cols[std::size_t(j) * _height + i];
+        }
+        return out;
+    }
+
+  private:
+    uint32_t _height, ///< Высота матрицы
+        _width;       ///< Ширина матрицы
+    /// R над диагональю и векторы отражений под ней, по столбцам
+    std::vector<value_type, Alloc> _qr;
+    std::vector<value_type, Alloc> _tau; ///< Коэффициенты отражений
+    /// Перестановка столбцов, см. permutation()
+    std::vector<uint32_t, RebindAlloc<Alloc, uint32_t>> _perm;
+
+    /// Количество столбцов панели
+    static constexpr uint32_t _block = 32;
+    /// Объем работы, начиная с которого шаг панели распараллеливается
+    static constexpr uint64_t _parallelThreshold = uint64_t(1) << 15;
+
+    value_type &_at(uint32_t i, uint32_t j)
+    {
+        return _qr[std::size_t(j) * _height + i];
+    }
+
+    const value_type &_at(uint32_t i, uint32_t j) const
+    {
+        return _qr[std::size_t(j) * _height + i];
+    }
+
+    value_type *_col(uint32_t j) { return _qr.data() + std::size_t(j) * _height; }
+
+    const value_type *_col(uint32_t j) const
+    {
+        return _qr.data() + std::size_t(j) * _height;
+    }
+
+    /// Норма части столбца **j** начиная со строки **from**
+    value_type _norm(uint32_t j, uint32_t from) const
+    {
+        using std::sqrt;
+        const value_type *c = _col(j);
+        value_type scale = value_type(0), sum = value_type(1);
+        for (uint32_t i = from; i < _height; ++i)
+        {
+            // Масштабирование, как в LAPACK dnrm2, чтобы квадраты не
+            // переполнялись
+            value_type x = c[i] < value_type(0) ? -c[i] : c[i];
+            if (x == value_type(0))
+                continue;
+            if (scale < x)
+            {
+                sum = value_type(1) + sum * (scale / x) * (scale / x);
+                scale = x;
+            }
+            else
+            {
+                sum += (x / scale) * (x / scale);
+            }
+        }
+        return scale * sqrt(sum);
+    }
+
+    /// Построение отражения для части столбца **k** начиная со строки **k**.
+    /// Возвращает новый диагональный элемент
+    value_type _householder(uint32_t k)
+    {
+        value_type *c = _col(k);
+        value_type alpha = c[k];
+        value_type xnorm = _norm(k, k + 1);
+        if (xnorm == value_type(0))
+        {
+            _tau[k] = value_type(0);
+            return alpha;
+        }
+
+        value_type beta = std::hypot(alpha, xnorm);
+        if (alpha > value_type(0))
+            beta = -beta;
+        _tau[k] = (beta - alpha) / beta;
+        value_type scale = value_type(1) / (alpha - beta);
+        for (uint32_t i = k + 1; i < _height; ++i)
+            c[i] *= scale;
+        return beta;
+    }
+
+    /**
+     * \brief Блочное разложение с выбором столбцов
+     * \details Алгоритм LAPACK dgeqp3/dlaqps. Для панели, начинающейся со
+     * столбца k, F(c, j) = tau_j * (A(:, c)^T v_j) с поправками на предыдущие
+     * отражения панели, так что после панели остаток обновляется как
+     * A -= V * F^T
+     */
+    void _factorize()
+    {
+        uint32_t kmax = uint32_t(_tau.size());
+        if (kmax == 0)
+            return;
+
+        std::vector<value_type, Alloc> vn1(_width, value_type(0),
+                                           _qr.get_allocator()),
+            vn2(_width, value_type(0), _qr.get_allocator());
+        for (uint32_t j = 0; j < _width; ++j)
+            vn1[j] = vn2[j] = _norm(j, 0);
+
+        std::vector<value_type, Alloc> f(std::size_t(_width) * _block,
+                                         value_type(0), _qr.get_allocator()),
+            aux(_block, value_type(0), _qr.get_allocator()),
+            update(_qr.get_allocator());
+        std::vector<char, RebindAlloc<Alloc, char>> stale(
+            _width, 0, RebindAlloc<Alloc, char>(_qr.get_allocator()));
+        value_type tol3z = std::sqrt(std::numeric_limits<value_type>::epsilon());
+
+        for (uint32_t k = 0; k < kmax;)
+        {
+            uint32_t nb = std::min(_block, kmax - k);
+            auto fAt = [&f, this](uint32_t c, uint32_t j) -> value_type &
+            { return f[std::size_t(j) * _width + c]; };
+
+            uint32_t j = 0;
+            bool restart = false;
+            while (j < nb && !restart)
+            {
+                uint32_t kk = k + j;
+
+                uint32_t pvt = kk;
+                for (uint32_t c = kk + 1; c < _width; ++c)
+                {
+                    if (vn1[c] > vn1[pvt])
+                        pvt = c;
+                }
+                if (pvt != kk)
+                {
+                    std::swap_ranges(_col(pvt), _col(pvt) + _height, _col(kk));
+                    for (uint32_t p = 0; p < j; ++p)
+                        std::swap(fAt(pvt, p), fAt(kk, p));
+                    std::swap(_perm[pvt], _perm[kk]);
+                    vn1[pvt] = vn1[kk];
+                    vn2[pvt] = vn2[kk];
+                    stale[pvt] = stale[kk];
+                }
+
+                // Предыдущие отражения панели к ведущему столбцу
+                value_type *v = _col(kk);
+                for (uint32_t p = 0; p < j; ++p)
+                {
+                    const value_type *vp = _col(k + p);
+                    value_type s = fAt(kk, p);
+                    for (uint32_t i = kk; i < _height; ++i)
+                        v[i] -= vp[i] * s;
+                }
+
+                value_type diag = _householder(kk);
+                value_type tau = _tau[kk];
+                v[kk] = value_type(1);
+
+                // F(kk + 1:n, j) = tau * A(kk:m, kk + 1:n)^T v
+                for (uint32_t c = 0; c <= kk; ++c)
+                    fAt(c, j) = value_type(0);
+                auto project = [&, kk, j, tau](uint32_t lo, uint32_t hi)
+                {
+                    for (uint32_t c = lo; c < hi; ++c)
+                    {
+                        const value_type *col = _col(c);
+                        value_type s = value_type(0);
+                        for (uint32_t i = kk; i < _height; ++i)
+                            s += col[i] * v[i];
+                        fAt(c, j) = tau * s;
+                    }
+                };
+                if (uint64_t(_height - kk) * (_width - kk) >= _parallelThreshold)
+                    ThreadPool::global().parallelFor(kk + 1, _width, 16,
+                                                     project);
+                else
+                    project(kk + 1, _width);
+
+                // Поправка на предыдущие отражения:
+                // F(:, j) -= tau * F(:, 0:j) * V(kk:m, 0:j)^T v
+                if (j > 0)
+                {
+                    for (uint32_t p = 0; p < j; ++p)
+                    {
+                        const value_type *vp = _col(k + p);
+                        value_type s = value_type(0);
+                        for (uint32_t i = kk; i < _height; ++i)
+                            s += vp[i] * v[i];
+                        aux[p] = -tau * s;
+                    }
+                    for (uint32_t c = 0; c < _width; ++c)
+                    {
+                        value_type s = value_type(0);
+                        for (uint32_t p = 0; p < j; ++p)
+                            s += fAt(c, p) * aux[p];
+                        fAt(c, j) += s;
+                    }
+                }
+
+                // Строка kk: A(kk, kk + 1:n) -= A(kk, k:kk + 1) * F^T
+                for (uint32_t c = kk + 1; c < _width; ++c)
+                {
+                    value_type s = value_type(0);
+                    for (uint32_t p = 0; p <= j; ++p)
+                        s += _at(kk, k + p) * fAt(c, p);
+                    _at(kk, c) -= s;
+                }
+
+                // Нормы остатка столбцов по обновленной строке kk
+                for (uint32_t c = kk + 1; c < _width; ++c)
+                {
+                    if (vn1[c] == value_type(0))
+                        continue;
+                    value_type t = std::abs(_at(kk, c)) / vn1[c];
+                    t = std::max(value_type(0), (value_type(1) + t) *
+                                                    (value_type(1) - t));
+                    value_type ratio = vn1[c] / vn2[c];
+                    if (t * ratio * ratio <= tol3z)
+                    {
+                        stale[c] = 1;
+                        restart = true;
+                    }
+                    else
+                    {
+                        vn1[c] *= std::sqrt(t);
+                    }
+                }
+
+                v[kk] = diag;
+                ++j;
+            }
+
+            uint32_t rk = k + j;
+            _updateTrailing(k, j, rk, f, update);
+
+            for (uint32_t c = rk; c < _width; ++c)
+            {
+                if (stale[c])
+                {
+                    vn1[c] = vn2[c] = rk < _height ? _norm(c, rk) : value_type(0);
+                    stale[c] = 0;
+                }
+            }
+            k = rk;
+        }
+    }
+
+    /**
+     * \brief Обновление остатка после панели
+     * \details A(rk:m, rk:n) -= V(rk:m, k:rk) * F(rk:n, 0:nb)^T. Произведение
+     * считается через gemm() во временный буфер
+     */
+    void _updateTrailing(uint32_t k, uint32_t nb, uint32_t rk,
+                         const std::vector<value_type, Alloc> &f,
+                         std::vector<value_type, Alloc> &update)
+    {
+        if (rk >= _height || rk >= _width)
+            return;
+
+        uint32_t rows = _height - rk, cols = _width - rk;
+        update.resize(std::size_t(rows) * cols);
+        // update(c, i) = sum_p F(rk + c, p) * V(rk + i, k + p): результат
+        // ложится по столбцам, как и сама матрица
+        detail::gemm(cols, rows, nb, f.data() + rk, 1, _width,
+                     _qr.data() + std::size_t(k) * _height + rk, _height, 1,
+                     update.data(), rows);
+        for (uint32_t c = 0; c < cols; ++c)
+        {
+            value_type *dst = _col(rk + c) + rk;
+            const value_type *src = update.data() + std::size_t(c) * rows;
+            for (uint32_t i = 0; i < rows; ++i)
+                dst[i] -= src[i];
+        }
+    }
+};
+
+template <typename T, typename Work, typename Alloc>
+constexpr uint32_t QRDecomposition<T, Work, Alloc>::_block;
+template <typename T, typename Work, typename Alloc>
+constexpr uint64_t QRDecomposition<T, Work, Alloc>::_parallelThreshold;
+
+#endif
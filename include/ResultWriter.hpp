@@ -0,0 +1,297 @@
+#ifndef __RESULT_WRITER
+#define __RESULT_WRITER
+
+#include <TokenReader.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * \file ResultWriter.hpp
+ * Файл, содержащий буферизованный вывод результатов калькулятора и
+ * форматирование чисел
+ * \author dmsukhikh
+ */
+
+namespace detail
+{
+
+/// Наибольшая длина числа, записанного formatNumber()
+constexpr std::size_t maxNumberLength = 64;
+
+/// Наибольшая поддерживаемая точность вещественных чисел
+constexpr int maxPrecision = 40;
+
+/**
+ * \brief Запись целого числа
+ * \param out Буфер не короче 21 байта
+ * \return Указатель за последний записанный символ
+ */
+inline char *formatInteger(char *out, uint64_t value, bool negative)
+{
+    char digits[20];
+    std::size_t n = 0;
+    do
+    {
+        digits[n++] = char('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    if (negative)
+        *out++ = '-';
+    while (n != 0)
+        *out++ = digits[--n];
+    return out;
+}
+
+/**
+ * \brief Запись вещественного числа
+ * \details При **precision** > 0 результат совпадает с выводом
+ * `std::ostream` с той же точностью (формат `%g`). При **precision** == 0
+ * выбирается кратчайшая запись, которая при обратном разборе дает то же самое
+ * число: перебираются точности от digits10 до max_digits10 (15-17 для double,
+ * 6-9 для float).
+ *
+ * Целые значения, которые `%g` напечатал бы без экспоненты, записываются без
+ * обращения к snprintf(). Точность больше maxPrecision уменьшается до нее
+ *
+ * \param out Буфер размером maxNumberLength
+ * \return Количество записанных символов
+ */
+template <typename T>
+std::size_t formatFloat(T value, int precision, char *out)
+{
+    using Limits = std::numeric_limits<T>;
+    const int digits = precision <= 0            ? Limits::digits10
+                       : precision > maxPrecision ? maxPrecision
+                                                  : precision;
+
+    // Быстрый путь для целых значений
+    const int exact = digits < Limits::digits10 ? digits : Limits::digits10;
+    if (std::fabs(value) < exactPowersOfTen()[exact] &&
+        value == std::floor(value))
+    {
+        auto magnitude = static_cast<uint64_t>(std::fabs(value));
+        return std::size_t(
+            formatInteger(out, magnitude, std::signbit(value)) - out);
+    }
+
+    int length = std::snprintf(out, maxNumberLength, "%.*g", digits,
+                               static_cast<double>(value));
+    if (precision > 0 || !std::isfinite(value))
+        return std::size_t(length);
+
+    // Кратчайшая запись, разбираемая обратно в то же число
+    for (int d = digits; d < Limits::max_digits10; ++d)
+    {
+        // parseNumber() отвергает субнормальные числа как выходящие за
+        // диапазон, для них проверка идет через strtod
+        T parsed;
+        if (!parseNumber(out, out + length, parsed))
+            parseFloatFallback(out, parsed, nullptr);
+        if (parsed == value)
+            break;
+        length = std::snprintf(out, maxNumberLength, "%.*g", d + 1,
+                               static_cast<double>(value));
+    }
+    return std::size_t(length);
+}
+
+/**
+ * \brief Запись числа
+ * \details Перегрузки для встроенных типов, которые поддерживает
+ * калькулятор. Для целых точность не используется
+ *
+ * \param value Число
+ * \param precision Количество значащих цифр или 0 для кратчайшей записи,
+ * разбираемой обратно без потерь
+ * \param out Буфер размером maxNumberLength
+ * \return Количество записанных символов
+ */
+inline std::size_t formatNumber(float value, int precision, char *out)
+{
+    return formatFloat(value, precision, out);
+}
+
+inline std::size_t formatNumber(double value, int precision, char *out)
+{
+    return formatFloat(value, precision, out);
+}
+
+inline std::size_t formatNumber(int value, int, char *out)
+{
+    uint64_t magnitude = value < 0 ? 0 - uint64_t(int64_t(value)) : value;
+    return std::size_t(formatInteger(out, magnitude, value < 0) - out);
+}
+
+inline std::size_t formatNumber(long long value, int, char *out)
+{
+    uint64_t magnitude = value < 0 ? 0 - uint64_t(value) : uint64_t(value);
+    return std::size_t(formatInteger(out, magnitude, value < 0) - out);
+}
+
+/// Есть ли перегрузка formatNumber() для типа **T**
+template <typename T>
+struct HasFormatNumber
+    : std::integral_constant<bool, std::is_same<T, float>::value ||
+                                       std::is_same<T, double>::value ||
+                                       std::is_same<T, int>::value ||
+                                       std::is_same<T, long long>::value>
+{
+};
+
+} // namespace detail
+
+/**
+ * \brief Буферизованный вывод результатов
+ * \details Числа форматируются прямо в большой буфер, который сбрасывается в
+ * поток целиком, когда заполняется, и при уничтожении объекта. В отличие от
+ * `std::cout << x << std::endl`, поток не сбрасывается после каждой строки, а
+ * элементы не проходят через проверки границ и локаль.
+ *
+ * Пример использования:
+ * \code
+ * ResultWriter writer(std::cout, 0); // кратчайшая запись без потерь
+ * writer.writeMatrix(a);
+ * \endcode
+ */
+class ResultWriter
+{
+  public:
+    /**
+     * \brief Создание писателя
+     * \param out Поток, в который пишется результат
+     * \param precision Количество значащих цифр вещественных чисел, как у
+     * `std::ostream::precision()`, или 0 для кратчайшей записи, которая
+     * разбирается обратно в то же самое число
+     * \param bufferSize Размер буфера в байтах
+     */
+    explicit ResultWriter(std::ostream &out, int precision = 6,
+                          std::size_t bufferSize = 1 << 20)
+        : _out(out), _precision(precision),
+          _buf(bufferSize > detail::maxNumberLength
+                   ? bufferSize
+                   : detail::maxNumberLength + 1)
+    {
+    }
+
+    ResultWriter(const ResultWriter &) = delete;
+    ResultWriter &operator=(const ResultWriter &) = delete;
+
+    /// Сбрасывает оставшиеся данные в поток
+    ~ResultWriter() { flush(); }
+
+    /**
+     * \brief Запись числа
+     * \details Для типов без перегрузки detail::formatNumber() используется
+     * `operator<<` с заданной точностью
+     */
+    template <typename T> void write(const T &value)
+    {
+        _write(value, detail::HasFormatNumber<T>{});
+    }
+
+    /// Запись символа
+    void put(char c)
+    {
+        if (_size == _buf.size())
+            flush();
+        _buf[_size++] = c;
+    }
+
+    /**
+     * \brief Запись матрицы
+     * \details Элементы строки разделяются пробелами (после последнего
+     * элемента тоже стоит пробел), строки - переводами строк
+     *
+     * \param m Матрица; строки берутся с шагом stride(), поэтому
+     * выравнивание строк в печать не попадает
+     */
+    template <typename M> void writeMatrix(const M &m)
+    {
+        for (uint32_t i = 0; i < m.height(); ++i)
+        {
+            const auto *row = m.data() + std::size_t(i) * m.stride();
+            for (uint32_t j = 0; j < m.width(); ++j)
+            {
+                write(row[j]);
+                put(' ');
+            }
+            put('\n');
+        }
+    }
+
+    /**
+     * \brief Запись разреженной матрицы
+     * \details Координатный формат, который калькулятор читает на входе:
+     * строка `coo`, затем высота, ширина и количество элементов, затем по
+     * строке `i j значение` на каждый хранимый элемент
+     *
+     * \param m Матрица SparseMatrix
+     */
+    template <typename S> void writeSparse(const S &m)
+    {
+        for (char c : {'c', 'o', 'o', '\n'})
+            put(c);
+        write((long long)m.height());
+        put(' ');
+        write((long long)m.width());
+        put(' ');
+        write((long long)m.nonZeros());
+        put('\n');
+        for (uint32_t i = 0; i < m.height(); ++i)
+        {
+            for (uint32_t p = m.rowPointers()[i]; p < m.rowPointers()[i + 1];
+                 ++p)
+            {
+                write((long long)i);
+                put(' ');
+                write((long long)m.columnIndices()[p]);
+                put(' ');
+                write(m.values()[p]);
+                put('\n');
+            }
+        }
+    }
+
+    /// Сброс буфера в поток
+    void flush()
+    {
+        if (_size != 0)
+            _out.write(_buf.data(), std::streamsize(_size));
+        _size = 0;
+        _out.flush();
+    }
+
+  private:
+    std::ostream &_out;
+    int _precision;
+    std::vector<char> _buf;
+    std::size_t _size{0}; ///< Заполненная часть буфера
+
+    template <typename T> void _write(const T &value, std::true_type)
+    {
+        if (_buf.size() - _size < detail::maxNumberLength)
+            flush();
+        _size += detail::formatNumber(value, _precision, _buf.data() + _size);
+    }
+
+    template <typename T> void _write(const T &value, std::false_type)
+    {
+        std::ostringstream str;
+        str.precision(_precision > 0 ? _precision : 17);
+        str << value;
+        for (char c : str.str())
+            put(c);
+    }
+};
+
+#endif
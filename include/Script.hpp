@@ -0,0 +1,1090 @@
+#ifndef __SCRIPT
+#define __SCRIPT
+
+#include <Exceptions.hpp>
+#include <MatrixBinary.hpp>
+#include <MatrixGeneric.hpp>
+#include <ThreadPool.hpp>
+#include <TokenReader.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \file Script.hpp
+ * Файл, содержащий язык выражений калькулятора: разбор сценария в граф
+ * операций, его оптимизацию и вычисление
+ * \author dmsukhikh
+ */
+
+/*
+ * Грамматика сценария:
+ *
+ * сценарий   := { инструкция (перевод строки | ';') }
+ * инструкция := 'matrix' ИМЯ операнд      -- матрица в формате калькулятора
+ *             | ИМЯ '=' выражение
+ *             | выражение
+ * выражение  := слагаемое { ('+' | '-') слагаемое }
+ * слагаемое  := множитель { ('*' | '/') множитель }
+ * множитель  := '-' множитель | степень
+ * степень    := первичное [ '^' ЦЕЛОЕ ]
+ * первичное  := ЧИСЛО | ИМЯ | ФУНКЦИЯ '(' выражение [',' аргумент] ')'
+ *             | '(' выражение ')' | '[' строка { (';' | перевод строки)
+ *               строка } ']'
+ * строка     := ЧИСЛО { [','] ЧИСЛО }
+ *
+ * ФУНКЦИЯ - inv, det, rk, t, pow, solve. Второй аргумент pow - ЦЕЛОЕ,
+ * solve - выражение. Комментарии начинаются с '#' и идут до конца строки.
+ */
+
+namespace detail
+{
+
+/// Лексема сценария
+struct ScriptToken
+{
+    enum Kind
+    {
+        End,     ///< Конец сценария
+        Newline, ///< Перевод строки
+        Name,    ///< Имя переменной, функции или ключевое слово
+        Number,  ///< Число без знака
+        Symbol   ///< Одиночный символ: = + - * / ^ ( ) [ ] , ;
+    };
+
+    Kind kind{End};
+    const char *begin{nullptr};
+    const char *end{nullptr};
+    int line{0}; ///< Номер строки в файле
+
+    std::string text() const { return std::string(begin, end); }
+    bool is(char c) const
+    {
+        return kind == Symbol && end - begin == 1 && *begin == c;
+    }
+};
+
+/// Лексический анализатор сценария
+class ScriptLexer
+{
+  public:
+    ScriptLexer(const char *first, const char *last, int line)
+        : _pos(first), _last(last), _line(line)
+    {
+    }
+
+    /// Следующая лексема
+    ScriptToken next()
+    {
+        _skipBlanks();
+
+        ScriptToken token;
+        token.line = _line;
+        token.begin = _pos;
+        if (_pos == _last)
+        {
+            token.end = _pos;
+            return token;
+        }
+
+        char c = *_pos;
+        if (c == '\n')
+        {
+            ++_pos;
+            ++_line;
+            token.kind = ScriptToken::Newline;
+        }
+        else if (_isNameStart(c))
+        {
+            while (_pos != _last && (_isNameStart(*_pos) || _isDigit(*_pos)))
+                ++_pos;
+            token.kind = ScriptToken::Name;
+        }
+        else if (_isDigit(c) || c == '.')
+        {
+            _scanNumber();
+            token.kind = ScriptToken::Number;
+        }
+        else if (std::string("=+-*/^()[],;").find(c) != std::string::npos)
+        {
+            ++_pos;
+            token.kind = ScriptToken::Symbol;
+        }
+        else
+        {
+            throw std::runtime_error("line " + std::to_string(_line) +
+                                     ": unexpected character '" +
+                                     std::string(1, c) + "'");
+        }
+        token.end = _pos;
+        return token;
+    }
+
+    /// Текущая позиция; используется для чтения матриц в формате калькулятора
+    const char *&position() noexcept { return _pos; }
+    const char *last() const noexcept { return _last; }
+    int &line() noexcept { return _line; }
+
+  private:
+    const char *_pos;
+    const char *_last;
+    int _line;
+
+    static bool _isDigit(char c) { return c >= '0' && c <= '9'; }
+    static bool _isNameStart(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    void _skipBlanks()
+    {
+        while (_pos != _last)
+        {
+            if (*_pos == '#')
+            {
+                while (_pos != _last && *_pos != '\n')
+                    ++_pos;
+            }
+            else if (*_pos != '\n' && (*_pos == ' ' ||
+                                       (*_pos >= '\t' && *_pos <= '\r')))
+            {
+                ++_pos;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    void _scanNumber()
+    {
+        while (_pos != _last && (_isDigit(*_pos) || *_pos == '.'))
+            ++_pos;
+        if (_pos != _last && (*_pos == 'e' || *_pos == 'E'))
+        {
+            const char *exp = _pos + 1;
+            if (exp != _last && (*exp == '+' || *exp == '-'))
+                ++exp;
+            if (exp != _last && _isDigit(*exp))
+            {
+                _pos = exp;
+                while (_pos != _last && _isDigit(*_pos))
+                    ++_pos;
+            }
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * \brief Сценарий калькулятора
+ * \details Сценарий из нескольких инструкций разбирается один раз в граф
+ * операций (DAG), после чего вычисляется целиком в памяти. Результат
+ * сценария - значение последней инструкции.
+ *
+ * При разборе граф оптимизируется:
+ * - переменная - это просто ссылка на узел, который ее вычисляет, а
+ *   одинаковые подвыражения (та же операция над теми же узлами) становятся
+ *   одним узлом, так что `inv(A) * B + inv(A) * C` обращает A один раз;
+ * - размеры матриц известны заранее, поэтому цепочки произведений вида
+ *   `A * B * C * D` перестраиваются в порядок с наименьшим числом
+ *   умножений элементов (классическое динамическое программирование для
+ *   задачи о порядке перемножения матриц). Произведения, значение которых
+ *   нужно где-то еще, остаются отдельными множителями. Для вещественных
+ *   типов результат может отличаться от вычисления слева направо в пределах
+ *   погрешности округления.
+ *
+ * run() вычисляет только узлы, от которых зависит результат, по уровням
+ * графа: независимые узлы одного уровня выполняются параллельно на
+ * \ref ThreadPool::global() "общем пуле". Каждый узел вычисляется один раз,
+ * а его значение освобождается, как только посчитаны все зависящие от него
+ * узлы.
+ *
+ * Числа и результаты det() и rk() - матрицы 1x1. При умножении матрицы 1x1
+ * на матрицу другого размера она считается скаляром, деление на матрицу 1x1
+ * делит каждый элемент.
+ *
+ * Пример сценария:
+ * \code
+ * matrix A        # матрица в формате калькулятора: размеры и элементы
+ * 2 2
+ * 4 7
+ * 2 6
+ * B = [1 2; 3 4]
+ * C = inv(A) * B + A
+ * C ^ 2 - 2 * t(C)
+ * \endcode
+ *
+ * \tparam T Тип элементов матриц
+ */
+template <typename T> class Script
+{
+  public:
+    using Value = std::shared_ptr<const MatrixGeneric<T>>; ///< Значение узла
+
+    /**
+     * \brief Разбор сценария
+     * \param first Начало текста сценария
+     * \param last Конец текста сценария
+     * \param line Номер строки файла, с которой начинается сценарий; нужен для
+     * сообщений об ошибках
+     * \throw std::runtime_error В случае синтаксической ошибки или обращения
+     * к неопределенной переменной
+     * \throw matrix_io_error Если матрица в двоичном формате некорректна
+     */
+    void parse(const char *first, const char *last, int line = 1)
+    {
+        _nodes.clear();
+        _shapes.clear();
+        _unique.clear();
+        _variables.clear();
+        _literals.clear();
+        _result = noNode;
+
+        detail::ScriptLexer lexer(first, last, line);
+        _lexer = &lexer;
+        _advance();
+        while (true)
+        {
+            while (_token.kind == detail::ScriptToken::Newline || _token.is(';'))
+                _advance();
+            if (_token.kind == detail::ScriptToken::End)
+                break;
+            _parseStatement();
+            if (_token.kind != detail::ScriptToken::End &&
+                _token.kind != detail::ScriptToken::Newline && !_token.is(';'))
+                _fail("expected end of statement");
+        }
+        _lexer = nullptr;
+
+        if (_result == noNode)
+            throw std::runtime_error("script is empty");
+        _reorderProducts();
+    }
+
+    /**
+     * \brief Вычисление сценария
+     * \return Значение последней инструкции
+     * \throw basic_matrix_exception Если операция над матрицами невозможна
+     */
+    MatrixGeneric<T> run() const
+    {
+        std::vector<uint32_t> order = _reachable();
+
+        // Уровень узла - длина самого длинного пути от него до литерала.
+        // Узлы одного уровня не зависят друг от друга
+        std::vector<uint32_t> level(_nodes.size(), 0), uses(_nodes.size(), 0);
+        uint32_t depth = 0;
+        for (uint32_t node : order)
+        {
+            const Node &n = _nodes[node];
+            if (_arity(n.kind) > 0)
+            {
+                level[node] = level[n.lhs] + 1;
+                ++uses[n.lhs];
+            }
+            if (_arity(n.kind) > 1)
+            {
+                level[node] = std::max(level[node], level[n.rhs] + 1);
+                ++uses[n.rhs];
+            }
+            depth = std::max(depth, level[node]);
+        }
+
+        std::vector<std::vector<uint32_t>> levels(depth + 1);
+        std::vector<Value> values(_nodes.size());
+        for (uint32_t node : order)
+        {
+            if (_nodes[node].kind == Kind::Literal)
+                values[node] = _literals[_nodes[node].index];
+            else
+                levels[level[node]].push_back(node);
+        }
+
+        for (uint32_t l = 1; l <= depth; ++l)
+        {
+            const std::vector<uint32_t> &nodes = levels[l];
+            ThreadPool::global().parallelFor(
+                0, uint32_t(nodes.size()), 1,
+                [&](uint32_t lo, uint32_t hi)
+                {
+                    for (uint32_t i = lo; i < hi; ++i)
+                        values[nodes[i]] = _compute(nodes[i], values);
+                });
+
+            // Значения, которые больше никому не нужны, освобождаются сразу
+            for (uint32_t node : nodes)
+            {
+                const Node &n = _nodes[node];
+                if (_arity(n.kind) > 0 && --uses[n.lhs] == 0)
+                    values[n.lhs].reset();
+                if (_arity(n.kind) > 1 && --uses[n.rhs] == 0)
+                    values[n.rhs].reset();
+            }
+        }
+        return *values[_result];
+    }
+
+    /**
+     * \brief Количество операций, которые выполнит run()
+     * \details Учитываются только узлы, от которых зависит результат, после
+     * слияния одинаковых подвыражений и перестановки произведений
+     */
+    std::size_t operationCount() const
+    {
+        std::vector<uint32_t> order = _reachable();
+        return std::size_t(std::count_if(
+            order.begin(), order.end(), [this](uint32_t node)
+            { return _nodes[node].kind != Kind::Literal; }));
+    }
+
+  private:
+    /// Вид узла синтаксического дерева
+    enum class Kind
+    {
+        Literal,   ///< Число или матрица из текста сценария
+        Add,       ///< a + b
+        Sub,       ///< a - b
+        Mul,       ///< a * b
+        Div,       ///< a / b
+        Neg,       ///< -a
+        Pow,       ///< a ^ n, pow(a, n)
+        Inverse,   ///< inv(a)
+        Solve,     ///< solve(a, b)
+        Det,       ///< det(a)
+        Rank,      ///< rk(a)
+        Transpose  ///< t(a)
+    };
+
+    /// Узел графа операций; дочерние узлы задаются номерами в _nodes
+    struct Node
+    {
+        Kind kind;
+        uint32_t lhs{0};
+        uint32_t rhs{0};
+        uint32_t index{0}; ///< Номер литерала, степень для Pow
+    };
+
+    /// Размер значения узла, если его можно определить при разборе
+    struct Shape
+    {
+        bool known{false};
+        uint32_t height{0};
+        uint32_t width{0};
+    };
+
+    static constexpr uint32_t noNode = UINT32_MAX;
+
+    std::vector<Node> _nodes;
+    std::vector<Shape> _shapes; ///< Размер значения каждого узла
+    /// Операция -> узел, для слияния одинаковых подвыражений
+    std::map<std::tuple<int, uint32_t, uint32_t, uint32_t>, uint32_t> _unique;
+    std::unordered_map<std::string, uint32_t> _variables; ///< Имя -> узел
+    std::vector<Value> _literals;
+    uint32_t _result{noNode}; ///< Узел последней инструкции
+
+    detail::ScriptLexer *_lexer{nullptr};
+    detail::ScriptToken _token;
+    int _nesting{0}; ///< Глубина скобок, внутри которых переводы строк не важны
+
+    [[noreturn]] void _fail(const std::string &what) const
+    {
+        std::string near = _token.kind == detail::ScriptToken::End
+                               ? "end of script"
+                           : _token.kind == detail::ScriptToken::Newline
+                               ? "end of line"
+                               : "\"" + _token.text() + "\"";
+        throw std::runtime_error("line " + std::to_string(_token.line) + ": " +
+                                 what + " near " + near);
+    }
+
+    void _advance()
+    {
+        _token = _lexer->next();
+        while (_nesting > 0 && _token.kind == detail::ScriptToken::Newline)
+            _token = _lexer->next();
+    }
+
+    void _expect(char c)
+    {
+        if (!_token.is(c))
+            _fail(std::string("expected '") + c + "'");
+        _advance();
+    }
+
+    /// Перевод строки после бинарной операции не завершает инструкцию
+    void _advanceOperator()
+    {
+        _advance();
+        while (_token.kind == detail::ScriptToken::Newline)
+            _advance();
+    }
+
+    static int _arity(Kind kind)
+    {
+        switch (kind)
+        {
+        case Kind::Literal:
+            return 0;
+        case Kind::Add:
+        case Kind::Sub:
+        case Kind::Mul:
+        case Kind::Div:
+        case Kind::Solve:
+            return 2;
+        default:
+            return 1;
+        }
+    }
+
+    static std::tuple<int, uint32_t, uint32_t, uint32_t> _key(const Node &n)
+    {
+        return std::make_tuple(int(n.kind), n.lhs, n.rhs, n.index);
+    }
+
+    /**
+     * \brief Узел для операции
+     * \details Если такая же операция над теми же узлами уже есть, возвращается
+     * существующий узел
+     */
+    uint32_t _add(Kind kind, uint32_t lhs = 0, uint32_t rhs = 0,
+                  uint32_t index = 0)
+    {
+        // Сложение коммутативно и для чисел с плавающей точкой
+        if (kind == Kind::Add && rhs < lhs)
+            std::swap(lhs, rhs);
+
+        Node node{kind, lhs, rhs, index};
+        auto it = _unique.find(_key(node));
+        if (it != _unique.end())
+            return it->second;
+        uint32_t added = _push(node);
+        _unique.emplace(_key(node), added);
+        return added;
+    }
+
+    uint32_t _push(const Node &node)
+    {
+        _nodes.push_back(node);
+        _shapes.push_back(_inferShape(node));
+        return uint32_t(_nodes.size() - 1);
+    }
+
+    uint32_t _literal(MatrixGeneric<T> value)
+    {
+        _literals.push_back(std::make_shared<const MatrixGeneric<T>>(
+            std::move(value)));
+        return _push(Node{Kind::Literal, 0, 0, uint32_t(_literals.size() - 1)});
+    }
+
+    static bool _isScalar(const Shape &s)
+    {
+        return s.height == 1 && s.width == 1;
+    }
+
+    /**
+     * \brief Размер значения узла
+     * \details Если операция заведомо невозможна, размер неизвестен: ошибка
+     * возникнет при вычислении
+     */
+    Shape _inferShape(const Node &node) const
+    {
+        if (node.kind == Kind::Literal)
+        {
+            const MatrixGeneric<T> &m = *_literals[node.index];
+            return Shape{true, m.height(), m.width()};
+        }
+        if (node.kind == Kind::Det || node.kind == Kind::Rank)
+            return Shape{true, 1, 1};
+
+        const Shape a = _shapes[node.lhs];
+        if (!a.known)
+            return Shape{};
+        const bool square = a.height == a.width;
+        switch (node.kind)
+        {
+        case Kind::Neg:
+            return a;
+        case Kind::Pow:
+        case Kind::Inverse:
+            return square ? a : Shape{};
+        case Kind::Transpose:
+            return Shape{true, a.width, a.height};
+        default:
+            break;
+        }
+
+        const Shape b = _shapes[node.rhs];
+        if (!b.known)
+            return Shape{};
+        switch (node.kind)
+        {
+        case Kind::Add:
+        case Kind::Sub:
+            return a.height == b.height && a.width == b.width ? a : Shape{};
+        case Kind::Mul:
+            if (_isScalar(a) != _isScalar(b))
+                return _isScalar(a) ? b : a;
+            return a.width == b.height ? Shape{true, a.height, b.width}
+                                       : Shape{};
+        case Kind::Solve:
+            return square && a.height == b.height
+                       ? Shape{true, a.width, b.width}
+                       : Shape{};
+        default:
+            if (!_isScalar(a) && _isScalar(b))
+                return a;
+            return b.height == b.width && a.width == b.height ? a : Shape{};
+        }
+    }
+
+    static bool _isReserved(const std::string &name)
+    {
+        return name == "matrix" || name == "inv" || name == "det" ||
+               name == "rk" || name == "t" || name == "pow" ||
+               name == "solve";
+    }
+
+    T _number(const detail::ScriptToken &token, bool negative)
+    {
+        T value{};
+        if (token.kind != detail::ScriptToken::Number ||
+            !detail::parseNumber(token.begin, token.end, value))
+            _fail("expected a number");
+        return negative ? T(-value) : value;
+    }
+
+    uint32_t _integer()
+    {
+        long long value = 0;
+        if (_token.kind != detail::ScriptToken::Number ||
+            !detail::parseNumber(_token.begin, _token.end, value) ||
+            value < 0 || value > UINT32_MAX ||
+            std::size_t(_token.end - _token.begin) !=
+                std::to_string(value).size())
+            _fail("expected a non-negative integer");
+        _advance();
+        return uint32_t(value);
+    }
+
+    void _parseStatement()
+    {
+        if (_token.kind == detail::ScriptToken::Name &&
+            _token.text() == "matrix")
+        {
+            _advance();
+            if (_token.kind != detail::ScriptToken::Name ||
+                _isReserved(_token.text()))
+                _fail("expected a matrix name");
+            std::string name = _token.text();
+            _result = _literal(_readOperand());
+            _variables[name] = _result;
+            _advance();
+            return;
+        }
+
+        // ИМЯ '=' выражение: нужна вторая лексема, поэтому позиция лексера
+        // запоминается и при необходимости восстанавливается
+        if (_token.kind == detail::ScriptToken::Name &&
+            !_isReserved(_token.text()))
+        {
+            detail::ScriptToken name = _token;
+            const char *position = _lexer->position();
+            int line = _lexer->line();
+            _advance();
+            if (_token.is('='))
+            {
+                _advanceOperator();
+                _result = _parseExpression();
+                _variables[name.text()] = _result;
+                return;
+            }
+            _lexer->position() = position;
+            _lexer->line() = line;
+            _token = name;
+        }
+
+        _result = _parseExpression();
+    }
+
+    /**
+     * \brief Матрица в формате калькулятора сразу после `matrix ИМЯ`
+     * \details Высота, ширина и элементы или матрица в двоичном формате
+     */
+    MatrixGeneric<T> _readOperand()
+    {
+        const char *&pos = _lexer->position();
+        const char *last = _lexer->last();
+        while (pos != last && (*pos == ' ' || (*pos >= '\t' && *pos <= '\r')))
+        {
+            if (*pos == '\n')
+                ++_lexer->line();
+            ++pos;
+        }
+
+        if (std::size_t(last - pos) >= sizeof(detail::binaryMagic) &&
+            detail::isBinaryMatrix(pos))
+        {
+            if (std::size_t(last - pos) < detail::binaryHeaderSize)
+                throw matrix_io_error("Binary matrix is truncated");
+            auto header = detail::decodeBinaryHeader(
+                pos, uint64_t(last - pos) - detail::binaryHeaderSize);
+            pos += detail::binaryHeaderSize;
+
+            MatrixGeneric<T> out(header.height, header.width);
+            detail::readBinaryPayload(header, out.data(),
+                                      [&pos, last](char *to, std::size_t n)
+                                      {
+                                          if (std::size_t(last - pos) < n)
+                                              return false;
+                                          std::copy(pos, pos + n, to);
+                                          pos += n;
+                                          return true;
+                                      });
+            return out;
+        }
+
+        auto element = [this]()
+        {
+            ScriptToken token = _nextSkippingNewlines();
+            bool negative = token.is('-');
+            if (negative)
+                token = _lexer->next();
+            _token = token;
+            return _number(token, negative);
+        };
+        auto size = [this]()
+        {
+            _token = _nextSkippingNewlines();
+            long long value = 0;
+            if (_token.kind != detail::ScriptToken::Number ||
+                !detail::parseNumber(_token.begin, _token.end, value) ||
+                value < 0 || value > UINT32_MAX)
+                _fail("expected matrix size");
+            return uint32_t(value);
+        };
+
+        uint32_t height = size();
+        uint32_t width = size();
+        if ((height == 0) != (width == 0))
+            _fail("only both height and width can be zero");
+        MatrixGeneric<T> out(height, width);
+        std::size_t count = std::size_t(height) * width;
+        for (std::size_t i = 0; i < count; ++i)
+            out.data()[i] = element();
+        return out;
+    }
+
+    using ScriptToken = detail::ScriptToken;
+
+    ScriptToken _nextSkippingNewlines()
+    {
+        ScriptToken token = _lexer->next();
+        while (token.kind == ScriptToken::Newline)
+            token = _lexer->next();
+        return token;
+    }
+
+    uint32_t _parseExpression()
+    {
+        uint32_t lhs = _parseTerm();
+        while (_token.is('+') || _token.is('-'))
+        {
+            Kind kind = _token.is('+') ? Kind::Add : Kind::Sub;
+            _advanceOperator();
+            lhs = _add(kind, lhs, _parseTerm());
+        }
+        return lhs;
+    }
+
+    uint32_t _parseTerm()
+    {
+        uint32_t lhs = _parseUnary();
+        while (_token.is('*') || _token.is('/'))
+        {
+            Kind kind = _token.is('*') ? Kind::Mul : Kind::Div;
+            _advanceOperator();
+            lhs = _add(kind, lhs, _parseUnary());
+        }
+        return lhs;
+    }
+
+    uint32_t _parseUnary()
+    {
+        if (_token.is('-'))
+        {
+            _advanceOperator();
+            return _add(Kind::Neg, _parseUnary());
+        }
+        uint32_t base = _parsePrimary();
+        if (_token.is('^'))
+        {
+            _advanceOperator();
+            return _add(Kind::Pow, base, 0, _integer());
+        }
+        return base;
+    }
+
+    uint32_t _parsePrimary()
+    {
+        if (_token.kind == ScriptToken::Number)
+        {
+            T value = _number(_token, false);
+            _advance();
+            return _literal(MatrixGeneric<T>{{value}});
+        }
+
+        if (_token.is('('))
+        {
+            ++_nesting;
+            _advance();
+            uint32_t node = _parseExpression();
+            --_nesting;
+            _expect(')');
+            return node;
+        }
+
+        if (_token.is('['))
+            return _literal(_parseMatrixLiteral());
+
+        if (_token.kind != ScriptToken::Name)
+            _fail("expected an expression");
+
+        std::string name = _token.text();
+        if (!_isReserved(name) || name == "matrix")
+        {
+            auto it = _variables.find(name);
+            if (it == _variables.end())
+                _fail("undefined variable");
+            _advance();
+            return it->second;
+        }
+
+        // Вызов функции
+        _advance();
+        if (!_token.is('('))
+            _fail("expected '('");
+        ++_nesting;
+        _advance();
+        uint32_t arg = _parseExpression();
+        uint32_t node;
+        if (name == "pow")
+        {
+            --_nesting;
+            _expect(',');
+            ++_nesting;
+            node = _add(Kind::Pow, arg, 0, _integer());
+        }
+        else if (name == "solve")
+        {
+            _expect(',');
+            node = _add(Kind::Solve, arg, _parseExpression());
+        }
+        else
+        {
+            Kind kind = name == "inv"   ? Kind::Inverse
+                        : name == "det" ? Kind::Det
+                        : name == "rk"  ? Kind::Rank
+                                        : Kind::Transpose;
+            node = _add(kind, arg);
+        }
+        --_nesting;
+        _expect(')');
+        return node;
+    }
+
+    MatrixGeneric<T> _parseMatrixLiteral()
+    {
+        int line = _token.line;
+        _advance();
+
+        std::vector<T> elements;
+        uint32_t width = 0, height = 0, inRow = 0;
+        auto endRow = [&]()
+        {
+            if (inRow == 0)
+                return;
+            if (height != 0 && inRow != width)
+                _fail("rows of the matrix have different lengths");
+            width = inRow;
+            ++height;
+            inRow = 0;
+        };
+
+        while (!_token.is(']'))
+        {
+            if (_token.kind == ScriptToken::End)
+                throw std::runtime_error("line " + std::to_string(line) +
+                                         ": unterminated matrix literal");
+            if (_token.kind == ScriptToken::Newline || _token.is(';'))
+            {
+                endRow();
+                _advance();
+                continue;
+            }
+            if (_token.is(','))
+            {
+                _advance();
+                continue;
+            }
+
+            bool negative = _token.is('-');
+            if (negative)
+                _advance();
+            elements.push_back(_number(_token, negative));
+            ++inRow;
+            _advance();
+        }
+        endRow();
+        _advance();
+
+        MatrixGeneric<T> out(height, width);
+        std::copy(elements.begin(), elements.end(), out.data());
+        return out;
+    }
+
+    /// Является ли узел произведением, которое можно переставлять
+    bool _isChainable(uint32_t node) const
+    {
+        const Node &n = _nodes[node];
+        if (n.kind != Kind::Mul)
+            return false;
+        const Shape &a = _shapes[n.lhs], &b = _shapes[n.rhs];
+        return a.known && b.known && _isScalar(a) == _isScalar(b) &&
+               a.width == b.height;
+    }
+
+    /**
+     * \brief Узлы, от которых зависит результат
+     * \return Номера узлов; каждый узел идет после своих аргументов
+     */
+    std::vector<uint32_t> _reachable() const
+    {
+        std::vector<uint32_t> order;
+        std::vector<char> state(_nodes.size(), 0); // 1 - в обходе, 2 - готов
+        std::vector<uint32_t> stack{_result};
+        while (!stack.empty())
+        {
+            uint32_t node = stack.back();
+            const Node &n = _nodes[node];
+            if (state[node] == 0)
+            {
+                state[node] = 1;
+                if (_arity(n.kind) > 1 && state[n.rhs] == 0)
+                    stack.push_back(n.rhs);
+                if (_arity(n.kind) > 0 && state[n.lhs] == 0)
+                    stack.push_back(n.lhs);
+                continue;
+            }
+            stack.pop_back();
+            if (state[node] == 1)
+            {
+                state[node] = 2;
+                order.push_back(node);
+            }
+        }
+        return order;
+    }
+
+    /**
+     * \brief Перестановка цепочек произведений
+     * \details Цепочка - это произведение, аргументы которого - другие
+     * произведения, нужные только ему, и так далее. Ее множители
+     * перемножаются в порядке с наименьшей стоимостью. Новое произведение
+     * заменяет корень цепочки во всех узлах, которые на него ссылаются; если
+     * такое произведение уже было в графе, используется существующий узел
+     */
+    void _reorderProducts()
+    {
+        std::vector<uint32_t> order = _reachable();
+        std::vector<uint32_t> uses(_nodes.size(), 0);
+        for (uint32_t node : order)
+        {
+            const Node &n = _nodes[node];
+            if (_arity(n.kind) > 0)
+                ++uses[n.lhs];
+            if (_arity(n.kind) > 1)
+                ++uses[n.rhs];
+        }
+
+        // Произведение внутри цепочки не обрабатывается отдельно
+        std::vector<char> inner(_nodes.size(), 0);
+        for (uint32_t node : order)
+        {
+            if (!_isChainable(node))
+                continue;
+            for (uint32_t arg : {_nodes[node].lhs, _nodes[node].rhs})
+                if (_isChainable(arg) && uses[arg] == 1)
+                    inner[arg] = 1;
+        }
+
+        // forward[i] - узел, которым заменяется узел i
+        std::vector<uint32_t> forward(_nodes.size());
+        for (uint32_t i = 0; i < forward.size(); ++i)
+            forward[i] = i;
+        auto resolve = [&forward](uint32_t node)
+        {
+            while (forward[node] != node)
+                node = forward[node];
+            return node;
+        };
+
+        for (uint32_t node : order)
+        {
+            if (!_isChainable(node) || inner[node])
+                continue;
+            std::vector<uint32_t> factors;
+            _collectFactors(node, uses, factors);
+            if (factors.size() < 3)
+                continue;
+            for (uint32_t &factor : factors)
+                factor = resolve(factor);
+
+            uint32_t reordered = _reorderChain(factors);
+            for (uint32_t i = uint32_t(forward.size()); i < _nodes.size(); ++i)
+                forward.push_back(i);
+            if (resolve(reordered) != node)
+                forward[node] = reordered;
+        }
+
+        for (Node &n : _nodes)
+        {
+            if (_arity(n.kind) > 0)
+                n.lhs = resolve(n.lhs);
+            if (_arity(n.kind) > 1)
+                n.rhs = resolve(n.rhs);
+        }
+        _result = resolve(_result);
+    }
+
+    void _collectFactors(uint32_t node, const std::vector<uint32_t> &uses,
+                         std::vector<uint32_t> &factors) const
+    {
+        for (uint32_t arg : {_nodes[node].lhs, _nodes[node].rhs})
+        {
+            if (_isChainable(arg) && uses[arg] == 1)
+                _collectFactors(arg, uses, factors);
+            else
+                factors.push_back(arg);
+        }
+    }
+
+    /**
+     * \brief Произведение множителей в наилучшем порядке
+     * \return Узел произведения
+     */
+    uint32_t _reorderChain(const std::vector<uint32_t> &factors)
+    {
+        // cost[i][j] - наименьшее число умножений элементов для произведения
+        // множителей i..j, split[i][j] - где его разделить на два
+        const std::size_t n = factors.size();
+        std::vector<double> dims(n + 1);
+        dims[0] = _shapes[factors[0]].height;
+        for (std::size_t i = 0; i < n; ++i)
+            dims[i + 1] = _shapes[factors[i]].width;
+
+        std::vector<double> cost(n * n, 0);
+        std::vector<std::size_t> split(n * n, 0);
+        for (std::size_t len = 2; len <= n; ++len)
+        {
+            for (std::size_t i = 0; i + len <= n; ++i)
+            {
+                std::size_t j = i + len - 1;
+                cost[i * n + j] = std::numeric_limits<double>::infinity();
+                for (std::size_t k = i; k < j; ++k)
+                {
+                    double c = cost[i * n + k] + cost[(k + 1) * n + j] +
+                               dims[i] * dims[k + 1] * dims[j + 1];
+                    if (c < cost[i * n + j])
+                    {
+                        cost[i * n + j] = c;
+                        split[i * n + j] = k;
+                    }
+                }
+            }
+        }
+        return _buildChain(factors, split, 0, n - 1);
+    }
+
+    uint32_t _buildChain(const std::vector<uint32_t> &factors,
+                         const std::vector<std::size_t> &split, std::size_t i,
+                         std::size_t j)
+    {
+        if (i == j)
+            return factors[i];
+        std::size_t k = split[i * factors.size() + j];
+        uint32_t lhs = _buildChain(factors, split, i, k);
+        uint32_t rhs = _buildChain(factors, split, k + 1, j);
+        return _add(Kind::Mul, lhs, rhs);
+    }
+
+    static bool _isScalar(const MatrixGeneric<T> &m)
+    {
+        return m.height() == 1 && m.width() == 1;
+    }
+
+    /// Вычисление узла, аргументы которого уже вычислены
+    Value _compute(uint32_t index, const std::vector<Value> &values) const
+    {
+        const Node &node = _nodes[index];
+        auto make = [](MatrixGeneric<T> m)
+        { return std::make_shared<const MatrixGeneric<T>>(std::move(m)); };
+
+        const MatrixGeneric<T> &a = *values[node.lhs];
+        switch (node.kind)
+        {
+        case Kind::Neg:
+            return make(T(-1) * a);
+        case Kind::Pow:
+            return make(a.pow(node.index));
+        case Kind::Inverse:
+            return make(a.inverse());
+        case Kind::Det:
+            return make(MatrixGeneric<T>{{a.det()}});
+        case Kind::Rank:
+            return make(MatrixGeneric<T>{{static_cast<T>(a.rk())}});
+        case Kind::Transpose:
+            return make(a.transpose());
+        default:
+            break;
+        }
+
+        const MatrixGeneric<T> &b = *values[node.rhs];
+        switch (node.kind)
+        {
+        case Kind::Add:
+            return make(a + b);
+        case Kind::Sub:
+            return make(a - b);
+        case Kind::Mul:
+            if (_isScalar(a) != _isScalar(b))
+                return make(_isScalar(a) ? a.get(0, 0) * b : b.get(0, 0) * a);
+            return make(a * b);
+        case Kind::Solve:
+            return make(solve(a, b));
+        default:
+            if (!_isScalar(a) && _isScalar(b))
+            {
+                MatrixGeneric<T> out(a);
+                const T divisor = b.get(0, 0);
+                std::size_t count = std::size_t(out.height()) * out.width();
+                for (std::size_t i = 0; i < count; ++i)
+                    out.data()[i] /= divisor;
+                return make(std::move(out));
+            }
+            return make(a / b);
+        }
+    }
+};
+
+#endif
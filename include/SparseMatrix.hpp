@@ -0,0 +1,784 @@
+#ifndef __SPARSE_MATRIX
+#define __SPARSE_MATRIX
+
+#include "Exceptions.hpp"
+#include "MatrixGeneric.hpp"
+#include "MatrixStats.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * \file SparseMatrix.hpp
+ * Файл, содержащий класс SparseMatrix - разреженную матрицу в формате CSR, и
+ * операции над ней: умножение на плотную и разреженную матрицу, поэлементные
+ * операции и транспонирование
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Ненулевой элемент в координатном формате
+ * \tparam T Тип элемента
+ */
+template <typename T> struct Triplet
+{
+    uint32_t row; ///< Номер строки
+    uint32_t col; ///< Номер столбца
+    T value;      ///< Значение
+};
+
+/**
+ * \brief Разреженная матрица в формате CSC
+ * \details Столбцы идут подряд: номера строк и значения элементов столбца j
+ * лежат в [colPtr[j], colPtr[j + 1]) массивов rowIdx и values. Результат
+ * SparseMatrix::toCsc()
+ *
+ * \tparam T Тип элементов
+ */
+template <typename T> struct CscStorage
+{
+    uint32_t height{0};           ///< Высота матрицы
+    uint32_t width{0};            ///< Ширина матрицы
+    std::vector<uint32_t> colPtr; ///< Начала столбцов, width + 1 элементов
+    std::vector<uint32_t> rowIdx; ///< Номера строк элементов
+    std::vector<T> values;        ///< Значения элементов
+};
+
+template <typename T> class SparseMatrix;
+
+namespace detail
+{
+
+/// Количество умножений, начиная с которого операции над разреженными
+/// матрицами распараллеливаются
+constexpr uint64_t sparseParallelThreshold = uint64_t(1) << 15;
+
+/// Количество строк в одной задаче пула для разреженных операций
+constexpr uint32_t sparseGrain = 64;
+
+/// Произведение SparseMatrix на MatrixGeneric - не умножение на число
+template <typename T> struct IsScalarOperand<SparseMatrix<T>> : std::false_type
+{
+};
+
+} // namespace detail
+
+/**
+ * \brief Разреженная матрица
+ * \details Хранит только ненулевые элементы в формате CSR: номера столбцов и
+ * значения элементов строки i лежат в [rowPointers()[i], rowPointers()[i +
+ * 1]) массивов columnIndices() и values(), внутри строки - по возрастанию
+ * номера столбца. Память и время операций пропорциональны количеству
+ * ненулевых элементов, а не h * w.
+ *
+ * Формат CSC получается методом toCsc(): это та же структура для
+ * транспонированной матрицы.
+ *
+ * Умножение разреженной матрицы на плотную (и наоборот) и на разреженную
+ * распараллеливается по строкам результата в \ref ThreadPool::global()
+ * "общем пуле". Произведение разреженных матриц считается алгоритмом
+ * Густавсона в два прохода: сначала количество элементов каждой строки, затем
+ * сами элементы.
+ *
+ * Пример использования:
+ * \code
+ * auto a = SparseMatrix<double>::fromTriplets(3, 3, {{0, 0, 2}, {2, 1, 5}});
+ * MatrixGeneric<double> x = {{1}, {2}, {3}};
+ * auto y = a * x;                 // {{2}, {0}, {10}}
+ * auto b = a * a.transpose();     // разреженная
+ * MatrixGeneric<double> d = b.toDense();
+ * \endcode
+ *
+ * \tparam T Тип элементов. Требования те же, что и у MatrixGeneric
+ */
+template <typename T> class SparseMatrix
+{
+  public:
+    using value_type = T; ///< Тип элементов
+
+    /// Пустая матрица 0x0
+    SparseMatrix() : _rowPtr(1, 0) {}
+
+    /**
+     * \brief Нулевая матрица
+     * \param height Высота
+     * \param width Ширина
+     */
+    SparseMatrix(uint32_t height, uint32_t width)
+        : _height(height), _width(width), _rowPtr(std::size_t(height) + 1, 0)
+    {
+    }
+
+    /**
+     * \brief Матрица из массивов CSR
+     *
+     * \param height Высота
+     * \param width Ширина
+     * \param rowPtr Начала строк, height + 1 элементов
+     * \param cols Номера столбцов элементов, по возрастанию внутри строки
+     * \param values Значения элементов
+     * \throw matrix_initialization_error Если массивы не образуют матрицу в
+     * формате CSR заданного размера
+     */
+    SparseMatrix(uint32_t height, uint32_t width, std::vector<uint32_t> rowPtr,
+                 std::vector<uint32_t> cols, std::vector<T> values)
+        : _height(height), _width(width), _rowPtr(std::move(rowPtr)),
+          _cols(std::move(cols)), _values(std::move(values))
+    {
+        if (_rowPtr.size() != std::size_t(height) + 1 || _rowPtr[0] != 0 ||
+            _rowPtr.back() != _cols.size() || _cols.size() != _values.size())
+            throw matrix_initialization_error("Invalid CSR arrays");
+        // Границы строк проверяются до чтения столбцов, иначе убывающий
+        // rowPtr уводит за конец cols
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            if (_rowPtr[i] > _rowPtr[i + 1] || _rowPtr[i + 1] > _cols.size())
+                throw matrix_initialization_error("Invalid CSR arrays");
+        }
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            for (uint32_t p = _rowPtr[i]; p < _rowPtr[i + 1]; ++p)
+            {
+                if (_cols[p] >= _width ||
+                    (p > _rowPtr[i] && _cols[p] <= _cols[p - 1]))
+                    throw matrix_initialization_error("Invalid CSR arrays");
+            }
+        }
+    }
+
+    /**
+     * \brief Матрица из формата CSC
+     * \details Перестановка элементов подсчетом, O(nnz + h + w)
+     *
+     * \param csc Матрица в формате CSC
+     * \throw matrix_initialization_error Если массивы некорректны
+     */
+    explicit SparseMatrix(const CscStorage<T> &csc)
+        : SparseMatrix(SparseMatrix(csc.width, csc.height, csc.colPtr,
+                                    csc.rowIdx, csc.values)
+                           .transpose())
+    {
+    }
+
+    /**
+     * \brief Разреженная копия плотной матрицы
+     * \details Нулевые элементы не сохраняются
+     *
+     * \param dense Плотная матрица
+     */
+    template <typename Alloc>
+    explicit SparseMatrix(const MatrixGeneric<T, Alloc> &dense)
+        : _height(dense.height()), _width(dense.width()),
+          _rowPtr(std::size_t(dense.height()) + 1, 0)
+    {
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            const T *row = dense.data() + std::size_t(i) * dense.stride();
+            for (uint32_t j = 0; j < _width; ++j)
+            {
+                if (row[j] != T(0))
+                {
+                    _cols.push_back(j);
+                    _values.push_back(row[j]);
+                }
+            }
+            _rowPtr[i + 1] = uint32_t(_cols.size());
+        }
+    }
+
+    /**
+     * \brief Матрица из списка ненулевых элементов
+     * \details Элементы сортируются по строкам и столбцам, значения с
+     * одинаковыми координатами складываются, нулевые суммы не сохраняются.
+     *
+     * Временная сложность: O(nnz * log(nnz))
+     *
+     * \param height Высота
+     * \param width Ширина
+     * \param triplets Элементы в произвольном порядке
+     * \return Матрица
+     * \throw matrix_bad_access Если координаты элемента выходят за пределы
+     * матрицы
+     */
+    static SparseMatrix fromTriplets(uint32_t height, uint32_t width,
+                                     std::vector<Triplet<T>> triplets)
+    {
+        for (const Triplet<T> &t : triplets)
+        {
+            if (t.row >= height || t.col >= width)
+                throw matrix_bad_access("Indexing is out of range");
+        }
+        std::sort(triplets.begin(), triplets.end(),
+                  [](const Triplet<T> &a, const Triplet<T> &b) {
+                      return a.row != b.row ? a.row < b.row : a.col < b.col;
+                  });
+
+        SparseMatrix out(height, width);
+        out._cols.reserve(triplets.size());
+        out._values.reserve(triplets.size());
+        for (std::size_t p = 0; p < triplets.size();)
+        {
+            const Triplet<T> &t = triplets[p];
+            T sum = t.value;
+            for (++p; p < triplets.size() && triplets[p].row == t.row &&
+                      triplets[p].col == t.col;
+                 ++p)
+                sum += triplets[p].value;
+            if (sum == T(0))
+                continue;
+            out._cols.push_back(t.col);
+            out._values.push_back(sum);
+            ++out._rowPtr[t.row + 1];
+        }
+        std::partial_sum(out._rowPtr.begin(), out._rowPtr.end(),
+                         out._rowPtr.begin());
+        return out;
+    }
+
+    /// Высота матрицы
+    uint32_t height() const noexcept { return _height; }
+
+    /// Ширина матрицы
+    uint32_t width() const noexcept { return _width; }
+
+    /// Количество хранимых элементов
+    std::size_t nonZeros() const noexcept { return _values.size(); }
+
+    /// Начала строк в columnIndices() и values(), height() + 1 элементов
+    const std::vector<uint32_t> &rowPointers() const noexcept { return _rowPtr; }
+
+    /// Номера столбцов хранимых элементов
+    const std::vector<uint32_t> &columnIndices() const noexcept
+    {
+        return _cols;
+    }
+
+    /// Значения хранимых элементов
+    const std::vector<T> &values() const noexcept { return _values; }
+
+    /**
+     * \brief Значение элемента
+     * \details Двоичный поиск по строке, O(log(nnz в строке))
+     *
+     * \param x Номер строки
+     * \param y Номер столбца
+     * \return Значение элемента; для нехранимых - ноль
+     * \throw matrix_bad_access Если элемент выходит за пределы матрицы
+     */
+    T get(uint32_t x, uint32_t y) const
+    {
+        if (x >= _height || y >= _width)
+            throw matrix_bad_access("Indexing is out of range");
+
+        auto first = _cols.begin() + _rowPtr[x],
+             last = _cols.begin() + _rowPtr[x + 1];
+        auto it = std::lower_bound(first, last, y);
+        if (it == last || *it != y)
+            return T(0);
+        return _values[std::size_t(it - _cols.begin())];
+    }
+
+    /**
+     * \brief Плотная копия матрицы
+     * \return Матрица h x w, в которой нехранимые элементы равны нулю
+     */
+    MatrixGeneric<T> toDense() const
+    {
+        MatrixGeneric<T> out(_height, _width);
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            T *row = out.data() + std::size_t(i) * out.stride();
+            for (uint32_t p = _rowPtr[i]; p < _rowPtr[i + 1]; ++p)
+                row[_cols[p]] = _values[p];
+        }
+        return out;
+    }
+
+    /**
+     * \brief Матрица в формате CSC
+     * \details Элементы раскладываются по столбцам подсчетом: O(nnz + h + w).
+     * Внутри столбца строки идут по возрастанию
+     *
+     * \return Матрица в формате CSC
+     */
+    CscStorage<T> toCsc() const
+    {
+        CscStorage<T> out;
+        out.height = _height;
+        out.width = _width;
+        out.colPtr.assign(std::size_t(_width) + 1, 0);
+        out.rowIdx.resize(_cols.size());
+        out.values.resize(_values.size());
+
+        for (uint32_t c : _cols)
+            ++out.colPtr[c + 1];
+        std::partial_sum(out.colPtr.begin(), out.colPtr.end(),
+                         out.colPtr.begin());
+
+        std::vector<uint32_t> next(out.colPtr.begin(), out.colPtr.end() - 1);
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            for (uint32_t p = _rowPtr[i]; p < _rowPtr[i + 1]; ++p)
+            {
+                uint32_t dst = next[_cols[p]]++;
+                out.rowIdx[dst] = i;
+                out.values[dst] = _values[p];
+            }
+        }
+        return out;
+    }
+
+    /**
+     * \brief Транспонирование матрицы
+     * \details Массивы CSC матрицы - это массивы CSR транспонированной, см.
+     * toCsc()
+     *
+     * \return Транспонированная матрица
+     */
+    SparseMatrix transpose() const
+    {
+        StatsScope stats("sparse.transpose");
+        CscStorage<T> csc = toCsc();
+        SparseMatrix out;
+        out._height = _width;
+        out._width = _height;
+        out._rowPtr = std::move(csc.colPtr);
+        out._cols = std::move(csc.rowIdx);
+        out._values = std::move(csc.values);
+        return out;
+    }
+
+    /**
+     * \brief Умножение матрицы на число
+     * \details Нули не появляются, если **k** не ноль; при k = 0 результат -
+     * пустая матрица того же размера
+     */
+    SparseMatrix operator*(const T &k) const
+    {
+        if (k == T(0))
+            return SparseMatrix(_height, _width);
+        SparseMatrix out(*this);
+        for (T &v : out._values)
+            v *= k;
+        return out;
+    }
+
+    /// \copydoc operator*(const T &) const
+    friend SparseMatrix operator*(const T &k, const SparseMatrix &m)
+    {
+        return m * k;
+    }
+
+    /**
+     * \brief Сравнение матриц
+     * \details Сравниваются значения, а не структура: хранимый ноль равен
+     * нехранимому элементу
+     */
+    friend bool operator==(const SparseMatrix &a, const SparseMatrix &b)
+    {
+        if (a._height != b._height || a._width != b._width)
+            return false;
+        for (uint32_t i = 0; i < a._height; ++i)
+        {
+            bool equal = true;
+            a._mergeRow(b, i,
+                        [&equal](uint32_t, const T &x, const T &y)
+                        { equal = equal && x == y; });
+            if (!equal)
+                return false;
+        }
+        return true;
+    }
+
+    /// \copydoc operator==()
+    friend bool operator!=(const SparseMatrix &a, const SparseMatrix &b)
+    {
+        return !(a == b);
+    }
+
+    /**
+     * \brief Поэлементная сумма разреженных матриц
+     * \details Строки сливаются по номерам столбцов, O(nnz(a) + nnz(b))
+     *
+     * \throw matrix_bad_operation Если размеры не совпадают
+     */
+    friend SparseMatrix operator+(const SparseMatrix &a, const SparseMatrix &b)
+    {
+        return a._combine(b, 1);
+    }
+
+    /// \copydoc operator+(const SparseMatrix &, const SparseMatrix &)
+    friend SparseMatrix operator-(const SparseMatrix &a, const SparseMatrix &b)
+    {
+        return a._combine(b, -1);
+    }
+
+    /**
+     * \brief Произведение разреженных матриц
+     * \details Алгоритм Густавсона: строка i результата - сумма строк b,
+     * взятых с коэффициентами из строки i матрицы a. Первый проход считает
+     * количество элементов каждой строки, второй - сами элементы. Строки
+     * делятся между потоками, у каждой задачи свои массивы размером w.
+     * Суммы, равные нулю, в результат не попадают.
+     *
+     * Временная сложность: O(количество умножений + h), дополнительная
+     * память: O(w) на задачу
+     *
+     * \throw matrix_bad_operation Если размеры не позволяют произвести
+     * умножение
+     */
+    friend SparseMatrix operator*(const SparseMatrix &a, const SparseMatrix &b)
+    {
+        _checkProduct(a._height, a._width, b._height, b._width);
+
+        uint64_t work = 0;
+        for (uint32_t c : a._cols)
+            work += b._rowPtr[c + 1] - b._rowPtr[c];
+        StatsScope stats("sparse.mul", 2.0 * work);
+
+        constexpr uint32_t unmarked = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> rowPtr(std::size_t(a._height) + 1, 0);
+        a._forRows(work,
+                   [&](uint32_t lo, uint32_t hi)
+                   {
+                       std::vector<uint32_t> mark(b._width, unmarked);
+                       for (uint32_t i = lo; i < hi; ++i)
+                       {
+                           uint32_t count = 0;
+                           for (uint32_t p = a._rowPtr[i]; p < a._rowPtr[i + 1];
+                                ++p)
+                           {
+                               uint32_t k = a._cols[p];
+                               for (uint32_t q = b._rowPtr[k];
+                                    q < b._rowPtr[k + 1]; ++q)
+                               {
+                                   if (mark[b._cols[q]] != i)
+                                   {
+                                       mark[b._cols[q]] = i;
+                                       ++count;
+                                   }
+                               }
+                           }
+                           rowPtr[i + 1] = count;
+                       }
+                   });
+        std::partial_sum(rowPtr.begin(), rowPtr.end(), rowPtr.begin());
+
+        std::vector<uint32_t> cols(rowPtr.back());
+        std::vector<T> values(rowPtr.back());
+        a._forRows(work,
+                   [&](uint32_t lo, uint32_t hi)
+                   {
+                       std::vector<uint32_t> mark(b._width, unmarked);
+                       std::vector<T> acc(b._width);
+                       for (uint32_t i = lo; i < hi; ++i)
+                       {
+                           uint32_t *rowCols = cols.data() + rowPtr[i];
+                           uint32_t count = 0;
+                           for (uint32_t p = a._rowPtr[i]; p < a._rowPtr[i + 1];
+                                ++p)
+                           {
+                               uint32_t k = a._cols[p];
+                               const T &x = a._values[p];
+                               for (uint32_t q = b._rowPtr[k];
+                                    q < b._rowPtr[k + 1]; ++q)
+                               {
+                                   uint32_t j = b._cols[q];
+                                   if (mark[j] != i)
+                                   {
+                                       mark[j] = i;
+                                       rowCols[count++] = j;
+                                       acc[j] = x * b._values[q];
+                                   }
+                                   else
+                                   {
+                                       acc[j] += x * b._values[q];
+                                   }
+                               }
+                           }
+                           std::sort(rowCols, rowCols + count);
+                           for (uint32_t q = 0; q < count; ++q)
+                               values[rowPtr[i] + q] = acc[rowCols[q]];
+                       }
+                   });
+
+        // Слагаемые могут взаимно уничтожиться; точные нули не хранятся
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < a._height; ++i)
+        {
+            uint32_t lo = rowPtr[i], hi = rowPtr[i + 1];
+            rowPtr[i] = kept;
+            for (uint32_t p = lo; p < hi; ++p)
+            {
+                if (values[p] != T(0))
+                {
+                    cols[kept] = cols[p];
+                    values[kept] = values[p];
+                    ++kept;
+                }
+            }
+        }
+        rowPtr[a._height] = kept;
+        cols.resize(kept);
+        values.resize(kept);
+
+        SparseMatrix out;
+        out._height = a._height;
+        out._width = b._width;
+        out._rowPtr = std::move(rowPtr);
+        out._cols = std::move(cols);
+        out._values = std::move(values);
+        return out;
+    }
+
+    /**
+     * \brief Произведение разреженной матрицы на плотную
+     * \details Строка i результата - сумма строк плотной матрицы, взятых с
+     * коэффициентами из строки i разреженной. Строки результата делятся между
+     * потоками. Умножение на столбец - SpMV.
+     *
+     * Временная сложность: O(nnz(a) * w(b))
+     *
+     * \return Плотная матрица; память берется у распределителя **b**
+     * \throw matrix_bad_operation Если размеры не позволяют произвести
+     * умножение
+     */
+    template <typename Alloc>
+    friend MatrixGeneric<T, Alloc> operator*(const SparseMatrix &a,
+                                             const MatrixGeneric<T, Alloc> &b)
+    {
+        _checkProduct(a._height, a._width, b.height(), b.width());
+
+        StatsScope stats("sparse.mul", 2.0 * a.nonZeros() * b.width());
+        MatrixGeneric<T, Alloc> out(a._height, b.width(), b.get_allocator());
+        uint32_t n = b.width();
+        a._forRows(uint64_t(a.nonZeros()) * n,
+                   [&](uint32_t lo, uint32_t hi)
+                   {
+                       for (uint32_t i = lo; i < hi; ++i)
+                       {
+                           T *dst = out.data() + std::size_t(i) * out.stride();
+                           for (uint32_t p = a._rowPtr[i]; p < a._rowPtr[i + 1];
+                                ++p)
+                           {
+                               const T &x = a._values[p];
+                               const T *src = b.data() +
+                                              std::size_t(a._cols[p]) * b.stride();
+                               for (uint32_t j = 0; j < n; ++j)
+                                   dst[j] += x * src[j];
+                           }
+                       }
+                   });
+        return out;
+    }
+
+    /**
+     * \brief Произведение плотной матрицы на разреженную
+     * \details Строка i результата - сумма строк разреженной матрицы, взятых с
+     * коэффициентами из строки i плотной. Строки результата делятся между
+     * потоками.
+     *
+     * Временная сложность: O(h(a) * nnz(b))
+     *
+     * \return Плотная матрица; память берется у распределителя **a**
+     * \throw matrix_bad_operation Если размеры не позволяют произвести
+     * умножение
+     */
+    template <typename Alloc>
+    friend MatrixGeneric<T, Alloc> operator*(const MatrixGeneric<T, Alloc> &a,
+                                             const SparseMatrix &b)
+    {
+        _checkProduct(a.height(), a.width(), b._height, b._width);
+
+        StatsScope stats("sparse.mul", 2.0 * a.height() * b.nonZeros());
+        MatrixGeneric<T, Alloc> out(a.height(), b._width, a.get_allocator());
+        auto rows = [&](uint32_t lo, uint32_t hi)
+        {
+            for (uint32_t i = lo; i < hi; ++i)
+            {
+                const T *src = a.data() + std::size_t(i) * a.stride();
+                T *dst = out.data() + std::size_t(i) * out.stride();
+                for (uint32_t k = 0; k < b._height; ++k)
+                {
+                    const T &x = src[k];
+                    if (x == T(0))
+                        continue;
+                    for (uint32_t q = b._rowPtr[k]; q < b._rowPtr[k + 1]; ++q)
+                        dst[b._cols[q]] += x * b._values[q];
+                }
+            }
+        };
+        if (uint64_t(a.height()) * b.nonZeros() >= detail::sparseParallelThreshold)
+            ThreadPool::global().parallelFor(0, a.height(), detail::sparseGrain,
+                                             rows);
+        else
+            rows(0, a.height());
+        return out;
+    }
+
+    /**
+     * \brief Поэлементная сумма разреженной и плотной матриц
+     * \details Плотная матрица копируется, к копии прибавляются хранимые
+     * элементы разреженной
+     *
+     * \return Плотная матрица
+     * \throw matrix_bad_operation Если размеры не совпадают
+     */
+    template <typename Alloc>
+    friend MatrixGeneric<T, Alloc> operator+(const SparseMatrix &a,
+                                             const MatrixGeneric<T, Alloc> &b)
+    {
+        MatrixGeneric<T, Alloc> out(b);
+        a._addTo(out, 1);
+        return out;
+    }
+
+    /// \copydoc operator+(const SparseMatrix &, const MatrixGeneric<T, Alloc> &)
+    template <typename Alloc>
+    friend MatrixGeneric<T, Alloc> operator+(const MatrixGeneric<T, Alloc> &a,
+                                             const SparseMatrix &b)
+    {
+        MatrixGeneric<T, Alloc> out(a);
+        b._addTo(out, 1);
+        return out;
+    }
+
+    /// \copydoc operator+(const SparseMatrix &, const MatrixGeneric<T, Alloc> &)
+    template <typename Alloc>
+    friend MatrixGeneric<T, Alloc> operator-(const MatrixGeneric<T, Alloc> &a,
+                                             const SparseMatrix &b)
+    {
+        MatrixGeneric<T, Alloc> out(a);
+        b._addTo(out, -1);
+        return out;
+    }
+
+    /// \copydoc operator+(const SparseMatrix &, const MatrixGeneric<T, Alloc> &)
+    template <typename Alloc>
+    friend MatrixGeneric<T, Alloc> operator-(const SparseMatrix &a,
+                                             const MatrixGeneric<T, Alloc> &b)
+    {
+        MatrixGeneric<T, Alloc> out(b);
+        for (uint32_t i = 0; i < out.height(); ++i)
+        {
+            T *row = out.data() + std::size_t(i) * out.stride();
+            for (uint32_t j = 0; j < out.width(); ++j)
+                row[j] = -row[j];
+        }
+        a._addTo(out, 1);
+        return out;
+    }
+
+  private:
+    uint32_t _height{0}, ///< Высота матрицы
+        _width{0};       ///< Ширина матрицы
+    std::vector<uint32_t> _rowPtr; ///< Начала строк, см. rowPointers()
+    std::vector<uint32_t> _cols;   ///< Номера столбцов, см. columnIndices()
+    std::vector<T> _values;        ///< Значения, см. values()
+
+    /// Проверка размеров множителей
+    static void _checkProduct(uint32_t ah, uint32_t aw, uint32_t bh,
+                              uint32_t bw)
+    {
+        if (aw == bh)
+            return;
+        std::string what =
+            "Sizes of matrices aren't compatible for multiplication: ";
+        what += std::to_string(ah) + "x" + std::to_string(aw);
+        what += " and ";
+        what += std::to_string(bh) + "x" + std::to_string(bw);
+        throw matrix_bad_operation(what.c_str());
+    }
+
+    /// Обход строк [0, h) блоками; при большом объеме работы **work** - в
+    /// общем пуле
+    template <typename F> void _forRows(uint64_t work, F &&f) const
+    {
+        if (work >= detail::sparseParallelThreshold)
+            ThreadPool::global().parallelFor(0, _height, detail::sparseGrain, f);
+        else
+            f(0, _height);
+    }
+
+    /**
+     * \brief Слияние строки **i** с той же строкой **b**
+     * \details Для каждого столбца, хранимого хотя бы в одной из строк,
+     * вызывает **f(столбец, a_ij, b_ij)** по возрастанию номера столбца
+     */
+    template <typename F>
+    void _mergeRow(const SparseMatrix &b, uint32_t i, F &&f) const
+    {
+        uint32_t p = _rowPtr[i], pe = _rowPtr[i + 1];
+        uint32_t q = b._rowPtr[i], qe = b._rowPtr[i + 1];
+        while (p < pe || q < qe)
+        {
+            if (q == qe || (p < pe && _cols[p] < b._cols[q]))
+            {
+                f(_cols[p], _values[p], T(0));
+                ++p;
+            }
+            else if (p == pe || b._cols[q] < _cols[p])
+            {
+                f(b._cols[q], T(0), b._values[q]);
+                ++q;
+            }
+            else
+            {
+                f(_cols[p], _values[p], b._values[q]);
+                ++p;
+                ++q;
+            }
+        }
+    }
+
+    /// this + sign * b; нулевые суммы не сохраняются
+    SparseMatrix _combine(const SparseMatrix &b, int sign) const
+    {
+        detail::checkSameSize(*this, b);
+
+        StatsScope stats("sparse.add", double(nonZeros()) + b.nonZeros());
+        SparseMatrix out(_height, _width);
+        out._cols.reserve(std::max(_cols.size(), b._cols.size()));
+        out._values.reserve(out._cols.capacity());
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            _mergeRow(b, i,
+                      [&out, sign](uint32_t j, const T &x, const T &y)
+                      {
+                          T sum = sign > 0 ? x + y : x - y;
+                          if (sum == T(0))
+                              return;
+                          out._cols.push_back(j);
+                          out._values.push_back(sum);
+                      });
+            out._rowPtr[i + 1] = uint32_t(out._cols.size());
+        }
+        return out;
+    }
+
+    /// out += sign * this
+    template <typename Alloc>
+    void _addTo(MatrixGeneric<T, Alloc> &out, int sign) const
+    {
+        detail::checkSameSize(*this, out);
+        for (uint32_t i = 0; i < _height; ++i)
+        {
+            T *row = out.data() + std::size_t(i) * out.stride();
+            for (uint32_t p = _rowPtr[i]; p < _rowPtr[i + 1]; ++p)
+            {
+                if (sign > 0)
+                    row[_cols[p]] += _values[p];
+                else
+                    row[_cols[p]] -= _values[p];
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef __SYMMETRIC_EIGEN
+#define __SYMMETRIC_EIGEN
+
+#include "Exceptions.hpp"
+#include "MatrixGeneric.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+/**
+ * \file SymmetricEigen.hpp
+ * Файл, содержащий класс SymmetricEigen - разложение симметричной матрицы по
+ * собственным векторам методом Якоби
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Спектральное разложение симметричной матрицы
+ * \details Циклический метод Якоби: вращениями обнуляются внедиагональные
+ * элементы, пока их сумма квадратов не станет пренебрежимо малой по сравнению
+ * с нормой матрицы. В результате A = V * D * V^T, где D - диагональная
+ * матрица собственных значений, а столбцы ортогональной матрицы V -
+ * собственные векторы.
+ *
+ * Временная сложность: O(n^3) на один проход, проходов обычно меньше десяти
+ *
+ * \tparam T Вещественный тип элементов
+ */
+template <typename T> class SymmetricEigen
+{
+    static_assert(std::is_floating_point<T>::value,
+                  "SymmetricEigen requires floating point elements");
+
+  public:
+    /**
+     * \brief Разложение матрицы
+     * \param a Симметричная матрица или ее \ref MatrixView "представление"
+     * \throw matrix_bad_operation Если матрица не квадратная
+     */
+    explicit SymmetricEigen(MatrixView<const T> a)
+        : _size(a.height()), _vectors(MatrixGeneric<T>::eye(a.height()))
+    {
+        if (a.height() != a.width())
+            throw matrix_bad_operation("Matrix isn't square");
+
+        std::vector<T> work(std::size_t(_size) * _size);
+        a.assignTo(work.data(), _size);
+        _diagonalize(work);
+
+        _values.resize(_size);
+        for (uint32_t i = 0; i < _size; ++i)
+            _values[i] = work[std::size_t(i) * _size + i];
+    }
+
+    /**
+     * \brief Собственные значения
+     * \return Собственные значения в порядке, соответствующем столбцам
+     * eigenvectors()
+     */
+    const std::vector<T> &eigenvalues() const noexcept { return _values; }
+
+    /**
+     * \brief Собственные векторы
+     * \return Ортогональная матрица, i-тый столбец которой - собственный
+     * вектор для i-того собственного значения
+     */
+    const MatrixGeneric<T> &eigenvectors() const noexcept { return _vectors; }
+
+    /**
+     * \brief Степень исходной матрицы
+     * \details Вычисляется как V * D^power * V^T
+     *
+     * Временная сложность: O(n^3)
+     *
+     * \param power Степень
+     * \return Исходная матрица в степени **power**
+     */
+    MatrixGeneric<T> pow(uint32_t power) const
+    {
+        MatrixGeneric<T> scaled(_vectors);
+        for (uint32_t j = 0; j < _size; ++j)
+        {
+            T lambda = std::pow(_values[j], static_cast<T>(power));
+            for (uint32_t i = 0; i < _size; ++i)
+                scaled.get(i, j) *= lambda;
+        }
+        return scaled * _vectors.transposeView();
+    }
+
+  private:
+    uint32_t _size;            ///< Длина стороны матрицы
+    std::vector<T> _values;    ///< Собственные значения
+    MatrixGeneric<T> _vectors; ///< Собственные векторы по столбцам
+
+    /**
+     * \brief Проходы метода Якоби
+     * \param a Копия матрицы, хранящаяся построчно. На выходе на ее диагонали
+     * лежат собственные значения
+     */
+    void _diagonalize(std::vector<T> &a)
+    {
+        const uint32_t n = _size;
+        const uint32_t maxSweeps = 64;
+        auto at = [&a, n](uint32_t i, uint32_t j) -> T &
+        { return a[std::size_t(i) * n + j]; };
+        T *v = _vectors.data();
+
+        T norm = 0;
+        for (const T &x : a)
+            norm += x * x;
+        const T eps = std::numeric_limits<T>::epsilon();
+
+        for (uint32_t sweep = 0; sweep < maxSweeps; ++sweep)
+        {
+            T off = 0;
+            for (uint32_t p = 0; p < n; ++p)
+                for (uint32_t q = p + 1; q < n; ++q)
+                    off += at(p, q) * at(p, q);
+            if (off <= eps * eps * norm)
+                return;
+
+            for (uint32_t p = 0; p < n; ++p)
+            {
+                for (uint32_t q = p + 1; q < n; ++q)
+                {
+                    T apq = at(p, q);
+                    if (apq == T(0))
+                        continue;
+
+                    // Угол поворота, обнуляющего a[p][q]: tg выбирается
+                    // меньшим из корней, чтобы поворот был не больше pi/4
+                    T theta = (at(q, q) - at(p, p)) / (2 * apq);
+                    T t = (theta >= 0 ? T(1) : T(-1)) /
+                          (std::abs(theta) + std::sqrt(theta * theta + 1));
+                    T c = 1 / std::sqrt(t * t + 1), s = t * c;
+
+                    for (uint32_t k = 0; k < n; ++k)
+                    {
+                        T akp = at(k, p), akq = at(k, q);
+                        at(k, p) = c * akp - s * akq;
+                        at(k, q) = s * akp + c * akq;
+                    }
+                    for (uint32_t k = 0; k < n; ++k)
+                    {
+                        T apk = at(p, k), aqk = at(q, k);
+                        at(p, k) = c * apk - s * aqk;
+                        at(q, k) = s * apk + c * aqk;
+                    }
+                    for (uint32_t k = 0; k < n; ++k)
+                    {
+                        T vkp = v[std::size_t(k) * n + p],
+                          vkq = v[std::size_t(k) * n + q];
+                        v[std::size_t(k) * n + p] = c * vkp - s * vkq;
+                        v[std::size_t(k) * n + q] = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
+    }
+};
+
+#endif
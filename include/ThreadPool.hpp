@@ -0,0 +1,336 @@
+#ifndef __THREAD_POOL
+#define __THREAD_POOL
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \file ThreadPool.hpp
+ * Файл, содержащий пул потоков с перехватом задач (work stealing), которым
+ * пользуются параллельные алгоритмы библиотеки
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Пул потоков с перехватом задач
+ * \details У каждого рабочего потока своя очередь задач. Поток берет задачи с
+ * конца своей очереди, а когда она пуста - забирает задачи из начала чужих
+ * очередей. Задачи, порожденные внутри рабочего потока, попадают в его же
+ * очередь, поэтому вложенные параллельные операции (например, умножения
+ * внутри MatrixGeneric::pow()) выполняются на тех же потоках, а не создают
+ * новые.
+ *
+ * Поток, ожидающий завершения группы задач, не блокируется, а сам исполняет
+ * задачи из очередей, так что вложенный parallelFor() не приводит к
+ * взаимоблокировке.
+ *
+ * Обычно используется общий пул библиотеки, см. global(). Количество потоков
+ * в нем по умолчанию равно std::thread::hardware_concurrency() и может быть
+ * задано переменной окружения TSPP_THREADS или функцией setGlobalThreads().
+ */
+class ThreadPool
+{
+  public:
+    using Task = std::function<void()>; ///< Тип задачи
+
+    /**
+     * \brief Создание пула
+     * \param threads Общее количество потоков, включая вызывающий: создается
+     * threads - 1 рабочих потоков. При 0 или 1 все задачи исполняются в
+     * вызывающем потоке
+     */
+    explicit ThreadPool(unsigned threads)
+        : _queues(threads > 1 ? threads - 1 : 0)
+    {
+        for (std::size_t i = 0; i < _queues.size(); ++i)
+            _queues[i].reset(new Queue);
+        for (std::size_t i = 0; i < _queues.size(); ++i)
+            _workers.emplace_back([this, i]() { _workerLoop(i); });
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * \brief Остановка пула
+     * \details Дожидается завершения рабочих потоков. Задачи, оставшиеся в
+     * очередях, не исполняются
+     */
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto &w : _workers)
+            w.join();
+    }
+
+    /**
+     * \brief Количество потоков
+     * \return Количество рабочих потоков плюс вызывающий поток
+     */
+    unsigned size() const noexcept
+    {
+        return static_cast<unsigned>(_workers.size()) + 1;
+    }
+
+    /**
+     * \brief Параллельный цикл
+     * \details Делит диапазон [**begin**, **end**) на отрезки не короче
+     * **grain** и вызывает **f(lo, hi)** для каждого отрезка. Последний
+     * отрезок исполняет вызывающий поток, после чего он помогает исполнять
+     * остальные задачи, пока все отрезки не будут обработаны.
+     *
+     * \param f Функция вида `void(uint32_t lo, uint32_t hi)`
+     * \throw <any> Первое исключение, выброшенное одним из отрезков
+     */
+    template <typename F>
+    void parallelFor(uint32_t begin, uint32_t end, uint32_t grain, F &&f)
+    {
+        if (begin >= end)
+            return;
+
+        grain = std::max<uint32_t>(grain, 1);
+        uint32_t chunks = std::min<uint32_t>((end - begin + grain - 1) / grain,
+                                             size() * 4);
+        if (chunks <= 1 || _queues.empty())
+        {
+            f(begin, end);
+            return;
+        }
+
+        Group group;
+        group.pending = chunks - 1;
+        uint32_t step = (end - begin) / chunks, extra = (end - begin) % chunks;
+
+        uint32_t lo = begin;
+        for (uint32_t c = 0; c + 1 < chunks; ++c)
+        {
+            uint32_t hi = lo + step + (c < extra ? 1 : 0);
+            _push([&group, &f, lo, hi]()
+                  {
+                      try
+                      {
+                          f(lo, hi);
+                      }
+                      catch (...)
+                      {
+                          group.fail(std::current_exception());
+                      }
+                      group.pending--;
+                  });
+            lo = hi;
+        }
+
+        try
+        {
+            f(lo, end);
+        }
+        catch (...)
+        {
+            group.fail(std::current_exception());
+        }
+
+        while (group.pending.load() != 0)
+        {
+            if (!_runOne())
+                std::this_thread::yield();
+        }
+
+        if (group.error)
+            std::rethrow_exception(group.error);
+    }
+
+    /**
+     * \brief Общий пул библиотеки
+     * \return Ссылка на пул, создаваемый при первом обращении
+     */
+    static ThreadPool &global()
+    {
+        std::lock_guard<std::mutex> lock(_globalMutex());
+        auto &pool = _globalHolder();
+        if (!pool)
+            pool.reset(new ThreadPool(defaultThreads()));
+        return *pool;
+    }
+
+    /**
+     * \brief Изменение количества потоков общего пула
+     * \details Пул пересоздается. Функцию нельзя вызывать, пока в других
+     * потоках идут вычисления с использованием общего пула
+     *
+     * \param threads Общее количество потоков, см. ThreadPool()
+     */
+    static void setGlobalThreads(unsigned threads)
+    {
+        std::lock_guard<std::mutex> lock(_globalMutex());
+        _globalHolder().reset(new ThreadPool(threads));
+    }
+
+    /**
+     * \brief Количество потоков по умолчанию
+     * \return Значение переменной окружения TSPP_THREADS, если она задана,
+     * иначе std::thread::hardware_concurrency()
+     */
+    static unsigned defaultThreads()
+    {
+        if (const char *env = std::getenv("TSPP_THREADS"))
+        {
+            long value = std::strtol(env, nullptr, 10);
+            if (value > 0)
+                return static_cast<unsigned>(value);
+        }
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+  private:
+    /// Очередь задач одного рабочего потока
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    /// Группа задач одного вызова parallelFor()
+    struct Group
+    {
+        std::atomic<uint32_t> pending{0};
+        std::mutex errorMutex;
+        std::exception_ptr error;
+
+        void fail(std::exception_ptr e)
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+                error = e;
+        }
+    };
+
+    /// Какому пулу и какой очереди принадлежит текущий поток
+    struct WorkerInfo
+    {
+        const ThreadPool *pool{nullptr};
+        std::size_t index{0};
+    };
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+    std::atomic<std::size_t> _queued{0};     ///< Задач во всех очередях
+    std::atomic<std::size_t> _nextQueue{0};  ///< Для распределения внешних задач
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    bool _stop{false};
+
+    static std::unique_ptr<ThreadPool> &_globalHolder()
+    {
+        static std::unique_ptr<ThreadPool> pool;
+        return pool;
+    }
+
+    static std::mutex &_globalMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static WorkerInfo &_current()
+    {
+        static thread_local WorkerInfo info;
+        return info;
+    }
+
+    void _push(Task task)
+    {
+        std::size_t idx = _current().pool == this
+                              ? _current().index
+                              : _nextQueue++ % _queues.size();
+        {
+            std::lock_guard<std::mutex> lock(_queues[idx]->mutex);
+            _queues[idx]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _queued++;
+        }
+        _wake.notify_one();
+    }
+
+    /**
+     * \brief Извлечение задачи
+     * \details Сначала конец своей очереди, затем начало чужих
+     * \param home Номер своей очереди; для внешних потоков - любой
+     */
+    bool _pop(std::size_t home, Task &task)
+    {
+        const std::size_t n = _queues.size();
+        for (std::size_t shift = 0; shift < n; ++shift)
+        {
+            Queue &q = *_queues[(home + shift) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty())
+                continue;
+            if (shift == 0)
+            {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            _queued--;
+            return true;
+        }
+        return false;
+    }
+
+    /// Исполнение одной задачи в ожидающем потоке
+    bool _runOne()
+    {
+        if (_queues.empty())
+            return false;
+        Task task;
+        std::size_t home = _current().pool == this ? _current().index : 0;
+        if (!_pop(home, task))
+            return false;
+        task();
+        return true;
+    }
+
+    void _workerLoop(std::size_t index)
+    {
+        _current().pool = this;
+        _current().index = index;
+
+        Task task;
+        while (true)
+        {
+            if (_pop(index, task))
+            {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_sleepMutex);
+            _wake.wait(lock, [this]() { return _stop || _queued.load() > 0; });
+            if (_stop)
+                return;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,444 @@
+#ifndef __TOKEN_READER
+#define __TOKEN_READER
+
+#include "MatrixBinary.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * \file TokenReader.hpp
+ * Файл, содержащий буферизованное чтение лексем из потока или памяти и разбор
+ * чисел без выделения памяти. Используется калькулятором при чтении матриц
+ * \author dmsukhikh
+ */
+
+/**
+ * \brief Буферизованное чтение лексем
+ * \details Читает поток большими блоками и выдает лексемы - участки между
+ * пробельными символами - в виде указателей на внутренний буфер. В отличие от
+ * `stream >> std::string`, не выделяет память на каждую лексему и не обращается
+ * к локали. Лексема, попавшая на границу блока, переносится в начало буфера;
+ * буфер растет, только если одна лексема длиннее него.
+ *
+ * Читатель также может работать над готовым участком памяти (например,
+ * отображенным в память файлом, см. MappedFile) - тогда лексемы указывают
+ * прямо в этот участок, и ничего не копируется.
+ *
+ * Пример использования:
+ * \code
+ * std::ifstream file("matrices.txt");
+ * TokenReader reader(file);
+ * const char *begin, *end;
+ * while (reader.next(begin, end))
+ *     std::cout << std::string(begin, end) << std::endl;
+ * \endcode
+ */
+class TokenReader
+{
+  public:
+    /**
+     * \brief Создание читателя потока
+     * \param in Поток, из которого читаются лексемы. Чтение начинается с
+     * текущей позиции
+     * \param bufferSize Размер буфера в байтах
+     */
+    explicit TokenReader(std::istream &in, std::size_t bufferSize = 1 << 20)
+        : _in(&in), _buf(bufferSize > 1 ? bufferSize : 2), _data(_buf.data())
+    {
+    }
+
+    /**
+     * \brief Создание читателя участка памяти
+     * \details Память не копируется и должна оставаться действительной, пока
+     * используются читатель и полученные из него лексемы
+     *
+     * \param first Начало участка
+     * \param last Конец участка (не включительно)
+     */
+    TokenReader(const char *first, const char *last)
+        : _data(first), _end(std::size_t(last - first))
+    {
+    }
+
+    /**
+     * \brief Следующая лексема
+     * \details Указатели действительны до следующего вызова
+     *
+     * \param[out] begin Начало лексемы
+     * \param[out] end Конец лексемы (не включительно)
+     * \return false, если лексемы закончились
+     */
+    bool next(const char *&begin, const char *&end)
+    {
+        // Пропуск пробельных символов
+        while (true)
+        {
+            while (_pos < _end && _isSpace(_data[_pos]))
+                ++_pos;
+            if (_pos < _end)
+                break;
+            if (!_fill())
+                return false;
+        }
+
+        // Лексема продолжается до пробела или конца данных
+        std::size_t scanned = _pos;
+        while (true)
+        {
+            while (scanned < _end && !_isSpace(_data[scanned]))
+                ++scanned;
+            if (scanned < _end)
+                break;
+            scanned -= _pos;
+            bool more = _fill();
+            scanned += _pos;
+            if (!more)
+                break;
+        }
+
+        begin = _data + _pos;
+        end = _data + scanned;
+        _pos = scanned;
+        return true;
+    }
+
+    /**
+     * \brief Начинаются ли следующие данные с **prefix**
+     * \details Пропускает пробельные символы и сравнивает следующие **size**
+     * байт с **prefix**, не считывая их
+     *
+     * \param prefix Искомые байты
+     * \param size Количество байт
+     * \return true, если данные начинаются с **prefix**
+     */
+    bool lookingAt(const char *prefix, std::size_t size)
+    {
+        while (true)
+        {
+            while (_pos < _end && _isSpace(_data[_pos]))
+                ++_pos;
+            if (_pos < _end && _end - _pos >= size)
+                break;
+            if (!_fill())
+                return false;
+        }
+        return std::memcmp(_data + _pos, prefix, size) == 0;
+    }
+
+    /**
+     * \brief Чтение байт как есть
+     * \details Используется для двоичных данных внутри текста. Пробельные
+     * символы не пропускаются. Большие участки потока читаются сразу в **out**,
+     * минуя буфер
+     *
+     * \param out Буфер размером **size**
+     * \param size Количество байт
+     * \return false, если данных не хватило
+     */
+    bool read(char *out, std::size_t size)
+    {
+        std::size_t buffered = std::min(size, _end - _pos);
+        if (buffered != 0)
+            std::memcpy(out, _data + _pos, buffered);
+        _pos += buffered;
+        if (buffered == size)
+            return true;
+        if (!_in)
+            return false;
+
+        std::size_t rest = size - buffered;
+        _in->read(out + buffered, std::streamsize(rest));
+        return static_cast<std::size_t>(_in->gcount()) == rest;
+    }
+
+    /**
+     * \brief Сколько байт осталось прочитать
+     * \return Остаток буфера или участка памяти вместе с остатком потока;
+     * detail::binaryUnknownSize, если поток не поддерживает позиционирование
+     */
+    uint64_t available()
+    {
+        uint64_t buffered = _end - _pos;
+        if (!_in)
+            return buffered;
+        uint64_t rest = detail::streamRemaining(*_in);
+        return rest == detail::binaryUnknownSize ? rest : buffered + rest;
+    }
+
+  private:
+    std::istream *_in{nullptr}; ///< Поток; nullptr для участка памяти
+    std::vector<char> _buf;     ///< Буфер для чтения потока
+    const char *_data;          ///< Начало данных: буфер или участок памяти
+    std::size_t _pos{0};        ///< Начало непрочитанной части данных
+    std::size_t _end{0};        ///< Конец данных
+
+    static bool _isSpace(char c)
+    {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    /**
+     * \brief Дочитывание потока
+     * \details Непрочитанный остаток переносится в начало буфера, свободное
+     * место заполняется из потока
+     * \return false, если поток (или участок памяти) закончился
+     */
+    bool _fill()
+    {
+        if (!_in || !*_in)
+            return false;
+
+        std::size_t rest = _end - _pos;
+        if (_pos != 0)
+            std::memmove(_buf.data(), _buf.data() + _pos, rest);
+        _pos = 0;
+        _end = rest;
+        if (_end == _buf.size())
+        {
+            _buf.resize(_buf.size() * 2);
+            _data = _buf.data();
+        }
+
+        _in->read(_buf.data() + _end, std::streamsize(_buf.size() - _end));
+        std::size_t got = static_cast<std::size_t>(_in->gcount());
+        _end += got;
+        return got != 0;
+    }
+};
+
+namespace detail
+{
+
+/**
+ * \brief Разбор целого числа
+ * \details Как и std::stoi(), разбирает наибольший корректный префикс:
+ * необязательный знак и десятичные цифры
+ *
+ * \return false, если цифр нет или число не помещается в **T**
+ */
+template <typename T>
+bool parseInteger(const char *first, const char *last, T &out)
+{
+    using Limits = std::numeric_limits<T>;
+    bool negative = false;
+    if (first != last && (*first == '+' || *first == '-'))
+        negative = *first++ == '-';
+
+    // Накопление идет в отрицательную сторону, чтобы поместился Limits::min()
+    T value = 0;
+    const char *digits = first;
+    for (; first != last && unsigned(*first - '0') < 10; ++first)
+    {
+        T d = T(*first - '0');
+        if (value < (Limits::min() + d) / 10)
+            return false;
+        value = value * 10 - d;
+    }
+    if (first == digits)
+        return false;
+    if (!negative && value == Limits::min())
+        return false;
+
+    out = negative ? value : T(-value);
+    return true;
+}
+
+/**
+ * \brief Точные степени десяти
+ * \details Степени до 10^22 представимы в double без округления
+ */
+inline const double *exactPowersOfTen()
+{
+    static const double powers[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    return powers;
+}
+
+/**
+ * \brief Параметры быстрого пути для вещественного типа
+ * \details Мантисса не длиннее **maxMantissa** и степень десяти не больше
+ * **maxExponent** по модулю представимы точно, поэтому результат
+ * единственного умножения или деления округляется правильно (алгоритм
+ * Клингера)
+ */
+template <typename T> struct FastFloatLimits;
+
+template <> struct FastFloatLimits<float>
+{
+    static constexpr uint64_t maxMantissa = uint64_t(1) << 24;
+    static constexpr int maxExponent = 10;
+};
+
+template <> struct FastFloatLimits<double>
+{
+    static constexpr uint64_t maxMantissa = uint64_t(1) << 53;
+    static constexpr int maxExponent = 22;
+};
+
+/// Разбор через strtof/strtod для случаев вне быстрого пути
+inline void parseFloatFallback(const char *str, float &out, char **end)
+{
+    out = std::strtof(str, end);
+}
+
+inline void parseFloatFallback(const char *str, double &out, char **end)
+{
+    out = std::strtod(str, end);
+}
+
+/**
+ * \brief Разбор вещественного числа
+ * \details Как и std::stod(), разбирает наибольший корректный префикс.
+ * Обычные десятичные записи с короткой мантиссой и небольшой экспонентой
+ * разбираются быстрым путем Клингера, остальные (длинные мантиссы, большие
+ * экспоненты, inf, nan, шестнадцатеричная запись) - через strtod на буфере в
+ * стеке, так что результат всегда совпадает с std::stod()
+ *
+ * \return false, если числа нет или оно вне диапазона **T**
+ */
+template <typename T>
+bool parseFloat(const char *first, const char *last, T &out)
+{
+    const char *p = first;
+    bool negative = false;
+    if (p != last && (*p == '+' || *p == '-'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int significant = 0, exponent = 0;
+    bool anyDigits = false, exact = true;
+
+    // Значимых цифр берется не больше 19, чтобы мантисса помещалась в 64 бита
+    auto digit = [&](unsigned d, bool fraction)
+    {
+        anyDigits = true;
+        if (mantissa == 0 && d == 0)
+        {
+            exponent -= fraction;
+            return;
+        }
+        if (significant < 19)
+        {
+            mantissa = mantissa * 10 + d;
+            ++significant;
+            exponent -= fraction;
+        }
+        else
+        {
+            exponent += !fraction;
+            exact = exact && d == 0;
+        }
+    };
+
+    for (; p != last && unsigned(*p - '0') < 10; ++p)
+        digit(unsigned(*p - '0'), false);
+    // 0x... разбирается strtod как шестнадцатеричное число
+    if (p != last && (*p == 'x' || *p == 'X'))
+        exact = false;
+    if (p != last && *p == '.')
+    {
+        for (++p; p != last && unsigned(*p - '0') < 10; ++p)
+            digit(unsigned(*p - '0'), true);
+    }
+
+    if (anyDigits && p != last && (*p == 'e' || *p == 'E'))
+    {
+        const char *q = p + 1;
+        bool negativeExp = false;
+        if (q != last && (*q == '+' || *q == '-'))
+            negativeExp = *q++ == '-';
+        if (q != last && unsigned(*q - '0') < 10)
+        {
+            int value = 0;
+            for (; q != last && unsigned(*q - '0') < 10; ++q)
+            {
+                if (value < 100000)
+                    value = value * 10 + (*q - '0');
+            }
+            exponent += negativeExp ? -value : value;
+        }
+    }
+
+    using Limits = FastFloatLimits<T>;
+    if (anyDigits && exact && mantissa <= Limits::maxMantissa &&
+        exponent >= -Limits::maxExponent && exponent <= Limits::maxExponent)
+    {
+        T value = T(mantissa);
+        if (exponent < 0)
+            value /= T(exactPowersOfTen()[-exponent]);
+        else
+            value *= T(exactPowersOfTen()[exponent]);
+        out = negative ? -value : value;
+        return true;
+    }
+
+    // Медленный путь: нуль-терминированная копия лексемы
+    char stackBuf[64];
+    std::string heapBuf;
+    const char *str = stackBuf;
+    std::size_t length = std::size_t(last - first);
+    if (length < sizeof(stackBuf))
+    {
+        std::memcpy(stackBuf, first, length);
+        stackBuf[length] = '\0';
+    }
+    else
+    {
+        heapBuf.assign(first, last);
+        str = heapBuf.c_str();
+    }
+
+    char *end = nullptr;
+    int savedErrno = errno;
+    errno = 0;
+    T value;
+    parseFloatFallback(str, value, &end);
+    bool ok = end != str && errno != ERANGE;
+    errno = savedErrno;
+    if (ok)
+        out = value;
+    return ok;
+}
+
+/**
+ * \brief Разбор числа из лексемы
+ * \details Перегрузки для встроенных типов, которые поддерживает
+ * калькулятор
+ *
+ * \param first Начало лексемы
+ * \param last Конец лексемы
+ * \param[out] out Результат; не меняется при ошибке
+ * \return false, если лексема не начинается с корректного числа
+ */
+inline bool parseNumber(const char *first, const char *last, int &out)
+{
+    return parseInteger(first, last, out);
+}
+
+inline bool parseNumber(const char *first, const char *last, long long &out)
+{
+    return parseInteger(first, last, out);
+}
+
+inline bool parseNumber(const char *first, const char *last, float &out)
+{
+    return parseFloat(first, last, out);
+}
+
+inline bool parseNumber(const char *first, const char *last, double &out)
+{
+    return parseFloat(first, last, out);
+}
+
+} // namespace detail
+
+#endif
@@ -0,0 +1,30 @@
+#include <MatrixStats.hpp>
+#include <new>
+
+/**
+ * \file StatsAlloc.cpp
+ * Замена глобальных operator new/delete, через которую счетчики
+ * MatrixStats.hpp видят выделения памяти. Компонуется в утилиту, если она
+ * собрана со счетчиками
+ * \author dmsukhikh
+ */
+
+void *operator new(std::size_t size)
+{
+    if (void *p = detail::statsAllocate(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept { detail::statsDeallocate(p); }
+void operator delete[](void *p) noexcept { detail::statsDeallocate(p); }
+void operator delete(void *p, std::size_t) noexcept
+{
+    detail::statsDeallocate(p);
+}
+void operator delete[](void *p, std::size_t) noexcept
+{
+    detail::statsDeallocate(p);
+}
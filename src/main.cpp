@@ -1,4 +1,11 @@
+#include <Batch.hpp>
 #include <Calculator.hpp>
+#include <MatrixStats.hpp>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
 
 /**
  * \file main.cpp
@@ -34,21 +41,44 @@
  *
  * Утилита исполняется следующим образом:
  * ```
- * tspp_calc [файл с информацией] [-f|-d]
+ * tspp_calc [файл с информацией] [-f|-d] [--mmap] [--binary] [--precision N]
+ *           [--stats] [--stats-json FILE]
  * ```
  *
  * Флаги `-f`, `-d` указывают на тип элементов матриц: -f - float, -d - double.
+ * Опция `--mmap` отображает файл в память и разбирает его без копирования
+ * через поток - это быстрее для очень больших файлов. Опция `--binary`
+ * печатает результат в двоичном формате MatrixGeneric::save(), который
+ * можно снова подать на вход утилите. Опция `--precision N` задает количество
+ * значащих цифр в текстовом выводе (по умолчанию 6); при N = 0 каждое число
+ * печатается кратчайшей записью, которая читается обратно без потерь.
+ * Опция `--stats` печатает в поток ошибок время, оценку GFLOP/s, выделения и
+ * пиковую память для чтения файла, вычисления, печати и каждой операции
+ * библиотеки (см. MatrixStats.hpp), а `--stats-json FILE` записывает те же
+ * счетчики в FILE в формате JSON. Счетчики есть, только если утилита собрана
+ * с TSPP_STATS (по умолчанию - да).
  * После этого утилита считывает переданный файл и производит, в котором описаны
  * матрицы и необходимая операция над ними. Далее, результат этой операции
  * направляется в поток стандартного вывода.
  *
+ * Чтобы решить много задач за один запуск, используется пакетный режим:
+ * ```
+ * tspp_calc --batch [-f|-d] [опции] [файл|директория|-] ...
+ * ```
+ * Файлы обрабатываются параллельно, результат для каждого файла записывается
+ * рядом с ним в файл с суффиксом `.out`. Из директории берутся все файлы,
+ * кроме `*.out`; вместо `-` (или если пути не указаны) список файлов читается
+ * из стандартного ввода. В конце печатается количество задач в секунду.
+ *
  * Список возможных операций следующий:
  *  - Все арифметические операции: **-, *, /, +**
  *  - **det** - определитель матрицы
  *  - **inv** - обратная матрица
+ *  - **solve** - решение системы A * X = B, см. solve()
  *  - **rk** - ранг матрицы
  *  - **t** - транспонирование матрицы
  *  - **pow** - степень матрицы
+ *  - **script** - сценарий из нескольких выражений, см. класс Script
  *
  * Слова или символы, указанные жирным - соответствующие операции команда в
  * файла. Формат файла следующий:
@@ -61,28 +91,130 @@
  * Если операция требует двух матриц (например, сложение), то после первой
  * матрицы в таком же виде сразу указывается информация о второй матрице.
  * Элементы матрицы разделяются пробелами, разделять строки переносом строки, в
- * целом, не обязательно. Примеры правильных (и не правильных) файлов можно
- * посмотреть в папке test/test_suite. В случае некорректного ввода (файл
- * отсутствует или информация в нем некорректна) программа завершится с ошибкой.
+ * целом, не обязательно. Вместо текста любая матрица может быть записана в
+ * двоичном формате (см. MatrixBinary.hpp) - он распознается автоматически,
+ * - или, если почти все элементы нулевые, в координатном формате `coo` (см.
+ * SparseMatrix и README).
+ * Примеры правильных (и не правильных) файлов можно посмотреть в папке
+ * test/test_suite. В случае некорректного ввода (файл отсутствует или
+ * информация в нем некорректна) программа завершится с ошибкой.
+ */
+
+/**
+ * \brief Печать счетчиков после успешного запуска
+ * \param text Печатать ли таблицу в поток ошибок
+ * \param jsonPath Файл для JSON; пустая строка - не записывать
  */
+void reportStats(bool text, const std::string &jsonPath)
+{
+    if (!text && jsonPath.empty())
+        return;
+    if (!statsEnabled())
+    {
+        std::cerr << "[tspp_calc] statistics are disabled in this build. "
+                     "Rebuild with -DSTATS=true"
+                  << std::endl;
+        return;
+    }
+    if (text)
+        printStats(std::cerr);
+    if (!jsonPath.empty())
+    {
+        std::ofstream out(jsonPath);
+        printStatsJson(out);
+        if (!out)
+            std::cerr << "[tspp_calc] can't write statistics to " << jsonPath
+                      << std::endl;
+    }
+}
 
 int main(int argc, char** argv)
 {
     if (argc < 3)
     {
-        std::cout << "[tspp_calc] usage: tspp_calc [file] [-f|-d]" << std::endl;
+        std::cout << "[tspp_calc] usage: tspp_calc [file] [-f|-d] [--mmap] "
+                     "[--binary] [--precision N]\n"
+                     "                             [--stats] "
+                     "[--stats-json FILE]\n"
+                     "                   tspp_calc --batch [-f|-d] [options] "
+                     "[file|dir|-] ..."
+                  << std::endl;
         return -1;
     }
 
+    const bool batch = std::string(argv[1]) == "--batch";
+    std::vector<std::string> paths;
+    CalculatorOptions options;
+    bool stats = false;
+    std::string statsJson;
+    for (int i = 3; i < argc; ++i)
+    {
+        if (batch && (std::string(argv[i]) == "-" || argv[i][0] != '-'))
+        {
+            paths.push_back(argv[i]);
+        }
+        else if (std::string(argv[i]) == "--mmap")
+        {
+            options.mmap = true;
+        }
+        else if (std::string(argv[i]) == "--binary")
+        {
+            options.binaryOutput = true;
+        }
+        else if (std::string(argv[i]) == "--precision")
+        {
+            const char *value = i + 1 < argc ? argv[++i] : "";
+            int precision = -1;
+            if (!detail::parseNumber(value, value + std::strlen(value),
+                                     precision) ||
+                precision < 0 || precision > detail::maxPrecision)
+            {
+                std::cout << "Invalid precision: \"" << value
+                          << "\". Expected a number from 0 to "
+                          << detail::maxPrecision << std::endl;
+                return -1;
+            }
+            options.precision = precision;
+        }
+        else if (std::string(argv[i]) == "--stats")
+        {
+            stats = true;
+        }
+        else if (std::string(argv[i]) == "--stats-json")
+        {
+            if (i + 1 >= argc)
+            {
+                std::cout << "Missing file name after --stats-json"
+                          << std::endl;
+                return -1;
+            }
+            statsJson = argv[++i];
+        }
+        else
+        {
+            std::cout << "Invalid option: " << argv[i]
+                      << ". Supported options: --mmap, --binary, --precision, "
+                         "--stats, --stats-json"
+                      << std::endl;
+            return -1;
+        }
+    }
+
     try
     {
         if (std::string(argv[2]) == "-f")
         {
-            mainRoutine<float>(argv);
+            if (batch)
+                batchRoutine<float>(paths, options);
+            else
+                mainRoutine<float>(argv, options);
         }
         else if (std::string(argv[2]) == "-d")
         {
-            mainRoutine<double>(argv);
+            if (batch)
+                batchRoutine<double>(paths, options);
+            else
+                mainRoutine<double>(argv, options);
         }
         else
         {
@@ -96,6 +228,6 @@ int main(int argc, char** argv)
         return -1;
     }
 
+    reportStats(stats, statsJson);
     return 0;
 }
-
@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 #include <initializer_list>
 #include "Exceptions.hpp"
+#include "FixedMatrix.hpp"
+#include "MatrixAllocator.hpp"
 #include "MatrixGeneric.hpp"
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <sstream>
 
@@ -200,3 +204,203 @@ TEST(TestBasic, MoveTest)
     b = std::move(a);
     EXPECT_EQ(old_a, b);
 }
+
+TEST(TestBasic, BinarySaveLoadTest)
+{
+    MatrixGeneric<double> a = {{1.5, -2, 3}, {4, 5e-300, 6}};
+    std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
+    a.save(stream);
+    EXPECT_EQ(stream.str().size(), 64 + 6 * sizeof(double));
+    EXPECT_EQ(MatrixGeneric<double>::load(stream), a);
+
+    // Пустая матрица и приведение типа элементов при чтении
+    MatrixGeneric<int> b = {{1, -2}, {3, 4}};
+    stream.str("");
+    b.save(stream);
+    MatrixGeneric<int>().save(stream);
+    EXPECT_EQ(MatrixGeneric<float>::load(stream),
+              MatrixGeneric<float>({{1, -2}, {3, 4}}));
+    EXPECT_EQ(MatrixGeneric<int>::load(stream), MatrixGeneric<int>());
+
+    // Файл с другим порядком байт
+    stream.str("");
+    b.save(stream);
+    std::string bytes = stream.str();
+    bytes[12] = bytes[12] == 1 ? 2 : 1;
+    for (std::size_t pos : {8, 16, 20, 24})
+    {
+        std::size_t size = pos == 8 ? 2 : pos == 24 ? 8 : 4;
+        std::reverse(bytes.begin() + pos, bytes.begin() + pos + size);
+    }
+    for (std::size_t pos = 64; pos < bytes.size(); pos += 4)
+        std::reverse(bytes.begin() + pos, bytes.begin() + pos + 4);
+    std::stringstream swapped(bytes);
+    EXPECT_EQ(MatrixGeneric<int>::load(swapped), b);
+
+    // Некорректные данные
+    std::stringstream text("2 2\n1 2 3 4\n");
+    EXPECT_THROW(MatrixGeneric<int>::load(text), matrix_io_error);
+    std::stringstream truncated(stream.str().substr(0, 70));
+    EXPECT_THROW(MatrixGeneric<int>::load(truncated), matrix_io_error);
+    std::string badType = stream.str();
+    badType[10] = 9;
+    std::stringstream badTypeStream(badType);
+    EXPECT_THROW(MatrixGeneric<int>::load(badTypeStream), matrix_io_error);
+    // Размеры в заголовке больше, чем данных в файле
+    std::string huge = stream.str().substr(0, 72);
+    const uint32_t side = 0x7fffffff;
+    std::memcpy(&huge[16], &side, 4);
+    std::memcpy(&huge[20], &side, 4);
+    std::stringstream hugeStream(huge);
+    EXPECT_THROW(MatrixGeneric<int>::load(hugeStream), matrix_io_error);
+    EXPECT_THROW(MatrixGeneric<int>::load("no_such_dir/matrix.bin"),
+                 matrix_io_error);
+}
+
+TEST(TestBasic, AllocatorTest)
+{
+    // Проверка распределителей памяти: арены и пула
+    MatrixGeneric<double> a = {{4, 7, 1}, {2, 6, 0}, {1, 2, 3}},
+                          b = {{1, 2, 3}, {3, 4, 5}, {0, 1, 1}};
+
+    ArenaResource arena(256);
+    {
+        ResourceScope scope(&arena);
+        ResourceMatrix<double> ra(a), rb(b);
+        EXPECT_EQ(ra.get_allocator().resource(), &arena);
+        EXPECT_GT(arena.used(), 0u);
+
+        // Результаты операций берут память у первого операнда
+        ResourceMatrix<double> sum = ra + rb, prod = ra * rb,
+                               quot = ra / rb;
+        EXPECT_EQ(prod.get_allocator().resource(), &arena);
+        EXPECT_EQ(quot.get_allocator().resource(), &arena);
+        EXPECT_EQ(ra.inverse().get_allocator().resource(), &arena);
+        EXPECT_EQ(ra.transpose().get_allocator().resource(), &arena);
+        EXPECT_EQ(ra.pow(5).get_allocator().resource(), &arena);
+
+        EXPECT_EQ(sum, a + b);
+        EXPECT_EQ(prod, a * b);
+        EXPECT_EQ(quot, a / b);
+        EXPECT_EQ(ra.inverse(), a.inverse());
+        EXPECT_EQ(ra.transpose(), a.transpose());
+        EXPECT_EQ(ra.pow(5), a.pow(5));
+        ResourceMatrix<double> sym = ra * ra.transpose();
+        EXPECT_EQ(sym.powSymmetric(2).get_allocator().resource(), &arena);
+        EXPECT_DOUBLE_EQ(ra.det(), a.det());
+        EXPECT_EQ(ra.rk(), a.rk());
+        EXPECT_EQ(ra * b, a * b);
+        EXPECT_EQ(a * rb, a * b);
+
+        // Копия переносит результат в кучу
+        MatrixGeneric<double> kept(prod);
+        ResourceMatrix<double> heap(prod, nullptr);
+        EXPECT_EQ(kept, a * b);
+        EXPECT_EQ(heap.get_allocator().resource(), nullptr);
+
+        // Присваивание сохраняет источник памяти матрицы
+        heap = ra;
+        EXPECT_EQ(heap.get_allocator().resource(), nullptr);
+        EXPECT_EQ(heap, a);
+    }
+    EXPECT_EQ(MemoryResource::current(), nullptr);
+    EXPECT_GT(arena.capacity(), 256u);
+
+    // После reset() куски объединяются, память выдается заново
+    std::size_t capacity = arena.capacity();
+    arena.reset();
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_EQ(arena.capacity(), capacity);
+    {
+        ResourceScope scope(&arena);
+        ResourceMatrix<double> ra(a);
+        EXPECT_EQ(ra.pow(3), a.pow(3));
+    }
+    EXPECT_EQ(arena.capacity(), capacity);
+
+    // Пул переиспользует освобожденные блоки своего класса
+    PoolResource pool;
+    const double *first;
+    {
+        ResourceMatrix<double> m(4, 4, &pool);
+        first = m.data();
+    }
+    {
+        ResourceMatrix<double> m(3, 5, &pool);
+        EXPECT_EQ(m.data(), first);
+        ResourceMatrix<double> pa(a, &pool);
+        EXPECT_EQ(ResourceMatrix<double>::eye(3, &pool) * pa, a);
+    }
+    ResourceMatrix<double> big(400, 400, &pool);
+    EXPECT_EQ(big.get(399, 399), 0);
+}
+
+TEST(TestBasic, AlignedStorageTest)
+{
+    // Проверка матриц с выровненными и дополненными строками
+    MatrixGeneric<double> a = {{4, 7, 1, 0, 2},
+                               {2, 6, 0, 1, 1},
+                               {1, 2, 3, 5, 0},
+                               {0, 1, 1, 2, 9},
+                               {3, 0, 2, 1, 1}},
+                          b = a.transpose();
+
+    AlignedMatrix<double> aa(a), ab(b);
+    EXPECT_EQ(aa.stride(), 8u);
+    EXPECT_EQ(MatrixGeneric<double>(3, 9).stride(), 9u);
+    EXPECT_EQ(AlignedMatrix<float>(3, 17).stride(), 32u);
+    for (uint32_t i = 0; i < aa.height(); ++i)
+    {
+        auto address = reinterpret_cast<std::uintptr_t>(aa.row(i).data());
+        EXPECT_EQ(address % 64, 0u);
+    }
+
+    EXPECT_EQ(aa, a);
+    EXPECT_EQ(aa.get(2, 3), 5);
+    EXPECT_THROW(aa.get(0, 5), matrix_bad_access);
+    EXPECT_THROW(aa.get(5, 0), matrix_bad_access);
+
+    // Операции учитывают шаг строк, в том числе с обычными матрицами
+    AlignedMatrix<double> sum = aa + ab, diff = aa - b, scaled = 2.0 * aa;
+    EXPECT_EQ(sum, a + b);
+    EXPECT_EQ(diff, a - b);
+    EXPECT_EQ(scaled, 2.0 * a);
+    EXPECT_EQ(aa * ab, a * b);
+    EXPECT_EQ(aa * b, a * b);
+    EXPECT_EQ(a * ab, a * b);
+    EXPECT_EQ(aa.transpose(), b);
+    EXPECT_EQ(aa.transposeView() * aa, b * a);
+    EXPECT_EQ(aa.inverse(), a.inverse());
+    EXPECT_EQ(aa / ab, a / b);
+    EXPECT_EQ(aa.pow(4), a.pow(4));
+    EXPECT_DOUBLE_EQ(aa.det(), a.det());
+    EXPECT_EQ(aa.rk(), a.rk());
+    EXPECT_EQ(aa.block(1, 2, 3, 3), a.block(1, 2, 3, 3));
+    EXPECT_EQ((FixedMatrix<double, 5, 5>(aa)), (FixedMatrix<double, 5, 5>(a)));
+
+    AlignedMatrix<int> ints = {{1, 2, 3}, {4, 5, 6}};
+    EXPECT_EQ(ints.stride(), 16u);
+    EXPECT_EQ(ints, MatrixGeneric<int>({{1, 2, 3}, {4, 5, 6}}));
+    EXPECT_EQ(ints.transpose(), MatrixGeneric<int>({{1, 4}, {2, 5}, {3, 6}}));
+
+    aa = aa + ab;
+    EXPECT_EQ(aa, a + b);
+    aa = 3.0 * ints;
+    EXPECT_EQ(aa, 3.0 * MatrixGeneric<int>({{1, 2, 3}, {4, 5, 6}}));
+
+    // Двоичный формат не зависит от шага строк
+    std::stringstream stream;
+    ab.save(stream);
+    EXPECT_EQ(MatrixGeneric<double>::load(stream), b);
+    stream.seekg(0);
+    AlignedMatrix<double> loaded = AlignedMatrix<double>::load(stream);
+    EXPECT_EQ(loaded, b);
+    for (uint32_t i = 0; i < loaded.height(); ++i)
+    {
+        for (uint32_t j = loaded.width(); j < loaded.stride(); ++j)
+            EXPECT_EQ(loaded.data()[i * loaded.stride() + j], 0);
+    }
+    stream.str("");
+    b.save(stream);
+    EXPECT_EQ(AlignedMatrix<double>::load(stream), b);
+}
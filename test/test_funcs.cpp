@@ -1,6 +1,8 @@
+#include <cmath>
 #include <functional>
 #include <gtest/gtest.h>
 #include "Exceptions.hpp"
+#include "MatrixAllocator.hpp"
 #include "MatrixGeneric.hpp"
 
 // Test suite для тестирования методов MatrixGeneric
@@ -52,6 +54,154 @@ TEST(TestFuncs, TestRk)
     EXPECT_EQ(MatrixGeneric<int>{}.rk(), 0);
 }
 
+TEST(TestFuncs, TestGaussElimination)
+{
+    // Матрица Гильберта 6x6: число обусловленности около 1.5e7
+    MatrixGeneric<double> h(6, 6);
+    for (int i = 0; i < 6; ++i)
+    {
+        for (int j = 0; j < 6; ++j)
+            h.get(i, j) = 1.0 / (i + j + 1);
+    }
+    double exact = 1.0 / 186313420339200000.0;
+    EXPECT_NEAR(h.det() / exact, 1, 1e-8);
+    EXPECT_NEAR(GaussElimination<double>(h, Pivoting::Full, 0).det() / exact,
+                1, 1e-8);
+    EXPECT_EQ(h.rk(), 6);
+
+    // Определитель целочисленной матрицы с большими элементами считается в
+    // double и не теряет точность float
+    MatrixGeneric<long long> big = {
+        {10007, 9973, 17}, {9967, 9941, -5}, {3, 11, 10009}};
+    EXPECT_EQ(big.det(), 789425892);
+    EXPECT_EQ(big.rk(), 3);
+
+    // Произведение 6x3 на 3x6: ранг 3, но после округления в остатке
+    // исключения остаются числа порядка eps
+    MatrixGeneric<double> l(6, 3), r(3, 6);
+    for (int i = 0; i < 6; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            l.get(i, j) = 0.1 * (i + 1) + 0.3 * j * j - 0.7 * (i == j);
+            r.get(j, i) = 0.2 * (j + 1) * (i + 2) - 0.1 * (i % 3) + (i == j);
+        }
+    }
+    MatrixGeneric<double> lowRank = l * r;
+    EXPECT_EQ(lowRank.rk(), 3);
+    EXPECT_EQ(lowRank.transpose().rk(), 3);
+    EXPECT_EQ(GaussElimination<double>(lowRank, Pivoting::Partial).rank(), 3);
+    EXPECT_NEAR(lowRank.det(), 0, 1e-10);
+
+    // Порог задается явно
+    MatrixGeneric<double> close = {{1, 2, 3}, {2, 4, 6.000001}};
+    EXPECT_EQ(close.rk(), 2);
+    EXPECT_EQ(GaussElimination<double>(close, Pivoting::Full, 0).rank(), 2);
+    EXPECT_EQ(GaussElimination<double>(close, Pivoting::Full, 1e-3).rank(), 1);
+    EXPECT_EQ(GaussElimination<double>(close, Pivoting::Partial, 1e-3).rank(),
+              1);
+    EXPECT_THROW(GaussElimination<double>(close).det(), matrix_bad_det);
+
+    // Ведущий элемент выбирается и при ненулевом диагональном
+    MatrixGeneric<double> tiny = {{1e-20, 1}, {1, 1}};
+    EXPECT_NEAR(tiny.det(), -1, 1e-15);
+    EXPECT_EQ(tiny.rk(), 2);
+
+    // Большая матрица исключается параллельно
+    MatrixGeneric<double> large(200, 200);
+    for (int i = 0; i < 200; ++i)
+    {
+        for (int j = 0; j < 200; ++j)
+            large.get(i, j) = (i == j ? 200 : 0) + std::sin(i * 7 + j * 3);
+    }
+    EXPECT_EQ(large.rk(), 200);
+    large.get(199, 199) = 0;
+    for (int j = 0; j < 200; ++j)
+        large.get(199, j) = large.get(0, j) - 2 * large.get(5, j);
+    EXPECT_EQ(large.rk(), 199);
+    EXPECT_EQ(
+        GaussElimination<double>(large, Pivoting::Partial).rank(), 199);
+}
+
+TEST(TestFuncs, TestQR)
+{
+    // A * P = Q * R, Q^T * Q = E, |r(i, i)| не возрастают
+    auto check = [](const MatrixGeneric<double> &a)
+    {
+        auto qr = a.qr();
+        auto q = qr.q();
+        auto r = qr.r();
+        auto qtq = q.transpose() * q;
+        auto prod = q * r;
+        uint32_t k = std::min(a.height(), a.width());
+        ASSERT_TRUE(q.height() == a.height() && q.width() == k);
+        ASSERT_TRUE(r.height() == k && r.width() == a.width());
+        for (uint32_t i = 0; i < k; ++i)
+        {
+            for (uint32_t j = 0; j < k; ++j)
+                EXPECT_NEAR(qtq.get(i, j), i == j, 1e-12);
+            for (uint32_t j = 0; j < i; ++j)
+                EXPECT_EQ(r.get(i, j), 0);
+            if (i > 0)
+            {
+                EXPECT_LE(std::abs(r.get(i, i)),
+                          std::abs(r.get(i - 1, i - 1)) * (1 + 1e-12));
+            }
+        }
+        for (uint32_t i = 0; i < a.height(); ++i)
+        {
+            for (uint32_t j = 0; j < a.width(); ++j)
+                EXPECT_NEAR(prod.get(i, j), a.get(i, qr.permutation()[j]),
+                            1e-10);
+        }
+    };
+
+    check({{1, 2}, {2, 4}, {3, 6}});
+    check({{4, 7, 1, 0}, {2, 6, -3, 5}});
+    check(MatrixGeneric<double>(3, 3));
+
+    // Несколько панелей и потеря точности при пересчете норм
+    auto noise = [](int i, int j)
+    { return std::fmod(std::sin(i * 12.9898 + j * 78.233) * 43758.5453, 1.0); };
+    MatrixGeneric<double> l(150, 40), r(40, 120);
+    for (int i = 0; i < 150; ++i)
+    {
+        for (int j = 0; j < 40; ++j)
+            l.get(i, j) = noise(i, j);
+    }
+    for (int i = 0; i < 40; ++i)
+    {
+        for (int j = 0; j < 120; ++j)
+            r.get(i, j) = noise(i + 1000, j);
+    }
+    MatrixGeneric<double> lowRank = l * r;
+    check(lowRank);
+    EXPECT_EQ(lowRank.rk(), 40);
+    EXPECT_EQ(lowRank.transpose().rk(), 40);
+    EXPECT_EQ(lowRank.qr().rank(0), 120);
+
+    MatrixGeneric<double> full(130, 130);
+    for (int i = 0; i < 130; ++i)
+    {
+        for (int j = 0; j < 130; ++j)
+            full.get(i, j) = noise(i, j + 500);
+    }
+    check(full);
+    EXPECT_EQ(full.rk(), 130);
+
+    // Порог задается явно
+    MatrixGeneric<double> close = {{1, 2, 3}, {2, 4, 6.000001}};
+    EXPECT_EQ(close.rk(), 2);
+    EXPECT_EQ(close.rk(1e-3), 1);
+    EXPECT_EQ(close.rk(0), 2);
+
+    MatrixGeneric<int> ints = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    EXPECT_EQ(ints.rk(), 2);
+    MatrixGeneric<float> floats = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    EXPECT_EQ(floats.rk(), 2);
+    EXPECT_EQ(MatrixGeneric<double>().qr().rank(), 0);
+}
+
 TEST(TestFuncs, TestEye)
 {
     // Тест, проверяющий корректность создания единичной матрицы
@@ -83,6 +233,61 @@ TEST(TestFuncs, TestTranspose)
     }
 }
 
+TEST(TestFuncs, TestTransposeBlocked)
+{
+    // Размеры, не кратные блоку рекурсивного транспонирования
+    for (auto dims : {std::make_pair(1, 1000), std::make_pair(37, 129),
+                      std::make_pair(300, 300), std::make_pair(17, 17)})
+    {
+        MatrixGeneric<int> a(dims.first, dims.second);
+        for (uint32_t i = 0; i < a.height(); ++i)
+        {
+            for (uint32_t j = 0; j < a.width(); ++j)
+                a.get(i, j) = i * 1000 + j;
+        }
+
+        auto b = a.transpose();
+        ASSERT_TRUE(b.height() == a.width() && b.width() == a.height());
+        auto c = a;
+        c.transposeInPlace();
+        EXPECT_EQ(b, c);
+        for (uint32_t i = 0; i < a.height(); ++i)
+        {
+            for (uint32_t j = 0; j < a.width(); ++j)
+                ASSERT_EQ(b.get(j, i), int(i * 1000 + j));
+        }
+
+        c.transposeInPlace();
+        EXPECT_EQ(a, c);
+    }
+
+    // Строки с выравниванием: шаг строки больше ширины
+    AlignedMatrix<double> p(45, 45), q(45, 70);
+    for (uint32_t i = 0; i < p.height(); ++i)
+    {
+        for (uint32_t j = 0; j < q.width(); ++j)
+        {
+            if (j < p.width())
+                p.get(i, j) = i - 0.5 * j;
+            q.get(i, j) = i + 0.25 * j;
+        }
+    }
+    auto pt = p;
+    pt.transposeInPlace();
+    auto qt = q.transpose();
+    for (uint32_t i = 0; i < p.height(); ++i)
+    {
+        for (uint32_t j = 0; j < q.width(); ++j)
+        {
+            if (j < p.width())
+            {
+                EXPECT_EQ(pt.get(j, i), p.get(i, j));
+            }
+            EXPECT_EQ(qt.get(j, i), q.get(i, j));
+        }
+    }
+}
+
 TEST(TestFuncs, TestInverse)
 {
     MatrixGeneric<int> bad_1 = {{1, 2, 3, 4, 5}},
@@ -112,3 +317,163 @@ TEST(TestFuncs, TestInverse)
         }
     }
 }
+
+TEST(TestFuncs, TestLUDecomposition)
+{
+    MatrixGeneric<double> a = {{2, 1, 1}, {4, -6, 0}, {-2, 7, 2}},
+                          b = {{5, 1}, {-2, 0}, {9, 3}};
+    LUDecomposition<double> lu(a);
+
+    EXPECT_FALSE(lu.isSingular());
+    EXPECT_NEAR(lu.det(), a.det(), 1e-12);
+    EXPECT_NEAR(lu.det(), -16, 1e-12);
+
+    auto x = lu.solve(b), ax = a * x;
+    for (uint32_t i = 0; i < b.height(); ++i)
+    {
+        for (uint32_t j = 0; j < b.width(); ++j)
+        {
+            EXPECT_NEAR(ax.get(i, j), b.get(i, j), 1e-12);
+        }
+    }
+
+    EXPECT_THROW(lu.solve(MatrixGeneric<double>::eye(2)), matrix_bad_operation);
+    EXPECT_THROW(LUDecomposition<int>(MatrixGeneric<int>(2, 3)),
+                 matrix_bad_operation);
+
+    LUDecomposition<int> singular(MatrixGeneric<int>{{1, 2}, {2, 4}});
+    EXPECT_TRUE(singular.isSingular());
+    EXPECT_EQ(singular.det(), 0);
+    EXPECT_THROW(singular.inverse(), matrix_bad_inverse);
+    EXPECT_THROW(singular.solve(MatrixGeneric<int>::eye(2)),
+                 matrix_bad_operation);
+
+    // Разложение и решение системы для представлений: транспонированная
+    // матрица и столбец правых частей
+    LUDecomposition<double> luT(a.transposeView());
+    EXPECT_NEAR(luT.det(), -16, 1e-12);
+    auto xCol = luT.solve(b.col(1)), check = a.transposeView() * xCol;
+    for (uint32_t i = 0; i < b.height(); ++i)
+        EXPECT_NEAR(check.get(i, 0), b.get(i, 1), 1e-12);
+}
+
+TEST(TestFuncs, TestInverseLarge)
+{
+    // Обращение 200x200 через LU-разложение. Матрица с диагональным
+    // преобладанием, так что обусловленность хорошая
+    const uint32_t n = 200;
+    MatrixGeneric<double> a(n, n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t j = 0; j < n; ++j)
+        {
+            a.get(i, j) = (i == j) ? n : double((i * 7 + j * 3) % 11) - 5;
+        }
+    }
+
+    auto e = a * a.inverse();
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t j = 0; j < n; ++j)
+        {
+            EXPECT_NEAR(e.get(i, j), i == j ? 1 : 0, 1e-12);
+        }
+    }
+}
+
+TEST(TestFuncs, TestSolve)
+{
+    // 150 уравнений с 40 правыми частями: прямой и обратный ход идут блоками
+    // строк. Каждый столбец решения должен совпадать с решением системы с
+    // одной правой частью, которое считается построчной подстановкой
+    const uint32_t n = 150, k = 40;
+    MatrixGeneric<double> a(n, n), b(n, k);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t j = 0; j < n; ++j)
+            a.get(i, j) = (i == j) ? n : double((i * 7 + j * 3) % 11) - 5;
+        for (uint32_t j = 0; j < k; ++j)
+            b.get(i, j) = double((i * 5 + j * 13) % 17) - 8;
+    }
+
+    auto x = solve(a, b), ax = a * x;
+    ASSERT_EQ(x.height(), n);
+    ASSERT_EQ(x.width(), k);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t j = 0; j < k; ++j)
+            EXPECT_NEAR(ax.get(i, j), b.get(i, j), 1e-10);
+    }
+
+    LUDecomposition<double> lu(a);
+    for (uint32_t j = 0; j < k; j += 13)
+    {
+        auto column = lu.solve(b.col(j));
+        for (uint32_t i = 0; i < n; ++i)
+            EXPECT_NEAR(column.get(i, 0), x.get(i, j), 1e-12);
+    }
+
+    // Целые матрицы решаются в float, как и при делении
+    MatrixGeneric<int> ai = {{2, 1}, {1, 3}}, bi = {{3}, {5}};
+    MatrixGeneric<float> xi = solve(ai, bi);
+    EXPECT_NEAR(xi.get(0, 0), 0.8f, 1e-6);
+    EXPECT_NEAR(xi.get(1, 0), 1.4f, 1e-6);
+
+    EXPECT_THROW(solve(MatrixGeneric<double>(2, 3), MatrixGeneric<double>(2, 1)),
+                 matrix_bad_operation);
+    EXPECT_THROW(solve(a, MatrixGeneric<double>(n - 1, 1)),
+                 matrix_bad_operation);
+    EXPECT_THROW(solve(MatrixGeneric<int>{{1, 2}, {2, 4}}, bi),
+                 matrix_bad_operation);
+}
+
+TEST(TestFuncs, TestPow)
+{
+    MatrixGeneric<int> a = {{1, 1, 0}, {1, 0, 2}, {0, -1, 1}};
+    MatrixGeneric<int> expected = MatrixGeneric<int>::eye(3);
+    for (uint32_t p = 0; p < 20; ++p)
+    {
+        EXPECT_EQ(a.pow(p), expected) << "power " << p;
+        expected = expected * a;
+    }
+    EXPECT_THROW(MatrixGeneric<int>(2, 3).pow(2), matrix_bad_pow);
+
+    // Стохастическая матрица цепи Маркова остается стохастической в любой
+    // степени
+    MatrixGeneric<double> markov = {{0.9, 0.1, 0}, {0.2, 0.7, 0.1}, {0, 0.3, 0.7}};
+    auto stationary = markov.pow(100000);
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        double sum = 0;
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            sum += stationary.get(i, j);
+            EXPECT_NEAR(stationary.get(i, j), stationary.get(0, j), 1e-9);
+        }
+        EXPECT_NEAR(sum, 1, 1e-9);
+    }
+}
+
+TEST(TestFuncs, TestPowSymmetric)
+{
+    MatrixGeneric<double> a = {{2, -1, 0, 0.5},
+                               {-1, 2, -1, 0},
+                               {0, -1, 2, 1},
+                               {0.5, 0, 1, 1}};
+    for (uint32_t p : {0u, 1u, 2u, 5u, 13u})
+    {
+        auto fast = a.powSymmetric(p), exact = a.pow(p);
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                EXPECT_NEAR(fast.get(i, j), exact.get(i, j),
+                            1e-9 * (1 + std::abs(exact.get(i, j))))
+                    << "power " << p;
+            }
+        }
+    }
+
+    MatrixGeneric<double> nonSymmetric = {{1, 2}, {3, 4}};
+    EXPECT_THROW(nonSymmetric.powSymmetric(2), matrix_bad_pow);
+}
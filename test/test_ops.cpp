@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <FixedMatrix.hpp>
 #include <MatrixGeneric.hpp>
+#include <SparseMatrix.hpp>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 TEST(TestOps, TestAddition)
 {
@@ -65,4 +72,463 @@ TEST(TestOps, TestDivision)
                 EXPECT_NEAR(testCase.get(i, j), 0, 10e-6);
         }
     }
+
+    // Частное прямоугольной матрицы: X * b == a
+    MatrixGeneric<double> c = {{1, 0, 2}, {-3, 4, 1}},
+                          b = {{2, 1, 0}, {1, 3, 1}, {0, 1, 4}};
+    auto x = c / b, xb = x * b;
+    ASSERT_EQ(x.height(), 2u);
+    ASSERT_EQ(x.width(), 3u);
+    for (uint32_t i = 0; i < c.height(); ++i)
+    {
+        for (uint32_t j = 0; j < c.width(); ++j)
+            EXPECT_NEAR(xb.get(i, j), c.get(i, j), 1e-12);
+    }
+
+    // Ленивые операнды вычисляются и делятся так же
+    EXPECT_EQ(MatrixGeneric<double>((c + c) / b),
+              MatrixGeneric<double>(2.0 * c) / b);
+    EXPECT_EQ(MatrixGeneric<double>(c.block(0, 0, 2, 3) / b), x);
+
+    EXPECT_THROW(c / c, matrix_bad_operation);
+    EXPECT_THROW(b / c.block(0, 0, 2, 2), matrix_bad_operation);
+    EXPECT_THROW(c / MatrixGeneric<double>({{1, 2, 3}, {2, 4, 6}, {0, 0, 1}}),
+                 matrix_bad_inverse);
+}
+
+template <typename T>
+MatrixGeneric<T> generateMatrix(uint32_t height, uint32_t width, int seed)
+{
+    MatrixGeneric<T> out(height, width);
+    for (uint32_t i = 0; i < height; ++i)
+    {
+        for (uint32_t j = 0; j < width; ++j)
+        {
+            out.get(i, j) = static_cast<T>((i * 31 + j * 17 + seed) % 19) - 9;
+        }
+    }
+    return out;
+}
+
+TEST(TestOps, TestMultiplicationBlockedMatchesReference)
+{
+    // Блочное ядро должно совпадать с умножением по определению на размерах,
+    // которые не кратны регистровым тайлам и пересекают границы блоков
+    const uint32_t shapes[][3] = {{1, 1, 1},     {3, 5, 7},   {4, 8, 8},
+                                  {5, 9, 13},    {17, 1, 33}, {130, 257, 9},
+                                  {129, 300, 11}, {2, 3, 2050}};
+
+    for (auto &shape : shapes)
+    {
+        auto a = generateMatrix<int>(shape[0], shape[1], 1);
+        auto b = generateMatrix<int>(shape[1], shape[2], 2);
+        EXPECT_EQ(a * b, detail::multiplyReference(a, b))
+            << shape[0] << "x" << shape[1] << " * " << shape[1] << "x"
+            << shape[2];
+
+        auto ad = generateMatrix<double>(shape[0], shape[1], 3);
+        auto bd = generateMatrix<double>(shape[1], shape[2], 4);
+        auto fast = ad * bd, ref = detail::multiplyReference(ad, bd);
+        for (uint32_t i = 0; i < fast.height(); ++i)
+        {
+            for (uint32_t j = 0; j < fast.width(); ++j)
+            {
+                EXPECT_NEAR(fast.get(i, j), ref.get(i, j), 1e-9);
+            }
+        }
+    }
+
+    // Разные типы операндов приводятся к типу результата
+    auto a = generateMatrix<int>(7, 6, 5);
+    auto b = generateMatrix<float>(6, 9, 6);
+    EXPECT_EQ(a * b, detail::multiplyReference(a, b));
+}
+
+TEST(TestOps, TestStrassen)
+{
+    // Целые числа складываются и вычитаются точно, поэтому результат должен
+    // совпадать с обычным умножением при любых размерах, в том числе нечетных
+    // и прямоугольных, и при глубокой рекурсии
+    for (auto shape : std::vector<std::array<uint32_t, 3>>{
+             {64, 64, 64}, {67, 45, 83}, {33, 100, 9}, {2, 2, 2}, {5, 3, 1}})
+    {
+        SCOPED_TRACE(::testing::Message()
+                     << shape[0] << "x" << shape[1] << " * " << shape[1] << "x"
+                     << shape[2]);
+        auto a = generateMatrix<int>(shape[0], shape[1], 1);
+        auto b = generateMatrix<int>(shape[1], shape[2], 2);
+        for (uint32_t crossover : {1u, 4u, 16u})
+            EXPECT_EQ(multiplyStrassen(a, b, crossover),
+                      detail::multiplyReference(a, b));
+    }
+
+    // Рост погрешности: каждый уровень рекурсии ухудшает оценку ошибки
+    // примерно в 3 раза, так что на глубине d ошибка не должна превосходить
+    // 4^d ошибок округления обычного умножения
+    const uint32_t n = 150;
+    MatrixGeneric<double> a(n, n + 3), b(n + 3, n - 1);
+    MatrixGeneric<long double> al(n, n + 3), bl(n + 3, n - 1);
+    uint64_t state = 1;
+    auto random = [&state]()
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return double(state >> 11) / double(uint64_t(1) << 53) * 2 - 1;
+    };
+    for (uint32_t i = 0; i < n; ++i)
+        for (uint32_t j = 0; j < n + 3; ++j)
+            al.get(i, j) = a.get(i, j) = random();
+    for (uint32_t i = 0; i < n + 3; ++i)
+        for (uint32_t j = 0; j < n - 1; ++j)
+            bl.get(i, j) = b.get(i, j) = random();
+    auto exact = detail::multiplyReference(al, bl);
+    auto error = [&exact](const MatrixGeneric<double> &c)
+    {
+        long double out = 0;
+        for (uint32_t i = 0; i < c.height(); ++i)
+            for (uint32_t j = 0; j < c.width(); ++j)
+                out = std::max(out, std::fabs(exact.get(i, j) - c.get(i, j)));
+        return double(out);
+    };
+
+    const double unit = n * std::numeric_limits<double>::epsilon();
+    EXPECT_LE(error(a * b), unit);
+    double bound = unit;
+    for (uint32_t crossover : {n - 1, 64u, 32u, 16u, 8u})
+    {
+        bound *= 4;
+        EXPECT_LE(error(multiplyStrassen(a, b, crossover)), bound)
+            << "crossover " << crossover;
+    }
+
+    // operator*() переходит на алгоритм по порогу, в том числе для
+    // представлений и операндов разных типов
+    auto af = generateMatrix<float>(40, 37, 3);
+    auto bi = generateMatrix<int>(41, 37, 4);
+    setStrassenCrossover(8);
+    EXPECT_EQ(strassenCrossover(), 8u);
+    auto viaOperator = af * bi.transposeView();
+    setStrassenCrossover(0);
+    auto classic = af * bi.transposeView();
+    EXPECT_EQ(viaOperator.height(), 40u);
+    EXPECT_EQ(viaOperator.width(), 41u);
+    for (uint32_t i = 0; i < classic.height(); ++i)
+        for (uint32_t j = 0; j < classic.width(); ++j)
+            EXPECT_NEAR(viaOperator.get(i, j), classic.get(i, j), 1e-3);
+
+    EXPECT_THROW(multiplyStrassen(a, a), matrix_bad_operation);
+}
+
+template <typename T> void checkSimdKernels(detail::simd::Level level)
+{
+    // Длина не кратна ширине ни одного из регистров, чтобы проверить хвосты
+    const std::size_t n = 103;
+    std::vector<T> a(n), b(n), out(n), expected(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        a[i] = static_cast<T>(int(i * 7 % 23) - 11);
+        b[i] = static_cast<T>(int(i * 5 % 17) - 3);
+    }
+
+    detail::simd::add(a.data(), b.data(), out.data(), n, level);
+    detail::simd::addScalar(a.data(), b.data(), expected.data(), n);
+    EXPECT_EQ(out, expected);
+
+    detail::simd::sub(a.data(), b.data(), out.data(), n, level);
+    detail::simd::subScalar(a.data(), b.data(), expected.data(), n);
+    EXPECT_EQ(out, expected);
+
+    detail::simd::scale(T(3), a.data(), out.data(), n, level);
+    detail::simd::scaleScalar(T(3), a.data(), expected.data(), n);
+    EXPECT_EQ(out, expected);
+
+    EXPECT_TRUE(detail::simd::equal(a.data(), a.data(), n, level));
+    for (std::size_t pos : {std::size_t(0), std::size_t(17), n - 1})
+    {
+        auto c = a;
+        c[pos] += T(1);
+        EXPECT_FALSE(detail::simd::equal(a.data(), c.data(), n, level))
+            << "mismatch at " << pos;
+    }
+}
+
+TEST(TestOps, TestSimdKernelsMatchScalar)
+{
+    // Каждый набор инструкций должен давать тот же результат, что и скалярный
+    // цикл. Недоступные процессору наборы заменяются лучшим доступным
+    using detail::simd::Level;
+    for (auto level : {Level::Scalar, Level::SSE2, Level::AVX2, Level::AVX512})
+    {
+        checkSimdKernels<float>(level);
+        checkSimdKernels<double>(level);
+        checkSimdKernels<int>(level);
+        checkSimdKernels<long long>(level);
+    }
+
+    MatrixGeneric<double> nan = {{0.0 / 0.0}};
+    EXPECT_NE(nan, nan) << "NaN isn't equal to itself";
+}
+
+TEST(TestOps, TestExpressionTemplates)
+{
+    auto a = generateMatrix<int>(9, 11, 1);
+    auto b = generateMatrix<int>(9, 11, 2);
+    auto c = generateMatrix<double>(9, 11, 3);
+
+    // Типы элементов совпадают с типами неленивых операций
+    static_assert(std::is_same<decltype(a + b)::value_type, int>::value, "");
+    static_assert(
+        std::is_same<decltype(2.0f * (a - b))::value_type, float>::value, "");
+    static_assert(std::is_same<decltype(a + b - c)::value_type, double>::value,
+                  "");
+
+    MatrixGeneric<double> fused = 2 * (a + b) - 0.5 * c;
+    for (uint32_t i = 0; i < a.height(); ++i)
+    {
+        for (uint32_t j = 0; j < a.width(); ++j)
+        {
+            double expected = 2 * (a.get(i, j) + b.get(i, j)) - 0.5 * c.get(i, j);
+            EXPECT_EQ(fused.get(i, j), expected) << i << " " << j;
+            EXPECT_EQ((2 * (a + b) - 0.5 * c).get(i, j), expected);
+        }
+    }
+
+    // Размеры проверяются при построении выражения на любой глубине
+    EXPECT_THROW(a + b - MatrixGeneric<int>::eye(3), matrix_bad_operation);
+    EXPECT_THROW(a - 2 * MatrixGeneric<int>::eye(3), matrix_bad_operation);
+    EXPECT_THROW((a + b).get(9, 0), matrix_bad_access);
+
+    // Временные операнды хранятся в выражении по значению
+    auto withTemporary = a + generateMatrix<int>(9, 11, 2);
+    EXPECT_EQ(withTemporary, a + b);
+
+    // Присваивание в операнд выражения
+    MatrixGeneric<int> acc = a;
+    acc = acc + b;
+    acc = acc - b;
+    EXPECT_EQ(acc, a);
+    acc = 3 * MatrixGeneric<int>::eye(4);
+    EXPECT_EQ(acc.height(), 4u);
+    EXPECT_EQ(acc.det(), 81);
+
+    // Операции, которым нужна готовая матрица, вычисляют выражение
+    auto bt = b.transpose();
+    EXPECT_EQ((a + a) * bt, 2 * (a * bt));
+    EXPECT_EQ((a - b).transpose(), a.transpose() - bt);
+}
+
+TEST(TestOps, TestMatrixView)
+{
+    auto a = generateMatrix<int>(6, 7, 1);
+
+    // Блоки, строки и столбцы ссылаются на элементы исходной матрицы
+    auto blk = a.block(1, 2, 3, 4);
+    EXPECT_EQ(blk.height(), 3u);
+    EXPECT_EQ(blk.width(), 4u);
+    EXPECT_EQ(&blk.get(0, 0), &a.get(1, 2));
+    EXPECT_EQ(blk.get(2, 3), a.get(3, 5));
+    EXPECT_EQ(a.row(4).get(0, 6), a.get(4, 6));
+    EXPECT_EQ(a.col(3).get(5, 0), a.get(5, 3));
+    EXPECT_THROW(a.block(4, 0, 3, 1), matrix_bad_access);
+    EXPECT_THROW(blk.get(3, 0), matrix_bad_access);
+    EXPECT_THROW(a.row(6), matrix_bad_access);
+
+    // Ленивое транспонирование совпадает с обычным
+    EXPECT_EQ(a.transposeView(), a.transpose());
+    EXPECT_EQ(a.transposeView().transposeView(), a);
+    EXPECT_EQ(blk.transposeView(), blk.transpose());
+
+    // Представления участвуют в поэлементных операциях и умножении
+    auto b = generateMatrix<int>(3, 4, 2);
+    MatrixGeneric<int> sum = blk + 2 * b;
+    for (uint32_t i = 0; i < 3; ++i)
+        for (uint32_t j = 0; j < 4; ++j)
+            EXPECT_EQ(sum.get(i, j), a.get(i + 1, j + 2) + 2 * b.get(i, j));
+
+    MatrixGeneric<int> blkCopy = blk;
+    EXPECT_EQ(blk * b.transposeView(), blkCopy * b.transpose());
+    EXPECT_EQ(a.transposeView() * a, detail::multiplyReference(a.transpose(), a));
+    EXPECT_THROW(blk * b, matrix_bad_operation);
+
+    auto ad = generateMatrix<double>(40, 40, 3);
+    auto lhs = ad.block(3, 5, 20, 30), rhs = ad.block(7, 1, 30, 25);
+    auto fast = lhs * rhs, ref = detail::multiplyReference(lhs, rhs);
+    for (uint32_t i = 0; i < fast.height(); ++i)
+        for (uint32_t j = 0; j < fast.width(); ++j)
+            EXPECT_NEAR(fast.get(i, j), ref.get(i, j), 1e-9);
+
+    // Алгоритмы принимают представления
+    auto square = ad.block(2, 2, 10, 10);
+    EXPECT_NEAR(square.det(), MatrixGeneric<double>(square).det(), 1e-6);
+    // Блок в углу ad вырожден, деление на него - ошибка
+    EXPECT_NEAR((ad.block(1, 3, 5, 5) / ad.block(1, 3, 5, 5)).get(2, 2), 1,
+                1e-9);
+    EXPECT_THROW(ad.block(0, 0, 5, 5) / ad.block(0, 0, 5, 5),
+                 matrix_bad_inverse);
+
+    // Запись через представление меняет исходную матрицу
+    a.block(0, 0, 2, 2).assign(MatrixGeneric<int>::eye(2));
+    EXPECT_EQ(a.get(0, 0), 1);
+    EXPECT_EQ(a.get(0, 1), 0);
+    a.col(6).assign(3 * a.col(5));
+    for (uint32_t i = 0; i < a.height(); ++i)
+        EXPECT_EQ(a.get(i, 6), 3 * a.get(i, 5));
+    EXPECT_THROW(a.row(0).assign(a.col(0)), matrix_bad_operation);
+}
+
+template <uint32_t N> void checkFixedDetInverse(int seed)
+{
+    // Диагональное преобладание, чтобы матрица была обратима
+    auto g = generateMatrix<double>(N, N, seed);
+    for (uint32_t i = 0; i < N; ++i)
+        g.get(i, i) += 40;
+    FixedMatrix<double, N, N> f(g);
+
+    EXPECT_NEAR(f.det(), g.det(), 1e-9 * std::abs(g.det())) << N;
+    auto inv = f.inverse();
+    MatrixGeneric<double> ref = g.inverse();
+    for (uint32_t i = 0; i < N; ++i)
+        for (uint32_t j = 0; j < N; ++j)
+            EXPECT_NEAR(inv.get(i, j), ref.get(i, j), 1e-12) << N;
+
+    auto gi = generateMatrix<int>(N, N, seed);
+    EXPECT_EQ((FixedMatrix<int, N, N>(gi).det()), gi.det()) << N;
+}
+
+TEST(TestOps, TestFixedMatrix)
+{
+    FixedMatrix<int, 2, 3> a = {{1, 2, 3}, {4, 5, 6}};
+    EXPECT_EQ(a.height(), 2u);
+    EXPECT_EQ(a.width(), 3u);
+    EXPECT_EQ(a.get(1, 2), 6);
+    EXPECT_THROW(a.get(2, 0), matrix_bad_access);
+    EXPECT_EQ((FixedMatrix<int, 2, 2>()), MatrixGeneric<int>(2, 2));
+    EXPECT_THROW((FixedMatrix<int, 2, 2>{{1, 2}}), matrix_initialization_error);
+    EXPECT_THROW((FixedMatrix<int, 2, 2>{{1, 2}, {3}}),
+                 matrix_initialization_error);
+    // MatrixGeneric преобразуется только явно, выражения - неявно
+    static_assert(!std::is_convertible<MatrixGeneric<int>,
+                                       FixedMatrix<int, 2, 2>>::value,
+                  "MatrixGeneric -> FixedMatrix must be explicit");
+    static_assert(
+        std::is_convertible<decltype(MatrixGeneric<int>() + MatrixGeneric<int>()),
+                            FixedMatrix<int, 2, 2>>::value,
+        "expressions convert to FixedMatrix implicitly");
+
+    // Произведение - FixedMatrix того же типа, что и у MatrixGeneric
+    auto ga = generateMatrix<int>(2, 3, 1), gb = generateMatrix<int>(3, 4, 2);
+    FixedMatrix<int, 2, 3> fa(ga);
+    FixedMatrix<int, 3, 4> fb(gb);
+    auto fab = fa * fb;
+    static_assert(std::is_same<decltype(fab), FixedMatrix<int, 2, 4>>::value,
+                  "Product of fixed matrices must be a fixed matrix");
+    EXPECT_EQ(fab, ga * gb);
+
+    auto g5 = generateMatrix<double>(5, 5, 3), h5 = generateMatrix<double>(5, 5, 4);
+    FixedMatrix<double, 5, 5> f5(g5), k5(h5);
+    EXPECT_EQ(f5 * k5, g5 * h5);
+    EXPECT_EQ(f5.pow(5), g5.pow(5));
+    EXPECT_EQ(f5.pow(0), MatrixGeneric<double>::eye(5));
+    EXPECT_EQ(f5.transpose(), g5.transpose());
+
+    // Совместная работа с MatrixGeneric и ленивыми выражениями
+    EXPECT_EQ(fa * gb, ga * gb);
+    EXPECT_EQ(ga * fb, ga * gb);
+    EXPECT_THROW(fa * ga, matrix_bad_operation);
+    MatrixGeneric<int> generic = fa;
+    EXPECT_EQ(generic, ga);
+
+    FixedMatrix<int, 2, 3> sum = fa + 2 * ga - fa;
+    EXPECT_EQ(sum, MatrixGeneric<int>(2 * ga));
+    sum = sum - fa;
+    EXPECT_EQ(sum, ga);
+    EXPECT_THROW((FixedMatrix<int, 3, 2>(fa + ga)), matrix_bad_operation);
+    EXPECT_THROW((FixedMatrix<int, 3, 3>(ga)), matrix_bad_operation);
+    EXPECT_EQ((FixedMatrix<double, 2, 3>(fa)), ga);
+
+    // Определитель и обращение в замкнутом виде и через MatrixGeneric
+    checkFixedDetInverse<1>(5);
+    checkFixedDetInverse<2>(6);
+    checkFixedDetInverse<3>(7);
+    checkFixedDetInverse<4>(8);
+    checkFixedDetInverse<6>(9);
+
+    FixedMatrix<int, 3, 3> singular = {{1, 2, 3}, {2, 4, 6}, {1, 1, 1}};
+    EXPECT_EQ(singular.det(), 0);
+    EXPECT_THROW(singular.inverse(), matrix_bad_inverse);
+    FixedMatrix<double, 2, 2> rot = {{0, -1}, {1, 0}};
+    EXPECT_EQ(rot * rot.inverse(), (FixedMatrix<double, 2, 2>::eye()));
+    EXPECT_EQ(rot / rot, (FixedMatrix<double, 2, 2>::eye()));
+}
+
+TEST(TestOps, TestSparseMatrix)
+{
+    // Повторяющиеся координаты складываются, нулевые суммы не хранятся
+    auto a = SparseMatrix<int>::fromTriplets(
+        3, 4, {{2, 1, 5}, {0, 3, 1}, {0, 0, 2}, {2, 1, 1}, {1, 2, 4}, {1, 2, -4}});
+    MatrixGeneric<int> da = {{2, 0, 0, 1}, {0, 0, 0, 0}, {0, 6, 0, 0}};
+    EXPECT_EQ(a.nonZeros(), 3);
+    EXPECT_EQ(a.toDense(), da);
+    EXPECT_EQ(a.get(2, 1), 6);
+    EXPECT_EQ(a.get(1, 1), 0);
+    EXPECT_THROW(a.get(3, 0), matrix_bad_access);
+    EXPECT_THROW(SparseMatrix<int>::fromTriplets(2, 2, {{2, 0, 1}}),
+                 matrix_bad_access);
+    EXPECT_EQ(SparseMatrix<int>(da), a);
+
+    // CSC и транспонирование
+    auto csc = a.toCsc();
+    EXPECT_EQ(csc.colPtr, (std::vector<uint32_t>{0, 1, 2, 2, 3}));
+    EXPECT_EQ(csc.rowIdx, (std::vector<uint32_t>{0, 2, 0}));
+    EXPECT_EQ(SparseMatrix<int>(csc), a);
+    EXPECT_EQ(a.transpose().toDense(), da.transpose());
+    EXPECT_THROW(SparseMatrix<int>(2, 2, {0, 2, 1}, {0, 1}, {1, 1}),
+                 matrix_initialization_error);
+    // Убывающий rowPtr с верным последним элементом
+    EXPECT_THROW(SparseMatrix<double>(2, 3, {0, 5, 2}, {0, 1}, {1, 2}),
+                 matrix_initialization_error);
+    EXPECT_THROW(SparseMatrix<double>(CscStorage<double>{
+                     3, 2, {0, 5, 2}, {0, 1}, {1, 2}}),
+                 matrix_initialization_error);
+
+    // Поэлементные операции
+    MatrixGeneric<int> db = {{-2, 1, 0, 0}, {0, 0, 3, 0}, {0, 0, 0, 7}};
+    SparseMatrix<int> b(db);
+    EXPECT_EQ((a + b).toDense(), MatrixGeneric<int>(da + db));
+    EXPECT_EQ((a - b).toDense(), MatrixGeneric<int>(da - db));
+    EXPECT_EQ((a + b).nonZeros(), 5);
+    EXPECT_EQ(a + db, MatrixGeneric<int>(da + db));
+    EXPECT_EQ(da - b, MatrixGeneric<int>(da - db));
+    EXPECT_EQ(a - db, MatrixGeneric<int>(da - db));
+    EXPECT_EQ((3 * a).toDense(), MatrixGeneric<int>(3 * da));
+    EXPECT_EQ((a * 0).nonZeros(), 0);
+    EXPECT_THROW(a + a.transpose(), matrix_bad_operation);
+
+    // Произведения с плотными и разреженными матрицами
+    MatrixGeneric<int> x = {{1, 2}, {3, 4}, {5, 6}, {7, 8}};
+    EXPECT_EQ(a * x, da * x);
+    EXPECT_EQ(db.transpose() * a, db.transpose() * da);
+    EXPECT_EQ((a * b.transpose()).toDense(), da * db.transpose());
+    EXPECT_EQ((a.transpose() * b).toDense(), da.transpose() * db);
+    EXPECT_THROW(a * b, matrix_bad_operation);
+    EXPECT_THROW(a * da, matrix_bad_operation);
+
+    // Взаимно уничтожившиеся слагаемые не хранятся
+    SparseMatrix<int> row(MatrixGeneric<int>{{1, 1}}),
+        col(MatrixGeneric<int>{{1}, {-1}});
+    SparseMatrix<int> zero = row * col;
+    EXPECT_EQ(zero.nonZeros(), 0u);
+    EXPECT_EQ(zero, SparseMatrix<int>(1, 1));
+
+    // Большая случайная матрица: SpGEMM и SpMV совпадают с плотным умножением
+    std::vector<Triplet<double>> triplets;
+    for (uint32_t k = 0; k < 3000; ++k)
+        triplets.push_back({k * 7919 % 400, k * 104729 % 300,
+                            double(k % 13) - 6});
+    auto s = SparseMatrix<double>::fromTriplets(400, 300, triplets);
+    MatrixGeneric<double> ds = s.toDense();
+    EXPECT_EQ((s * s.transpose()).toDense(), ds * ds.transpose());
+    MatrixGeneric<double> v(300, 1);
+    for (uint32_t i = 0; i < 300; ++i)
+        v.get(i, 0) = i % 5;
+    EXPECT_EQ(s * v, ds * v);
 }
@@ -0,0 +1,124 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "MatrixGeneric.hpp"
+#include "SparseMatrix.hpp"
+#include "ThreadPool.hpp"
+
+// Test suite для пула потоков и параллельных алгоритмов
+
+TEST(TestParallel, ParallelForCoversRange)
+{
+    // Каждый индекс должен быть обработан ровно один раз
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> hits(1000);
+    for (auto &h : hits)
+        h = 0;
+
+    pool.parallelFor(0, 1000, 7,
+                     [&hits](uint32_t lo, uint32_t hi)
+                     {
+                         for (uint32_t i = lo; i < hi; ++i)
+                             hits[i]++;
+                     });
+
+    for (auto &h : hits)
+        EXPECT_EQ(h.load(), 1);
+}
+
+TEST(TestParallel, NestedParallelFor)
+{
+    // Вложенный parallelFor исполняется на тех же потоках и не зависает
+    ThreadPool pool(3);
+    std::atomic<int> sum{0};
+    pool.parallelFor(0, 8, 1,
+                     [&](uint32_t lo, uint32_t hi)
+                     {
+                         for (uint32_t i = lo; i < hi; ++i)
+                         {
+                             pool.parallelFor(0, 100, 10,
+                                              [&](uint32_t l, uint32_t h)
+                                              { sum += h - l; });
+                         }
+                     });
+    EXPECT_EQ(sum.load(), 800);
+}
+
+TEST(TestParallel, ParallelForPropagatesException)
+{
+    ThreadPool pool(4);
+    EXPECT_THROW(pool.parallelFor(0, 100, 1,
+                                  [](uint32_t lo, uint32_t hi)
+                                  {
+                                      if (lo <= 50 && 50 < hi)
+                                          throw std::runtime_error("task");
+                                  }),
+                 std::runtime_error);
+}
+
+TEST(TestParallel, ParallelMultiplicationMatchesSerial)
+{
+    // Параллельное умножение раскладывает блоки C по потокам, результат
+    // должен совпадать с однопоточным
+    auto fill = [](uint32_t h, uint32_t w, int seed)
+    {
+        MatrixGeneric<long long> m(h, w);
+        for (uint32_t i = 0; i < h; ++i)
+            for (uint32_t j = 0; j < w; ++j)
+                m.get(i, j) = int((i * 13 + j * 7 + seed) % 21) - 10;
+        return m;
+    };
+
+    for (auto shape : {std::vector<uint32_t>{300, 270, 310},
+                       std::vector<uint32_t>{70, 600, 90}})
+    {
+        auto a = fill(shape[0], shape[1], 1), b = fill(shape[1], shape[2], 2);
+
+        ThreadPool::setGlobalThreads(1);
+        auto serial = a * b;
+        ThreadPool::setGlobalThreads(4);
+        auto parallel = a * b;
+        EXPECT_EQ(serial, parallel);
+        EXPECT_EQ(parallel, detail::multiplyReference(a, b));
+    }
+
+    MatrixGeneric<double> m(300, 300);
+    for (uint32_t i = 0; i < 300; ++i)
+        for (uint32_t j = 0; j < 300; ++j)
+            m.get(i, j) = i == j ? 300 : double((i + 2 * j) % 7) - 3;
+    auto e = m * m.inverse();
+    for (uint32_t i = 0; i < 300; ++i)
+        for (uint32_t j = 0; j < 300; ++j)
+            EXPECT_NEAR(e.get(i, j), i == j ? 1 : 0, 1e-12);
+
+    ThreadPool::setGlobalThreads(ThreadPool::defaultThreads());
+}
+
+TEST(TestParallel, ParallelSparseMatchesSerial)
+{
+    // Строки разреженных произведений делятся между потоками, результат
+    // должен совпадать с однопоточным
+    std::vector<Triplet<long long>> triplets;
+    for (uint32_t k = 0; k < 20000; ++k)
+        triplets.push_back({k * 7919 % 2000, k * 104729 % 1500,
+                            (long long)(k % 21) - 10});
+    auto a = SparseMatrix<long long>::fromTriplets(2000, 1500, triplets);
+    MatrixGeneric<long long> x(1500, 40);
+    for (uint32_t i = 0; i < 1500; ++i)
+        for (uint32_t j = 0; j < 40; ++j)
+            x.get(i, j) = int((i * 3 + j) % 11) - 5;
+    MatrixGeneric<long long> y = x.transpose();
+
+    ThreadPool::setGlobalThreads(1);
+    auto serialSparse = a.transpose() * a;
+    auto serialRight = a * x;
+    auto serialLeft = y * a.transpose();
+    ThreadPool::setGlobalThreads(4);
+    EXPECT_EQ(a.transpose() * a, serialSparse);
+    EXPECT_EQ(a * x, serialRight);
+    EXPECT_EQ(y * a.transpose(), serialLeft);
+    EXPECT_EQ((a * x).transpose(), serialLeft);
+
+    ThreadPool::setGlobalThreads(ThreadPool::defaultThreads());
+}
@@ -0,0 +1,99 @@
+#include <Calculator.hpp>
+#include <MatrixGeneric.hpp>
+#include <MatrixStats.hpp>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Test suite для счетчиков MatrixStats.hpp. Собирается отдельно от tests:
+// ему нужна замена operator new из src/StatsAlloc.cpp
+
+TEST(TestStats, TestCounters)
+{
+    ASSERT_TRUE(statsEnabled());
+    auto find = [](const std::vector<OperationStats> &ops, const char *name)
+    {
+        for (const OperationStats &op : ops)
+        {
+            if (std::string(op.name) == name)
+                return op;
+        }
+        return OperationStats{nullptr};
+    };
+
+    // Вложенные замеры: пик внешнего включает пик внутреннего
+    resetStats();
+    {
+        StatsScope outer("test.outer", 10);
+        std::vector<char> a(1000);
+        {
+            StatsScope inner("test.inner");
+            std::vector<char> b(5000);
+        }
+        std::vector<char> c(100);
+    }
+    std::vector<OperationStats> ops = statsSnapshot();
+    ASSERT_EQ(ops.size(), 2u);
+    OperationStats inner = find(ops, "test.inner"),
+                   outer = find(ops, "test.outer");
+    EXPECT_EQ(inner.calls, 1u);
+    EXPECT_EQ(inner.allocations, 1u);
+    EXPECT_EQ(inner.bytes, 5000u);
+    EXPECT_EQ(inner.peakBytes, 5000u);
+    EXPECT_EQ(outer.allocations, 3u);
+    EXPECT_EQ(outer.bytes, 6100u);
+    EXPECT_EQ(outer.peakBytes, 6000u);
+    EXPECT_EQ(outer.flops, 10);
+    EXPECT_GE(statsPeakMemory(), 6000u);
+
+    // Этапы калькулятора и операции библиотеки
+    resetStats();
+    MatrixGeneric<float> a = {{4, 7, 1}, {2, 6, 0}, {1, 1, 5}};
+    {
+        std::ofstream file("stats_input.txt");
+        file << "inv\n3 3\n4 7 1\n2 6 0\n1 1 5\n";
+    }
+    std::ostringstream printed;
+    writeResult(printed, calculate<float>("stats_input.txt"),
+                CalculatorOptions());
+    std::remove("stats_input.txt");
+    ops = statsSnapshot();
+    for (const char *name :
+         {"calculator.parse", "calculator.compute", "calculator.print"})
+    {
+        EXPECT_EQ(find(ops, name).calls, 1u) << name;
+    }
+    OperationStats inverse = find(ops, "inverse");
+    EXPECT_EQ(inverse.calls, 1u);
+    EXPECT_DOUBLE_EQ(inverse.flops, 8.0 / 3 * 27);
+    EXPECT_GT(inverse.allocations, 0u);
+    EXPECT_GT(inverse.peakBytes, 0u);
+    EXPECT_LE(inverse.seconds, find(ops, "calculator.compute").seconds);
+
+    MatrixGeneric<float> b = a * a + a;
+    b = a.pow(5) - b;
+    ops = statsSnapshot();
+    EXPECT_EQ(find(ops, "mul").calls, 1u);
+    EXPECT_DOUBLE_EQ(find(ops, "mul").flops, 2.0 * 27);
+    EXPECT_EQ(find(ops, "elementwise").calls, 2u);
+    EXPECT_DOUBLE_EQ(find(ops, "pow").flops, 3 * 2.0 * 27);
+
+    std::ostringstream table, json;
+    printStats(table);
+    printStatsJson(json);
+    EXPECT_NE(table.str().find("calculator.parse"), std::string::npos);
+    EXPECT_NE(table.str().find("peak memory"), std::string::npos);
+    EXPECT_NE(json.str().find("{\"name\": \"inverse\", \"calls\": 1,"),
+              std::string::npos);
+
+    resetStats();
+    EXPECT_TRUE(statsSnapshot().empty());
+
+    // Размер с заголовком не помещается в size_t
+    EXPECT_EQ(detail::statsAllocate(std::size_t(-1)), nullptr);
+    EXPECT_EQ(detail::statsAllocate(std::size_t(-1) - detail::statsHeader + 1),
+              nullptr);
+}
@@ -1,10 +1,15 @@
+#include "MatrixAllocator.hpp"
 #include "MatrixGeneric.hpp"
 #include <functional>
 #include <gtest/gtest.h>
+#include <Batch.hpp>
 #include <Calculator.hpp>
+#include <limits>
 #include <numeric>
+#include <random>
 #include <string>
 #include <unordered_map>
+#include <sys/stat.h>
 #include <vector>
 
 struct Args
@@ -138,6 +143,11 @@ TEST(TestUtil, TestCalcValidBinaryOps)
         Args args("test_suite/valid.txt");
         EXPECT_EQ(Calculator<float>(args.args).getResult(), op.second()); 
     }
+
+    // a вырождена, поэтому система решается с матрицей b
+    generateFileBinaryOp(b, a, "solve", {});
+    Args args("test_suite/valid.txt");
+    EXPECT_EQ(Calculator<float>(args.args).getResult(), solve(b, a));
 }
 
 TEST(TestUtil, TestCalcValidUnaryOps)
@@ -176,3 +186,528 @@ TEST(TestUtil, TestCalcValidPow)
         EXPECT_EQ(Calculator<float>(args.args).getResult(), a.pow(i));
     }
 }
+
+TEST(TestUtil, TestCalcMmap)
+{
+    CalculatorOptions options;
+    options.mmap = true;
+
+    for (std::string bad : {"bobic.txt", "test_suite", "test_suite/badPow.txt",
+                            "test_suite/badAdd.txt",
+                            "test_suite/notCompleteMatrix.txt"})
+    {
+        Args args(bad);
+        EXPECT_ANY_THROW(Calculator<float>(args.args, options)) << bad;
+    }
+
+    MatrixGeneric<float> a = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}},
+                         b = {{1, 0, 1}, {2, 3, 4}, {5, 6, 7}};
+    for (std::string op : {"+", "-", "*", "/"})
+    {
+        generateFileBinaryOp(a, b, op, {});
+        Args args("test_suite/valid.txt");
+        EXPECT_EQ(Calculator<float>(args.args, options).getResult(),
+                  Calculator<float>(args.args).getResult())
+            << op;
+    }
+
+    MatrixGeneric<float> empty;
+    generateFileBinaryOp(a, empty, "pow", {"3"});
+    Args args("test_suite/valid.txt");
+    EXPECT_EQ(Calculator<float>(args.args, options).getResult(), a.pow(3));
+}
+
+TEST(TestUtil, TestCalcBinaryOperands)
+{
+    MatrixGeneric<float> a = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    MatrixGeneric<double> b = {{1, 0, 1}, {2, 3, 4}, {5, 6, 7}};
+    MatrixGeneric<float> expected =
+        a * MatrixGeneric<float>{{1, 0, 1}, {2, 3, 4}, {5, 6, 7}};
+
+    // Первый операнд текстом, второй - в двоичном виде, и оба в двоичном
+    for (bool textFirst : {true, false})
+    {
+        {
+            std::ofstream file("test_suite/valid.txt", std::ios::binary);
+            file << "*\n";
+            if (textFirst)
+                file << "3 3\n1 2 3\n4 5 6\n7 8 9\n";
+            else
+                a.save(file);
+            b.save(file);
+        }
+
+        for (bool mmap : {false, true})
+        {
+            CalculatorOptions options;
+            options.mmap = mmap;
+            Args args("test_suite/valid.txt");
+            EXPECT_EQ(Calculator<float>(args.args, options).getResult(),
+                      expected);
+        }
+    }
+
+    // Оборванная двоичная матрица
+    {
+        std::ofstream file("test_suite/valid.txt", std::ios::binary);
+        file << "t\n";
+        a.save(file);
+    }
+    std::string bytes;
+    {
+        std::ifstream file("test_suite/valid.txt", std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    {
+        std::ofstream file("test_suite/valid.txt", std::ios::binary);
+        file << bytes.substr(0, bytes.size() - 1);
+    }
+    Args args("test_suite/valid.txt");
+    EXPECT_ANY_THROW(Calculator<float>(args.args));
+}
+
+TEST(TestUtil, TestCalcSparseOperands)
+{
+    MatrixGeneric<float> a = {{1, 0, 0}, {0, 0, 2}, {0, 3, 0}},
+                         b = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    const char *sparseA = "coo\n3 3 3\n0 0 1\n2 1 3\n1 2 2\n";
+    const char *sparseB =
+        "coo 3 3 9 0 0 1 0 1 2 0 2 3 1 0 4 1 1 5 1 2 6 2 0 7 2 1 8 2 2 9";
+    const char *denseB = "3 3\n1 2 3\n4 5 6\n7 8 9\n";
+
+    struct Case
+    {
+        std::string op, first, second;
+        MatrixGeneric<float> expected;
+        bool sparse;
+    };
+    std::vector<Case> cases = {
+        {"*", sparseA, sparseB, a * b, true},
+        {"*", sparseA, denseB, a * b, false},
+        {"*", denseB, sparseA, b * a, false},
+        {"+", sparseA, sparseB, a + b, true},
+        {"-", sparseA, denseB, a - b, false},
+        {"t", sparseA, "", a.transpose(), true},
+        {"det", sparseA, "", {{a.det()}}, false},
+        {"inv", sparseA, "", a.inverse(), false},
+    };
+    for (const Case &c : cases)
+    {
+        {
+            std::ofstream file("test_suite/valid.txt");
+            file << c.op << "\n" << c.first << "\n" << c.second;
+        }
+        for (bool mmap : {false, true})
+        {
+            CalculatorOptions options;
+            options.mmap = mmap;
+            Args args("test_suite/valid.txt");
+            Calculator<float> calc(args.args, options);
+            auto res = calc.compute();
+            EXPECT_EQ(res.isSparse, c.sparse) << c.op;
+            EXPECT_EQ(res.toDense(), c.expected) << c.op;
+        }
+
+        // Разреженный результат печатается в формате coo, который снова
+        // читается калькулятором
+        if (!c.sparse)
+            continue;
+        auto res = calculate<float>("test_suite/valid.txt");
+        std::ostringstream out;
+        writeResult(out, res, CalculatorOptions());
+        {
+            std::ofstream file("test_suite/valid.txt");
+            file << "t\n" << out.str();
+        }
+        EXPECT_EQ(calculate<float>("test_suite/valid.txt").toDense(),
+                  c.expected.transpose())
+            << c.op;
+    }
+
+    for (std::string bad : {"coo 2 2 1 0 0", "coo 2 2 1 2 0 1", "coo 2 2 -1",
+                            "cool 2 2 0"})
+    {
+        {
+            std::ofstream file("test_suite/valid.txt");
+            file << "t\n" << bad;
+        }
+        Args args("test_suite/valid.txt");
+        EXPECT_ANY_THROW(Calculator<float>(args.args)) << bad;
+    }
+    try
+    {
+        calculate<float>("test_suite/valid.txt");
+        ADD_FAILURE() << "cool isn't an operand format";
+    }
+    catch (std::runtime_error &e)
+    {
+        EXPECT_EQ(std::string(e.what()),
+                  "error: unknown operand format \"cool\"");
+    }
+}
+
+TEST(TestUtil, TestTokenReader)
+{
+    // Маленький буфер, чтобы лексемы попадали на границы блоков, и лексема
+    // длиннее буфера
+    std::string text = "  12 -3.5\n\t1e10   abc\r\n0123456789012345678901 x ";
+    std::vector<std::string> expected = {"12",  "-3.5", "1e10",
+                                         "abc", "0123456789012345678901", "x"};
+
+    for (std::size_t size : {2, 3, 5, 8, 1 << 20})
+    {
+        std::stringstream stream(text);
+        TokenReader reader(stream, size);
+        std::vector<std::string> tokens;
+        const char *begin, *end;
+        while (reader.next(begin, end))
+            tokens.emplace_back(begin, end);
+        EXPECT_EQ(tokens, expected) << "buffer size " << size;
+    }
+
+    // Чтение участка памяти без копирования
+    TokenReader memory(text.data(), text.data() + text.size());
+    std::vector<std::string> tokens;
+    const char *first, *last;
+    while (memory.next(first, last))
+    {
+        EXPECT_TRUE(first >= text.data() && last <= text.data() + text.size());
+        tokens.emplace_back(first, last);
+    }
+    EXPECT_EQ(tokens, expected);
+
+    std::stringstream empty(" \n ");
+    TokenReader reader(empty);
+    const char *begin, *end;
+    EXPECT_FALSE(reader.next(begin, end));
+}
+
+TEST(TestUtil, TestParseNumberMatchesStd)
+{
+    // Быстрый путь, strtod-путь и ошибки должны вести себя как std::sto*
+    std::vector<std::string> cases = {
+        "0", "-0", "1", "-17", "+42", "3.25", "-0.001", ".5", "5.", "1e10",
+        "1.5e-7", "2E+3", "123456789012345678", "0.1", "0.3", "9007199254740993",
+        "1.7976931348623157e308", "4.9e-324", "1e-400", "1e400", "inf", "-nan",
+        "0x1p3", "12abc", "1.5e", "1e+", "-", ".", "abc", "", "2147483647",
+        "2147483648", "-2147483648", "-2147483649", "3.4028235e38", "1e39",
+        "0.000000000000000000000000000001", "123456.789e-3"};
+
+    for (const auto &str : cases)
+    {
+        const char *first = str.data(), *last = str.data() + str.size();
+
+        double d = 0, dRef = 0;
+        bool dOk = detail::parseNumber(first, last, d), dRefOk = true;
+        try { dRef = std::stod(str); } catch (...) { dRefOk = false; }
+        EXPECT_EQ(dOk, dRefOk) << str;
+        if (dOk && dRefOk && !std::isnan(dRef))
+        {
+            EXPECT_EQ(d, dRef) << str;
+        }
+
+        float f = 0, fRef = 0;
+        bool fOk = detail::parseNumber(first, last, f), fRefOk = true;
+        try { fRef = std::stof(str); } catch (...) { fRefOk = false; }
+        EXPECT_EQ(fOk, fRefOk) << str;
+        if (fOk && fRefOk && !std::isnan(fRef))
+        {
+            EXPECT_EQ(f, fRef) << str;
+        }
+
+        int i = 0, iRef = 0;
+        bool iOk = detail::parseNumber(first, last, i), iRefOk = true;
+        try { iRef = std::stoi(str); } catch (...) { iRefOk = false; }
+        EXPECT_EQ(iOk, iRefOk) << str;
+        if (iOk && iRefOk)
+        {
+            EXPECT_EQ(i, iRef) << str;
+        }
+    }
+
+    std::stringstream stream("7 x");
+    TokenReader reader(stream);
+    EXPECT_EQ(getFromTokens<int>(reader, "bad"), 7);
+    EXPECT_THROW(getFromTokens<double>(reader, "bad"), std::runtime_error);
+    EXPECT_THROW(getFromTokens<double>(reader, "bad"), std::runtime_error);
+}
+
+TEST(TestUtil, TestResultWriter)
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(-1e3, 1e3);
+    std::vector<double> values = {0,    -0.0, 1,      -17,    1e6,   123456,
+                                  1e15, 1e16, 0.1,    1.0 / 3, 2.5e-8, 1e300,
+                                  5e-324, std::numeric_limits<double>::infinity(),
+                                  -std::numeric_limits<double>::infinity()};
+    for (int i = 0; i < 200; ++i)
+        values.push_back(dist(gen));
+
+    char buf[detail::maxNumberLength];
+    for (double v : values)
+    {
+        // Точность > 0 - как у std::ostream
+        for (int precision : {1, 6, 10, 17, 25})
+        {
+            std::ostringstream ref;
+            ref.precision(precision);
+            ref << v;
+            EXPECT_EQ(std::string(buf, detail::formatNumber(v, precision, buf)),
+                      ref.str());
+
+            float f = float(v);
+            std::ostringstream refFloat;
+            refFloat.precision(precision);
+            refFloat << f;
+            EXPECT_EQ(std::string(buf, detail::formatNumber(f, precision, buf)),
+                      refFloat.str());
+        }
+
+        // Кратчайшая запись разбирается обратно в то же число
+        std::string shortest(buf, detail::formatNumber(v, 0, buf));
+        EXPECT_EQ(std::strtod(shortest.c_str(), nullptr), v) << shortest;
+        EXPECT_LE(shortest.size(), 24u);
+
+        float f = float(v);
+        std::string shortestFloat(buf, detail::formatNumber(f, 0, buf));
+        EXPECT_EQ(std::strtof(shortestFloat.c_str(), nullptr), f)
+            << shortestFloat;
+    }
+    EXPECT_EQ(std::string(buf, detail::formatNumber(0.1, 0, buf)), "0.1");
+    EXPECT_EQ(std::string(buf, detail::formatNumber(0.1f, 0, buf)), "0.1");
+    EXPECT_EQ(std::string(buf, detail::formatNumber(-2147483647 - 1, 0, buf)),
+              "-2147483648");
+
+    // Вывод матрицы через маленький буфер совпадает с прежним выводом
+    MatrixGeneric<double> a = {{1.5, -2, 1.0 / 3}, {4e10, 5, 6}};
+    std::ostringstream ref;
+    for (uint32_t i = 0; i < a.height(); ++i)
+    {
+        for (uint32_t j = 0; j < a.width(); ++j)
+            ref << a.get(i, j) << " ";
+        ref << std::endl;
+    }
+    std::ostringstream out;
+    {
+        ResultWriter writer(out, 6, 8);
+        writer.writeMatrix(a);
+    }
+    EXPECT_EQ(out.str(), ref.str());
+
+    // Строки с выравниванием печатаются без заполнителя
+    AlignedMatrix<double> padded = {{1, 2, 3}, {4, 5, 6}};
+    ASSERT_GT(padded.stride(), padded.width());
+    std::ostringstream paddedOut;
+    {
+        ResultWriter writer(paddedOut);
+        writer.writeMatrix(padded);
+    }
+    EXPECT_EQ(paddedOut.str(), "1 2 3 \n4 5 6 \n");
+}
+
+TEST(TestUtil, TestBatch)
+{
+    const std::string dir = "test_suite/batch";
+    ::mkdir(dir.c_str(), 0755);
+
+    MatrixGeneric<float> a = {{1, 2}, {3, 4}}, empty;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 12; ++i)
+    {
+        std::string path = dir + "/problem" + std::to_string(i / 10) +
+                           std::to_string(i % 10) + ".txt";
+        std::ofstream file(path);
+        file << "pow " << i << "\n2 2\n1 2\n3 4\n";
+
+        std::ostringstream out;
+        writeResult(out, a.pow(i), CalculatorOptions());
+        expected.push_back(out.str());
+    }
+    {
+        std::ofstream bad(dir + "/problem12.txt");
+        bad << "inv\n2 2\n1 2\n2 4\n";
+    }
+    {
+        // Результат прошлого запуска не считается задачей
+        std::ofstream old(dir + "/problem12.txt.out");
+    }
+
+    std::stringstream noManifest;
+    auto files = collectBatchFiles({dir}, noManifest);
+    ASSERT_EQ(files.size(), 13u);
+    EXPECT_EQ(files[0], dir + "/problem00.txt");
+    EXPECT_EQ(files[12], dir + "/problem12.txt");
+
+    std::stringstream manifest(dir + "/problem03.txt\n\n  " + dir +
+                               "/problem05.txt \n");
+    EXPECT_EQ(collectBatchFiles({}, manifest),
+              (std::vector<std::string>{dir + "/problem03.txt",
+                                        dir + "/problem05.txt"}));
+
+    BatchReport report = runBatch<float>(files);
+    EXPECT_EQ(report.failed, 1u);
+    EXPECT_EQ(report.errors[12].find("error while computing"), 0u);
+    for (int i = 0; i < 12; ++i)
+    {
+        EXPECT_TRUE(report.errors[i].empty()) << report.errors[i];
+        std::ifstream out(files[i] + ".out");
+        std::string text((std::istreambuf_iterator<char>(out)), {});
+        EXPECT_EQ(text, expected[i]) << files[i];
+    }
+
+    // Отсутствующий файл - ошибка только для него
+    report = runBatch<float>({dir + "/missing.txt", files[1]});
+    EXPECT_EQ(report.failed, 1u);
+    EXPECT_EQ(report.errors[0], "error: invalid file. See README.md for info");
+}
+
+MatrixGeneric<double> runScript(const std::string &text)
+{
+    Script<double> script;
+    script.parse(text.data(), text.data() + text.size());
+    return script.run();
+}
+
+TEST(TestUtil, TestScript)
+{
+    MatrixGeneric<double> a = {{4, 7}, {2, 6}}, b = {{1, 2}, {3, 4}};
+    MatrixGeneric<double> c = a.inverse() * b + a;
+
+    EXPECT_EQ(runScript("matrix A\n2 2\n4 7\n2 6\n"
+                        "B = [1 2; 3 4]\n"
+                        "C = inv(A) * B + A  # комментарий\n"
+                        "C ^ 2 - 2 * t(C)\n"),
+              MatrixGeneric<double>(c.pow(2) - 2.0 * c.transpose()));
+
+    // Приоритеты, скобки, унарный минус и перенос строки после операции
+    EXPECT_EQ(runScript("A = [1, 2\n3, 4]; B = -A * A +\n (A - A) / 2"),
+              MatrixGeneric<double>(-1.0 * (b * b)));
+    EXPECT_EQ(runScript("x = det([1 2; 3 4]); x * 2 + 1"),
+              MatrixGeneric<double>({{b.det() * 2 + 1}}));
+    EXPECT_EQ(runScript("A = [2 0; 0 2]\nrk(A) * pow(A, 3) / 4"),
+              MatrixGeneric<double>({{4, 0}, {0, 4}}));
+    EXPECT_EQ(runScript("A = [1 2; 3 4]; A = A + A; A"),
+              MatrixGeneric<double>(2.0 * b));
+    EXPECT_EQ(runScript("solve([4 7; 2 6], [1 2; 3 4] + [1 0; 0 1])"),
+              MatrixGeneric<double>(solve(a, b + MatrixGeneric<double>::eye(2))));
+
+    // Двоичный операнд внутри сценария
+    std::stringstream bin;
+    bin << "matrix A ";
+    a.save(bin);
+    bin << "\nA * 2";
+    EXPECT_EQ(runScript(bin.str()), MatrixGeneric<double>(2.0 * a));
+
+    // Ошибки разбора и вычисления
+    for (std::string bad :
+         {"", "A + 1", "A = ", "[1 2; 3]", "[1 2", "inv A", "pow(A)",
+          "solve([1])",
+          "A = [1]; A ^ -1", "A = [1] B", "matrix A 2 2 1 2 3", "1 $ 2",
+          "matrix inv 1 1 1"})
+        EXPECT_THROW(runScript(bad), std::runtime_error) << bad;
+    EXPECT_THROW(runScript("[1 2] + [1; 2]"), matrix_bad_operation);
+    EXPECT_THROW(runScript("inv([1 2; 2 4])"), matrix_bad_inverse);
+    EXPECT_THROW(runScript("solve([1 2; 2 4], [1; 1])"), matrix_bad_operation);
+
+    try
+    {
+        runScript("A = [1]\nB = A +\n\nC)");
+        FAIL();
+    }
+    catch (std::runtime_error &e)
+    {
+        EXPECT_EQ(std::string(e.what()), "line 4: undefined variable near \"C\"");
+    }
+
+    // Сценарий в калькуляторе, в том числе через --mmap
+    {
+        std::ofstream file("test_suite/valid.txt");
+        file << "script\nA = [1 2; 3 4]\n2 * A\n";
+    }
+    for (bool mmap : {false, true})
+    {
+        CalculatorOptions options;
+        options.mmap = mmap;
+        Args args("test_suite/valid.txt");
+        EXPECT_EQ(Calculator<float>(args.args, options).getResult(),
+                  MatrixGeneric<float>({{2, 4}, {6, 8}}));
+    }
+    {
+        std::ofstream file("test_suite/valid.txt");
+        file << "script\nA = [1 2; 3 4]\nB\n";
+    }
+    try
+    {
+        calculate<float>("test_suite/valid.txt");
+        FAIL();
+    }
+    catch (std::runtime_error &e)
+    {
+        EXPECT_EQ(std::string(e.what()),
+                  "error: line 3: undefined variable near \"B\"");
+    }
+}
+
+TEST(TestUtil, TestScriptGraph)
+{
+    auto parse = [](const std::string &text)
+    {
+        Script<double> script;
+        script.parse(text.data(), text.data() + text.size());
+        return script;
+    };
+
+    // Одинаковые подвыражения и переменные вычисляются один раз
+    const std::string ab = "A = [4 7; 2 6]; B = [1 2; 3 4]\n";
+    MatrixGeneric<double> a = {{4, 7}, {2, 6}}, b = {{1, 2}, {3, 4}};
+    Script<double> cse = parse(ab + "inv(A) * B + inv(A) * B");
+    EXPECT_EQ(cse.operationCount(), 3u);
+    EXPECT_EQ(cse.run(), MatrixGeneric<double>(2.0 * (a.inverse() * b)));
+    EXPECT_EQ(parse(ab + "X = A * B; Y = A * B; X - Y").operationCount(), 2u);
+    EXPECT_EQ(parse(ab + "A + B - (B + A)").operationCount(), 2u);
+
+    // Инструкции, от которых не зависит результат, не вычисляются
+    Script<double> dead = parse(ab + "C = inv([1 2; 2 4]); A");
+    EXPECT_EQ(dead.operationCount(), 0u);
+    EXPECT_EQ(dead.run(), a);
+
+    // Цепочки произведений перемножаются в наилучшем порядке
+    std::mt19937 gen(14);
+    std::uniform_int_distribution<int> dist(-3, 3);
+    auto operand = [&](const std::string &name, uint32_t h, uint32_t w,
+                       MatrixGeneric<double> &m)
+    {
+        m = MatrixGeneric<double>(h, w);
+        std::string text = "matrix " + name + " " + std::to_string(h) + " " +
+                           std::to_string(w);
+        for (std::size_t i = 0; i < std::size_t(h) * w; ++i)
+        {
+            m.data()[i] = dist(gen);
+            text += " " + std::to_string(int(m.data()[i]));
+        }
+        return text + "\n";
+    };
+    MatrixGeneric<double> u, v, w, x;
+    std::string chain = operand("U", 20, 1, u) + operand("V", 1, 20, v) +
+                        operand("W", 20, 1, w) + operand("X", 1, 5, x);
+
+    // U * V * W = U * (V * W), и это произведение уже есть в графе
+    Script<double> reordered = parse(chain + "U * V * W + U * (V * W)");
+    EXPECT_EQ(reordered.operationCount(), 3u);
+    EXPECT_EQ(reordered.run(), MatrixGeneric<double>(2.0 * (u * v * w)));
+
+    EXPECT_EQ(parse(chain + "U * V * W * X").run(),
+              MatrixGeneric<double>(u * v * w * x));
+
+    // Общее произведение остается отдельным множителем
+    Script<double> shared = parse(chain + "P = U * V; P * W * V + P");
+    EXPECT_EQ(shared.operationCount(), 4u);
+    EXPECT_EQ(shared.run(), MatrixGeneric<double>(u * v * w * v + u * v));
+
+    // Скаляры, неизвестные размеры и ошибки
+    EXPECT_EQ(parse(chain + "2 * V * W * 3").run(),
+              MatrixGeneric<double>(6.0 * (v * w)));
+    EXPECT_EQ(parse(chain + "det(V * U) * V * U * V").run(),
+              MatrixGeneric<double>((v * u).det() * (v * u * v)));
+    EXPECT_THROW(parse(chain + "U * W * V").run(), matrix_bad_operation);
+}